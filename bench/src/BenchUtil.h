@@ -0,0 +1,71 @@
+#ifndef BENCHUTIL_H
+#define BENCHUTIL_H
+
+// Timing and reporting shared by the in-process benchmarks.
+
+static inline int64_t monotonicNs()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static inline void printPercentiles(const char* name, vector<int64_t>& values)
+{
+	if (values.empty()) {
+		printf("%-24s no samples\n", name);
+		return;
+	}
+	std::sort(values.begin(), values.end());
+	size_t n = values.size();
+	printf("%-24s n=%-8zu p50=%8.0f ns  p99=%8.0f ns  p99.9=%8.0f ns  max=%8.0f ns\n", name, n,
+		(double)values[n / 2], (double)values[n * 99 / 100], (double)values[n * 999 / 1000], (double)values[n - 1]);
+}
+
+static inline bool withinBudget(const char* name, double ns, double budgetNs)
+{
+	printf("%-24s %.1f ns per op, budget %.0f ns: %s\n", name, ns, budgetNs, ns <= budgetNs ? "ok" : "OVER");
+	return ns <= budgetNs;
+}
+
+typedef bool (*_benchFunction)(int64_t n);
+
+typedef struct {
+	const char* name;
+	_benchFunction bench;
+	int64_t n;
+} BenchCase;
+
+// Runs the cases named on the command line, all of them when none is;
+// -n overrides the operation count of every case.
+static inline int runBenches(const BenchCase benches[], int argc, char* argv[])
+{
+	int64_t count = 0;
+	int opt;
+	while ((opt = getopt(argc, argv, "n:h")) != -1) {
+		switch (opt) {
+		case 'n': count = atoll(optarg); break;
+		default:
+			fprintf(stderr, "usage: %s [-n count] [case...]\ncases:", argv[0]);
+			for (int i = 0; benches[i].name; i++) {
+				fprintf(stderr, " %s", benches[i].name);
+			}
+			fprintf(stderr, "\n");
+			return 1;
+		}
+	}
+
+	bool passed = true;
+	for (int i = 0; benches[i].name; i++) {
+		bool selected = optind == argc;
+		for (int j = optind; j < argc; j++) {
+			selected |= strcmp(argv[j], benches[i].name) == 0;
+		}
+		if (selected) {
+			passed = benches[i].bench(count > 0 ? count : benches[i].n) && passed;
+		}
+	}
+	return passed ? 0 : 1;
+}
+
+#endif
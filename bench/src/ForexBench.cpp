@@ -0,0 +1,328 @@
+﻿/*
+* Copyright 2020 FXDaemon
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+// Times the libForexApi modules in process against the mocked ForexConnect
+// readers and session of test/forex. Each case prints its cost per operation
+// and fails the run when it misses its budget.
+#include "stdafx.h"
+#include "DepthBook.h"
+#include "TableListener.h"
+#include "MarketCalendar.h"
+#include "ForexMocks.h"
+#include "ForexPlugin.h"
+#include "BenchUtil.h"
+
+// The depth book before its ladders were fixed arrays: a map of ladders by
+// originator name, a set of the touched ladders per batch, and the depth
+// rebuilt by inserting every level of every ladder.
+class COldDepthBook
+{
+private:
+	typedef struct {
+		TblDepth Depth;
+		map<string, TblDepth> Ladders;
+	} OldSymbolBook;
+
+	vector<OldSymbolBook> m_vtBooks;
+	map<int, size_t> m_mapSymbolIDs;
+	map<string, size_t> m_mapSymbols;
+
+public:
+	void addSymbol(int symbolID, const char* symbol)
+	{
+		OldSymbolBook book;
+		memset(&book.Depth, 0, sizeof(book.Depth));
+		strcpy(book.Depth.Symbol, symbol);
+		m_mapSymbolIDs[symbolID] = m_vtBooks.size();
+		m_mapSymbols[symbol] = m_vtBooks.size();
+		m_vtBooks.push_back(book);
+	}
+
+	void onLevel2MarketData(IO2GLevel2MarketDataUpdatesReader* reader)
+	{
+		set<pair<size_t, string> > touched;
+		set<size_t> changed;
+		for (int i = 0; i < reader->getPriceQuotesCount(); i++) {
+			map<int, size_t>::iterator mpos = m_mapSymbolIDs.find(reader->getSymbolID(i));
+			if (mpos == m_mapSymbolIDs.end()) {
+				continue;
+			}
+			OldSymbolBook& book = m_vtBooks[mpos->second];
+			book.Depth.Time = CTableListener::date2Time(reader->getDateTime(i));
+			changed.insert(mpos->second);
+			for (int j = 0; j < reader->getPricesCount(i); j++) {
+				const char* originator = reader->getOriginator(i, j);
+				string key = originator ? originator : "";
+				TblDepth& ladder = book.Ladders[key];
+				if (touched.insert(make_pair(mpos->second, key)).second) {
+					ladder.BidLevels = 0;
+					ladder.AskLevels = 0;
+				}
+				if (reader->isBid(i, j)) {
+					CDepthBook::insertLevel(ladder.BidRate, ladder.BidAmount, ladder.BidLevels, reader->getRate(i, j), reader->getAmount(i, j), true);
+				}
+				else if (reader->isAsk(i, j)) {
+					CDepthBook::insertLevel(ladder.AskRate, ladder.AskAmount, ladder.AskLevels, reader->getRate(i, j), reader->getAmount(i, j), false);
+				}
+			}
+		}
+		for (set<size_t>::iterator it = changed.begin(); it != changed.end(); it++) {
+			OldSymbolBook& book = m_vtBooks[*it];
+			TblDepth& depth = book.Depth;
+			depth.BidLevels = 0;
+			depth.AskLevels = 0;
+			for (map<string, TblDepth>::iterator lit = book.Ladders.begin(); lit != book.Ladders.end(); lit++) {
+				TblDepth& ladder = lit->second;
+				for (int k = 0; k < ladder.BidLevels; k++) {
+					CDepthBook::insertLevel(depth.BidRate, depth.BidAmount, depth.BidLevels, ladder.BidRate[k], ladder.BidAmount[k], true);
+				}
+				for (int k = 0; k < ladder.AskLevels; k++) {
+					CDepthBook::insertLevel(depth.AskRate, depth.AskAmount, depth.AskLevels, ladder.AskRate[k], ladder.AskAmount[k], false);
+				}
+			}
+		}
+	}
+
+	bool getDepth(const char* symbol, TblDepth* tblDepth)
+	{
+		map<string, size_t>::iterator mpos = m_mapSymbols.find(symbol);
+		if (mpos == m_mapSymbols.end()) {
+			return false;
+		}
+		*tblDepth = m_vtBooks[mpos->second].Depth;
+		return true;
+	}
+};
+
+static const char* DepthSymbols[] = { "EUR/USD", "USD/JPY", "EUR/JPY", "GBP/USD", "AUD/USD", "USD/CHF", "USD/CAD", "NZD/USD" };
+static const char* DepthOriginators[] = { "LP1", "LP2", "LP3", "LP4" };
+
+// Batches of the synthetic feed: each names 2 of the 8 symbols, and each of
+// those with 1 to 4 originators of 10 bid and 10 ask levels in random order.
+static void makeDepthFeed(vector<CMockLevel2Reader>& feed, int64_t& levels)
+{
+	uint32_t seed = 12345;
+	levels = 0;
+	for (size_t b = 0; b < feed.size(); b++) {
+		for (int q = 0; q < 2; q++) {
+			seed = seed * 1664525 + 1013904223;
+			int symbol = (seed >> 16) % 8;
+			feed[b].addQuote(symbol + 1, 45301.5 + b / 86400.0);
+			int originators = 1 + (seed >> 8) % 4;
+			for (int o = 0; o < originators; o++) {
+				for (int k = 0; k < 2 * DEPTH_MAX; k++) {
+					seed = seed * 1664525 + 1013904223;
+					int tick = (seed >> 16) % 40;
+					bool bid = k % 2 == 0;
+					double rate = 1.1 + symbol + (bid ? -tick : tick + 1) * 0.00001;
+					feed[b].addPrice(bid, rate, 100000 * (1 + (seed >> 8) % 5), DepthOriginators[(o + b) % 4]);
+					levels++;
+				}
+			}
+		}
+	}
+}
+
+template <class Book>
+static double runDepth(Book& book, vector<CMockLevel2Reader>& feed, int64_t batches)
+{
+	for (int i = 0; i < 8; i++) {
+		book.addSymbol(i + 1, DepthSymbols[i]);
+	}
+	int64_t t0 = monotonicNs();
+	for (int64_t i = 0; i < batches; i++) {
+		book.onLevel2MarketData(&feed[i % feed.size()]);
+	}
+	return (double)(monotonicNs() - t0);
+}
+
+// Replays n level 2 batches into CDepthBook and into the map-based book it
+// replaced. Budget: the same depth for every symbol, and no slower per level.
+static bool benchDepth(int64_t n)
+{
+	vector<CMockLevel2Reader> feed(1024);
+	int64_t feedLevels;
+	makeDepthFeed(feed, feedLevels);
+	double levels = (double)feedLevels * n / feed.size();
+
+	COldDepthBook oldBook;
+	CDepthBook book;
+	double oldNs = runDepth(oldBook, feed, n) / levels;
+	double newNs = runDepth(book, feed, n) / levels;
+
+	int differ = 0;
+	for (int i = 0; i < 8; i++) {
+		TblDepth oldDepth, depth;
+		if (!oldBook.getDepth(DepthSymbols[i], &oldDepth) || !book.getDepth(DepthSymbols[i], &depth)
+			|| oldDepth.BidLevels != depth.BidLevels || oldDepth.AskLevels != depth.AskLevels || oldDepth.Time != depth.Time
+			|| memcmp(oldDepth.BidRate, depth.BidRate, sizeof(double) * depth.BidLevels) != 0
+			|| memcmp(oldDepth.BidAmount, depth.BidAmount, sizeof(double) * depth.BidLevels) != 0
+			|| memcmp(oldDepth.AskRate, depth.AskRate, sizeof(double) * depth.AskLevels) != 0
+			|| memcmp(oldDepth.AskAmount, depth.AskAmount, sizeof(double) * depth.AskLevels) != 0) {
+			differ++;
+		}
+	}
+	printf("%-24s %lld batches, %.0f levels: map %6.1f ns  arrays %6.1f ns per level  %.1fx, %d symbols differ\n", "depth",
+		(long long)n, levels, oldNs, newNs, oldNs / newNs, differ);
+	return differ == 0 && newNs <= oldNs;
+}
+
+// Keeps the last price sent for each offer.
+class CLastPriceProxy : public IPluginProxy
+{
+public:
+	map<string, TblPrice> m_mapPrices;
+	int64_t m_nPrices;
+
+	CLastPriceProxy() : m_nPrices(0) {}
+
+	bool registerPlugin(const char* /*name*/, IBaseOrder* /*baseOrder*/) { return true; }
+	void onDisconnected() {}
+	void onMessage(MsgLevel /*level*/, const char* /*message*/) {}
+	void onPrice(TableStatus /*status*/, const TblPrice* tblPrice) { m_mapPrices[tblPrice->OfferID] = *tblPrice; m_nPrices++; }
+	void onAccount(TableStatus /*status*/, const TblAccount* /*tblAccount*/) {}
+	void onOrder(TableStatus /*status*/, const TblOrder* /*tblOrder*/) {}
+	void onOpenedTrade(TableStatus /*status*/, const TblTrade* /*tblTrade*/) {}
+	void onClosedTrade(TableStatus /*status*/, const TblTrade* /*tblTrade*/) {}
+};
+
+// Replays n offer updates, in batches of 16 rows over 8 offers, through the
+// raw tables-updates path and through the table listener callbacks. Both
+// merge every row into the same cache, the raw path gains by sending each
+// offer once per batch. Budget: the same last price for every offer, fewer
+// prices sent, and the raw path no slower per row, within 10% of noise.
+static bool benchTables(int64_t n)
+{
+	const int rowsPerBatch = 16;
+	vector<CMockOfferRow> snapshot;
+	for (int i = 0; i < 8; i++) {
+		snapshot.push_back(CMockOfferRow(std::to_string(i + 1).c_str(), DepthSymbols[i], 1.1 + i, 1.1002 + i, 45301.5, false));
+	}
+	vector<CMockOfferRow> rows;
+	uint32_t seed = 12345;
+	for (int i = 0; i < 256 * rowsPerBatch; i++) {
+		seed = seed * 1664525 + 1013904223;
+		int offer = (seed >> 16) % 8;
+		double bid = 1.1 + offer + ((seed >> 8) % 100) * 0.00001;
+		rows.push_back(CMockOfferRow(std::to_string(offer + 1).c_str(), "", bid, bid + 0.0002, 45301.5 + i / 86400.0, true));
+	}
+	vector<CMockTablesUpdatesReader> batches(rows.size() / rowsPerBatch);
+	for (size_t i = 0; i < rows.size(); i++) {
+		batches[i / rowsPerBatch].add(Update, &rows[i]);
+	}
+	int64_t count = n / rowsPerBatch;
+
+	CLastPriceProxy tableProxy, rawProxy;
+	CTrailingStop trailingStop(NULL);
+	CTableListener tableListener(&tableProxy, NULL, &trailingStop);
+	CTableListener rawListener(&rawProxy, NULL, &trailingStop);
+	for (size_t i = 0; i < snapshot.size(); i++) {
+		tableListener.onChanged(snapshot[i].getOfferID(), &snapshot[i]);
+		rawListener.onChanged(snapshot[i].getOfferID(), &snapshot[i]);
+	}
+	tableProxy.m_nPrices = rawProxy.m_nPrices = 0;
+
+	int64_t t0 = monotonicNs();
+	for (int64_t i = 0; i < count; i++) {
+		CMockTablesUpdatesReader& batch = batches[i % batches.size()];
+		for (int j = 0; j < rowsPerBatch; j++) {
+			tableListener.onChanged(NULL, batch.m_vtUpdates[j].Row);
+		}
+	}
+	double tableNs = (double)(monotonicNs() - t0) / (count * rowsPerBatch);
+	t0 = monotonicNs();
+	for (int64_t i = 0; i < count; i++) {
+		rawListener.onTablesUpdates(&batches[i % batches.size()]);
+	}
+	double rawNs = (double)(monotonicNs() - t0) / (count * rowsPerBatch);
+
+	int differ = 0;
+	for (map<string, TblPrice>::iterator it = tableProxy.m_mapPrices.begin(); it != tableProxy.m_mapPrices.end(); it++) {
+		map<string, TblPrice>::iterator rit = rawProxy.m_mapPrices.find(it->first);
+		if (rit == rawProxy.m_mapPrices.end() || rit->second.Bid != it->second.Bid || rit->second.Ask != it->second.Ask
+			|| rit->second.Time != it->second.Time || strcmp(rit->second.Symbol, it->second.Symbol) != 0) {
+			differ++;
+		}
+	}
+	printf("%-24s %lld rows: table listener %6.1f ns  raw %6.1f ns per row  %.1fx, %lld/%lld prices sent, %d offers differ\n", "tables",
+		(long long)(count * rowsPerBatch), tableNs, rawNs, tableNs / rawNs, (long long)tableProxy.m_nPrices, (long long)rawProxy.m_nPrices, differ);
+	return differ == 0 && tableProxy.m_mapPrices.size() == 8 && rawProxy.m_nPrices < tableProxy.m_nPrices && rawNs <= tableNs * 1.1;
+}
+
+// Fetches n days of m1 bars from 2024-01-08 (Monday) through COrder2Go over the
+// mock session, each answer after a 2 ms round trip. The windows go out
+// HistoryConcurrency (4, conf/bench-forexapi.cfg) at a time, so the call costs
+// about a round trip per wave where one window at a time would cost one per
+// window. Budget: every bar the calendar has open, in order, in under half the
+// serial time.
+static bool benchHistory(int64_t n)
+{
+	const time_t start = 1704672000;
+	const time_t end = start + (time_t)n * 86400;
+	const DWORD latencyMs = 2;
+	IBaseOrder* baseOrder = forexPlugin("conf/bench-forexapi.cfg");
+	if (!baseOrder) {
+		printf("%-24s plugin init failed\n", "history");
+		return false;
+	}
+	CMockSession* session = mockSession();
+	session->reset();
+	session->setLatency(latencyMs);
+
+	TblCandle** candles = NULL;
+	int64_t t0 = monotonicNs();
+	int count = baseOrder->getHistoricalData("EUR/USD", "m1", start, end, false, &candles);
+	double ms = (monotonicNs() - t0) / 1e6;
+
+	CMarketCalendar calendar;
+	int expected = 0;
+	int differ = 0;
+	for (time_t t = start + 60; t < end; t += 60) {
+		if (!calendar.isOpen(t)) {
+			continue;
+		}
+		if (expected >= count || candles[expected]->StartDate != t || candles[expected]->BidOpen != CMockSession::barPrice(t)) {
+			differ++;
+		}
+		expected++;
+	}
+	for (int i = 0; i < count; i++) {
+		delete candles[i];
+	}
+	if (count > 0) {
+		delete[] candles;
+	}
+
+	vector<CMockRequest*> sent;
+	session->getSent(sent);
+	int maxInFlight = session->getMaxInFlight();
+	session->reset();
+	double serialMs = (double)sent.size() * latencyMs;
+	printf("%-24s %d bars in %d windows, %d in flight: %7.1f ms  %.0f bars/s, serial %.0f ms  %.1fx, %d bars differ\n", "history",
+		count, (int)sent.size(), maxInFlight, ms, count / (ms / 1000), serialMs, serialMs / ms, differ);
+	return differ == 0 && count == expected && ms < serialMs / 2;
+}
+
+static const BenchCase benches[] = {
+	{ "depth", benchDepth, 200000 },
+	{ "tables", benchTables, 1000000 },
+	{ "history", benchHistory, 30 },
+	{ 0, 0, 0 }
+};
+
+int main(int argc, char* argv[])
+{
+	return runBenches(benches, argc, argv);
+}
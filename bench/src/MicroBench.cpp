@@ -0,0 +1,844 @@
+﻿/*
+* Copyright 2020 FXDaemon
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+// Times the hot paths of the plugin modules in process, with no server or
+// broker. Each case prints its cost per operation and fails the run when it
+// misses its budget.
+#include "stdafx.h"
+#include "Utils.h"
+#include "TickJournal.h"
+#include "CurlImpl.h"
+#include "QuoteCache.h"
+#include "TrailingStop.h"
+#include "BenchUtil.h"
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <thread>
+
+// Counts the heap allocations of the thread that sets allocCounting, in the
+// binary and in the shared libraries it loads (curl, libstdc++).
+extern "C" void* __libc_malloc(size_t size);
+extern "C" void* __libc_calloc(size_t n, size_t size);
+extern "C" void* __libc_realloc(void* ptr, size_t size);
+static __thread bool allocCounting = false;
+static __thread int64_t allocCount = 0;
+
+extern "C" void* malloc(size_t size)
+{
+	if (allocCounting) {
+		allocCount++;
+	}
+	return __libc_malloc(size);
+}
+
+extern "C" void* calloc(size_t n, size_t size)
+{
+	if (allocCounting) {
+		allocCount++;
+	}
+	return __libc_calloc(n, size);
+}
+
+extern "C" void* realloc(void* ptr, size_t size)
+{
+	if (allocCounting) {
+		allocCount++;
+	}
+	return __libc_realloc(ptr, size);
+}
+
+// Appends with the flush thread running, as the plugins do on every price.
+// Budget: 1 us per tick, mean and 99th percentile.
+static bool benchJournal(int64_t n)
+{
+	char path[] = "/tmp/microbench-journal-XXXXXX";
+	if (!mkdtemp(path)) {
+		printf("journal                  can't create %s\n", path);
+		return false;
+	}
+	static const char* symbols[] = { "EUR/USD", "USD/JPY", "EUR/JPY", "GBP/USD", "AUD/USD", "USD/CHF", "USD/CAD", "NZD/USD" };
+	vector<TblPrice> prices(8);
+	for (int i = 0; i < 8; i++) {
+		memset(&prices[i], 0, sizeof(TblPrice));
+		strcpy(prices[i].Symbol, symbols[i]);
+		prices[i].Bid = 1.1 + i;
+		prices[i].Ask = 1.1002 + i;
+	}
+
+	vector<int64_t> ns;
+	ns.reserve(n);
+	int64_t total;
+	{
+		CTickJournal journal((string(path) + "/").c_str(), n, 1000);
+		if (journal.start() != RET_SUCCESS) {
+			printf("journal                  can't open the journal in %s\n", path);
+			return false;
+		}
+		int64_t start = monotonicNs();
+		for (int64_t i = 0; i < n; i++) {
+			TblPrice& tblPrice = prices[i % 8];
+			int64_t nowNs = CTickJournal::getRealtimeNs();
+			tblPrice.Time = (time_t)(nowNs / 1000000000);
+			int64_t t0 = monotonicNs();
+			journal.append(&tblPrice, nowNs);
+			ns.push_back(monotonicNs() - t0);
+		}
+		total = monotonicNs() - start;
+		journal.stop();
+	}
+	string cmd = string("rm -rf ") + path;
+	if (system(cmd.c_str()) != 0) {
+		printf("can't remove %s\n", path);
+	}
+
+	printf("journal                  %lld ticks in %.1f ms\n", (long long)n, total / 1e6);
+	printPercentiles("append", ns);
+	double mean = 0;
+	for (size_t i = 0; i < ns.size(); i++) {
+		mean += ns[i];
+	}
+	mean /= ns.size();
+	bool ok = withinBudget("append mean", mean, 1000);
+	return withinBudget("append p99", (double)ns[ns.size() * 99 / 100], 1000) && ok;
+}
+
+// Templates of restapi-plugin.cfg.
+static const char* OrderPath = "/v3/accounts/$account_id/orders/$order_id";
+static const char* OrderRequest = "{\"order\":{\"timeInForce\":\"GTC\",\"price\":\"$stop\",\"type\":\"STOP_LOSS\",\"tradeID\":\"$trade_id\"}}";
+static const char* PriceRequest = "instruments=$symbols";
+
+// The way requests were built before templates were compiled: a copy of the
+// template and one replace scan per parameter.
+static void replaceParams(const char* text, const vector<ReqParam>& params, string& out)
+{
+	out.assign(text);
+	for (size_t i = 0; i < params.size(); i++) {
+		CUtils::replace(out, params[i].key.c_str(), params[i].value.c_str());
+	}
+}
+
+static void replaceParams(const char* text, const map<string, string>& params, string& out)
+{
+	out.assign(text);
+	for (map<string, string>::const_iterator it = params.begin(); it != params.end(); it++) {
+		CUtils::replace(out, it->first.c_str(), it->second.c_str());
+	}
+}
+
+// ns per build of one request part, with replace scans and with the compiled template.
+static bool compareBuild(const char* name, const char* text, const vector<ReqParam>* params, const map<string, string>* pathParams, int64_t n)
+{
+	CReqTemplate tmpl;
+	tmpl.compile(text);
+	string out;
+	size_t sink = 0;
+	int64_t t0 = monotonicNs();
+	for (int64_t i = 0; i < n; i++) {
+		if (params) {
+			replaceParams(text, *params, out);
+		}
+		else {
+			replaceParams(text, *pathParams, out);
+		}
+		sink += out.size();
+	}
+	double replaceNs = (double)(monotonicNs() - t0) / n;
+	t0 = monotonicNs();
+	for (int64_t i = 0; i < n; i++) {
+		out.clear();
+		if (params) {
+			tmpl.render(params, out);
+		}
+		else {
+			tmpl.render(*pathParams, out);
+		}
+		sink -= out.size();
+	}
+	double compiledNs = (double)(monotonicNs() - t0) / n;
+	printf("%-24s replace %7.1f ns  compiled %7.1f ns  %.1fx%s\n", name, replaceNs, compiledNs, replaceNs / compiledNs, sink ? " (output differs)" : "");
+	return compiledNs <= replaceNs && sink == 0;
+}
+
+// Builds order and poll requests both ways, then whole requests through CCurlImpl.
+// Budget: the compiled templates are never slower than the replace scans.
+static bool benchRequest(int64_t n)
+{
+	map<string, string> pathParams;
+	pathParams["$account_id"] = "101-000-0000000-001";
+	pathParams["$order_id"] = "1234567";
+	vector<ReqParam> orderParams;
+	orderParams.push_back(ReqParam{ "$stop", std::to_string(1.08765) });
+	orderParams.push_back(ReqParam{ "$trade_id", "7654321" });
+	string symbols;
+	for (int i = 0; i < 20; i++) {
+		symbols.append(i > 0 ? "%2C" : "").append("EUR_USD");
+	}
+	vector<ReqParam> priceParams;
+	priceParams.push_back(ReqParam{ "$symbols", symbols });
+
+	bool ok = compareBuild("order path", OrderPath, NULL, &pathParams, n);
+	ok = compareBuild("order body", OrderRequest, &orderParams, NULL, n) && ok;
+	ok = compareBuild("poll query (20 symbols)", PriceRequest, &priceParams, NULL, n) && ok;
+
+	// A change order as the plugin builds it: path, body and URL on a new handle,
+	// and the poll's query on a reused one.
+	curl_global_init(CURL_GLOBAL_ALL);
+	int64_t count = n / 10 > 0 ? n / 10 : 1;
+	int64_t t0 = monotonicNs();
+	for (int64_t i = 0; i < count; i++) {
+		CCurlImpl curlImpl("http://127.0.0.1:18080", false);
+		curlImpl.setPath(OrderPath, pathParams);
+		curlImpl.init("PUT", OrderRequest, false);
+		curlImpl.setEasyPerform(&orderParams);
+	}
+	printf("%-24s %.1f ns per request\n", "order on a new handle", (double)(monotonicNs() - t0) / count);
+	CCurlImpl poll("http://127.0.0.1:18080", false);
+	poll.setPath("/v3/accounts/$account_id/pricing", pathParams);
+	poll.init("GET", PriceRequest, true);
+	t0 = monotonicNs();
+	for (int64_t i = 0; i < n; i++) {
+		poll.setEasyPerform(&priceParams);
+	}
+	printf("%-24s %.1f ns per request\n", "poll on its handle", (double)(monotonicNs() - t0) / n);
+	curl_global_cleanup();
+	return ok;
+}
+
+// Takes the stop changes of the trailing engine, after a simulated broker
+// round trip, and keeps the last stop sent for each trade.
+class CStopBroker : public IBaseOrder
+{
+public:
+	map<string, double> m_mapStops;
+	int64_t m_nChanges;
+	int64_t m_nCalls;
+	long m_lLatencyUs;
+
+	CStopBroker(long latencyUs) : m_nChanges(0), m_nCalls(0), m_lLatencyUs(latencyUs) {}
+
+	int init(const char* /*iniFile*/) { return RET_SUCCESS; }
+	int login() { return RET_SUCCESS; }
+	int close() { return RET_SUCCESS; }
+	time_t getServerTime() { return 0; }
+	int getAccount(const char* /*accountID*/, TblAccount** /*tblAccount*/) { return RET_FAILED; }
+	int getPrice(const char* /*symbols*/[], TblPrice** /*pTblPrice*/[]) { return RET_FAILED; }
+	int getOpenedTrades(TblTrade** /*pTblTrade*/[]) { return RET_FAILED; }
+	int getClosedTrades(TblTrade** /*pTblTrade*/[]) { return RET_FAILED; }
+	int getHistoricalData(const char* /*symbol*/, const char* /*period*/, time_t /*start*/, time_t /*end*/, bool /*maxRange*/, TblCandle** /*pTblCandle*/[]) { return RET_FAILED; }
+	int openMarketOrder(TblOrder* /*tblOrder*/) { return RET_FAILED; }
+	int changeStopLoss(TblTrade* /*tblTrade*/) { return RET_FAILED; }
+	int changeTakeProfit(TblTrade* /*tblTrade*/) { return RET_FAILED; }
+	int closeTrade(TblTrade* /*tblTrade*/) { return RET_FAILED; }
+	int openMarketOrders(TblOrder* /*tblOrders*/[]) { return RET_FAILED; }
+	int changeTakeProfits(TblTrade* /*tblTrades*/[]) { return RET_FAILED; }
+	int closeTrades(TblTrade* /*tblTrades*/[]) { return RET_FAILED; }
+	int getDepth(const char* /*symbol*/, TblDepth** /*tblDepth*/) { return RET_FAILED; }
+	int setTrailingStop(TblTrade* /*tblTrade*/, double /*distance*/, double /*step*/) { return RET_FAILED; }
+	int removeTrailingStop(TblTrade* /*tblTrade*/) { return RET_FAILED; }
+	int subscribe(const char* /*symbols*/[]) { return RET_SUCCESS; }
+	int unsubscribe(const char* /*symbols*/[]) { return RET_SUCCESS; }
+
+	int changeStopLosses(TblTrade* tblTrades[])
+	{
+		if (m_lLatencyUs > 0) {
+			usleep(m_lLatencyUs);
+		}
+		int count = 0;
+		for (; tblTrades[count]; count++) {
+			m_mapStops[tblTrades[count]->TradeID] = tblTrades[count]->Stop;
+		}
+		m_nChanges += count;
+		m_nCalls++;
+		return count;
+	}
+};
+
+static const char* TrailSymbols[] = { "EUR/USD", "USD/JPY", "EUR/JPY", "GBP/USD", "AUD/USD", "USD/CHF", "USD/CAD", "NZD/USD" };
+static const int TrailsPerSymbol = 16;
+
+// Writes n ticks of a random walk on 8 symbols to a tick journal of 2024-01-10.
+static bool writeTickFile(const char* path, int64_t n, int64_t& day)
+{
+	const int64_t NsPerDay = (int64_t)86400 * 1000000000;
+	const int64_t StartNs = (int64_t)1704844800 * 1000000000;
+	day = StartNs / NsPerDay;
+	CTickJournal journal(path, n, 1000);
+	if (journal.start() != RET_SUCCESS) {
+		return false;
+	}
+	TblPrice prices[8];
+	for (int i = 0; i < 8; i++) {
+		memset(&prices[i], 0, sizeof(TblPrice));
+		strcpy(prices[i].Symbol, TrailSymbols[i]);
+		prices[i].Bid = 1.1 + i;
+		prices[i].Ask = prices[i].Bid + 0.0002;
+	}
+	uint32_t seed = 12345;
+	for (int64_t i = 0; i < n; i++) {
+		TblPrice& tblPrice = prices[i % 8];
+		seed = seed * 1664525 + 1013904223;
+		double move = ((int)(seed >> 16) % 11 - 5) * 0.00001;
+		tblPrice.Bid += move;
+		tblPrice.Ask += move;
+		int64_t recvNs = StartNs + i * 1000000;
+		tblPrice.Time = (time_t)(recvNs / 1000000000);
+		journal.append(&tblPrice, recvNs);
+	}
+	journal.stop();
+	return true;
+}
+
+// Replays the tick file into an engine with 16 trails per symbol, half of
+// them buys. Inline, each due stop is flushed on its tick as the replay plugin
+// does; threaded, the send thread of the engine takes them as the REST and
+// Forex plugins do. Returns the ns of each onPrice.
+static bool replayTrails(const CTickJournalReader& reader, CStopBroker& broker, bool threaded, vector<int64_t>& ns)
+{
+	CTrailingStop trailingStop(&broker);
+	for (int i = 0; i < 8; i++) {
+		for (int j = 0; j < TrailsPerSymbol; j++) {
+			TblTrade tblTrade;
+			memset(&tblTrade, 0, sizeof(tblTrade));
+			snprintf(tblTrade.TradeID, sizeof(tblTrade.TradeID), "%d", i * TrailsPerSymbol + j);
+			strcpy(tblTrade.Symbol, TrailSymbols[i]);
+			strcpy(tblTrade.BS, j % 2 == 0 ? "B" : "S");
+			trailingStop.add(&tblTrade, 0.0005 * (1 + j / 2), 0.0001 * (1 + j % 4));
+		}
+	}
+	if (threaded && trailingStop.start() != RET_SUCCESS) {
+		return false;
+	}
+
+	ns.reserve(reader.size());
+	TblPrice tblPrice;
+	memset(&tblPrice, 0, sizeof(tblPrice));
+	for (uint64_t i = 0; i < reader.size(); i++) {
+		const TickRecord* tick = reader.get(i);
+		strcpy(tblPrice.Symbol, reader.getSymbol(tick->SymbolID));
+		tblPrice.Bid = tick->Bid;
+		tblPrice.Ask = tick->Ask;
+		tblPrice.Time = (time_t)(tick->RecvTimeNs / 1000000000);
+		int64_t t0 = monotonicNs();
+		bool pending = trailingStop.onPrice(&tblPrice);
+		ns.push_back(monotonicNs() - t0);
+		if (pending && !threaded) {
+			trailingStop.flush();
+		}
+	}
+	trailingStop.stop();
+	trailingStop.flush();
+	return true;
+}
+
+// Replays n ticks through the trailing engine, inline and with its send thread
+// against a broker taking 200 us per change call.
+// Budget: 1 us per tick on average, the threaded run ends on the same stops
+// with no more changes than the inline one.
+static bool benchTrailing(int64_t n)
+{
+	char path[] = "/tmp/microbench-trailing-XXXXXX";
+	if (!mkdtemp(path)) {
+		printf("trailing                 can't create %s\n", path);
+		return false;
+	}
+	string dir = string(path) + "/";
+	int64_t day;
+	CTickJournalReader reader;
+	bool ok = writeTickFile(dir.c_str(), n, day) && reader.open(dir.c_str(), day);
+	if (!ok) {
+		printf("trailing                 can't write the tick file in %s\n", path);
+	}
+
+	CStopBroker inlineBroker(0);
+	CStopBroker threadedBroker(200);
+	if (ok) {
+		vector<int64_t> inlineNs, threadedNs;
+		ok = replayTrails(reader, inlineBroker, false, inlineNs) && replayTrails(reader, threadedBroker, true, threadedNs);
+		printf("trailing                 %llu ticks, %d trails\n", (unsigned long long)reader.size(), 8 * TrailsPerSymbol);
+		printPercentiles("onPrice inline", inlineNs);
+		printPercentiles("onPrice threaded", threadedNs);
+		printf("%-24s inline %lld changes in %lld calls, threaded %lld changes in %lld calls\n", "stops sent",
+			(long long)inlineBroker.m_nChanges, (long long)inlineBroker.m_nCalls, (long long)threadedBroker.m_nChanges, (long long)threadedBroker.m_nCalls);
+		bool same = inlineBroker.m_mapStops == threadedBroker.m_mapStops && (int)inlineBroker.m_mapStops.size() == 8 * TrailsPerSymbol;
+		printf("%-24s %s\n", "final stops", same ? "same" : "DIFFER");
+		double mean = 0;
+		for (size_t i = 0; i < inlineNs.size(); i++) {
+			mean += inlineNs[i];
+		}
+		mean /= inlineNs.size() > 0 ? inlineNs.size() : 1;
+		ok = withinBudget("onPrice mean", mean, 1000) && same && threadedBroker.m_nChanges <= inlineBroker.m_nChanges && ok;
+	}
+	reader.close();
+	string cmd = string("rm -rf ") + path;
+	if (system(cmd.c_str()) != 0) {
+		printf("can't remove %s\n", path);
+	}
+	return ok;
+}
+
+// The way timestamps were parsed before the RFC3339 parser: sscanf of the
+// fields, then mktime and the time zone offset, whole seconds only.
+static time_t oldStr2Time(const char* s)
+{
+	struct tm tmCal;
+	memset(&tmCal, 0, sizeof(tmCal));
+	int ret = sscanf(s, "%d-%d-%dT%d:%d:%d",
+		&tmCal.tm_year, &tmCal.tm_mon, &tmCal.tm_mday,
+		&tmCal.tm_hour, &tmCal.tm_min, &tmCal.tm_sec);
+	if (ret != 6) {
+		return 0;
+	}
+	tmCal.tm_year -= 1900;
+	tmCal.tm_mon -= 1;
+	return mktime(&tmCal) - CUtils::getTimeZone();
+}
+
+// Parses broker timestamps, with 9, 6 and no fraction digits, both ways.
+// Budget: every nanosecond timestamp read back exactly, and faster than the old way.
+static bool benchRFC3339(int64_t n)
+{
+	const int Distinct = 4096;
+	vector<string> texts(Distinct);
+	vector<int64_t> expected(Distinct);
+	for (int i = 0; i < Distinct; i++) {
+		time_t t = 1700000000 + (time_t)i * 86413 + (i * 7919) % 86400;
+		int64_t frac = ((int64_t)i * 104729 * 1009) % 1000000000;
+		struct tm tmCal;
+		gmtime_r(&t, &tmCal);
+		char text[64];
+		size_t len = strftime(text, sizeof(text), "%Y-%m-%dT%H:%M:%S", &tmCal);
+		if (i % 3 == 0) {
+			snprintf(text + len, sizeof(text) - len, ".%09lldZ", (long long)frac);
+		}
+		else if (i % 3 == 1) {
+			frac -= frac % 1000;
+			snprintf(text + len, sizeof(text) - len, ".%06lldZ", (long long)(frac / 1000));
+		}
+		else {
+			frac = 0;
+			snprintf(text + len, sizeof(text) - len, "Z");
+		}
+		texts[i] = text;
+		expected[i] = (int64_t)t * 1000000000 + frac;
+	}
+
+	int64_t mismatches = 0;
+	int64_t sink = 0;
+	int64_t t0 = monotonicNs();
+	for (int64_t i = 0; i < n; i++) {
+		sink += oldStr2Time(texts[i % Distinct].c_str());
+	}
+	double oldNs = (double)(monotonicNs() - t0) / n;
+	t0 = monotonicNs();
+	for (int64_t i = 0; i < n; i++) {
+		int64_t ns = CUtils::str2TimeNs(texts[i % Distinct].c_str());
+		mismatches += ns != expected[i % Distinct];
+		sink -= ns / 1000000000;
+	}
+	double newNs = (double)(monotonicNs() - t0) / n;
+	printf("%-24s %lld parses: sscanf+mktime %7.1f ns  parseRFC3339Ns %7.1f ns  %.1fx, %lld mismatches%s\n", "rfc3339", (long long)n,
+		oldNs, newNs, oldNs / newNs, (long long)mismatches, sink ? " (seconds differ)" : "");
+	return mismatches == 0 && sink == 0 && newNs <= oldNs;
+}
+
+// The quote cache before its slots were seqlocks: every get and update
+// takes the one lock.
+class CLockedQuotes
+{
+private:
+	vector<TblPrice> m_vtQuotes;
+	vector<bool> m_vtValid;
+	CCriticalSection m_csQuotes;
+
+public:
+	void update(int id, const TblPrice* tblPrice)
+	{
+		CCriticalSection::Lock l(m_csQuotes);
+		if (id >= (int)m_vtQuotes.size()) {
+			m_vtQuotes.resize(id + 1);
+			m_vtValid.resize(id + 1, false);
+		}
+		m_vtQuotes[id] = *tblPrice;
+		m_vtValid[id] = true;
+	}
+
+	bool get(int id, TblPrice* tblPrice)
+	{
+		CCriticalSection::Lock l(m_csQuotes);
+		if (id < 0 || id >= (int)m_vtQuotes.size() || !m_vtValid[id]) {
+			return false;
+		}
+		*tblPrice = m_vtQuotes[id];
+		return true;
+	}
+};
+
+static const int CacheSymbols = 8;
+
+// Every field the writer sets carries the same count, from the OfferID at the
+// front of the quote to the Reserve at its end, so a torn copy shows.
+static void stampQuote(TblPrice* tblPrice, int64_t k)
+{
+	memcpy(tblPrice->OfferID, &k, sizeof(k));
+	tblPrice->Bid = (double)k;
+	tblPrice->Ask = (double)k + 1;
+	tblPrice->Time = (time_t)k;
+	memcpy(tblPrice->Reserve + sizeof(tblPrice->Reserve) - sizeof(k), &k, sizeof(k));
+}
+
+static bool isTorn(const TblPrice* tblPrice)
+{
+	int64_t front, back;
+	memcpy(&front, tblPrice->OfferID, sizeof(front));
+	memcpy(&back, tblPrice->Reserve + sizeof(tblPrice->Reserve) - sizeof(back), sizeof(back));
+	return front != back || tblPrice->Bid != (double)front || tblPrice->Ask != (double)front + 1 || tblPrice->Time != (time_t)front;
+}
+
+template <class Cache>
+struct CacheRun {
+	Cache* cache;
+	atomic<bool> stop;
+	atomic<int64_t> updates;
+	atomic<int64_t> torn;
+};
+
+template <class Cache>
+static void cacheWriter(CacheRun<Cache>* run)
+{
+	TblPrice tblPrice;
+	memset(&tblPrice, 0, sizeof(tblPrice));
+	int64_t k = 0;
+	while (!run->stop.load(std::memory_order_relaxed)) {
+		k++;
+		stampQuote(&tblPrice, k);
+		run->cache->update((int)(k % CacheSymbols), &tblPrice);
+	}
+	run->updates.store(k);
+}
+
+template <class Cache>
+static void cacheReader(CacheRun<Cache>* run, int64_t n, vector<int64_t>* ns)
+{
+	TblPrice tblPrice;
+	int64_t torn = 0;
+	ns->reserve(n);
+	for (int64_t i = 0; i < n; i++) {
+		int64_t t0 = monotonicNs();
+		bool found = run->cache->get((int)(i % CacheSymbols), &tblPrice);
+		ns->push_back(monotonicNs() - t0);
+		torn += found && isTorn(&tblPrice);
+	}
+	run->torn.fetch_add(torn);
+}
+
+// Runs one writer updating the quotes nonstop against readers that each get n quotes.
+template <class Cache>
+static bool runCache(const char* name, int readers, int64_t n, double& p99)
+{
+	Cache cache;
+	TblPrice tblPrice;
+	memset(&tblPrice, 0, sizeof(tblPrice));
+	for (int i = 0; i < CacheSymbols; i++) {
+		cache.update(i, &tblPrice);
+	}
+	CacheRun<Cache> run;
+	run.cache = &cache;
+	run.stop.store(false);
+	run.updates.store(0);
+	run.torn.store(0);
+
+	std::thread writer(cacheWriter<Cache>, &run);
+	vector<vector<int64_t> > ns(readers);
+	vector<std::thread> threads;
+	int64_t t0 = monotonicNs();
+	for (int i = 0; i < readers; i++) {
+		threads.push_back(std::thread(cacheReader<Cache>, &run, n, &ns[i]));
+	}
+	for (int i = 0; i < readers; i++) {
+		threads[i].join();
+	}
+	double seconds = (monotonicNs() - t0) / 1e9;
+	run.stop.store(true);
+	writer.join();
+
+	vector<int64_t> all;
+	for (int i = 0; i < readers; i++) {
+		all.insert(all.end(), ns[i].begin(), ns[i].end());
+	}
+	char label[64];
+	snprintf(label, sizeof(label), "%s x%d", name, readers);
+	printPercentiles(label, all);
+	p99 = (double)all[all.size() * 99 / 100];
+	printf("%-24s %.1f M gets/s, %.1f M updates/s, %lld torn\n", "", readers * n / seconds / 1e6, run.updates.load() / seconds / 1e6,
+		(long long)run.torn.load());
+	return run.torn.load() == 0;
+}
+
+// One writer against 1, 2, 4 and 8 readers, on CQuoteCache and on the locked
+// cache it replaced. Budget: no torn quote, and a p99 get no slower than the
+// locked one. On a single core the threads only time-slice, so the p99s are
+// printed but not compared.
+static bool benchCache(int64_t n)
+{
+	bool ok = true;
+	bool compare = std::thread::hardware_concurrency() > 1;
+	if (!compare) {
+		printf("cache                    single core, p99s not compared\n");
+	}
+	static const int readers[] = { 1, 2, 4, 8 };
+	for (int i = 0; i < 4; i++) {
+		double lockedP99, seqlockP99;
+		ok = runCache<CLockedQuotes>("locked", readers[i], n, lockedP99) && ok;
+		ok = runCache<CQuoteCache>("seqlock", readers[i], n, seqlockP99) && ok;
+		ok = (!compare || seqlockP99 <= lockedP99) && ok;
+	}
+	return ok;
+}
+
+// Answers every GET on a keep-alive connection with a fixed body: 20 prices
+// on /pricing, 5000 candles on /candles.
+class CPollServer
+{
+private:
+	int m_nListenFd;
+	int m_nPort;
+	string m_sPricing;
+	string m_sCandles;
+
+public:
+	CPollServer() : m_nListenFd(-1), m_nPort(0)
+	{
+		m_sPricing = "{\"prices\":[";
+		for (int i = 0; i < 20; i++) {
+			char price[256];
+			snprintf(price, sizeof(price), "%s{\"instrument\":\"SYM_%02d\",\"time\":\"2024-01-10T12:00:00.123456789Z\","
+				"\"bids\":[{\"price\":\"1.08765\",\"liquidity\":1000000}],\"asks\":[{\"price\":\"1.08775\",\"liquidity\":1000000}],"
+				"\"tradeable\":true}", i > 0 ? "," : "", i);
+			m_sPricing.append(price);
+		}
+		m_sPricing.append("]}");
+		m_sCandles = "{\"instrument\":\"EUR_USD\",\"granularity\":\"M1\",\"candles\":[";
+		for (int i = 0; i < 5000; i++) {
+			char candle[256];
+			snprintf(candle, sizeof(candle), "%s{\"complete\":true,\"volume\":%d,\"time\":\"%d\",\"bid\":{\"o\":\"1.08765\",\"h\":\"1.08795\","
+				"\"l\":\"1.08745\",\"c\":\"1.08775\"},\"ask\":{\"o\":\"1.08775\",\"h\":\"1.08805\",\"l\":\"1.08755\",\"c\":\"1.08785\"}}",
+				i > 0 ? "," : "", 100 + i % 50, 1704888000 + i * 60);
+			m_sCandles.append(candle);
+		}
+		m_sCandles.append("]}");
+	}
+
+	~CPollServer()
+	{
+		if (m_nListenFd >= 0) {
+			close(m_nListenFd);
+		}
+	}
+
+	bool start()
+	{
+		m_nListenFd = socket(AF_INET, SOCK_STREAM, 0);
+		struct sockaddr_in addr;
+		memset(&addr, 0, sizeof(addr));
+		addr.sin_family = AF_INET;
+		addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		socklen_t len = sizeof(addr);
+		if (m_nListenFd < 0 || bind(m_nListenFd, (struct sockaddr*)&addr, len) != 0 || listen(m_nListenFd, 8) != 0
+			|| getsockname(m_nListenFd, (struct sockaddr*)&addr, &len) != 0) {
+			return false;
+		}
+		m_nPort = ntohs(addr.sin_port);
+		std::thread(&CPollServer::run, this).detach();
+		return true;
+	}
+
+	int getPort() const
+	{
+		return m_nPort;
+	}
+
+	size_t getSize(bool candles) const
+	{
+		return candles ? m_sCandles.size() : m_sPricing.size();
+	}
+
+private:
+	void run()
+	{
+		int fd;
+		while ((fd = accept(m_nListenFd, NULL, NULL)) >= 0) {
+			std::thread(&CPollServer::serve, this, fd).detach();
+		}
+	}
+
+	void serve(int fd)
+	{
+		string request;
+		char buf[4096];
+		ssize_t n;
+		while ((n = recv(fd, buf, sizeof(buf), 0)) > 0) {
+			request.append(buf, n);
+			size_t end;
+			while ((end = request.find("\r\n\r\n")) != string::npos) {
+				const string& body = request.find("/candles") < end ? m_sCandles : m_sPricing;
+				char header[256];
+				int len = snprintf(header, sizeof(header), "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nContent-Length: %zu\r\n"
+					"Connection: keep-alive\r\n\r\n", body.size());
+				string response(header, len);
+				response.append(body);
+				for (size_t sent = 0; sent < response.size(); ) {
+					ssize_t w = send(fd, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+					if (w <= 0) {
+						close(fd);
+						return;
+					}
+					sent += w;
+				}
+				request.erase(0, end + 4);
+			}
+		}
+		close(fd);
+	}
+};
+
+// The response buffers as they were before they kept their capacity: a
+// malloc on the first chunk, a realloc on every later one, freed by clear().
+typedef struct {
+	char *buf;
+	size_t size;
+} OldResBuffer;
+
+static size_t oldWriteCallBack(void *contents, size_t size, size_t nmemb, void *buf)
+{
+	size_t realsize = size * nmemb;
+	OldResBuffer *resbuf = (OldResBuffer *)buf;
+	char *ptr;
+
+	if (resbuf->buf) {
+		ptr = (char*)realloc(resbuf->buf, resbuf->size + realsize + 1);
+		if (!ptr) {
+			return 0;
+		}
+	}
+	else {
+		resbuf->size = 0;
+		ptr = (char*)malloc(realsize + 1);
+	}
+
+	memcpy(ptr + resbuf->size, contents, realsize);
+	resbuf->buf = ptr;
+	resbuf->size += realsize;
+	resbuf->buf[resbuf->size] = 0;
+
+	return realsize;
+}
+
+static void oldClear(OldResBuffer *resbuf)
+{
+	free(resbuf->buf);
+	resbuf->buf = NULL;
+	resbuf->size = 0;
+}
+
+// Allocations per poll of one handle after warm-up, with the old buffers when
+// oldBuffers is set. curl's own allocations are counted in both.
+static double pollAllocs(int port, const char* path, int64_t n, bool oldBuffers, size_t& received)
+{
+	char host[64];
+	snprintf(host, sizeof(host), "http://127.0.0.1:%d", port);
+	map<string, string> pathParams;
+	pathParams["$account_id"] = "101-000-0000000-001";
+	vector<ReqParam> priceParams;
+	priceParams.push_back(ReqParam{ "$symbols", "EUR_USD%2CUSD_JPY" });
+	CCurlImpl poll(host, false);
+	poll.setPath(path, pathParams);
+	poll.init("GET", PriceRequest, true);
+	OldResBuffer header = { NULL, 0 };
+	OldResBuffer contents = { NULL, 0 };
+	if (oldBuffers) {
+		curl_easy_setopt(poll.getCurlHandle(), CURLOPT_HEADERFUNCTION, oldWriteCallBack);
+		curl_easy_setopt(poll.getCurlHandle(), CURLOPT_HEADERDATA, &header);
+		curl_easy_setopt(poll.getCurlHandle(), CURLOPT_WRITEFUNCTION, oldWriteCallBack);
+		curl_easy_setopt(poll.getCurlHandle(), CURLOPT_WRITEDATA, &contents);
+	}
+
+	int64_t allocs = 0;
+	received = 0;
+	for (int64_t i = -10; i < n; i++) {
+		allocCount = 0;
+		allocCounting = i >= 0;
+		if (oldBuffers) {
+			oldClear(&header);
+			oldClear(&contents);
+		}
+		poll.setEasyPerform(&priceParams);
+		CURLcode ret = poll.doEasyPerform();
+		allocCounting = false;
+		if (ret != CURLE_OK) {
+			printf("%-24s %s\n", path, curl_easy_strerror(ret));
+			received = 0;
+			break;
+		}
+		allocs += allocCount;
+		received = oldBuffers ? contents.size : poll.getResSize();
+	}
+	oldClear(&header);
+	oldClear(&contents);
+	return n > 0 ? (double)allocs / n : 0;
+}
+
+// Polls a loopback server with the response buffers from before and after
+// they kept their capacity, for a pricing and a candle response.
+// Budget: fewer allocations per poll after than before.
+static bool benchAlloc(int64_t n)
+{
+	CPollServer server;
+	if (!server.start()) {
+		printf("alloc                    can't listen on loopback\n");
+		return false;
+	}
+	curl_global_init(CURL_GLOBAL_ALL);
+	bool ok = true;
+	static const char* paths[] = { "/v3/accounts/$account_id/pricing", "/v3/accounts/$account_id/candles" };
+	static const char* names[] = { "pricing", "candles" };
+	for (int i = 0; i < 2; i++) {
+		size_t expected = server.getSize(i == 1);
+		size_t beforeSize, afterSize;
+		double before = pollAllocs(server.getPort(), paths[i], n, true, beforeSize);
+		double after = pollAllocs(server.getPort(), paths[i], n, false, afterSize);
+		bool passed = beforeSize == expected && afterSize == expected && after < before;
+		printf("%-24s %zu bytes, allocations per poll: before %.1f  after %.1f  saved %.1f: %s\n", names[i], expected,
+			before, after, before - after, passed ? "ok" : "FAILED");
+		ok = passed && ok;
+	}
+	curl_global_cleanup();
+	return ok;
+}
+
+static const BenchCase benches[] = {
+	{ "journal", benchJournal, 1000000 },
+	{ "request", benchRequest, 1000000 },
+	{ "trailing", benchTrailing, 1000000 },
+	{ "rfc3339", benchRFC3339, 1000000 },
+	{ "cache", benchCache, 1000000 },
+	{ "alloc", benchAlloc, 10000 },
+	{ 0, 0, 0 }
+};
+
+int main(int argc, char* argv[])
+{
+	return runBenches(benches, argc, argv);
+}
@@ -0,0 +1,556 @@
+﻿/*
+* Copyright 2020 FXDaemon
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+// Loads libRestApi.so against the stub server and measures it end to end.
+// The driver exports getPluginProxy(), so the plugin binds to the recording proxy
+// below instead of FXDaemon's libPluginProxy.so when it is dlopened.
+#include <pthread.h>
+#include <dlfcn.h>
+#include <sys/resource.h>
+#include <thread>
+#include <mutex>
+#include "stdafx.h"
+#include "IPluginProxy.h"
+#include "curl/curl.h"
+
+typedef struct {
+	int64_t Prices;
+	int64_t Polls;
+	int64_t CpuNs;
+	int64_t Ns;
+} BenchSample;
+
+class CBenchProxy : public IPluginProxy
+{
+public:
+	IBaseOrder* m_pBaseOrder;
+	std::mutex m_mtx;
+	int64_t m_nPrices;
+	int64_t m_nErrors;
+	vector<int64_t> m_vtWireNs;		// server send time to onPrice
+	vector<int64_t> m_vtRecvNs;		// first response byte to onPrice
+	map<string, TblTrade> m_mapTrades;
+	bool m_bVerbose;
+
+	CBenchProxy() : m_pBaseOrder(NULL), m_nPrices(0), m_nErrors(0), m_bVerbose(false) {}
+
+	bool registerPlugin(const char* /*name*/, IBaseOrder* baseOrder) { m_pBaseOrder = baseOrder; return true; }
+	void onDisconnected() {}
+	void onMessage(MsgLevel level, const char* message)
+	{
+		if (level == MSG_ERROR) {
+			std::lock_guard<std::mutex> l(m_mtx);
+			m_nErrors++;
+		}
+		if (m_bVerbose || level == MSG_ERROR) {
+			fprintf(stderr, "[%d] %s\n", level, message);
+		}
+	}
+	void onPrice(TableStatus /*status*/, const TblPrice* tblPrice)
+	{
+		int64_t now = realtimeNs();
+		TblTimeExt ext;
+		std::lock_guard<std::mutex> l(m_mtx);
+		m_nPrices++;
+		if (getTimeExt(tblPrice, &ext)) {
+			m_vtWireNs.push_back(now - ext.TimeNs);
+			m_vtRecvNs.push_back(now - ext.RecvNs);
+		}
+	}
+	void onAccount(TableStatus /*status*/, const TblAccount* /*tblAccount*/) {}
+	void onOrder(TableStatus /*status*/, const TblOrder* /*tblOrder*/) {}
+	void onOpenedTrade(TableStatus status, const TblTrade* tblTrade)
+	{
+		std::lock_guard<std::mutex> l(m_mtx);
+		if (status == TableStatus::ST_DEL) {
+			m_mapTrades.erase(tblTrade->TradeID);
+		}
+		else {
+			m_mapTrades[tblTrade->TradeID] = *tblTrade;
+		}
+	}
+	void onClosedTrade(TableStatus /*status*/, const TblTrade* /*tblTrade*/) {}
+
+	static int64_t realtimeNs()
+	{
+		struct timespec ts;
+		clock_gettime(CLOCK_REALTIME, &ts);
+		return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+	}
+};
+
+static CBenchProxy benchProxy;
+
+extern "C" IPluginProxy* getPluginProxy()
+{
+	return &benchProxy;
+}
+
+static int64_t monotonicNs()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static int64_t cpuNs()
+{
+	struct rusage ru;
+	getrusage(RUSAGE_SELF, &ru);
+	return ((int64_t)ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1000000000 + ((int64_t)ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) * 1000;
+}
+
+static size_t onStatsData(char* data, size_t size, size_t nmemb, void* userp)
+{
+	((string*)userp)->append(data, size * nmemb);
+	return size * nmemb;
+}
+
+// Requests served so far, read from the stub's /stats.
+static int64_t stubRequests(const string& host, const char* endpoint)
+{
+	string body;
+	CURL* curl = curl_easy_init();
+	curl_easy_setopt(curl, CURLOPT_URL, (host + "/stats").c_str());
+	curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, onStatsData);
+	curl_easy_setopt(curl, CURLOPT_WRITEDATA, &body);
+	CURLcode ret = curl_easy_perform(curl);
+	curl_easy_cleanup(curl);
+	if (ret != CURLE_OK) {
+		return -1;
+	}
+	string key = string("\"") + endpoint + "\":";
+	size_t pos = body.find(key);
+	return pos == string::npos ? -1 : atoll(body.c_str() + pos + key.size());
+}
+
+static BenchSample sample(const string& host)
+{
+	BenchSample s;
+	{
+		std::lock_guard<std::mutex> l(benchProxy.m_mtx);
+		s.Prices = benchProxy.m_nPrices;
+	}
+	s.Polls = stubRequests(host, "pricing");
+	s.CpuNs = cpuNs();
+	s.Ns = monotonicNs();
+	return s;
+}
+
+static void printPercentiles(const char* name, vector<int64_t>& values)
+{
+	if (values.empty()) {
+		printf("%-24s no samples\n", name);
+		return;
+	}
+	std::sort(values.begin(), values.end());
+	size_t n = values.size();
+	printf("%-24s n=%-6zu p50=%8.1f us  p90=%8.1f us  p99=%8.1f us  max=%8.1f us\n", name, n,
+		values[n / 2] / 1e3, values[n * 9 / 10] / 1e3, values[n * 99 / 100] / 1e3, values[n - 1] / 1e3);
+}
+
+// The trade as the broker has it now, from a getOpenedTrades request rather than
+// the last poll.
+static bool findTrade(IBaseOrder* baseOrder, const char* tradeID, TblTrade* tblTrade)
+{
+	TblTrade** tblTrades = NULL;
+	int count = baseOrder->getOpenedTrades(&tblTrades);
+	bool found = false;
+	for (int i = 0; i < count; i++) {
+		if (!found && strcmp(tblTrades[i]->TradeID, tradeID) == 0) {
+			*tblTrade = *tblTrades[i];
+			found = true;
+		}
+		delete tblTrades[i];
+	}
+	delete[] tblTrades;
+	return found;
+}
+
+// The newest trade opened since the given set of trade IDs was taken.
+static bool newTrade(const set<string>& before, TblTrade* tblTrade)
+{
+	std::lock_guard<std::mutex> l(benchProxy.m_mtx);
+	for (map<string, TblTrade>::iterator it = benchProxy.m_mapTrades.begin(); it != benchProxy.m_mapTrades.end(); it++) {
+		if (before.find(it->first) == before.end()) {
+			*tblTrade = it->second;
+			return true;
+		}
+	}
+	return false;
+}
+
+// The trade reported by onOpenedTrade for the order that opened it.
+static bool openedBy(const char* orderID, TblTrade* tblTrade)
+{
+	std::lock_guard<std::mutex> l(benchProxy.m_mtx);
+	for (map<string, TblTrade>::iterator it = benchProxy.m_mapTrades.begin(); it != benchProxy.m_mapTrades.end(); it++) {
+		if (strcmp(it->second.OpenOrderID, orderID) == 0) {
+			*tblTrade = it->second;
+			return true;
+		}
+	}
+	return false;
+}
+
+static set<string> tradeIDs()
+{
+	set<string> ids;
+	std::lock_guard<std::mutex> l(benchProxy.m_mtx);
+	for (map<string, TblTrade>::iterator it = benchProxy.m_mapTrades.begin(); it != benchProxy.m_mapTrades.end(); it++) {
+		ids.insert(it->first);
+	}
+	return ids;
+}
+
+static void benchPrices(IBaseOrder* baseOrder, const string& host, vector<const char*>& symbols, int seconds)
+{
+	baseOrder->subscribe(&symbols[0]);
+	sleep(1);
+	{
+		std::lock_guard<std::mutex> l(benchProxy.m_mtx);
+		benchProxy.m_vtWireNs.clear();
+		benchProxy.m_vtRecvNs.clear();
+	}
+
+	BenchSample s0 = sample(host);
+	sleep(seconds);
+	BenchSample s1 = sample(host);
+	baseOrder->unsubscribe(&symbols[0]);
+
+	double elapsed = (s1.Ns - s0.Ns) / 1e9;
+	int64_t polls = s1.Polls - s0.Polls;
+	printf("quotes                   %lld in %.1f s, %.1f quotes/s, %lld polls\n",
+		(long long)(s1.Prices - s0.Prices), elapsed, (s1.Prices - s0.Prices) / elapsed, (long long)polls);
+	if (polls > 0) {
+		printf("cpu per poll             %.1f us\n", (s1.CpuNs - s0.CpuNs) / 1e3 / polls);
+	}
+	std::lock_guard<std::mutex> l(benchProxy.m_mtx);
+	printPercentiles("server send -> onPrice", benchProxy.m_vtWireNs);
+	printPercentiles("first byte -> onPrice", benchProxy.m_vtRecvNs);
+}
+
+static void benchOrders(IBaseOrder* baseOrder, const char* symbol, int count)
+{
+	vector<int64_t> openNs, changeNs, closeNs;
+	int failed = 0;
+	for (int i = 0; i < count; i++) {
+		set<string> before = tradeIDs();
+		TblOrder tblOrder;
+		memset(&tblOrder, 0, sizeof(tblOrder));
+		strcpy(tblOrder.Symbol, symbol);
+		strcpy(tblOrder.BS, "B");
+		tblOrder.Amount = 1000;
+		tblOrder.Stop = 0.5;
+
+		int64_t t0 = monotonicNs();
+		if (baseOrder->openMarketOrder(&tblOrder) != RET_SUCCESS) {
+			failed++;
+			continue;
+		}
+		openNs.push_back(monotonicNs() - t0);
+
+		TblTrade tblTrade;
+		if (!newTrade(before, &tblTrade)) {
+			failed++;
+			continue;
+		}
+		tblTrade.Stop = 0.6;
+		t0 = monotonicNs();
+		if (baseOrder->changeStopLoss(&tblTrade) == RET_SUCCESS) {
+			changeNs.push_back(monotonicNs() - t0);
+		}
+		else {
+			failed++;
+		}
+
+		t0 = monotonicNs();
+		if (baseOrder->closeTrade(&tblTrade) == RET_SUCCESS) {
+			closeNs.push_back(monotonicNs() - t0);
+		}
+		else {
+			failed++;
+		}
+	}
+	printf("orders                   %d round trips, %d failed calls\n", count, failed);
+	printPercentiles("openMarketOrder + SL", openNs);
+	printPercentiles("changeStopLoss", changeNs);
+	printPercentiles("closeTrade", closeNs);
+}
+
+typedef struct {
+	IBaseOrder* BaseOrder;
+	TblTrade Trade;
+	int Result;
+	int64_t Ns;
+} ChangeCall;
+
+static void changeProcess(ChangeCall* call)
+{
+	TblTrade* tblTrades[2] = { &call->Trade, NULL };
+	int64_t t0 = monotonicNs();
+	call->Result = call->BaseOrder->changeStopLosses(tblTrades);
+	call->Ns = monotonicNs() - t0;
+}
+
+// Several callers move the stop of one trade at once; the plugin keeps one change
+// in flight and every caller must still learn the ID of the stop order it ends with.
+static bool benchCoalescing(IBaseOrder* baseOrder, const char* symbol, int callers)
+{
+	set<string> before = tradeIDs();
+	TblOrder tblOrder;
+	memset(&tblOrder, 0, sizeof(tblOrder));
+	strcpy(tblOrder.Symbol, symbol);
+	strcpy(tblOrder.BS, "B");
+	tblOrder.Amount = 1000;
+	tblOrder.Stop = 0.5;
+	TblTrade tblTrade;
+	if (baseOrder->openMarketOrder(&tblOrder) != RET_SUCCESS || !newTrade(before, &tblTrade)) {
+		printf("coalescing               open failed\n");
+		return false;
+	}
+
+	vector<ChangeCall> calls(callers);
+	vector<std::thread> threads;
+	for (int i = 0; i < callers; i++) {
+		calls[i].BaseOrder = baseOrder;
+		calls[i].Trade = tblTrade;
+		calls[i].Trade.Stop = 0.5 + 0.01 * (i + 1);
+		threads.push_back(std::thread(changeProcess, &calls[i]));
+	}
+	vector<int64_t> ns;
+	int succeeded = 0, stale = 0;
+	for (int i = 0; i < callers; i++) {
+		threads[i].join();
+		succeeded += calls[i].Result;
+		ns.push_back(calls[i].Ns);
+	}
+
+	// The last stop order sent is the one the trade has now.
+	TblTrade current;
+	bool found = findTrade(baseOrder, tblTrade.TradeID, &current);
+	baseOrder->closeTrade(&tblTrade);
+	if (!found) {
+		printf("coalescing               trade %s not found after the changes\n", tblTrade.TradeID);
+		return false;
+	}
+	for (int i = 0; i < callers; i++) {
+		if (calls[i].Result > 0 && strcmp(calls[i].Trade.StopOrderID, current.StopOrderID) != 0) {
+			stale++;
+		}
+	}
+	printf("coalescing               %d callers, %d succeeded, %d not holding the current stop order ID %s\n",
+		callers, succeeded, stale, current.StopOrderID);
+	printPercentiles("changeStopLosses", ns);
+	return stale == 0;
+}
+
+enum {
+	MIXED_OPEN,
+	MIXED_CHANGESTOP,
+	MIXED_CHANGELIMIT,
+	MIXED_HISTORY,
+	MIXED_CLOSE,
+	MIXED_COUNT
+};
+
+static const char* MixedNames[MIXED_COUNT] = {
+	"openMarketOrder + SL/TP", "changeStopLoss", "changeTakeProfit", "getHistoricalData", "closeTrade"
+};
+
+// 2024-01-10 12:00 UTC, a Wednesday, so every history window is in trading hours.
+static const time_t MixedHistoryEnd = 1704888000;
+
+typedef struct {
+	IBaseOrder* BaseOrder;
+	const char* Symbol;
+	int Index;
+	int Rounds;
+	int Failed;			// calls that returned a failure
+	int Foreign;		// IDs or rows that are not this caller's
+	vector<int64_t> Ns[MIXED_COUNT];
+} MixedCall;
+
+static bool timed(MixedCall* call, int op, int64_t t0, bool ok)
+{
+	call->Ns[op].push_back(monotonicNs() - t0);
+	if (!ok) {
+		call->Failed++;
+	}
+	return ok;
+}
+
+// Each caller opens trades of its own size, so the trade behind every order ID it
+// gets back shows whose it is, and asks history for windows no other caller asks for.
+static void mixedProcess(MixedCall* call)
+{
+	IBaseOrder* baseOrder = call->BaseOrder;
+	double amount = 1000 + call->Index;
+	for (int round = 0; round < call->Rounds; round++) {
+		TblOrder tblOrder;
+		memset(&tblOrder, 0, sizeof(tblOrder));
+		strcpy(tblOrder.Symbol, call->Symbol);
+		strcpy(tblOrder.BS, "B");
+		tblOrder.Amount = amount;
+		tblOrder.Stop = 0.5;
+		tblOrder.Limit = 2.0;
+		int64_t t0 = monotonicNs();
+		if (!timed(call, MIXED_OPEN, t0, baseOrder->openMarketOrder(&tblOrder) == RET_SUCCESS)) {
+			continue;
+		}
+		TblTrade tblTrade;
+		if (!openedBy(tblOrder.OrderID, &tblTrade) || tblTrade.Amount != amount || strcmp(tblTrade.Symbol, call->Symbol) != 0) {
+			call->Foreign++;
+			continue;
+		}
+
+		tblTrade.Stop = 0.6;
+		t0 = monotonicNs();
+		timed(call, MIXED_CHANGESTOP, t0, baseOrder->changeStopLoss(&tblTrade) == RET_SUCCESS);
+		tblTrade.Limit = 1.9;
+		t0 = monotonicNs();
+		timed(call, MIXED_CHANGELIMIT, t0, baseOrder->changeTakeProfit(&tblTrade) == RET_SUCCESS);
+
+		time_t end = MixedHistoryEnd - (time_t)(call->Index * call->Rounds + round) * 600;
+		TblCandle** tblCandles = NULL;
+		t0 = monotonicNs();
+		int count = baseOrder->getHistoricalData(call->Symbol, "m1", end - 3600, end, false, &tblCandles);
+		if (timed(call, MIXED_HISTORY, t0, count >= 0) && (count != 59 || tblCandles[count - 1]->StartDate != end - 60)) {
+			call->Foreign++;
+		}
+		for (int i = 0; i < count; i++) {
+			delete tblCandles[i];
+		}
+		delete[] tblCandles;
+
+		// The broker's trade holds the stop and limit orders this caller was given.
+		TblTrade current;
+		if (!findTrade(baseOrder, tblTrade.TradeID, &current) || current.Amount != amount
+			|| strcmp(current.StopOrderID, tblTrade.StopOrderID) != 0 || strcmp(current.LimitOrderID, tblTrade.LimitOrderID) != 0) {
+			call->Foreign++;
+		}
+
+		t0 = monotonicNs();
+		timed(call, MIXED_CLOSE, t0, baseOrder->closeTrade(&tblTrade) == RET_SUCCESS);
+	}
+}
+
+// Many callers at once through every trade and history call. Fails when any
+// caller gets back an ID or rows that belong to another.
+static bool benchMixed(IBaseOrder* baseOrder, vector<const char*>& symbols, int callers, int rounds)
+{
+	vector<MixedCall> calls(callers);
+	vector<std::thread> threads;
+	int64_t t0 = monotonicNs();
+	for (int i = 0; i < callers; i++) {
+		calls[i].BaseOrder = baseOrder;
+		calls[i].Symbol = symbols[i % (symbols.size() - 1)];
+		calls[i].Index = i;
+		calls[i].Rounds = rounds;
+		calls[i].Failed = 0;
+		calls[i].Foreign = 0;
+		threads.push_back(std::thread(mixedProcess, &calls[i]));
+	}
+	int failed = 0, foreign = 0;
+	vector<int64_t> ns[MIXED_COUNT];
+	for (int i = 0; i < callers; i++) {
+		threads[i].join();
+		failed += calls[i].Failed;
+		foreign += calls[i].Foreign;
+		for (int op = 0; op < MIXED_COUNT; op++) {
+			ns[op].insert(ns[op].end(), calls[i].Ns[op].begin(), calls[i].Ns[op].end());
+		}
+	}
+	printf("mixed                    %d callers x %d rounds in %.1f s, %d failed calls, %d foreign results\n",
+		callers, rounds, (monotonicNs() - t0) / 1e9, failed, foreign);
+	for (int op = 0; op < MIXED_COUNT; op++) {
+		printPercentiles(MixedNames[op], ns[op]);
+	}
+	return failed == 0 && foreign == 0;
+}
+
+static void usage(const char* prog)
+{
+	fprintf(stderr, "usage: %s [-p libRestApi.so] [-c config] [-H stub_host] [-s symbols] [-d seconds] [-n orders] [-t callers] [-m callers] [-r rounds] [-v]\n", prog);
+}
+
+int main(int argc, char* argv[])
+{
+	string lib = "../libRestApi/release/libRestApi.so";
+	string config = "conf/bench-restapi.cfg";
+	string host = "http://127.0.0.1:18080";
+	string symbolList = "EUR/USD,USD/JPY,EUR/JPY";
+	int seconds = 10, orders = 20, callers = 4, mixedCallers = 32, rounds = 5;
+	int opt;
+	while ((opt = getopt(argc, argv, "p:c:H:s:d:n:t:m:r:vh")) != -1) {
+		switch (opt) {
+		case 'p': lib = optarg; break;
+		case 'c': config = optarg; break;
+		case 'H': host = optarg; break;
+		case 's': symbolList = optarg; break;
+		case 'd': seconds = atoi(optarg); break;
+		case 'n': orders = atoi(optarg); break;
+		case 't': callers = atoi(optarg); break;
+		case 'm': mixedCallers = atoi(optarg); break;
+		case 'r': rounds = atoi(optarg); break;
+		case 'v': benchProxy.m_bVerbose = true; break;
+		default: usage(argv[0]); return 1;
+		}
+	}
+
+	void* handle = dlopen(lib.c_str(), RTLD_NOW | RTLD_GLOBAL);
+	if (!handle) {
+		fprintf(stderr, "dlopen failed: %s\n", dlerror());
+		return 1;
+	}
+	IBaseOrder* baseOrder = benchProxy.m_pBaseOrder;
+	if (!baseOrder) {
+		fprintf(stderr, "%s registered no plugin\n", lib.c_str());
+		return 1;
+	}
+	if (baseOrder->init(config.c_str()) != RET_SUCCESS || baseOrder->login() != RET_SUCCESS) {
+		fprintf(stderr, "plugin init/login failed\n");
+		return 1;
+	}
+
+	vector<string> symbolNames;
+	size_t start = 0, pos;
+	while ((pos = symbolList.find(',', start)) != string::npos) {
+		symbolNames.push_back(symbolList.substr(start, pos - start));
+		start = pos + 1;
+	}
+	symbolNames.push_back(symbolList.substr(start));
+	vector<const char*> symbols;
+	for (size_t i = 0; i < symbolNames.size(); i++) {
+		symbols.push_back(symbolNames[i].c_str());
+	}
+	symbols.push_back(NULL);
+
+	benchPrices(baseOrder, host, symbols, seconds);
+	if (orders > 0) {
+		benchOrders(baseOrder, symbols[0], orders);
+	}
+	bool passed = true;
+	if (callers > 1) {
+		passed = benchCoalescing(baseOrder, symbols[0], callers);
+	}
+	if (mixedCallers > 0) {
+		passed = benchMixed(baseOrder, symbols, mixedCallers, rounds) && passed;
+	}
+	printf("plugin errors            %lld\n", (long long)benchProxy.m_nErrors);
+
+	baseOrder->close();
+	return passed ? 0 : 1;
+}
@@ -0,0 +1,721 @@
+﻿/*
+* Copyright 2020 FXDaemon
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+// A local stand-in for the OANDA v20 REST API, answering the paths and response
+// fields of restapi-plugin.cfg so COrder2Rest can be exercised without a broker.
+// Every response is delayed by Latency +/- Jitter milliseconds, ErrorRate of the
+// requests are answered 503, and the row counts and Padding bytes per row set
+// the payload size. GET /stats returns the number of requests per endpoint.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <random>
+#include <atomic>
+#include <thread>
+using namespace std;
+
+typedef struct {
+	int Port;
+	int Latency;		// ms
+	int Jitter;			// ms
+	double ErrorRate;	// 0..1
+	int OpenTrades;		// synthetic rows besides the trades opened through the stub
+	int ClosedTrades;
+	int Candles;		// rows per candles request
+	int Padding;		// bytes added to every row
+} StubOptions;
+
+typedef struct {
+	string Method;
+	string Path;
+	map<string, string> Query;
+	string Body;
+	bool KeepAlive;
+} StubRequest;
+
+typedef struct {
+	string ID;
+	string Symbol;
+	long Units;
+	double Price;
+	int64_t OpenNs;
+	string StopOrderID;
+	double Stop;
+	string LimitOrderID;
+	double Limit;
+} StubTrade;
+
+enum {
+	EP_SUMMARY,
+	EP_PRICING,
+	EP_OPENTRADES,
+	EP_CLOSEDTRADES,
+	EP_CANDLES,
+	EP_ORDERS,
+	EP_CHANGEORDER,
+	EP_CLOSETRADE,
+	EP_STATS,
+	EP_UNKNOWN,
+	EP_COUNT
+};
+
+static const char* EndpointNames[EP_COUNT] = {
+	"summary", "pricing", "openTrades", "closedTrades", "candles", "orders", "changeOrder", "closeTrade", "stats", "unknown"
+};
+
+class CStubServer
+{
+private:
+	StubOptions m_Options;
+	string m_sPadding;
+	map<string, double> m_mapMids;
+	mutex m_mtxMids;
+	map<string, StubTrade> m_mapTrades;
+	long m_lNextID;
+	mutex m_mtxState;
+	atomic<long> m_Requests[EP_COUNT];
+	atomic<long> m_lErrors;
+
+public:
+	CStubServer(const StubOptions& options);
+	int run();
+
+private:
+	static void connectionProcess(CStubServer* server, int fd);
+	void serve(int fd);
+	bool readRequest(int fd, string& buffer, StubRequest& request);
+	int endpoint(const StubRequest& request);
+	string respond(int ep, const StubRequest& request);
+	void delay(mt19937& rng);
+
+	string pricing(const string& instruments);
+	string summary(const string& accountID);
+	string openTrades();
+	string closedTrades();
+	string candles(const string& instrument, const StubRequest& request);
+	string postOrder(const string& accountID, const string& body);
+	string changeOrder(const string& accountID, const string& orderID, const string& body);
+	string closeTrade(const string& accountID, const string& tradeID);
+	string stats();
+
+	string nextID();
+	double mid(const string& instrument);
+	static int64_t nowNs();
+	static string rfc3339(int64_t ns);
+	static int64_t parseTime(const string& s);
+	static string num(double value, int digits = 5);
+	static string jsonField(const string& body, const char* key);
+	static string urlDecode(const string& s);
+	static vector<string> split(const string& s, char delimiter);
+};
+
+CStubServer::CStubServer(const StubOptions& options) : m_Options(options), m_lNextID(1000)
+{
+	m_sPadding.assign(options.Padding, 'x');
+	for (int i = 0; i < EP_COUNT; i++) {
+		m_Requests[i] = 0;
+	}
+	m_lErrors = 0;
+}
+
+int CStubServer::run()
+{
+	int fd = socket(AF_INET, SOCK_STREAM, 0);
+	if (fd < 0) {
+		perror("socket");
+		return -1;
+	}
+	int on = 1;
+	setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+
+	struct sockaddr_in addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	addr.sin_port = htons(m_Options.Port);
+	if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(fd, 64) != 0) {
+		perror("bind");
+		close(fd);
+		return -1;
+	}
+	printf("stubserver listening on 127.0.0.1:%d\n", m_Options.Port);
+	fflush(stdout);
+
+	while (true) {
+		int conn = accept(fd, NULL, NULL);
+		if (conn < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			perror("accept");
+			break;
+		}
+		setsockopt(conn, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+		thread(connectionProcess, this, conn).detach();
+	}
+	close(fd);
+	return 0;
+}
+
+void CStubServer::connectionProcess(CStubServer* server, int fd)
+{
+	server->serve(fd);
+	close(fd);
+}
+
+void CStubServer::serve(int fd)
+{
+	mt19937 rng((unsigned)nowNs() ^ (unsigned)fd);
+	uniform_real_distribution<double> dist(0, 1);
+	string buffer;
+	StubRequest request;
+	while (readRequest(fd, buffer, request)) {
+		string body;
+		int status = 200;
+		int ep = endpoint(request);
+		m_Requests[ep]++;
+		if (ep != EP_STATS) {
+			delay(rng);
+		}
+		if (ep != EP_STATS && m_Options.ErrorRate > 0 && dist(rng) < m_Options.ErrorRate) {
+			m_lErrors++;
+			status = 503;
+			body = "{\"errorMessage\":\"Injected error\"}";
+		}
+		else {
+			// Built after the delay, so timestamps are the time of sending.
+			body = respond(ep, request);
+		}
+		if (body.empty() && status == 200) {
+			status = 404;
+			body = "{\"errorMessage\":\"Unknown path " + request.Path + "\"}";
+		}
+
+		char head[256];
+		snprintf(head, sizeof(head), "HTTP/1.1 %d %s\r\nContent-Type: application/json\r\nContent-Length: %zu\r\nConnection: %s\r\n\r\n",
+			status, status == 200 ? "OK" : (status == 404 ? "Not Found" : "Service Unavailable"), body.size(), request.KeepAlive ? "keep-alive" : "close");
+		string response = head + body;
+		size_t sent = 0;
+		while (sent < response.size()) {
+			ssize_t n = send(fd, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+			if (n <= 0) {
+				return;
+			}
+			sent += n;
+		}
+		if (!request.KeepAlive) {
+			return;
+		}
+	}
+}
+
+bool CStubServer::readRequest(int fd, string& buffer, StubRequest& request)
+{
+	size_t end;
+	while ((end = buffer.find("\r\n\r\n")) == string::npos) {
+		char chunk[4096];
+		ssize_t n = recv(fd, chunk, sizeof(chunk), 0);
+		if (n <= 0) {
+			return false;
+		}
+		buffer.append(chunk, n);
+	}
+
+	string head = buffer.substr(0, end);
+	vector<string> lines = split(head, '\n');
+	vector<string> words = split(lines[0], ' ');
+	if (words.size() < 2) {
+		return false;
+	}
+	request.Method = words[0];
+	string target = words[1];
+	request.Query.clear();
+	size_t q = target.find('?');
+	request.Path = target.substr(0, q);
+	if (q != string::npos) {
+		vector<string> params = split(target.substr(q + 1), '&');
+		for (size_t i = 0; i < params.size(); i++) {
+			size_t eq = params[i].find('=');
+			request.Query[params[i].substr(0, eq)] = eq == string::npos ? "" : urlDecode(params[i].substr(eq + 1));
+		}
+	}
+
+	size_t length = 0;
+	request.KeepAlive = true;
+	for (size_t i = 1; i < lines.size(); i++) {
+		string line = lines[i];
+		if (!line.empty() && line[line.size() - 1] == '\r') {
+			line.erase(line.size() - 1);
+		}
+		if (strncasecmp(line.c_str(), "Content-Length:", 15) == 0) {
+			length = strtoul(line.c_str() + 15, NULL, 10);
+		}
+		else if (strncasecmp(line.c_str(), "Connection:", 11) == 0 && strstr(line.c_str(), "close")) {
+			request.KeepAlive = false;
+		}
+	}
+
+	buffer.erase(0, end + 4);
+	while (buffer.size() < length) {
+		char chunk[4096];
+		ssize_t n = recv(fd, chunk, sizeof(chunk), 0);
+		if (n <= 0) {
+			return false;
+		}
+		buffer.append(chunk, n);
+	}
+	request.Body = buffer.substr(0, length);
+	buffer.erase(0, length);
+	return true;
+}
+
+int CStubServer::endpoint(const StubRequest& request)
+{
+	if (request.Path == "/stats") {
+		return EP_STATS;
+	}
+	vector<string> parts = split(request.Path, '/');
+	if (parts.size() < 5 || parts[1] != "v3") {
+		return EP_UNKNOWN;
+	}
+	if (parts[2] == "instruments") {
+		return parts[4] == "candles" && request.Method == "GET" ? EP_CANDLES : EP_UNKNOWN;
+	}
+	if (parts[2] != "accounts") {
+		return EP_UNKNOWN;
+	}
+	if (parts.size() == 5 && request.Method == "GET") {
+		if (parts[4] == "summary") {
+			return EP_SUMMARY;
+		}
+		if (parts[4] == "pricing") {
+			return EP_PRICING;
+		}
+		if (parts[4] == "openTrades") {
+			return EP_OPENTRADES;
+		}
+		if (parts[4] == "trades") {
+			return EP_CLOSEDTRADES;
+		}
+	}
+	if (parts.size() == 5 && parts[4] == "orders" && request.Method == "POST") {
+		return EP_ORDERS;
+	}
+	if (parts.size() == 6 && parts[4] == "orders" && request.Method == "PUT") {
+		return EP_CHANGEORDER;
+	}
+	if (parts.size() == 7 && parts[4] == "trades" && parts[6] == "close" && request.Method == "PUT") {
+		return EP_CLOSETRADE;
+	}
+	return EP_UNKNOWN;
+}
+
+// An empty response is answered 404.
+string CStubServer::respond(int ep, const StubRequest& request)
+{
+	vector<string> parts = split(request.Path, '/');
+	map<string, string>::const_iterator it;
+	switch (ep) {
+	case EP_STATS:
+		return stats();
+	case EP_SUMMARY:
+		return summary(parts[3]);
+	case EP_PRICING:
+		it = request.Query.find("instruments");
+		return pricing(it == request.Query.end() ? "" : it->second);
+	case EP_OPENTRADES:
+		return openTrades();
+	case EP_CLOSEDTRADES:
+		return closedTrades();
+	case EP_CANDLES:
+		return candles(parts[3], request);
+	case EP_ORDERS:
+		return postOrder(parts[3], request.Body);
+	case EP_CHANGEORDER:
+		return changeOrder(parts[3], parts[5], request.Body);
+	case EP_CLOSETRADE:
+		return closeTrade(parts[3], parts[5]);
+	default:
+		return "";
+	}
+}
+
+void CStubServer::delay(mt19937& rng)
+{
+	int ms = m_Options.Latency;
+	if (m_Options.Jitter > 0) {
+		ms += uniform_int_distribution<int>(-m_Options.Jitter, m_Options.Jitter)(rng);
+	}
+	if (ms > 0) {
+		struct timespec ts = { ms / 1000, (ms % 1000) * 1000000L };
+		nanosleep(&ts, NULL);
+	}
+}
+
+string CStubServer::pricing(const string& instruments)
+{
+	int64_t ns = nowNs();
+	string time = rfc3339(ns);
+	vector<string> list = split(instruments, ',');
+	string body = "{\"prices\":[";
+	for (size_t i = 0; i < list.size(); i++) {
+		double m = mid(list[i]);
+		double spread = m > 20 ? 0.012 : 0.00012;
+		if (i > 0) {
+			body += ",";
+		}
+		body += "{\"type\":\"PRICE\",\"instrument\":\"" + list[i] + "\",\"time\":\"" + time +
+			"\",\"closeoutBid\":\"" + num(m - spread / 2) + "\",\"closeoutAsk\":\"" + num(m + spread / 2) +
+			"\",\"tradeable\":true,\"padding\":\"" + m_sPadding + "\"}";
+	}
+	body += "],\"time\":\"" + time + "\"}";
+	return body;
+}
+
+string CStubServer::summary(const string& accountID)
+{
+	double pl = 0;
+	{
+		lock_guard<mutex> l(m_mtxState);
+		for (map<string, StubTrade>::iterator it = m_mapTrades.begin(); it != m_mapTrades.end(); it++) {
+			pl += (mid(it->second.Symbol) - it->second.Price) * it->second.Units;
+		}
+	}
+	return "{\"account\":{\"id\":\"" + accountID + "\",\"alias\":\"stub\",\"currency\":\"USD\",\"balance\":\"100000.0000\"," +
+		"\"pl\":\"0.0000\",\"unrealizedPl\":\"" + num(pl, 4) + "\",\"marginUsed\":\"0.0000\",\"marginAvailable\":\"100000.0000\"," +
+		"\"marginRate\":\"0.02\",\"hedgingEnabled\":false},\"lastTransactionID\":\"" + to_string(m_lNextID) + "\"}";
+}
+
+string CStubServer::openTrades()
+{
+	string body = "{\"trades\":[";
+	int rows = 0;
+	lock_guard<mutex> l(m_mtxState);
+	for (map<string, StubTrade>::iterator it = m_mapTrades.begin(); it != m_mapTrades.end(); it++) {
+		StubTrade& t = it->second;
+		body += string(rows++ > 0 ? "," : "") + "{\"id\":\"" + t.ID + "\",\"instrument\":\"" + t.Symbol + "\",\"price\":\"" + num(t.Price) +
+			"\",\"openTime\":\"" + rfc3339(t.OpenNs) + "\",\"currentUnits\":\"" + to_string(t.Units) +
+			"\",\"unrealizedPL\":\"" + num((mid(t.Symbol) - t.Price) * t.Units, 4) + "\"";
+		if (!t.StopOrderID.empty()) {
+			body += ",\"stopLossOrder\":{\"id\":\"" + t.StopOrderID + "\",\"price\":\"" + num(t.Stop) + "\"}";
+		}
+		if (!t.LimitOrderID.empty()) {
+			body += ",\"takeProfitOrder\":{\"id\":\"" + t.LimitOrderID + "\",\"price\":\"" + num(t.Limit) + "\"}";
+		}
+		body += ",\"padding\":\"" + m_sPadding + "\"}";
+	}
+	string time = rfc3339(nowNs());
+	for (int i = 0; i < m_Options.OpenTrades; i++) {
+		body += string(rows++ > 0 ? "," : "") + "{\"id\":\"" + to_string(i + 1) + "\",\"instrument\":\"EUR_USD\",\"price\":\"1.10000\"," +
+			"\"openTime\":\"" + time + "\",\"currentUnits\":\"1000\",\"unrealizedPL\":\"0.0000\",\"padding\":\"" + m_sPadding + "\"}";
+	}
+	body += "]}";
+	return body;
+}
+
+string CStubServer::closedTrades()
+{
+	string time = rfc3339(nowNs());
+	string body = "{\"trades\":[";
+	for (int i = 0; i < m_Options.ClosedTrades; i++) {
+		body += string(i > 0 ? "," : "") + "{\"id\":\"" + to_string(i + 1) + "\",\"instrument\":\"EUR_USD\",\"price\":\"1.10000\"," +
+			"\"averageClosePrice\":\"1.10100\",\"initialUnits\":\"1000\",\"realizedPL\":\"1.0000\",\"openTime\":\"" + time +
+			"\",\"closeTime\":\"" + time + "\",\"state\":\"CLOSED\",\"padding\":\"" + m_sPadding + "\"}";
+	}
+	body += "]}";
+	return body;
+}
+
+string CStubServer::candles(const string& instrument, const StubRequest& request)
+{
+	static const struct {
+		const char* granularity;
+		int seconds;
+	} granularities[] = {
+		{ "M1", 60 }, { "M5", 300 }, { "M15", 900 }, { "M30", 1800 }, { "H1", 3600 }, { "H4", 14400 },
+		{ "H6", 21600 }, { "H8", 28800 }, { "D", 86400 }, { 0, 0 }
+	};
+	int seconds = 60;
+	map<string, string>::const_iterator git = request.Query.find("granularity");
+	for (int i = 0; git != request.Query.end() && granularities[i].granularity; i++) {
+		if (git->second == granularities[i].granularity) {
+			seconds = granularities[i].seconds;
+		}
+	}
+
+	// Rows end at the requested "to", at now when there is none.
+	int64_t end = nowNs() / 1000000000;
+	map<string, string>::const_iterator tit = request.Query.find("to");
+	if (tit != request.Query.end() && parseTime(tit->second) > 0) {
+		end = parseTime(tit->second);
+	}
+	end -= end % seconds;
+
+	double m = mid(instrument);
+	string body = "{\"instrument\":\"" + instrument + "\",\"granularity\":\"" + (git == request.Query.end() ? "M1" : git->second) + "\",\"candles\":[";
+	for (int i = 0; i < m_Options.Candles; i++) {
+		int64_t start = end - (int64_t)(m_Options.Candles - i) * seconds;
+		string ohlc = "{\"o\":\"" + num(m) + "\",\"h\":\"" + num(m * 1.001) + "\",\"l\":\"" + num(m * 0.999) + "\",\"c\":\"" + num(m) + "\"}";
+		body += string(i > 0 ? "," : "") + "{\"complete\":true,\"volume\":10,\"time\":\"" + rfc3339(start * 1000000000) +
+			"\",\"bid\":" + ohlc + ",\"ask\":" + ohlc + ",\"padding\":\"" + m_sPadding + "\"}";
+	}
+	body += "]}";
+	return body;
+}
+
+string CStubServer::postOrder(const string& accountID, const string& body)
+{
+	string type = jsonField(body, "type");
+	string time = rfc3339(nowNs());
+	lock_guard<mutex> l(m_mtxState);
+	if (type == "MARKET") {
+		StubTrade t;
+		t.ID = nextID();
+		t.Symbol = jsonField(body, "instrument");
+		t.Units = atol(jsonField(body, "units").c_str());
+		t.Price = mid(t.Symbol);
+		t.OpenNs = nowNs();
+		t.Stop = t.Limit = 0;
+		m_mapTrades[t.ID] = t;
+		string orderID = nextID();
+		return "{\"orderFillTransaction\":{\"id\":\"" + t.ID + "\",\"orderID\":\"" + orderID + "\",\"requestID\":\"" + nextID() +
+			"\",\"accountID\":\"" + accountID + "\",\"instrument\":\"" + t.Symbol + "\",\"type\":\"ORDER_FILL\",\"units\":\"" + to_string(t.Units) +
+			"\",\"price\":\"" + num(t.Price) + "\",\"time\":\"" + time + "\",\"pl\":\"0.0000\",\"commission\":\"0.0000\"," +
+			"\"tradeOpened\":{\"tradeID\":\"" + t.ID + "\",\"units\":\"" + to_string(t.Units) + "\",\"price\":\"" + num(t.Price) + "\"}}}";
+	}
+
+	string tradeID = jsonField(body, "tradeID");
+	map<string, StubTrade>::iterator it = m_mapTrades.find(tradeID);
+	if (it == m_mapTrades.end() || (type != "STOP_LOSS" && type != "TAKE_PROFIT")) {
+		return "";
+	}
+	string orderID = nextID();
+	double price = atof(jsonField(body, "price").c_str());
+	if (type == "STOP_LOSS") {
+		it->second.StopOrderID = orderID;
+		it->second.Stop = price;
+	}
+	else {
+		it->second.LimitOrderID = orderID;
+		it->second.Limit = price;
+	}
+	return "{\"orderCreateTransaction\":{\"id\":\"" + orderID + "\",\"requestID\":\"" + nextID() + "\",\"accountID\":\"" + accountID +
+		"\",\"tradeID\":\"" + tradeID + "\",\"type\":\"" + type + "\",\"price\":\"" + num(price) + "\",\"time\":\"" + time + "\"}}";
+}
+
+// Replacing an order cancels it and creates a new one with a new ID, as v20 does.
+string CStubServer::changeOrder(const string& accountID, const string& orderID, const string& body)
+{
+	string type = jsonField(body, "type");
+	string tradeID = jsonField(body, "tradeID");
+	double price = atof(jsonField(body, "price").c_str());
+	lock_guard<mutex> l(m_mtxState);
+	map<string, StubTrade>::iterator it = m_mapTrades.find(tradeID);
+	if (it == m_mapTrades.end()) {
+		return "";
+	}
+	string& current = type == "STOP_LOSS" ? it->second.StopOrderID : it->second.LimitOrderID;
+	if (current != orderID) {
+		return "";
+	}
+	current = nextID();
+	(type == "STOP_LOSS" ? it->second.Stop : it->second.Limit) = price;
+	return "{\"orderCreateTransaction\":{\"id\":\"" + current + "\",\"requestID\":\"" + nextID() + "\",\"accountID\":\"" + accountID +
+		"\",\"tradeID\":\"" + tradeID + "\",\"type\":\"" + type + "\",\"price\":\"" + num(price) + "\",\"time\":\"" + rfc3339(nowNs()) +
+		"\",\"replacesOrderID\":\"" + orderID + "\"}}";
+}
+
+string CStubServer::closeTrade(const string& accountID, const string& tradeID)
+{
+	lock_guard<mutex> l(m_mtxState);
+	map<string, StubTrade>::iterator it = m_mapTrades.find(tradeID);
+	if (it == m_mapTrades.end()) {
+		return "";
+	}
+	StubTrade t = it->second;
+	m_mapTrades.erase(it);
+	double price = mid(t.Symbol);
+	string body = "{\"orderFillTransaction\":{\"id\":\"" + nextID() + "\",\"orderID\":\"" + nextID() + "\",\"requestID\":\"" + nextID() +
+		"\",\"accountID\":\"" + accountID + "\",\"instrument\":\"" + t.Symbol + "\",\"type\":\"ORDER_FILL\",\"units\":\"" + to_string(-t.Units) +
+		"\",\"price\":\"" + num(price) + "\",\"time\":\"" + rfc3339(nowNs()) + "\",\"pl\":\"" + num((price - t.Price) * t.Units, 4) +
+		"\",\"commission\":\"0.0000\",\"tradesClosed\":[{\"tradeID\":\"" + t.ID + "\",\"units\":\"" + to_string(-t.Units) + "\"}]}}";
+	return body;
+}
+
+string CStubServer::stats()
+{
+	string body = "{";
+	for (int i = 0; i < EP_COUNT; i++) {
+		body += "\"" + string(EndpointNames[i]) + "\":" + to_string(m_Requests[i].load()) + ",";
+	}
+	body += "\"errors\":" + to_string(m_lErrors.load()) + "}";
+	return body;
+}
+
+string CStubServer::nextID()
+{
+	return to_string(++m_lNextID);
+}
+
+// A random walk per instrument, each call moves it by up to half a pip.
+double CStubServer::mid(const string& instrument)
+{
+	static __thread unsigned seed = 0;
+	if (seed == 0) {
+		seed = (unsigned)nowNs() | 1;
+	}
+	double step = ((double)rand_r(&seed) / RAND_MAX - 0.5) * 0.0001;
+	lock_guard<mutex> l(m_mtxMids);
+	map<string, double>::iterator it = m_mapMids.find(instrument);
+	if (it == m_mapMids.end()) {
+		double start = instrument.find("JPY") != string::npos ? 150.0 : 1.1;
+		it = m_mapMids.insert(make_pair(instrument, start)).first;
+	}
+	it->second += it->second > 20 ? step * 100 : step;
+	return it->second;
+}
+
+int64_t CStubServer::nowNs()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_REALTIME, &ts);
+	return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+string CStubServer::rfc3339(int64_t ns)
+{
+	time_t sec = (time_t)(ns / 1000000000);
+	struct tm t;
+	gmtime_r(&sec, &t);
+	char buf[64];
+	size_t n = strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%S", &t);
+	snprintf(buf + n, sizeof(buf) - n, ".%09dZ", (int)(ns % 1000000000));
+	return buf;
+}
+
+// Unix seconds, or RFC3339 in UTC with the fraction and zone ignored. 0 if neither.
+int64_t CStubServer::parseTime(const string& s)
+{
+	if (s.find('-') == string::npos) {
+		return atoll(s.c_str());
+	}
+	struct tm t;
+	memset(&t, 0, sizeof(t));
+	if (!strptime(s.c_str(), "%Y-%m-%dT%H:%M:%S", &t)) {
+		return 0;
+	}
+	return timegm(&t);
+}
+
+string CStubServer::num(double value, int digits)
+{
+	char buf[64];
+	snprintf(buf, sizeof(buf), "%.*f", digits, value);
+	return buf;
+}
+
+// The string value of the first "key" in a flat JSON body.
+string CStubServer::jsonField(const string& body, const char* key)
+{
+	string pattern = string("\"") + key + "\"";
+	size_t pos = body.find(pattern);
+	if (pos == string::npos) {
+		return "";
+	}
+	pos = body.find(':', pos + pattern.size());
+	if (pos == string::npos) {
+		return "";
+	}
+	pos = body.find_first_not_of(" \t", pos + 1);
+	if (pos == string::npos) {
+		return "";
+	}
+	if (body[pos] == '"') {
+		size_t end = body.find('"', pos + 1);
+		return body.substr(pos + 1, end == string::npos ? string::npos : end - pos - 1);
+	}
+	size_t end = body.find_first_of(",}", pos);
+	return body.substr(pos, end == string::npos ? string::npos : end - pos);
+}
+
+string CStubServer::urlDecode(const string& s)
+{
+	string out;
+	for (size_t i = 0; i < s.size(); i++) {
+		if (s[i] == '%' && i + 2 < s.size()) {
+			out += (char)strtol(s.substr(i + 1, 2).c_str(), NULL, 16);
+			i += 2;
+		}
+		else {
+			out += s[i] == '+' ? ' ' : s[i];
+		}
+	}
+	return out;
+}
+
+vector<string> CStubServer::split(const string& s, char delimiter)
+{
+	vector<string> parts;
+	size_t start = 0;
+	while (true) {
+		size_t pos = s.find(delimiter, start);
+		parts.push_back(s.substr(start, pos == string::npos ? string::npos : pos - start));
+		if (pos == string::npos) {
+			break;
+		}
+		start = pos + 1;
+	}
+	return parts;
+}
+
+static void usage(const char* prog)
+{
+	fprintf(stderr, "usage: %s [-p port] [-l latency_ms] [-j jitter_ms] [-e error_rate] [-o open_trades] [-c closed_trades] [-n candles] [-s padding_bytes]\n", prog);
+}
+
+int main(int argc, char* argv[])
+{
+	StubOptions options = { 18080, 0, 0, 0, 0, 0, 500, 0 };
+	int opt;
+	while ((opt = getopt(argc, argv, "p:l:j:e:o:c:n:s:h")) != -1) {
+		switch (opt) {
+		case 'p': options.Port = atoi(optarg); break;
+		case 'l': options.Latency = atoi(optarg); break;
+		case 'j': options.Jitter = atoi(optarg); break;
+		case 'e': options.ErrorRate = atof(optarg); break;
+		case 'o': options.OpenTrades = atoi(optarg); break;
+		case 'c': options.ClosedTrades = atoi(optarg); break;
+		case 'n': options.Candles = atoi(optarg); break;
+		case 's': options.Padding = atoi(optarg); break;
+		default: usage(argv[0]); return 1;
+		}
+	}
+	signal(SIGPIPE, SIG_IGN);
+	CStubServer server(options);
+	return server.run() == 0 ? 0 : 1;
+}
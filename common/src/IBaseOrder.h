@@ -22,6 +22,15 @@ public:
 	virtual int changeStopLoss(TblTrade* tblTrade) = 0;
 	virtual int changeTakeProfit(TblTrade* tblTrade) = 0;
 	virtual int closeTrade(TblTrade* tblTrade) = 0;
+	virtual int openMarketOrders(TblOrder* tblOrders[]) = 0;
+	virtual int changeStopLosses(TblTrade* tblTrades[]) = 0;
+	virtual int changeTakeProfits(TblTrade* tblTrades[]) = 0;
+	virtual int closeTrades(TblTrade* tblTrades[]) = 0;
+	virtual int getDepth(const char* symbol, TblDepth** tblDepth) = 0;
+	virtual int setTrailingStop(TblTrade* tblTrade, double distance, double step) = 0;
+	virtual int removeTrailingStop(TblTrade* tblTrade) = 0;
+	virtual int subscribe(const char* symbols[]) = 0;
+	virtual int unsubscribe(const char* symbols[]) = 0;
 };
 
 #endif
@@ -13,7 +13,7 @@ typedef enum {
 class IPluginProxy
 {
 protected:
-	IPluginProxy();
+	IPluginProxy() {};
 public:
 	virtual bool registerPlugin(const char* name, IBaseOrder* baseOrder) = 0;
 	virtual void onDisconnected() = 0;
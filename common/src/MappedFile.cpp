@@ -0,0 +1,137 @@
+﻿/*
+* Copyright 2020 FXDaemon
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include "stdafx.h"
+#include "MappedFile.h"
+
+CMappedFile::CMappedFile()
+{
+#ifdef WIN32
+	m_hFile = INVALID_HANDLE_VALUE;
+	m_hMapping = NULL;
+#else
+	m_nFd = -1;
+#endif
+	m_pBase = NULL;
+	m_nSize = 0;
+}
+
+CMappedFile::~CMappedFile()
+{
+	close();
+}
+
+// A writable file is created or grown to size bytes; a read-only file is
+// mapped as it is when size is 0.
+bool CMappedFile::open(const char* fileName, size_t size, bool writable)
+{
+	close();
+#ifdef WIN32
+	m_hFile = ::CreateFileA(fileName, writable ? GENERIC_READ | GENERIC_WRITE : GENERIC_READ,
+		FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, writable ? OPEN_ALWAYS : OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (m_hFile == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+	LARGE_INTEGER fileSize;
+	if (!::GetFileSizeEx(m_hFile, &fileSize)) {
+		close();
+		return false;
+	}
+	if (size < (size_t)fileSize.QuadPart) {
+		size = (size_t)fileSize.QuadPart;
+	}
+	if (size == 0) {
+		close();
+		return false;
+	}
+	m_hMapping = ::CreateFileMappingA(m_hFile, NULL, writable ? PAGE_READWRITE : PAGE_READONLY,
+		(DWORD)((unsigned long long)size >> 32), (DWORD)(size & 0xFFFFFFFF), NULL);
+	if (!m_hMapping) {
+		close();
+		return false;
+	}
+	m_pBase = (char*)::MapViewOfFile(m_hMapping, writable ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, size);
+#else
+	m_nFd = ::open(fileName, writable ? O_RDWR | O_CREAT : O_RDONLY, 0644);
+	if (m_nFd < 0) {
+		return false;
+	}
+	struct stat st;
+	if (fstat(m_nFd, &st) != 0) {
+		close();
+		return false;
+	}
+	if (size < (size_t)st.st_size) {
+		size = (size_t)st.st_size;
+	}
+	if (size == 0 || (writable && (size_t)st.st_size < size && ftruncate(m_nFd, size) != 0)) {
+		close();
+		return false;
+	}
+	void* base = mmap(NULL, size, writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, m_nFd, 0);
+	m_pBase = base == MAP_FAILED ? NULL : (char*)base;
+#endif
+	if (!m_pBase) {
+		close();
+		return false;
+	}
+	m_nSize = size;
+	return true;
+}
+
+void CMappedFile::close()
+{
+#ifdef WIN32
+	if (m_pBase) {
+		::UnmapViewOfFile(m_pBase);
+	}
+	if (m_hMapping) {
+		::CloseHandle(m_hMapping);
+		m_hMapping = NULL;
+	}
+	if (m_hFile != INVALID_HANDLE_VALUE) {
+		::CloseHandle(m_hFile);
+		m_hFile = INVALID_HANDLE_VALUE;
+	}
+#else
+	if (m_pBase) {
+		munmap(m_pBase, m_nSize);
+	}
+	if (m_nFd >= 0) {
+		::close(m_nFd);
+		m_nFd = -1;
+	}
+#endif
+	m_pBase = NULL;
+	m_nSize = 0;
+}
+
+// An asynchronous flush only schedules the dirty pages for writeback.
+bool CMappedFile::flush(size_t offset, size_t length, bool sync)
+{
+	if (!m_pBase || length == 0) {
+		return true;
+	}
+#ifdef WIN32
+	if (!::FlushViewOfFile(m_pBase + offset, length)) {
+		return false;
+	}
+	return !sync || ::FlushFileBuffers(m_hFile);
+#else
+	size_t page = (size_t)sysconf(_SC_PAGESIZE);
+	size_t begin = offset - offset % page;
+	return msync(m_pBase + begin, length + offset - begin, sync ? MS_SYNC : MS_ASYNC) == 0;
+#endif
+}
@@ -0,0 +1,28 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+class CMappedFile
+{
+private:
+#ifdef WIN32
+	HANDLE m_hFile;
+	HANDLE m_hMapping;
+#else
+	int m_nFd;
+#endif
+	char *m_pBase;
+	size_t m_nSize;
+
+public:
+	CMappedFile();
+	~CMappedFile();
+
+	bool open(const char* fileName, size_t size, bool writable);
+	void close();
+	bool flush(size_t offset, size_t length, bool sync);
+	char* data() const { return m_pBase; };
+	size_t size() const { return m_nSize; };
+	bool isOpen() const { return m_pBase != NULL; };
+};
+
+#endif
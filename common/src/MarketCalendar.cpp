@@ -0,0 +1,276 @@
+﻿/*
+* Copyright 2020 FXDaemon
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include "stdafx.h"
+#include "Utils.h"
+#include "MarketCalendar.h"
+
+static const int64_t SecsPerDay = 86400;
+static const int64_t SecsPerWeek = 7 * SecsPerDay;
+static const int64_t WeekOrigin = 3 * SecsPerDay;	// Sunday 1970-01-04 00:00 UTC
+
+static int64_t weekOf(time_t t)
+{
+	int64_t d = (int64_t)t - WeekOrigin;
+	return d >= 0 ? d / SecsPerWeek : (d + 1) / SecsPerWeek - 1;
+}
+
+CMarketCalendar::CMarketCalendar()
+{
+	setWeek(0, 19, 5, 21);
+}
+
+// Open from openWday openHour to closeWday closeHour UTC (0 = Sunday), the same time means always open.
+void CMarketCalendar::setWeek(int openWday, int openHour, int closeWday, int closeHour)
+{
+	m_nOpenPos = openWday * SecsPerDay + openHour * 3600;
+	m_nClosePos = closeWday * SecsPerDay + closeHour * 3600;
+	m_nWeekOpen = weekTradingBefore(SecsPerWeek);
+	rebuild();
+}
+
+// dates: "2024-12-25,2025-01-01", closed for the whole UTC day.
+int CMarketCalendar::addHolidays(const char* dates)
+{
+	int count = 0;
+	const char* p = dates;
+	while (*p) {
+		int y, m, d;
+		if (sscanf(p, " %d-%d-%d", &y, &m, &d) == 3) {
+			time_t day = (time_t)(CUtils::daysFromCivil(y, m, d) * SecsPerDay);
+			addClosed(day, day + SecsPerDay);
+			count++;
+		}
+		p = strchr(p, ',');
+		if (!p) {
+			break;
+		}
+		p++;
+	}
+	rebuild();
+	return count;
+}
+
+// times: "2024-12-24 18:00,...", closed from then to the end of the UTC day.
+int CMarketCalendar::addEarlyCloses(const char* times)
+{
+	int count = 0;
+	const char* p = times;
+	while (*p) {
+		int y, m, d, hour, min;
+		if (sscanf(p, " %d-%d-%d %d:%d", &y, &m, &d, &hour, &min) == 5) {
+			time_t day = (time_t)(CUtils::daysFromCivil(y, m, d) * SecsPerDay);
+			addClosed(day + hour * 3600 + min * 60, day + SecsPerDay);
+			count++;
+		}
+		p = strchr(p, ',');
+		if (!p) {
+			break;
+		}
+		p++;
+	}
+	rebuild();
+	return count;
+}
+
+bool CMarketCalendar::isOpen(time_t t) const
+{
+	if (!isWeekOpen(t)) {
+		return false;
+	}
+	size_t i = findClosed(t);
+	return i == m_vtClosed.size() || t < m_vtClosed[i].first;
+}
+
+time_t CMarketCalendar::nextOpen(time_t t) const
+{
+	while (true) {
+		t = nextWeekOpen(t);
+		size_t i = findClosed(t);
+		if (i == m_vtClosed.size() || t < m_vtClosed[i].first) {
+			return t;
+		}
+		t = m_vtClosed[i].second;
+	}
+}
+
+time_t CMarketCalendar::tradingSeconds(time_t from, time_t to) const
+{
+	if (to <= from) {
+		return 0;
+	}
+
+	int64_t secs = weekTrading(from, to);
+	size_t first = findClosed(from);
+	size_t last = findClosed(to);
+	if (first < m_vtClosed.size()) {
+		// Closed periods overlapping [from, to): clip the ends, sum the inner ones.
+		if (last > first) {
+			secs -= weekTrading(max(from, m_vtClosed[first].first), m_vtClosed[first].second);
+			secs -= m_vtClosedPrefix[last] - m_vtClosedPrefix[first + 1];
+			if (last < m_vtClosed.size() && m_vtClosed[last].first < to) {
+				secs -= weekTrading(m_vtClosed[last].first, to);
+			}
+		}
+		else if (m_vtClosed[first].first < to) {
+			secs -= weekTrading(max(from, m_vtClosed[first].first), to);
+		}
+	}
+	return (time_t)secs;
+}
+
+// The time at which seconds of trading time have passed since t.
+time_t CMarketCalendar::addTradingSeconds(time_t t, time_t seconds) const
+{
+	if (m_nWeekOpen == 0) {
+		return t;
+	}
+
+	int64_t remaining = seconds;
+	while (true) {
+		t = nextOpen(t);
+		size_t i = findClosed(t);
+		time_t closedStart = i < m_vtClosed.size() ? m_vtClosed[i].first : 0;
+
+		// Whole weeks without a closed period in between.
+		int64_t weeks = remaining / m_nWeekOpen;
+		if (weeks > 0 && (i == m_vtClosed.size() || (int64_t)t + weeks * SecsPerWeek <= closedStart)) {
+			t += (time_t)(weeks * SecsPerWeek);
+			remaining -= weeks * m_nWeekOpen;
+			if (remaining == 0) {
+				return t;
+			}
+			continue;
+		}
+
+		time_t sessionEnd = nextWeekClose(t);
+		if (i < m_vtClosed.size() && closedStart < sessionEnd) {
+			sessionEnd = closedStart;
+		}
+		if (remaining <= (int64_t)sessionEnd - t) {
+			return t + (time_t)remaining;
+		}
+		remaining -= (int64_t)sessionEnd - t;
+		t = sessionEnd;
+	}
+}
+
+// Splits [start, end] into contiguous windows holding span seconds of trading time each.
+void CMarketCalendar::planWindows(time_t start, time_t end, time_t span, vector<pair<time_t, time_t> >& windows) const
+{
+	windows.clear();
+	time_t cur = start;
+	while (cur <= end) {
+		time_t to = span > 0 ? addTradingSeconds(cur, span) : end;
+		if (to >= end || to <= cur) {
+			windows.push_back(make_pair(cur, end));
+			break;
+		}
+		windows.push_back(make_pair(cur, to));
+		cur = to;
+	}
+}
+
+void CMarketCalendar::addClosed(time_t start, time_t end)
+{
+	if (start < end) {
+		m_vtClosed.push_back(make_pair(start, end));
+	}
+}
+
+// Sorts and merges the closed periods and sums the trading time they remove.
+void CMarketCalendar::rebuild()
+{
+	sort(m_vtClosed.begin(), m_vtClosed.end());
+	vector<pair<time_t, time_t> > merged;
+	for (size_t i = 0; i < m_vtClosed.size(); i++) {
+		if (!merged.empty() && m_vtClosed[i].first <= merged.back().second) {
+			merged.back().second = max(merged.back().second, m_vtClosed[i].second);
+		}
+		else {
+			merged.push_back(m_vtClosed[i]);
+		}
+	}
+	m_vtClosed.swap(merged);
+
+	m_vtClosedPrefix.assign(1, 0);
+	for (size_t i = 0; i < m_vtClosed.size(); i++) {
+		m_vtClosedPrefix.push_back(m_vtClosedPrefix.back() + weekTrading(m_vtClosed[i].first, m_vtClosed[i].second));
+	}
+}
+
+// Trading seconds of the weekly rule from the start of a week to pos.
+int64_t CMarketCalendar::weekTradingBefore(int64_t pos) const
+{
+	if (m_nOpenPos == m_nClosePos) {
+		return pos;
+	}
+	if (m_nOpenPos < m_nClosePos) {
+		return max(m_nOpenPos, min(pos, m_nClosePos)) - m_nOpenPos;
+	}
+	return min(pos, m_nClosePos) + max((int64_t)0, pos - m_nOpenPos);
+}
+
+int64_t CMarketCalendar::weekTrading(time_t from, time_t to) const
+{
+	int64_t fromWeek = weekOf(from);
+	int64_t toWeek = weekOf(to);
+	int64_t fromPos = (int64_t)from - WeekOrigin - fromWeek * SecsPerWeek;
+	int64_t toPos = (int64_t)to - WeekOrigin - toWeek * SecsPerWeek;
+	return (toWeek - fromWeek) * m_nWeekOpen + weekTradingBefore(toPos) - weekTradingBefore(fromPos);
+}
+
+bool CMarketCalendar::isWeekOpen(time_t t) const
+{
+	int64_t pos = (int64_t)t - WeekOrigin - weekOf(t) * SecsPerWeek;
+	return weekTradingBefore(pos + 1) > weekTradingBefore(pos);
+}
+
+time_t CMarketCalendar::nextWeekOpen(time_t t) const
+{
+	if (m_nWeekOpen == 0 || isWeekOpen(t)) {
+		return t;
+	}
+	int64_t pos = (int64_t)t - WeekOrigin - weekOf(t) * SecsPerWeek;
+	int64_t wait = m_nOpenPos - pos;
+	return t + (time_t)(wait > 0 ? wait : wait + SecsPerWeek);
+}
+
+// Only called with an open t. Always open markets close at the end of the week.
+time_t CMarketCalendar::nextWeekClose(time_t t) const
+{
+	int64_t pos = (int64_t)t - WeekOrigin - weekOf(t) * SecsPerWeek;
+	if (m_nOpenPos == m_nClosePos) {
+		return t + (time_t)(SecsPerWeek - pos);
+	}
+	int64_t wait = m_nClosePos - pos;
+	return t + (time_t)(wait > 0 ? wait : wait + SecsPerWeek);
+}
+
+// Index of the first closed period ending after t.
+size_t CMarketCalendar::findClosed(time_t t) const
+{
+	size_t lo = 0, hi = m_vtClosed.size();
+	while (lo < hi) {
+		size_t mid = (lo + hi) / 2;
+		if (m_vtClosed[mid].second <= t) {
+			lo = mid + 1;
+		}
+		else {
+			hi = mid;
+		}
+	}
+	return lo;
+}
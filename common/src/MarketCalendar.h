@@ -0,0 +1,39 @@
+#ifndef MARKETCALENDAR_H
+#define MARKETCALENDAR_H
+
+// Trading hours as a weekly open/close rule in UTC minus holidays and early closes.
+// Closed periods are kept sorted with a prefix sum of the trading time they remove,
+// so the queries cost O(1) for the weekly rule plus O(log holidays).
+class CMarketCalendar
+{
+private:
+	int64_t m_nOpenPos;
+	int64_t m_nClosePos;
+	int64_t m_nWeekOpen;
+	vector<pair<time_t, time_t> > m_vtClosed;
+	vector<int64_t> m_vtClosedPrefix;
+
+public:
+	CMarketCalendar();
+
+	void setWeek(int openWday, int openHour, int closeWday, int closeHour);
+	int addHolidays(const char* dates);
+	int addEarlyCloses(const char* times);
+	bool isOpen(time_t t) const;
+	time_t nextOpen(time_t t) const;
+	time_t tradingSeconds(time_t from, time_t to) const;
+	time_t addTradingSeconds(time_t t, time_t seconds) const;
+	void planWindows(time_t start, time_t end, time_t span, vector<pair<time_t, time_t> >& windows) const;
+
+private:
+	void addClosed(time_t start, time_t end);
+	void rebuild();
+	int64_t weekTradingBefore(int64_t pos) const;
+	int64_t weekTrading(time_t from, time_t to) const;
+	bool isWeekOpen(time_t t) const;
+	time_t nextWeekOpen(time_t t) const;
+	time_t nextWeekClose(time_t t) const;
+	size_t findClosed(time_t t) const;
+};
+
+#endif
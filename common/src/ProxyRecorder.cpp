@@ -0,0 +1,179 @@
+﻿/*
+* Copyright 2020 FXDaemon
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include "stdafx.h"
+#include "Utils.h"
+#include "ProxyRecorder.h"
+
+static const char* RecordNames[] = { "Price", "Account", "Order", "OpenedTrade", "ClosedTrade" };
+
+CProxyRecorder::CProxyRecorder(IPluginProxy* pluginProxy, size_t capacity)
+	: m_pPluginProxy(pluginProxy)
+{
+	uint64_t size = 1;
+	while (size < capacity) {
+		size <<= 1;
+	}
+	m_pRing = new RecordSlot[size];
+	for (uint64_t i = 0; i < size; i++) {
+		m_pRing[i].Seq.store(0);
+	}
+	m_nRingMask = size - 1;
+	m_nWriteSeq.store(0);
+
+	for (int i = 0; i < REC_MAX; i++) {
+		m_nCounts[i].store(0);
+		m_nLastTimeNs[i].store(0);
+		for (int j = 0; j < REC_HISTOGRAM_BUCKETS; j++) {
+			m_nHistogram[i][j].store(0);
+		}
+	}
+}
+
+CProxyRecorder::~CProxyRecorder()
+{
+	delete[] m_pRing;
+}
+
+bool CProxyRecorder::registerPlugin(const char* name, IBaseOrder* baseOrder)
+{
+	return m_pPluginProxy->registerPlugin(name, baseOrder);
+}
+
+void CProxyRecorder::onDisconnected()
+{
+	m_pPluginProxy->onDisconnected();
+}
+
+void CProxyRecorder::onMessage(MsgLevel level, const char* message)
+{
+	m_pPluginProxy->onMessage(level, message);
+}
+
+void CProxyRecorder::onPrice(TableStatus status, const TblPrice* tblPrice)
+{
+	record(REC_PRICE, status, tblPrice->Symbol, tblPrice->Bid, tblPrice->Ask);
+	m_pPluginProxy->onPrice(status, tblPrice);
+}
+
+void CProxyRecorder::onAccount(TableStatus status, const TblAccount* tblAccount)
+{
+	record(REC_ACCOUNT, status, tblAccount->AccountID, tblAccount->Balance, tblAccount->Equity);
+	m_pPluginProxy->onAccount(status, tblAccount);
+}
+
+void CProxyRecorder::onOrder(TableStatus status, const TblOrder* tblOrder)
+{
+	record(REC_ORDER, status, tblOrder->OrderID, tblOrder->Rate, tblOrder->Amount);
+	m_pPluginProxy->onOrder(status, tblOrder);
+}
+
+void CProxyRecorder::onOpenedTrade(TableStatus status, const TblTrade* tblTrade)
+{
+	record(REC_OPENEDTRADE, status, tblTrade->TradeID, tblTrade->Open, tblTrade->Close);
+	m_pPluginProxy->onOpenedTrade(status, tblTrade);
+}
+
+void CProxyRecorder::onClosedTrade(TableStatus status, const TblTrade* tblTrade)
+{
+	record(REC_CLOSEDTRADE, status, tblTrade->TradeID, tblTrade->Open, tblTrade->Close);
+	m_pPluginProxy->onClosedTrade(status, tblTrade);
+}
+
+uint64_t CProxyRecorder::getCount(RecordType type) const
+{
+	return m_nCounts[type].load();
+}
+
+// Writes the counts, the inter-arrival histograms (bucket n holds intervals
+// of 2^n..2^(n+1) ns) and the events still held in the ring, oldest first.
+int CProxyRecorder::dump(const char* fileName)
+{
+	FILE* fp = fopen(fileName, "w");
+	if (!fp) {
+		return RET_FAILED;
+	}
+
+	for (int i = 0; i < REC_MAX; i++) {
+		fprintf(fp, "# %s Count:%llu\n", RecordNames[i], (unsigned long long)m_nCounts[i].load());
+		fprintf(fp, "# %s Interval:", RecordNames[i]);
+		for (int j = 0; j < REC_HISTOGRAM_BUCKETS; j++) {
+			fprintf(fp, " %u", m_nHistogram[i][j].load());
+		}
+		fprintf(fp, "\n");
+	}
+
+	uint64_t end = m_nWriteSeq.load(memory_order_acquire);
+	uint64_t begin = end > m_nRingMask + 1 ? end - m_nRingMask - 1 : 0;
+	int count = 0;
+	for (uint64_t seq = begin; seq < end; seq++) {
+		RecordSlot& slot = m_pRing[seq & m_nRingMask];
+		uint64_t before = slot.Seq.load(memory_order_acquire);
+		if (before != seq * 2 + 2) {
+			continue;
+		}
+		int type = slot.Type;
+		int status = slot.Status;
+		int64_t timeNs = slot.TimeNs;
+		char key[sizeof(slot.Key)];
+		memcpy(key, slot.Key, sizeof(key));
+		double value1 = slot.Value1;
+		double value2 = slot.Value2;
+		atomic_thread_fence(memory_order_acquire);
+		if (slot.Seq.load(memory_order_relaxed) != before) {
+			continue;
+		}
+		fprintf(fp, "%lld\t%s\t%d\t%s\t%.6f\t%.6f\n", (long long)timeNs, RecordNames[type], status, key, value1, value2);
+		count++;
+	}
+
+	fclose(fp);
+	return count;
+}
+
+// Producers claim a slot with one fetch_add. The slot sequence is odd while
+// it is being written, so the reader can skip torn or overwritten entries.
+void CProxyRecorder::record(RecordType type, TableStatus status, const char* key, double value1, double value2)
+{
+	int64_t now = CUtils::getMonotonicNs();
+	m_nCounts[type].fetch_add(1, memory_order_relaxed);
+	int64_t last = m_nLastTimeNs[type].exchange(now, memory_order_relaxed);
+	if (last > 0) {
+		m_nHistogram[type][bucketOf(now - last)].fetch_add(1, memory_order_relaxed);
+	}
+
+	uint64_t seq = m_nWriteSeq.fetch_add(1, memory_order_relaxed);
+	RecordSlot& slot = m_pRing[seq & m_nRingMask];
+	slot.Seq.store(seq * 2 + 1, memory_order_relaxed);
+	atomic_thread_fence(memory_order_release);
+	slot.Type = type;
+	slot.Status = status;
+	slot.TimeNs = now;
+	strncpy(slot.Key, key, sizeof(slot.Key) - 1);
+	slot.Key[sizeof(slot.Key) - 1] = '\0';
+	slot.Value1 = value1;
+	slot.Value2 = value2;
+	slot.Seq.store(seq * 2 + 2, memory_order_release);
+}
+
+int CProxyRecorder::bucketOf(int64_t interval)
+{
+	int bucket = 0;
+	while (interval > 1 && bucket < REC_HISTOGRAM_BUCKETS - 1) {
+		interval >>= 1;
+		bucket++;
+	}
+	return bucket;
+}
@@ -0,0 +1,61 @@
+#ifndef PROXYRECORDER_H
+#define PROXYRECORDER_H
+
+#include "IPluginProxy.h"
+
+typedef enum {
+	REC_PRICE = 0,
+	REC_ACCOUNT = 1,
+	REC_ORDER = 2,
+	REC_OPENEDTRADE = 3,
+	REC_CLOSEDTRADE = 4,
+	REC_MAX = 5
+} RecordType;
+
+#define REC_HISTOGRAM_BUCKETS 40
+
+typedef struct {
+	atomic<uint64_t> Seq;
+	int Type;
+	int Status;
+	int64_t TimeNs;
+	char Key[40];
+	double Value1;
+	double Value2;
+} RecordSlot;
+
+// Passes every callback through to the real proxy and keeps the latest
+// events in a ring buffer together with counts and inter-arrival times.
+class CProxyRecorder : public IPluginProxy
+{
+private:
+	IPluginProxy *m_pPluginProxy;
+	RecordSlot *m_pRing;
+	uint64_t m_nRingMask;
+	atomic<uint64_t> m_nWriteSeq;
+	atomic<uint64_t> m_nCounts[REC_MAX];
+	atomic<int64_t> m_nLastTimeNs[REC_MAX];
+	atomic<uint32_t> m_nHistogram[REC_MAX][REC_HISTOGRAM_BUCKETS];
+
+public:
+	CProxyRecorder(IPluginProxy* pluginProxy, size_t capacity);
+	~CProxyRecorder();
+
+	bool registerPlugin(const char* name, IBaseOrder* baseOrder);
+	void onDisconnected();
+	void onMessage(MsgLevel level, const char* message);
+	void onPrice(TableStatus status, const TblPrice* tblPrice);
+	void onAccount(TableStatus status, const TblAccount* tblAccount);
+	void onOrder(TableStatus status, const TblOrder* tblOrder);
+	void onOpenedTrade(TableStatus status, const TblTrade* tblTrade);
+	void onClosedTrade(TableStatus status, const TblTrade* tblTrade);
+
+	uint64_t getCount(RecordType type) const;
+	int dump(const char* fileName);
+
+private:
+	void record(RecordType type, TableStatus status, const char* key, double value1, double value2);
+	static int bucketOf(int64_t interval);
+};
+
+#endif
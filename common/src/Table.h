@@ -2,6 +2,8 @@
 #define TABLE_H
 
 #include <time.h>
+#include <string.h>
+#include <stdint.h>
 
 typedef enum {
 	ST_UNKNOWN = -1,
@@ -10,6 +12,8 @@ typedef enum {
 	ST_DEL = 2
 } TableStatus;
 
+#define DEPTH_MAX 10
+
 struct TblPrice
 {
 	char OfferID[20];
@@ -25,6 +29,19 @@ struct TblPrice
 	char Reserve[120];
 };
 
+struct TblDepth
+{
+	char Symbol[40];
+	int BidLevels;
+	int AskLevels;
+	double BidRate[DEPTH_MAX];
+	double BidAmount[DEPTH_MAX];
+	double AskRate[DEPTH_MAX];
+	double AskAmount[DEPTH_MAX];
+	time_t Time;
+	char Reserve[120];
+};
+
 struct TblCandle
 {
 	char Symbol[40];
@@ -107,4 +124,32 @@ struct TblTrade
 	char Reserve[120];
 };
 
+// Optional nanosecond timestamps kept in the last bytes of the Reserve of
+// TblPrice, TblOrder and TblTrade. Hosts that don't know the tag still see
+// the same struct layout, the Reserve text before it is kept.
+#define TIME_EXT_TAG "TX1"
+
+struct TblTimeExt
+{
+	char Tag[4];
+	int32_t Reserve;
+	int64_t TimeNs;			// broker time, the OpenTime of a trade
+	int64_t CloseTimeNs;	// TblTrade only
+	int64_t RecvNs;			// local time the data was received (REST: first byte of the response)
+};
+
+template<class T> inline void setTimeExt(T* tbl, int64_t timeNs, int64_t closeTimeNs, int64_t recvNs)
+{
+	TblTimeExt ext = { TIME_EXT_TAG, 0, timeNs, closeTimeNs, recvNs };
+	char* p = tbl->Reserve + sizeof(tbl->Reserve) - sizeof(ext);
+	p[-1] = '\0';
+	memcpy(p, &ext, sizeof(ext));
+}
+
+template<class T> inline bool getTimeExt(const T* tbl, TblTimeExt* ext)
+{
+	memcpy(ext, tbl->Reserve + sizeof(tbl->Reserve) - sizeof(*ext), sizeof(*ext));
+	return memcmp(ext->Tag, TIME_EXT_TAG, sizeof(ext->Tag)) == 0;
+}
+
 #endif
@@ -0,0 +1,282 @@
+﻿/*
+* Copyright 2020 FXDaemon
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include "stdafx.h"
+#include "Utils.h"
+#include "TickJournal.h"
+
+static const int64_t NsPerDay = 86400LL * 1000000000LL;
+
+CTickJournal::CTickJournal(const char* path, uint64_t capacity, long flushInterval)
+	: m_sPath(path), m_nCapacity(capacity), m_lFlushInterval(flushInterval)
+{
+	m_pHeader = NULL;
+	m_pRecords = NULL;
+	m_nDay = -1;
+	m_nCount = 0;
+	m_nFlushed = 0;
+	m_nDropped = 0;
+	m_fpSymbols = NULL;
+	m_hExitEvent = nsapi::CreateEvent(NULL, FALSE, FALSE, NULL);
+	ThreadFunAttr threadFunAttr = { flushProcess, this };
+	m_pFlushThread = new CThread(threadFunAttr);
+}
+
+CTickJournal::~CTickJournal()
+{
+	stop();
+	delete m_pFlushThread;
+	nsapi::CloseHandle(m_hExitEvent);
+}
+
+int CTickJournal::start()
+{
+	CCriticalSection::Lock l(m_csJournal);
+	if (!openDay(getRealtimeNs() / NsPerDay)) {
+		return RET_FAILED;
+	}
+	return m_pFlushThread->_start() == 0 ? RET_SUCCESS : RET_FAILED;
+}
+
+void CTickJournal::stop()
+{
+	if (m_pFlushThread->isRunning()) {
+		nsapi::SetEvent(m_hExitEvent);
+		m_pFlushThread->join();
+	}
+	CCriticalSection::Lock l(m_csJournal);
+	closeDay();
+}
+
+void CTickJournal::append(const TblPrice* tblPrice, int64_t recvTimeNs)
+{
+	CCriticalSection::Lock l(m_csJournal);
+	int64_t day = recvTimeNs / NsPerDay;
+	if (day != m_nDay) {
+		closeDay();
+		openDay(day);
+	}
+	if (!m_pRecords || m_nCount >= m_nCapacity) {
+		m_nDropped++;
+		return;
+	}
+
+	TickRecord& record = m_pRecords[m_nCount];
+	record.SymbolID = getSymbolID(tblPrice->Symbol);
+	record.Reserve = 0;
+	record.Bid = tblPrice->Bid;
+	record.Ask = tblPrice->Ask;
+	TblTimeExt ext;
+	record.ServerTimeNs = getTimeExt(tblPrice, &ext) ? ext.TimeNs : (int64_t)tblPrice->Time * 1000000000LL;
+	record.RecvTimeNs = recvTimeNs;
+	m_nCount++;
+}
+
+uint64_t CTickJournal::getDropped()
+{
+	CCriticalSection::Lock l(m_csJournal);
+	return m_nDropped;
+}
+
+int64_t CTickJournal::getRealtimeNs()
+{
+	return CUtils::getRealtimeNs();
+}
+
+string CTickJournal::getFileName(const char* path, int64_t day, const char* ext)
+{
+	tm cal = CUtils::getUTCCal((time_t)(day * 86400));
+	return string(path) + "ticks-" + CUtils::strOfTime(&cal, "%Y%m%d") + ext;
+}
+
+// Reopening the file of the current day continues after the last flushed record.
+bool CTickJournal::openDay(int64_t day)
+{
+	m_nDay = day;
+	m_nCount = 0;
+	m_nFlushed = 0;
+	m_mapSymbolIDs.clear();
+
+	size_t size = sizeof(TickJournalHeader) + m_nCapacity * sizeof(TickRecord);
+	if (!m_MappedFile.open(getFileName(m_sPath.c_str(), day, ".dat").c_str(), size, true)) {
+		return false;
+	}
+	m_pHeader = (TickJournalHeader*)m_MappedFile.data();
+	m_pRecords = (TickRecord*)(m_MappedFile.data() + sizeof(TickJournalHeader));
+	if (m_pHeader->Magic == TICK_JOURNAL_MAGIC && m_pHeader->RecordSize == sizeof(TickRecord) && m_pHeader->Count <= m_nCapacity) {
+		m_nCount = m_pHeader->Count;
+		m_nFlushed = m_nCount;
+	}
+	else {
+		memset(m_pHeader, 0, sizeof(TickJournalHeader));
+		m_pHeader->Magic = TICK_JOURNAL_MAGIC;
+		m_pHeader->RecordSize = sizeof(TickRecord);
+		m_pHeader->Day = day;
+	}
+	m_pHeader->Capacity = m_nCapacity;
+
+	string symFile = getFileName(m_sPath.c_str(), day, ".sym");
+	if (m_nCount > 0) {
+		FILE* fp = fopen(symFile.c_str(), "r");
+		if (fp) {
+			char buf[256];
+			unsigned int id;
+			while (fscanf(fp, "%u\t%255s", &id, buf) == 2) {
+				m_mapSymbolIDs[buf] = id;
+			}
+			fclose(fp);
+		}
+	}
+	m_fpSymbols = fopen(symFile.c_str(), m_nCount > 0 ? "a" : "w");
+	return true;
+}
+
+void CTickJournal::closeDay()
+{
+	if (m_MappedFile.isOpen()) {
+		flush(true);
+		m_MappedFile.close();
+	}
+	if (m_fpSymbols) {
+		fclose(m_fpSymbols);
+		m_fpSymbols = NULL;
+	}
+	m_pHeader = NULL;
+	m_pRecords = NULL;
+}
+
+uint32_t CTickJournal::getSymbolID(const char* symbol)
+{
+	map<string, uint32_t>::iterator mpos = m_mapSymbolIDs.find(symbol);
+	if (mpos != m_mapSymbolIDs.end()) {
+		return mpos->second;
+	}
+	uint32_t id = (uint32_t)m_mapSymbolIDs.size();
+	m_mapSymbolIDs[symbol] = id;
+	if (m_fpSymbols) {
+		fprintf(m_fpSymbols, "%u\t%s\n", id, symbol);
+		fflush(m_fpSymbols);
+	}
+	return id;
+}
+
+// The header count is only advanced after the records it covers were handed
+// to the OS, so a reader never sees a record that was not written.
+void CTickJournal::flush(bool sync)
+{
+	if (!m_pHeader || m_nFlushed == m_nCount) {
+		return;
+	}
+	size_t offset = sizeof(TickJournalHeader) + m_nFlushed * sizeof(TickRecord);
+	m_MappedFile.flush(offset, (m_nCount - m_nFlushed) * sizeof(TickRecord), sync);
+	m_pHeader->Count = m_nCount;
+	m_MappedFile.flush(0, sizeof(TickJournalHeader), sync);
+	m_nFlushed = m_nCount;
+}
+
+void CTickJournal::flushProcess(void* pv)
+{
+	CTickJournal* tickJournal = (CTickJournal*)pv;
+	while (nsapi::WaitForSingleObject(tickJournal->m_hExitEvent, tickJournal->m_lFlushInterval) == WAIT_TIMEOUT) {
+		CCriticalSection::Lock l(tickJournal->m_csJournal);
+		tickJournal->flush(false);
+	}
+}
+
+bool CTickJournalReader::open(const char* path, int64_t day)
+{
+	close();
+	if (!m_MappedFile.open(CTickJournal::getFileName(path, day, ".dat").c_str(), 0, false) ||
+		m_MappedFile.size() < sizeof(TickJournalHeader)) {
+		return false;
+	}
+	const TickJournalHeader* header = (const TickJournalHeader*)m_MappedFile.data();
+	if (header->Magic != TICK_JOURNAL_MAGIC || header->RecordSize != sizeof(TickRecord)) {
+		close();
+		return false;
+	}
+	m_pRecords = (const TickRecord*)(m_MappedFile.data() + sizeof(TickJournalHeader));
+	m_nCount = header->Count;
+	if (sizeof(TickJournalHeader) + m_nCount * sizeof(TickRecord) > m_MappedFile.size()) {
+		m_nCount = (m_MappedFile.size() - sizeof(TickJournalHeader)) / sizeof(TickRecord);
+	}
+
+	FILE* fp = fopen(CTickJournal::getFileName(path, day, ".sym").c_str(), "r");
+	if (fp) {
+		char buf[256];
+		unsigned int id;
+		while (fscanf(fp, "%u\t%255s", &id, buf) == 2) {
+			if (id >= m_vtSymbols.size()) {
+				m_vtSymbols.resize(id + 1);
+			}
+			m_vtSymbols[id] = buf;
+		}
+		fclose(fp);
+	}
+
+	m_vtIndexes.resize(m_vtSymbols.size());
+	for (uint64_t i = 0; i < m_nCount; i++) {
+		if (m_pRecords[i].SymbolID < m_vtIndexes.size()) {
+			m_vtIndexes[m_pRecords[i].SymbolID].push_back(i);
+		}
+	}
+	return true;
+}
+
+void CTickJournalReader::close()
+{
+	m_MappedFile.close();
+	m_pRecords = NULL;
+	m_nCount = 0;
+	m_vtSymbols.clear();
+	m_vtIndexes.clear();
+}
+
+const char* CTickJournalReader::getSymbol(uint32_t symbolID) const
+{
+	return symbolID < m_vtSymbols.size() ? m_vtSymbols[symbolID].c_str() : NULL;
+}
+
+int CTickJournalReader::getSymbolID(const char* symbol) const
+{
+	for (size_t i = 0; i < m_vtSymbols.size(); i++) {
+		if (m_vtSymbols[i] == symbol) {
+			return (int)i;
+		}
+	}
+	return -1;
+}
+
+// Records are appended in receive order, so the position is found by bisection.
+uint64_t CTickJournalReader::seek(int64_t recvTimeNs) const
+{
+	uint64_t low = 0;
+	uint64_t high = m_nCount;
+	while (low < high) {
+		uint64_t mid = low + (high - low) / 2;
+		if (m_pRecords[mid].RecvTimeNs < recvTimeNs) {
+			low = mid + 1;
+		}
+		else {
+			high = mid;
+		}
+	}
+	return low;
+}
+
+const vector<uint64_t>* CTickJournalReader::getIndex(uint32_t symbolID) const
+{
+	return symbolID < m_vtIndexes.size() ? &m_vtIndexes[symbolID] : NULL;
+}
@@ -0,0 +1,93 @@
+#ifndef TICKJOURNAL_H
+#define TICKJOURNAL_H
+
+#include "CriticalSection.h"
+#include "Thread.h"
+#include "MappedFile.h"
+#include "IBaseOrder.h"
+
+#define TICK_JOURNAL_MAGIC 0x314A4B54
+
+typedef struct {
+	uint32_t SymbolID;
+	uint32_t Reserve;
+	double Bid;
+	double Ask;
+	int64_t ServerTimeNs;
+	int64_t RecvTimeNs;
+} TickRecord;
+
+typedef struct {
+	uint32_t Magic;
+	uint32_t RecordSize;
+	uint64_t Capacity;
+	uint64_t Count;
+	int64_t Day;
+	char Reserve[32];
+} TickJournalHeader;
+
+// Appends every tick to a memory mapped file per UTC day (ticks-YYYYMMDD.dat),
+// with the symbol names of that day in ticks-YYYYMMDD.sym.
+// Records are written in place and a background thread flushes them in groups.
+class CTickJournal
+{
+private:
+	string m_sPath;
+	uint64_t m_nCapacity;
+	long m_lFlushInterval;
+	CMappedFile m_MappedFile;
+	TickJournalHeader *m_pHeader;
+	TickRecord *m_pRecords;
+	int64_t m_nDay;
+	uint64_t m_nCount;
+	uint64_t m_nFlushed;
+	uint64_t m_nDropped;
+	map<string, uint32_t> m_mapSymbolIDs;
+	FILE *m_fpSymbols;
+	CCriticalSection m_csJournal;
+	HANDLE m_hExitEvent;
+	CThread *m_pFlushThread;
+
+public:
+	CTickJournal(const char* path, uint64_t capacity, long flushInterval);
+	~CTickJournal();
+
+	int start();
+	void stop();
+	void append(const TblPrice* tblPrice, int64_t recvTimeNs);
+	uint64_t getDropped();
+
+	static int64_t getRealtimeNs();
+	static string getFileName(const char* path, int64_t day, const char* ext);
+
+private:
+	bool openDay(int64_t day);
+	void closeDay();
+	uint32_t getSymbolID(const char* symbol);
+	void flush(bool sync);
+	static void flushProcess(void* pv);
+};
+
+class CTickJournalReader
+{
+private:
+	CMappedFile m_MappedFile;
+	const TickRecord *m_pRecords;
+	uint64_t m_nCount;
+	vector<string> m_vtSymbols;
+	vector<vector<uint64_t> > m_vtIndexes;
+
+public:
+	CTickJournalReader() : m_pRecords(NULL), m_nCount(0) {};
+
+	bool open(const char* path, int64_t day);
+	void close();
+	uint64_t size() const { return m_nCount; };
+	const TickRecord* get(uint64_t pos) const { return pos < m_nCount ? &m_pRecords[pos] : NULL; };
+	const char* getSymbol(uint32_t symbolID) const;
+	int getSymbolID(const char* symbol) const;
+	uint64_t seek(int64_t recvTimeNs) const;
+	const vector<uint64_t>* getIndex(uint32_t symbolID) const;
+};
+
+#endif
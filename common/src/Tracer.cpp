@@ -0,0 +1,133 @@
+﻿/*
+* Copyright 2020 FXDaemon
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include "stdafx.h"
+#include "Utils.h"
+#include "CriticalSection.h"
+#include "IBaseOrder.h"
+#include "Tracer.h"
+
+#ifdef PLUGIN_TRACE
+
+static const size_t TraceCapacity = 16384;
+
+typedef struct {
+	int Tid;
+	atomic<size_t> Count;
+	TraceEvent Events[TraceCapacity];
+} TraceBuffer;
+
+// Buffers live until the process exits, so dump() can read them from any thread.
+static vector<TraceBuffer*> traceBuffers;
+static CCriticalSection traceBuffersLock;
+static thread_local TraceBuffer* threadBuffer = NULL;
+
+static TraceBuffer* getThreadBuffer()
+{
+	if (!threadBuffer) {
+		TraceBuffer* buffer = new TraceBuffer();
+		buffer->Count.store(0);
+		CCriticalSection::Lock l(traceBuffersLock);
+		buffer->Tid = (int)traceBuffers.size() + 1;
+		traceBuffers.push_back(buffer);
+		threadBuffer = buffer;
+	}
+	return threadBuffer;
+}
+
+static void copyId(char* dst, const char* id)
+{
+	size_t i = 0;
+	if (id) {
+		for (; id[i] && i < TRACE_ID_SIZE - 1; i++) {
+			dst[i] = (id[i] == '"' || id[i] == '\\' || (unsigned char)id[i] < 0x20) ? '_' : id[i];
+		}
+	}
+	dst[i] = '\0';
+}
+
+static void append(const char* name, char phase, int64_t startNs, int64_t durNs, const char* id)
+{
+	TraceBuffer* buffer = getThreadBuffer();
+	size_t count = buffer->Count.load(std::memory_order_relaxed);
+	if (count == TraceCapacity) {
+		return;
+	}
+	TraceEvent& event = buffer->Events[count];
+	event.Name = name;
+	event.Phase = phase;
+	event.StartNs = startNs;
+	event.DurNs = durNs;
+	copyId(event.Id, id);
+	buffer->Count.store(count + 1, std::memory_order_release);
+}
+
+void CTracer::span(const char* name, int64_t startNs, int64_t endNs, const char* id)
+{
+	append(name, 'X', startNs, endNs - startNs, id);
+}
+
+void CTracer::instant(const char* name, const char* id)
+{
+	append(name, 'i', CUtils::getMonotonicNs(), 0, id);
+}
+
+int CTracer::dump(const char* file)
+{
+	FILE* fp = fopen(file, "w");
+	if (!fp) {
+		return RET_FAILED;
+	}
+
+	vector<TraceBuffer*> buffers;
+	{
+		CCriticalSection::Lock l(traceBuffersLock);
+		buffers = traceBuffers;
+	}
+	fprintf(fp, "{\"traceEvents\":[");
+	bool first = true;
+	for (size_t i = 0; i < buffers.size(); i++) {
+		size_t count = buffers[i]->Count.load(std::memory_order_acquire);
+		for (size_t j = 0; j < count; j++) {
+			const TraceEvent& event = buffers[i]->Events[j];
+			fprintf(fp, "%s\n{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%.3f,", first ? "" : ",",
+				event.Name, event.Phase, event.StartNs / 1000.0);
+			if (event.Phase == 'X') {
+				fprintf(fp, "\"dur\":%.3f,", event.DurNs / 1000.0);
+			}
+			else {
+				fprintf(fp, "\"s\":\"t\",");
+			}
+			fprintf(fp, "\"pid\":1,\"tid\":%d,\"args\":{\"id\":\"%s\"}}", buffers[i]->Tid, event.Id);
+			first = false;
+		}
+	}
+	fprintf(fp, "\n]}\n");
+	fclose(fp);
+	return RET_SUCCESS;
+}
+
+CTraceScope::CTraceScope(const char* name, const char* id) : m_pName(name)
+{
+	copyId(m_sId, id);
+	m_nStartNs = CUtils::getMonotonicNs();
+}
+
+CTraceScope::~CTraceScope()
+{
+	append(m_pName, 'X', m_nStartNs, CUtils::getMonotonicNs() - m_nStartNs, m_sId);
+}
+
+#endif
@@ -0,0 +1,54 @@
+#ifndef TRACER_H
+#define TRACER_H
+
+// Build with -DPLUGIN_TRACE to record spans, without it the TRACE_ macros are empty.
+#ifdef PLUGIN_TRACE
+
+#define TRACE_ID_SIZE	32
+
+typedef struct {
+	const char* Name;		// string literal
+	char Phase;				// 'X' span, 'i' instant
+	int64_t StartNs;		// monotonic
+	int64_t DurNs;
+	char Id[TRACE_ID_SIZE];
+} TraceEvent;
+
+// Spans and instants on the monotonic clock. Each thread appends to a buffer of
+// its own without locking; a full buffer drops further events of that thread.
+// dump() writes the Chrome trace JSON format (chrome://tracing, ui.perfetto.dev).
+class CTracer
+{
+public:
+	static void span(const char* name, int64_t startNs, int64_t endNs, const char* id = NULL);
+	static void instant(const char* name, const char* id = NULL);
+	static int dump(const char* file);
+};
+
+class CTraceScope
+{
+private:
+	const char* m_pName;
+	int64_t m_nStartNs;
+	char m_sId[TRACE_ID_SIZE];
+
+public:
+	CTraceScope(const char* name, const char* id = NULL);
+	~CTraceScope();
+};
+
+#define TRACE_SCOPE(name, id)					CTraceScope traceScope(name, id)
+#define TRACE_SPAN(name, startNs, endNs, id)	CTracer::span(name, startNs, endNs, id)
+#define TRACE_INSTANT(name, id)					CTracer::instant(name, id)
+#define TRACE_DUMP(file)						CTracer::dump(file)
+
+#else
+
+#define TRACE_SCOPE(name, id)
+#define TRACE_SPAN(name, startNs, endNs, id)
+#define TRACE_INSTANT(name, id)
+#define TRACE_DUMP(file)
+
+#endif
+
+#endif
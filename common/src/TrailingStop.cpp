@@ -0,0 +1,169 @@
+﻿/*
+* Copyright 2020 FXDaemon
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include "stdafx.h"
+#include "TrailingStop.h"
+
+CTrailingStop::CTrailingStop(IBaseOrder* baseOrder) : m_pBaseOrder(baseOrder)
+{
+	m_hExitEvent = nsapi::CreateEvent(NULL, FALSE, FALSE, NULL);
+	m_hPendingEvent = nsapi::CreateEvent(NULL, FALSE, FALSE, NULL);
+	ThreadFunAttr threadFunAttr = { sendProcess, this };
+	m_pSendThread = new CThread(threadFunAttr);
+}
+
+CTrailingStop::~CTrailingStop()
+{
+	stop();
+	delete m_pSendThread;
+	nsapi::CloseHandle(m_hExitEvent);
+	nsapi::CloseHandle(m_hPendingEvent);
+}
+
+// Sends the due stops from a thread of its own. Without it, the owner calls flush().
+int CTrailingStop::start()
+{
+	return m_pSendThread->_start() == 0 ? RET_SUCCESS : RET_FAILED;
+}
+
+void CTrailingStop::stop()
+{
+	if (m_pSendThread->isRunning()) {
+		nsapi::SetEvent(m_hExitEvent);
+		m_pSendThread->join();
+	}
+}
+
+// distance and step are in price units.
+int CTrailingStop::add(const TblTrade* tblTrade, double distance, double step)
+{
+	if (distance <= 0 || step < 0) {
+		return RET_FAILED;
+	}
+
+	CCriticalSection::Lock l(m_csTrails);
+	map<string, string>::iterator it = m_mapTradeSymbols.find(tblTrade->TradeID);
+	if (it != m_mapTradeSymbols.end()) {
+		m_mapSymbols[it->second].erase(tblTrade->TradeID);
+	}
+
+	TrailingTrade& trail = m_mapSymbols[tblTrade->Symbol][tblTrade->TradeID];
+	trail.Trade = *tblTrade;
+	trail.Distance = distance;
+	trail.Step = step;
+	trail.Best = 0;
+	trail.Pending = false;
+	m_mapTradeSymbols[tblTrade->TradeID] = tblTrade->Symbol;
+	return RET_SUCCESS;
+}
+
+int CTrailingStop::remove(const char* tradeID)
+{
+	CCriticalSection::Lock l(m_csTrails);
+	map<string, string>::iterator it = m_mapTradeSymbols.find(tradeID);
+	if (it == m_mapTradeSymbols.end()) {
+		return RET_FAILED;
+	}
+	m_mapSymbols[it->second].erase(tradeID);
+	m_mapTradeSymbols.erase(it);
+	return RET_SUCCESS;
+}
+
+// Returns true when a stop is due.
+bool CTrailingStop::onPrice(const TblPrice* tblPrice)
+{
+	bool pending = false;
+	{
+		CCriticalSection::Lock l(m_csTrails);
+		map<string, map<string, TrailingTrade> >::iterator sit = m_mapSymbols.find(tblPrice->Symbol);
+		if (sit == m_mapSymbols.end()) {
+			return false;
+		}
+
+		for (map<string, TrailingTrade>::iterator it = sit->second.begin(); it != sit->second.end(); it++) {
+			TrailingTrade& trail = it->second;
+			bool buy = strcmp(trail.Trade.BS, "B") == 0;
+			double rate = buy ? tblPrice->Bid : tblPrice->Ask;
+			if (rate > 0 && (trail.Best == 0 || (buy ? rate > trail.Best : rate < trail.Best))) {
+				trail.Best = rate;
+				double stop = buy ? rate - trail.Distance : rate + trail.Distance;
+				if (trail.Trade.Stop == 0 || (buy ? stop >= trail.Trade.Stop + trail.Step : stop <= trail.Trade.Stop - trail.Step)) {
+					trail.Trade.Stop = stop;
+					trail.Pending = true;
+				}
+			}
+			pending |= trail.Pending;
+		}
+	}
+
+	if (pending && m_pSendThread->isRunning()) {
+		nsapi::SetEvent(m_hPendingEvent);
+	}
+	return pending;
+}
+
+// Sends the latest due stop of each trade, returns the number of changed stops.
+int CTrailingStop::flush()
+{
+	vector<TblTrade> tblTradeList;
+	{
+		CCriticalSection::Lock l(m_csTrails);
+		for (map<string, map<string, TrailingTrade> >::iterator sit = m_mapSymbols.begin(); sit != m_mapSymbols.end(); sit++) {
+			for (map<string, TrailingTrade>::iterator it = sit->second.begin(); it != sit->second.end(); it++) {
+				if (it->second.Pending) {
+					it->second.Pending = false;
+					tblTradeList.push_back(it->second.Trade);
+				}
+			}
+		}
+	}
+	if (tblTradeList.empty()) {
+		return 0;
+	}
+
+	vector<TblTrade*> tblTrades;
+	for (size_t i = 0; i < tblTradeList.size(); i++) {
+		tblTrades.push_back(&tblTradeList[i]);
+	}
+	tblTrades.push_back(NULL);
+	int count = m_pBaseOrder->changeStopLosses(&tblTrades[0]);
+
+	// The count does not tell which change failed, so after a partial failure
+	// every stop of the batch is due again; resending an accepted one is harmless.
+	bool failed = count < (int)tblTradeList.size();
+	CCriticalSection::Lock l(m_csTrails);
+	for (size_t i = 0; i < tblTradeList.size(); i++) {
+		map<string, TrailingTrade>& trails = m_mapSymbols[tblTradeList[i].Symbol];
+		map<string, TrailingTrade>::iterator it = trails.find(tblTradeList[i].TradeID);
+		if (it == trails.end()) {
+			continue;
+		}
+		// A new stop order may have been created by the first change.
+		strcpy(it->second.Trade.StopOrderID, tblTradeList[i].StopOrderID);
+		if (failed) {
+			it->second.Pending = true;
+		}
+	}
+	return count;
+}
+
+void CTrailingStop::sendProcess(void* pv)
+{
+	CTrailingStop* trailingStop = (CTrailingStop*)pv;
+	HANDLE handles[2] = { trailingStop->m_hExitEvent, trailingStop->m_hPendingEvent };
+	while (nsapi::WaitForMultipleObjects(2, handles, FALSE, INFINITE) == WAIT_OBJECT_0 + 1) {
+		trailingStop->flush();
+	}
+}
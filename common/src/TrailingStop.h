@@ -0,0 +1,46 @@
+#ifndef TRAILINGSTOP_H
+#define TRAILINGSTOP_H
+
+#include "CriticalSection.h"
+#include "Thread.h"
+#include "IBaseOrder.h"
+
+typedef struct {
+	TblTrade Trade;
+	double Distance;
+	double Step;
+	double Best;
+	bool Pending;
+} TrailingTrade;
+
+// Moves the stop of registered trades behind the best price seen.
+// A new stop is due when it improves on the last one by Step; due stops are
+// sent with changeStopLosses, so several moves before a send collapse into one.
+// A stop that failed to send stays due and is sent again on the next price.
+class CTrailingStop
+{
+private:
+	IBaseOrder *m_pBaseOrder;
+	map<string, map<string, TrailingTrade> > m_mapSymbols;
+	map<string, string> m_mapTradeSymbols;
+	CCriticalSection m_csTrails;
+	HANDLE m_hExitEvent;
+	HANDLE m_hPendingEvent;
+	CThread *m_pSendThread;
+
+public:
+	CTrailingStop(IBaseOrder* baseOrder);
+	~CTrailingStop();
+
+	int start();
+	void stop();
+	int add(const TblTrade* tblTrade, double distance, double step);
+	int remove(const char* tradeID);
+	bool onPrice(const TblPrice* tblPrice);
+	int flush();
+
+private:
+	static void sendProcess(void* pv);
+};
+
+#endif
@@ -0,0 +1,183 @@
+﻿/*
+* Copyright 2020 FXDaemon
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include "stdafx.h"
+#include "TableListener.h"
+#include "DepthBook.h"
+
+bool CDepthBook::empty()
+{
+	CCriticalSection::Lock l(m_csBooks);
+	return m_vtBooks.empty();
+}
+
+void CDepthBook::addSymbol(int symbolID, const char* symbol)
+{
+	CCriticalSection::Lock l(m_csBooks);
+	if (m_mapSymbolIDs.find(symbolID) != m_mapSymbolIDs.end()) {
+		return;
+	}
+
+	m_vtBooks.resize(m_vtBooks.size() + 1);
+	SymbolBook& book = m_vtBooks.back();
+	memset(&book, 0, sizeof(book));
+	strcpy(book.Depth.Symbol, symbol);
+	m_mapSymbolIDs[symbolID] = m_vtBooks.size() - 1;
+	m_mapSymbols[symbol] = m_vtBooks.size() - 1;
+}
+
+// An update carries the whole ladder of each originator it names, so only the
+// ladders of those originators are replaced; the others stay as they were.
+// A ladder is replaced the first time a batch names it, its stamp tells.
+void CDepthBook::onLevel2MarketData(IO2GLevel2MarketDataUpdatesReader* reader)
+{
+	CCriticalSection::Lock l(m_csBooks);
+	uint32_t batch = ++m_nBatch;
+	m_vtChanged.clear();
+
+	for (int i = 0; i < reader->getPriceQuotesCount(); i++) {
+		map<int, size_t>::iterator mpos = m_mapSymbolIDs.find(reader->getSymbolID(i));
+		if (mpos == m_mapSymbolIDs.end()) {
+			continue;
+		}
+
+		SymbolBook& book = m_vtBooks[mpos->second];
+		book.Depth.Time = CTableListener::date2Time(reader->getDateTime(i));
+		if (book.Batch != batch) {
+			book.Batch = batch;
+			m_vtChanged.push_back(mpos->second);
+		}
+
+		for (int j = 0; j < reader->getPricesCount(i); j++) {
+			int o = originatorIndex(reader->getOriginator(i, j));
+			if (o < 0) {
+				continue;
+			}
+			if (book.Stamps[o] != batch) {
+				book.Stamps[o] = batch;
+				book.BidLevels[o] = 0;
+				book.AskLevels[o] = 0;
+				if (o >= book.Ladders) {
+					book.Ladders = o + 1;
+				}
+			}
+			if (reader->isBid(i, j)) {
+				insertLevel(book.BidRates[o], book.BidAmounts[o], book.BidLevels[o], reader->getRate(i, j), reader->getAmount(i, j), true);
+			}
+			else if (reader->isAsk(i, j)) {
+				insertLevel(book.AskRates[o], book.AskAmounts[o], book.AskLevels[o], reader->getRate(i, j), reader->getAmount(i, j), false);
+			}
+		}
+	}
+
+	for (size_t i = 0; i < m_vtChanged.size(); i++) {
+		aggregate(m_vtBooks[m_vtChanged[i]]);
+	}
+}
+
+bool CDepthBook::getDepth(const char* symbol, TblDepth* tblDepth)
+{
+	CCriticalSection::Lock l(m_csBooks);
+	map<string, size_t>::iterator mpos = m_mapSymbols.find(symbol);
+	if (mpos == m_mapSymbols.end()) {
+		return false;
+	}
+	*tblDepth = m_vtBooks[mpos->second].Depth;
+	return true;
+}
+
+// Originators are few and named on every level, a scan of their names beats
+// a map lookup. Past DEPTH_ORIGINATORS their levels are dropped (-1).
+int CDepthBook::originatorIndex(const char* originator)
+{
+	if (!originator) {
+		originator = "";
+	}
+	for (size_t i = 0; i < m_vtOriginators.size(); i++) {
+		if (strcmp(m_vtOriginators[i].c_str(), originator) == 0) {
+			return (int)i;
+		}
+	}
+	if (m_vtOriginators.size() >= DEPTH_ORIGINATORS) {
+		return -1;
+	}
+	m_vtOriginators.push_back(originator);
+	return (int)m_vtOriginators.size() - 1;
+}
+
+void CDepthBook::aggregate(SymbolBook& book)
+{
+	TblDepth& depth = book.Depth;
+	depth.BidLevels = mergeLevels(book.BidRates, book.BidAmounts, book.BidLevels, book.Ladders, depth.BidRate, depth.BidAmount, true);
+	depth.AskLevels = mergeLevels(book.AskRates, book.AskAmounts, book.AskLevels, book.Ladders, depth.AskRate, depth.AskAmount, false);
+}
+
+// Merges sorted ladders into the best DEPTH_MAX levels, summing the amounts
+// of equal rates. Returns the number of levels written.
+int CDepthBook::mergeLevels(const double rates[][DEPTH_MAX], const double amounts[][DEPTH_MAX], const int levels[], int ladders,
+	double outRates[], double outAmounts[], bool descending)
+{
+	int pos[DEPTH_ORIGINATORS] = { 0 };
+	int count = 0;
+	while (count < DEPTH_MAX) {
+		int best = -1;
+		for (int i = 0; i < ladders; i++) {
+			if (pos[i] < levels[i] && (best < 0 ||
+				(descending ? rates[i][pos[i]] > rates[best][pos[best]] : rates[i][pos[i]] < rates[best][pos[best]]))) {
+				best = i;
+			}
+		}
+		if (best < 0) {
+			break;
+		}
+
+		double rate = rates[best][pos[best]];
+		double amount = 0;
+		for (int i = 0; i < ladders; i++) {
+			if (pos[i] < levels[i] && rates[i][pos[i]] == rate) {
+				amount += amounts[i][pos[i]];
+				pos[i]++;
+			}
+		}
+		outRates[count] = rate;
+		outAmounts[count] = amount;
+		count++;
+	}
+	return count;
+}
+
+void CDepthBook::insertLevel(double rates[], double amounts[], int& levels, double rate, double amount, bool descending)
+{
+	int pos = 0;
+	while (pos < levels && (descending ? rates[pos] > rate : rates[pos] < rate)) {
+		pos++;
+	}
+	if (pos < levels && rates[pos] == rate) {
+		amounts[pos] += amount;
+		return;
+	}
+	if (pos >= DEPTH_MAX) {
+		return;
+	}
+
+	int last = levels < DEPTH_MAX ? levels : DEPTH_MAX - 1;
+	memmove(&rates[pos + 1], &rates[pos], (last - pos) * sizeof(double));
+	memmove(&amounts[pos + 1], &amounts[pos], (last - pos) * sizeof(double));
+	rates[pos] = rate;
+	amounts[pos] = amount;
+	if (levels < DEPTH_MAX) {
+		levels++;
+	}
+}
@@ -0,0 +1,53 @@
+#ifndef DEPTHBOOK_H
+#define DEPTHBOOK_H
+
+#include "ForexConnect/ForexConnect.h"
+#include "CriticalSection.h"
+#include "Table.h"
+
+#define DEPTH_ORIGINATORS 16
+
+// The levels of each originator are kept apart, best first, in fixed arrays
+// indexed by the originator's index in CDepthBook. Depth merges them by rate.
+typedef struct {
+	TblDepth Depth;
+	int Ladders;
+	uint32_t Batch;
+	uint32_t Stamps[DEPTH_ORIGINATORS];
+	int BidLevels[DEPTH_ORIGINATORS];
+	int AskLevels[DEPTH_ORIGINATORS];
+	double BidRates[DEPTH_ORIGINATORS][DEPTH_MAX];
+	double BidAmounts[DEPTH_ORIGINATORS][DEPTH_MAX];
+	double AskRates[DEPTH_ORIGINATORS][DEPTH_MAX];
+	double AskAmounts[DEPTH_ORIGINATORS][DEPTH_MAX];
+} SymbolBook;
+
+class CDepthBook
+{
+private:
+	vector<SymbolBook> m_vtBooks;
+	map<int, size_t> m_mapSymbolIDs;
+	map<string, size_t> m_mapSymbols;
+	vector<string> m_vtOriginators;
+	vector<size_t> m_vtChanged;
+	uint32_t m_nBatch;
+	CCriticalSection m_csBooks;
+
+public:
+	CDepthBook() : m_nBatch(0) {};
+
+	bool empty();
+	void addSymbol(int symbolID, const char* symbol);
+	void onLevel2MarketData(IO2GLevel2MarketDataUpdatesReader* reader);
+	bool getDepth(const char* symbol, TblDepth* tblDepth);
+
+	static void insertLevel(double rates[], double amounts[], int& levels, double rate, double amount, bool descending);
+	static int mergeLevels(const double rates[][DEPTH_MAX], const double amounts[][DEPTH_MAX], const int levels[], int ladders,
+		double outRates[], double outAmounts[], bool descending);
+
+private:
+	int originatorIndex(const char* originator);
+	static void aggregate(SymbolBook& book);
+};
+
+#endif
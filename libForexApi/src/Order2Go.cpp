@@ -46,6 +46,14 @@ COrder2Go::COrder2Go()
 {
 	m_pPluginProxy = getPluginProxy();
 	m_pPluginProxy->registerPlugin("Order2Go", this);
+	m_pProxyRecorder = NULL;
+	m_pTickJournal = NULL;
+	m_pTrailingStop = new CTrailingStop(this);
+}
+
+COrder2Go::~COrder2Go()
+{
+	delete m_pTrailingStop;
 }
 
 int COrder2Go::init(const char* iniFile)
@@ -56,6 +64,23 @@ int COrder2Go::init(const char* iniFile)
 		return RET_FAILED;
 	}
 
+	if (atoi(getRecorderInfo("Enable", "0")) != 0) {
+		m_pProxyRecorder = new CProxyRecorder(m_pPluginProxy, atol(getRecorderInfo("Capacity", "65536")));
+		m_pPluginProxy = m_pProxyRecorder;
+	}
+
+	if (atoi(getJournalInfo("Enable", "0")) != 0) {
+		m_pTickJournal = new CTickJournal(getJournalInfo("Path", "./"),
+			strtoull(getJournalInfo("Capacity", "4194304"), NULL, 10), atol(getJournalInfo("FlushInterval", "1000")));
+		if (m_pTickJournal->start() != RET_SUCCESS) {
+			m_pPluginProxy->onMessage(MSG_ERROR, "Tick journal open failed.");
+			delete m_pTickJournal;
+			m_pTickJournal = NULL;
+		}
+	}
+
+	initMarketCalendar();
+
 	m_pSession = CO2GTransport::createSession();
 	if (!m_pSession) {
 		m_pPluginProxy->onMessage(MSG_ERROR, "Failed to create session.");
@@ -63,13 +88,15 @@ int COrder2Go::init(const char* iniFile)
 	}
 
 	m_pSession->useTableManager(::Yes, NULL);
-	m_pTableListener = new CTableListener(m_pPluginProxy);
+	m_pTableListener = new CTableListener(m_pPluginProxy, m_pTickJournal, m_pTrailingStop);
 
 	m_pSessionStatusListener = new CSessionStatusListener(m_pSession,
 		new CLoginDataProvider(getLoginInfo("SessionID"), getLoginInfo("Pin")), m_pPluginProxy);
 	m_pSession->subscribeSessionStatus(m_pSessionStatusListener);
 
-	m_pResponseListener = new CResponseListener();
+	m_pDepthBook = new CDepthBook();
+	m_bRawUpdates = atoi(getUpdatesInfo("Raw", "0")) != 0;
+	m_pResponseListener = new CResponseListener(m_pSession, m_pDepthBook, m_bRawUpdates ? m_pTableListener : NULL);
 	m_pSession->subscribeResponse(m_pResponseListener);
 
 	return RET_SUCCESS;
@@ -91,6 +118,7 @@ int COrder2Go::login()
 	DWORD dwRes = nsapi::WaitForMultipleObjects(2, handles, FALSE, INFINITE);
 	if (dwRes == WAIT_OBJECT_0) {
 		onConnected();
+		m_pTrailingStop->start();
 		return subscribeTableListener(m_pSession->getTableManager(), m_pTableListener);
 	}
 	return RET_FAILED;
@@ -100,6 +128,7 @@ int COrder2Go::close()
 {
 	int ret = RET_SUCCESS;
 
+	m_pTrailingStop->stop();
 	if (m_pSession->getSessionStatus() == IO2GSessionStatus::Connected) {
 		unsubscribeTableListener(m_pSession->getTableManager(), m_pTableListener);
 	}
@@ -107,6 +136,7 @@ int COrder2Go::close()
 		
 	m_pSession->unsubscribeResponse(m_pResponseListener);
 	m_pResponseListener->release();
+	delete m_pDepthBook;
 	if (m_pSession->getSessionStatus() == IO2GSessionStatus::Connected) {
 		ret = logout();
 	}
@@ -115,6 +145,14 @@ int COrder2Go::close()
 	m_pSessionStatusListener->release();
 		
 	m_pSession->release();
+	if (m_pTickJournal) {
+		delete m_pTickJournal;
+		m_pTickJournal = NULL;
+	}
+	if (m_pProxyRecorder) {
+		m_pProxyRecorder->dump(getRecorderInfo("DumpFile", "proxy-recorder.log"));
+	}
+	TRACE_DUMP(getLoginInfo("TraceFile", "forexapi-trace.json"));
 
 	return ret;
 }
@@ -173,6 +211,16 @@ int COrder2Go::getPrice(const char* symbols[], TblPrice** pTblPrice[])
 	return tblPriceList.size();
 }
 
+int COrder2Go::getDepth(const char* symbol, TblDepth** tblDepth)
+{
+	*tblDepth = new TblDepth();
+	if (!m_pDepthBook->getDepth(symbol, *tblDepth)) {
+		delete *tblDepth;
+		*tblDepth = NULL;
+	}
+	return *tblDepth ? 1 : 0;
+}
+
 int COrder2Go::getOpenedTrades(TblTrade** pTblTrade[])
 {
 	IO2GTableManager *tableManager = m_pSession->getTableManager();
@@ -219,44 +267,37 @@ int COrder2Go::getClosedTrades(TblTrade** pTblTrade[])
 
 int COrder2Go::getHistoricalData(const char* symbol, const char* period, time_t start, time_t end, bool maxRange, TblCandle** pTblCandle[])
 {
-	// UTC (Sunday 19:00 - Friday 21:00)
-	int marketOpenWday = atoi(getMarketInfo("OpenWday", "0"));
-	int marketOpenHour = atoi(getMarketInfo("OpenHour", "19"));
-	int marketCloseWday = atoi(getMarketInfo("CloseWday", "5"));
-	int marketCloseHour = atoi(getMarketInfo("CloseHour", "21"));
 	time_t interval = getTimetByPeriod(period);
-	
-	vector<TblCandle*> outCandleList;
-	time_t cur = start - interval;
-	time_t addLastTime = start;
+	size_t concurrency = atoi(getMarketInfo("HistoryConcurrency", "4"));
+	if (concurrency < 1) {
+		concurrency = 1;
+	}
 
-	while (cur <= end) {
-		vector<TblCandle*> tmpCandleList;
-		getHistoricalData(symbol, period, cur, CandleMaxNumber, tmpCandleList);
-		if (!tmpCandleList.empty()) {
-			if (!outCandleList.empty()) {
-				addLastTime = outCandleList.back()->StartDate;
-			}
+	// Split the range into windows of at most CandleMaxNumber bars of trading time,
+	// so the windows can be requested at the same time and merged in order.
+	vector<pair<time_t, time_t> > windows;
+	m_MarketCalendar.planWindows(start - interval, end, interval * CandleMaxNumber, windows);
 
-			bool isAddNew = false;
-			vector<TblCandle*>::iterator vpos = tmpCandleList.begin();
-			while (vpos != tmpCandleList.end()) {
+	vector<TblCandle*> outCandleList;
+	time_t addLastTime = start;
+	for (size_t i = 0; i < windows.size(); i += concurrency) {
+		vector<pair<time_t, time_t> > waveWindows(windows.begin() + i, windows.begin() + (i + concurrency < windows.size() ? i + concurrency : windows.size()));
+		vector<vector<TblCandle*> > tmpCandleLists;
+		getHistoricalData(symbol, period, waveWindows, tmpCandleLists);
+
+		for (size_t j = 0; j < tmpCandleLists.size(); j++) {
+			vector<TblCandle*>::iterator vpos = tmpCandleLists[j].begin();
+			while (vpos != tmpCandleLists[j].end()) {
 				if ((*vpos)->StartDate > addLastTime && (*vpos)->StartDate <= end - interval) {
 					outCandleList.push_back(*vpos);
-					isAddNew = true;
+					addLastTime = (*vpos)->StartDate;
 				}
 				else {
 					delete *vpos;
 				}
 				++vpos;
 			}
-
-			if (isAddNew) {
-				cur = outCandleList.back()->StartDate - interval;
-				continue;
-			}
 		}
-		cur = CUtils::overDayoff(cur, marketOpenWday, marketOpenHour, marketCloseWday, marketCloseHour);
 	}
 	
 	if (outCandleList.size() > 0) {
@@ -269,19 +310,11 @@ int COrder2Go::getHistoricalData(const char* symbol, const char* period, time_t
 
 int COrder2Go::openMarketOrder(TblOrder* tblOrder)
 {
+	TRACE_SCOPE("openMarketOrder", tblOrder->Symbol);
 	string orderID;
 	IO2GRequestFactory *requestFactory = m_pSession->getRequestFactory();
 	IO2GValueMap *valuemap = requestFactory->createValueMap();
-	valuemap->setString(Command, O2G2::Commands::CreateOrder);
-	valuemap->setString(OrderType, O2G2::Orders::TrueMarketOpen);
-	valuemap->setString(AccountID, tblOrder->AccountID);
-	valuemap->setString(OfferID, tblOrder->OfferID);
-	valuemap->setString(BuySell, tblOrder->BS);
-	valuemap->setInt(Amount, (int)tblOrder->Amount);
-	valuemap->setDouble(RateStop, tblOrder->Stop);
-	valuemap->setDouble(RateLimit, tblOrder->Limit);
-	valuemap->setInt(TrailStep, 0);
-	valuemap->setString(TimeInForce, O2G2::TIF::IOC);
+	fillOpenMarketOrder(valuemap, tblOrder);
 
 	IO2GRequest *request = requestFactory->createOrderRequest(valuemap);
 	valuemap->release();
@@ -290,27 +323,22 @@ int COrder2Go::openMarketOrder(TblOrder* tblOrder)
 		return RET_FAILED;
 	}
 
-	m_pResponseListener->setRequestID(request->getRequestID());
-	m_pSession->sendRequest(request);
-	request->release();
-	requestFactory->release();
+	TRACE_INSTANT("requestBuilt", request->getRequestID());
+	CResponse* response = NULL;
+	{
+		CCriticalSection::Lock l(m_csRequest);
+		m_pResponseListener->setRequestID(request->getRequestID());
+		m_pSession->sendRequest(request);
+		TRACE_INSTANT("sendRequest", request->getRequestID());
+		request->release();
+		requestFactory->release();
 
-	nsapi::WaitForSingleObject(m_pResponseListener->getReponseEvent(), INFINITE);
-	CResponse* response = m_pResponseListener->popResponse();
+		nsapi::WaitForSingleObject(m_pResponseListener->getReponseEvent(), INFINITE);
+		response = m_pResponseListener->popResponse();
+	}
 	if (response) {
-		if (response->getResponseStatus() == CResponse::COMPLETED) {
-			IO2GResponseReaderFactory *factory = m_pSession->getResponseReaderFactory();
-			if (factory) {
-				IO2GOrderResponseReader *responseReader  = factory->createOrderResponseReader(response->getIResponse());
-				if (responseReader) {
-					orderID = responseReader->getOrderID();
-					responseReader->release();
-				}
-				factory->release();
-			}
-		} else {
-			m_pPluginProxy->onMessage(MSG_ERROR, response->getError().c_str());
-		}
+		orderID = orderIDOfResponse(response);
+		TRACE_INSTANT("parsed", orderID.c_str());
 		delete response;
 	}
 	
@@ -322,29 +350,24 @@ int COrder2Go::openMarketOrder(TblOrder* tblOrder)
 }
 
 int COrder2Go::changeStopLoss(TblTrade* tblTrade)
+{
+	return changeOrder(tblTrade, O2G2::Orders::Stop);
+}
+
+int COrder2Go::changeTakeProfit(TblTrade* tblTrade)
+{
+	return changeOrder(tblTrade, O2G2::Orders::Limit);
+}
+
+int COrder2Go::closeTrade(TblTrade* tblTrade)
 {
 	int ret = RET_SUCCESS;
 	IO2GRequestFactory *requestFactory = m_pSession->getRequestFactory();
 	IO2GValueMap *valuemap = requestFactory->createValueMap();
-	string stopOrderID = getStopOrderID(tblTrade->TradeID);
-	if (stopOrderID.empty()) {
-		valuemap->setString(Command, O2G2::Commands::CreateOrder);
-		valuemap->setString(OrderType, O2G2::Orders::Stop);
-		valuemap->setString(AccountID, tblTrade->AccountID);
-		valuemap->setString(OfferID, tblTrade->OfferID);
-		valuemap->setString(TradeID, tblTrade->TradeID);
-		valuemap->setString(BuySell, strcmp(tblTrade->BS, "B") == 0 ? O2G2::Sell : O2G2::Buy);
-		valuemap->setInt(Amount, (int)tblTrade->Amount);
-		valuemap->setDouble(Rate, tblTrade->Stop);
-	}
-	else {
-		valuemap->setString(Command, O2G2::Commands::EditOrder);
-		valuemap->setString(OrderID, stopOrderID.c_str());
-		valuemap->setString(AccountID, tblTrade->AccountID);
-		valuemap->setDouble(Rate, tblTrade->Stop);
-	}
+	fillCloseTrade(valuemap, tblTrade);
 	IO2GRequest *request = requestFactory->createOrderRequest(valuemap);
 	if (request) {
+		CCriticalSection::Lock l(m_csRequest);
 		m_pResponseListener->setRequestID(request->getRequestID());
 		m_pSession->sendRequest(request);
 		request->release();
@@ -358,35 +381,104 @@ int COrder2Go::changeStopLoss(TblTrade* tblTrade)
 			delete response;
 		}
 	}
+
 	valuemap->release();
 	requestFactory->release();
 	return ret;
 }
 
-int COrder2Go::changeTakeProfit(TblTrade* tblTrade)
+int COrder2Go::openMarketOrders(TblOrder* tblOrders[])
 {
-	int ret = RET_SUCCESS;
 	IO2GRequestFactory *requestFactory = m_pSession->getRequestFactory();
-	IO2GValueMap *valuemap = requestFactory->createValueMap();
-	string limitOrderID = getLimitOrderID(tblTrade->TradeID);
-	if (limitOrderID.empty()) {
-		valuemap->setString(Command, O2G2::Commands::CreateOrder);
-		valuemap->setString(OrderType, O2G2::Orders::Limit);
-		valuemap->setString(AccountID, tblTrade->AccountID);
-		valuemap->setString(OfferID, tblTrade->OfferID);
-		valuemap->setString(TradeID, tblTrade->TradeID);
-		valuemap->setString(BuySell, strcmp(tblTrade->BS, "B") == 0 ? O2G2::Sell : O2G2::Buy);
-		valuemap->setInt(Amount, (int)tblTrade->Amount);
-		valuemap->setDouble(Rate, tblTrade->Limit);
+	vector<IO2GValueMap*> valuemaps;
+	for (int i = 0; tblOrders[i]; i++) {
+		IO2GValueMap *valuemap = requestFactory->createValueMap();
+		fillOpenMarketOrder(valuemap, tblOrders[i]);
+		valuemaps.push_back(valuemap);
 	}
-	else {
-		valuemap->setString(Command, O2G2::Commands::EditOrder);
-		valuemap->setString(OrderID, limitOrderID.c_str());
-		valuemap->setString(AccountID, tblTrade->AccountID);
-		valuemap->setDouble(Rate, tblTrade->Limit);
+
+	vector<CResponse*> responses;
+	int ret = sendBatchRequest(requestFactory, O2G2::Commands::CreateOrder, valuemaps, responses);
+	releaseValueMaps(valuemaps);
+	requestFactory->release();
+	if (ret == RET_FAILED) {
+		return RET_FAILED;
+	}
+
+	int count = 0;
+	for (size_t i = 0; i < responses.size(); i++) {
+		if (responses[i]) {
+			string orderID = orderIDOfResponse(responses[i]);
+			if (!orderID.empty()) {
+				strcpy(tblOrders[i]->OrderID, orderID.c_str());
+				count++;
+			}
+			delete responses[i];
+		}
+	}
+	return count;
+}
+
+int COrder2Go::changeStopLosses(TblTrade* tblTrades[])
+{
+	return changeOrders(tblTrades, O2G2::Orders::Stop);
+}
+
+int COrder2Go::changeTakeProfits(TblTrade* tblTrades[])
+{
+	return changeOrders(tblTrades, O2G2::Orders::Limit);
+}
+
+int COrder2Go::closeTrades(TblTrade* tblTrades[])
+{
+	IO2GRequestFactory *requestFactory = m_pSession->getRequestFactory();
+	vector<IO2GValueMap*> valuemaps;
+	for (int i = 0; tblTrades[i]; i++) {
+		IO2GValueMap *valuemap = requestFactory->createValueMap();
+		fillCloseTrade(valuemap, tblTrades[i]);
+		valuemaps.push_back(valuemap);
+	}
+
+	vector<CResponse*> responses;
+	int ret = sendBatchRequest(requestFactory, O2G2::Commands::CreateOrder, valuemaps, responses);
+	releaseValueMaps(valuemaps);
+	requestFactory->release();
+	if (ret == RET_FAILED) {
+		return RET_FAILED;
 	}
+	return countCompleted(responses);
+}
+
+int COrder2Go::setTrailingStop(TblTrade* tblTrade, double distance, double step)
+{
+	return m_pTrailingStop->add(tblTrade, distance, step);
+}
+
+int COrder2Go::removeTrailingStop(TblTrade* tblTrade)
+{
+	return m_pTrailingStop->remove(tblTrade->TradeID);
+}
+
+// The offers table streams every offer of the account, there is nothing to poll.
+int COrder2Go::subscribe(const char* /*symbols*/[])
+{
+	return RET_SUCCESS;
+}
+
+int COrder2Go::unsubscribe(const char* /*symbols*/[])
+{
+	return RET_SUCCESS;
+}
+
+int COrder2Go::changeOrder(TblTrade* tblTrade, const char* orderType)
+{
+	int ret = RET_SUCCESS;
+	IO2GRequestFactory *requestFactory = m_pSession->getRequestFactory();
+	IO2GValueMap *valuemap = requestFactory->createValueMap();
+	fillChangeOrder(valuemap, tblTrade, orderType);
 	IO2GRequest *request = requestFactory->createOrderRequest(valuemap);
 	if (request) {
+		CCriticalSection::Lock l(m_csRequest);
 		m_pResponseListener->setRequestID(request->getRequestID());
 		m_pSession->sendRequest(request);
 		request->release();
@@ -405,11 +497,113 @@ int COrder2Go::changeTakeProfit(TblTrade* tblTrade)
 	return ret;
 }
 
-int COrder2Go::closeTrade(TblTrade* tblTrade)
+int COrder2Go::changeOrders(TblTrade* tblTrades[], const char* orderType)
 {
-	int ret = RET_SUCCESS;
+	// New stop/limit orders and edits of existing ones are different commands,
+	// so they travel as (at most) two batches. Both are sent before the wait,
+	// their children are answered under one set of request IDs.
 	IO2GRequestFactory *requestFactory = m_pSession->getRequestFactory();
-	IO2GValueMap *valuemap = requestFactory->createValueMap();
+	vector<IO2GValueMap*> createValuemaps;
+	vector<IO2GValueMap*> editValuemaps;
+	for (int i = 0; tblTrades[i]; i++) {
+		IO2GValueMap *valuemap = requestFactory->createValueMap();
+		if (fillChangeOrder(valuemap, tblTrades[i], orderType)) {
+			editValuemaps.push_back(valuemap);
+		}
+		else {
+			createValuemaps.push_back(valuemap);
+		}
+	}
+
+	map<string, size_t> requestIndexes;
+	vector<string> requestIDs;
+	vector<IO2GRequest*> requests;
+	bool failed = false;
+	if (!createValuemaps.empty()) {
+		IO2GRequest *request = createBatchRequest(requestFactory, O2G2::Commands::CreateOrder, createValuemaps, 0, requestIndexes, requestIDs);
+		if (request) {
+			requests.push_back(request);
+		}
+		else {
+			failed = true;
+		}
+	}
+	if (!editValuemaps.empty()) {
+		IO2GRequest *request = createBatchRequest(requestFactory, O2G2::Commands::EditOrder, editValuemaps, createValuemaps.size(), requestIndexes, requestIDs);
+		if (request) {
+			requests.push_back(request);
+		}
+		else {
+			failed = true;
+		}
+	}
+	vector<CResponse*> responses(createValuemaps.size() + editValuemaps.size(), (CResponse*)NULL);
+	releaseValueMaps(createValuemaps);
+	releaseValueMaps(editValuemaps);
+	requestFactory->release();
+
+	// Nothing is sent unless both batches could be built.
+	if (failed) {
+		for (size_t i = 0; i < requests.size(); i++) {
+			requests[i]->release();
+		}
+		return RET_FAILED;
+	}
+	if (requests.empty()) {
+		return 0;
+	}
+
+	{
+		CCriticalSection::Lock l(m_csRequest);
+		m_pResponseListener->setRequestIDs(requestIDs);
+		for (size_t i = 0; i < requests.size(); i++) {
+			m_pSession->sendRequest(requests[i]);
+			requests[i]->release();
+		}
+		collectResponses(requestIndexes, responses);
+	}
+	return countCompleted(responses);
+}
+
+void COrder2Go::fillOpenMarketOrder(IO2GValueMap *valuemap, TblOrder* tblOrder)
+{
+	valuemap->setString(Command, O2G2::Commands::CreateOrder);
+	valuemap->setString(OrderType, O2G2::Orders::TrueMarketOpen);
+	valuemap->setString(AccountID, tblOrder->AccountID);
+	valuemap->setString(OfferID, tblOrder->OfferID);
+	valuemap->setString(BuySell, tblOrder->BS);
+	valuemap->setInt(Amount, (int)tblOrder->Amount);
+	valuemap->setDouble(RateStop, tblOrder->Stop);
+	valuemap->setDouble(RateLimit, tblOrder->Limit);
+	valuemap->setInt(TrailStep, 0);
+	valuemap->setString(TimeInForce, O2G2::TIF::IOC);
+}
+
+bool COrder2Go::fillChangeOrder(IO2GValueMap *valuemap, TblTrade* tblTrade, const char* orderType)
+{
+	bool isStop = strcmp(orderType, O2G2::Orders::Stop) == 0;
+	double rate = isStop ? tblTrade->Stop : tblTrade->Limit;
+	string orderID = isStop ? getStopOrderID(tblTrade->TradeID) : getLimitOrderID(tblTrade->TradeID);
+	if (orderID.empty()) {
+		valuemap->setString(Command, O2G2::Commands::CreateOrder);
+		valuemap->setString(OrderType, orderType);
+		valuemap->setString(AccountID, tblTrade->AccountID);
+		valuemap->setString(OfferID, tblTrade->OfferID);
+		valuemap->setString(TradeID, tblTrade->TradeID);
+		valuemap->setString(BuySell, strcmp(tblTrade->BS, "B") == 0 ? O2G2::Sell : O2G2::Buy);
+		valuemap->setInt(Amount, (int)tblTrade->Amount);
+		valuemap->setDouble(Rate, rate);
+		return false;
+	}
+	valuemap->setString(Command, O2G2::Commands::EditOrder);
+	valuemap->setString(OrderID, orderID.c_str());
+	valuemap->setString(AccountID, tblTrade->AccountID);
+	valuemap->setDouble(Rate, rate);
+	return true;
+}
+
+void COrder2Go::fillCloseTrade(IO2GValueMap *valuemap, TblTrade* tblTrade)
+{
 	valuemap->setString(Command, O2G2::Commands::CreateOrder);
 	valuemap->setString(OrderType, O2G2::Orders::TrueMarketClose);
 	valuemap->setString(AccountID, tblTrade->AccountID);
@@ -417,25 +611,124 @@ int COrder2Go::closeTrade(TblTrade* tblTrade)
 	valuemap->setString(TradeID, tblTrade->TradeID);
 	valuemap->setString(BuySell, strcmp(tblTrade->BS, "B") == 0 ? O2G2::Sell : O2G2::Buy);
 	valuemap->setInt(Amount, tblTrade->Amount);
-	IO2GRequest *request = requestFactory->createOrderRequest(valuemap);
-	if (request) {
-		m_pResponseListener->setRequestID(request->getRequestID());
-		m_pSession->sendRequest(request);
-		request->release();
-		nsapi::WaitForSingleObject(m_pResponseListener->getReponseEvent(), INFINITE);
-		CResponse* response = m_pResponseListener->popResponse();
-		if (response) {
-			if (response->getResponseStatus() == CResponse::FAILED) {
-				m_pPluginProxy->onMessage(MSG_ERROR, response->getError().c_str());
-				ret = RET_FAILED;
-			}
+}
+
+int COrder2Go::sendBatchRequest(IO2GRequestFactory *requestFactory, const char* command, vector<IO2GValueMap*>& valuemaps, vector<CResponse*>& responses)
+{
+	responses.assign(valuemaps.size(), NULL);
+	if (valuemaps.empty()) {
+		return 0;
+	}
+
+	map<string, size_t> requestIndexes;
+	vector<string> requestIDs;
+	IO2GRequest *request = createBatchRequest(requestFactory, command, valuemaps, 0, requestIndexes, requestIDs);
+	if (!request) {
+		return RET_FAILED;
+	}
+	CCriticalSection::Lock l(m_csRequest);
+	m_pResponseListener->setRequestIDs(requestIDs);
+	m_pSession->sendRequest(request);
+	request->release();
+	return collectResponses(requestIndexes, responses);
+}
+
+// Children are indexed from offset on, so several batches can share one wait.
+IO2GRequest* COrder2Go::createBatchRequest(IO2GRequestFactory *requestFactory, const char* command, vector<IO2GValueMap*>& valuemaps,
+	size_t offset, map<string, size_t>& requestIndexes, vector<string>& requestIDs)
+{
+	IO2GValueMap *batchValuemap = requestFactory->createValueMap();
+	batchValuemap->setString(Command, command);
+	for (size_t i = 0; i < valuemaps.size(); i++) {
+		batchValuemap->appendChild(valuemaps[i]);
+	}
+	IO2GRequest *request = requestFactory->createOrderRequest(batchValuemap);
+	batchValuemap->release();
+	if (!request) {
+		m_pPluginProxy->onMessage(MSG_ERROR, requestFactory->getLastError());
+		return NULL;
+	}
+
+	// Every child is answered under its own request ID, in the order appended.
+	int children = request->getChildrenCount();
+	for (int i = 0; i < children; i++) {
+		IO2GRequest *childRequest = request->getChildRequest(i);
+		requestIndexes[childRequest->getRequestID()] = offset + i;
+		requestIDs.push_back(childRequest->getRequestID());
+		childRequest->release();
+	}
+	if (children == 0) {
+		requestIndexes[request->getRequestID()] = offset;
+		requestIDs.push_back(request->getRequestID());
+	}
+	return request;
+}
+
+// Called under m_csRequest: the response listener awaits one call's request
+// IDs at a time, so concurrent calls (the trailing-stop thread's flushes and
+// the host's orders) take turns from setRequestID(s) to the last response.
+int COrder2Go::collectResponses(map<string, size_t>& requestIndexes, vector<CResponse*>& responses)
+{
+	nsapi::WaitForSingleObject(m_pResponseListener->getReponseEvent(), INFINITE);
+	int count = 0;
+	CResponse* response;
+	while ((response = m_pResponseListener->popResponse()) != NULL) {
+		map<string, size_t>::iterator mpos = requestIndexes.find(response->getRequestID());
+		if (mpos != requestIndexes.end() && mpos->second < responses.size() && !responses[mpos->second]) {
+			responses[mpos->second] = response;
+			count++;
+		}
+		else {
 			delete response;
 		}
 	}
+	return count;
+}
 
-	valuemap->release();
-	requestFactory->release();
-	return ret;
+int COrder2Go::countCompleted(vector<CResponse*>& responses)
+{
+	int count = 0;
+	for (size_t i = 0; i < responses.size(); i++) {
+		if (!responses[i]) {
+			continue;
+		}
+		if (responses[i]->getResponseStatus() == CResponse::COMPLETED) {
+			count++;
+		}
+		else {
+			m_pPluginProxy->onMessage(MSG_ERROR, responses[i]->getError().c_str());
+		}
+		delete responses[i];
+	}
+	responses.clear();
+	return count;
+}
+
+void COrder2Go::releaseValueMaps(vector<IO2GValueMap*>& valuemaps)
+{
+	for (size_t i = 0; i < valuemaps.size(); i++) {
+		valuemaps[i]->release();
+	}
+	valuemaps.clear();
+}
+
+string COrder2Go::orderIDOfResponse(CResponse* response)
+{
+	string orderID;
+	if (response->getResponseStatus() == CResponse::COMPLETED) {
+		IO2GResponseReaderFactory *factory = m_pSession->getResponseReaderFactory();
+		if (factory) {
+			IO2GOrderResponseReader *responseReader  = factory->createOrderResponseReader(response->getIResponse());
+			if (responseReader) {
+				orderID = responseReader->getOrderID();
+				responseReader->release();
+			}
+			factory->release();
+		}
+	} else {
+		m_pPluginProxy->onMessage(MSG_ERROR, response->getError().c_str());
+	}
+	return orderID;
 }
 
 int COrder2Go::logout()
@@ -447,6 +740,15 @@ int COrder2Go::logout()
 	return RET_FAILED;
 }
 
+// UTC (Sunday 19:00 - Friday 21:00) by default.
+void COrder2Go::initMarketCalendar()
+{
+	m_MarketCalendar.setWeek(atoi(getMarketInfo("OpenWday", "0")), atoi(getMarketInfo("OpenHour", "19")),
+		atoi(getMarketInfo("CloseWday", "5")), atoi(getMarketInfo("CloseHour", "21")));
+	m_MarketCalendar.addHolidays(getMarketInfo("Holidays"));
+	m_MarketCalendar.addEarlyCloses(getMarketInfo("EarlyCloses"));
+}
+
 void COrder2Go::onConnected()
 {
 	logTimeFrames();
@@ -584,25 +886,53 @@ int COrder2Go::subscribeTableListener(IO2GTableManager *manager, IO2GTableListen
 	while (manager->getStatus() != TablesLoaded && manager->getStatus() != TablesLoadFailed) {
 		nsapi::Sleep(50);
 	}
-	if (manager->getStatus() == TablesLoaded) {
-		m_bSubscribed = true;
-		O2G2Ptr<IO2GOffersTable> offersTable = (IO2GOffersTable*)manager->getTable(::Offers);
-		O2G2Ptr<IO2GAccountsTable> accountsTable = (IO2GAccountsTable*)manager->getTable(::Accounts);
-		O2G2Ptr<IO2GOrdersTable> ordersTable = (IO2GOrdersTable *)manager->getTable(::Orders);
-		O2G2Ptr<IO2GTradesTable> tradesTable = (IO2GTradesTable*)manager->getTable(::Trades);
-		O2G2Ptr<IO2GClosedTradesTable> closeTradesTable = (IO2GClosedTradesTable*)manager->getTable(::ClosedTrades);
-		offersTable->subscribeUpdate(Update, listener);
-		accountsTable->subscribeUpdate(Update, listener);
-		ordersTable->subscribeUpdate(Insert, listener);
-		ordersTable->subscribeUpdate(Update, listener);
-		ordersTable->subscribeUpdate(Delete, listener);
-		tradesTable->subscribeUpdate(Insert, listener);
-		tradesTable->subscribeUpdate(Update, listener);
-		tradesTable->subscribeUpdate(Delete, listener);
-		closeTradesTable->subscribeUpdate(Insert, listener);
+	if (manager->getStatus() != TablesLoaded) {
+		return RET_FAILED;
+	}
+
+	O2G2Ptr<IO2GOffersTable> offersTable = (IO2GOffersTable*)manager->getTable(::Offers);
+	m_pTableListener->loadPrices(offersTable);
+	addDepthSymbols(offersTable);
+	if (m_bRawUpdates) {
+		// The table manager only provides the initial snapshot, updates come from the response listener.
 		return RET_SUCCESS;
 	}
-	return RET_FAILED;
+
+	m_bSubscribed = true;
+	O2G2Ptr<IO2GAccountsTable> accountsTable = (IO2GAccountsTable*)manager->getTable(::Accounts);
+	O2G2Ptr<IO2GOrdersTable> ordersTable = (IO2GOrdersTable *)manager->getTable(::Orders);
+	O2G2Ptr<IO2GTradesTable> tradesTable = (IO2GTradesTable*)manager->getTable(::Trades);
+	O2G2Ptr<IO2GClosedTradesTable> closeTradesTable = (IO2GClosedTradesTable*)manager->getTable(::ClosedTrades);
+	offersTable->subscribeUpdate(Update, listener);
+	accountsTable->subscribeUpdate(Update, listener);
+	ordersTable->subscribeUpdate(Insert, listener);
+	ordersTable->subscribeUpdate(Update, listener);
+	ordersTable->subscribeUpdate(Delete, listener);
+	tradesTable->subscribeUpdate(Insert, listener);
+	tradesTable->subscribeUpdate(Update, listener);
+	tradesTable->subscribeUpdate(Delete, listener);
+	closeTradesTable->subscribeUpdate(Insert, listener);
+	return RET_SUCCESS;
+}
+
+// Level 2 quotes only carry the offer's numeric ID, so the configured
+// symbols are resolved against the offers table once it is loaded.
+void COrder2Go::addDepthSymbols(IO2GOffersTable *offersTable)
+{
+	string symbols = string(",") + getDepthInfo("Symbols") + ",";
+	if (symbols.length() <= 2) {
+		return;
+	}
+
+	IO2GOfferTableRow *offerRow = NULL;
+	IO2GTableIterator tableIterator;
+	while (offersTable->getNextRow(tableIterator, offerRow)) {
+		string instrument = string(",") + offerRow->getInstrument() + ",";
+		if (symbols.find(instrument) != string::npos) {
+			m_pDepthBook->addSymbol(atoi(offerRow->getOfferID()), offerRow->getInstrument());
+		}
+		offerRow->release();
+	}
 }
 
 void COrder2Go::unsubscribeTableListener(IO2GTableManager *manager, IO2GTableListener *listener)
@@ -625,53 +955,67 @@ void COrder2Go::unsubscribeTableListener(IO2GTableManager *manager, IO2GTableLis
 	}
 }
 
-int COrder2Go::getHistoricalData(const char* symbol, const char* period, time_t start, int maxNumber, vector<TblCandle*>& tblCandleList)
-{
-	time_t end = start + getTimetByPeriod(period) * maxNumber;
-	int ret = getHistoricalData(symbol, period, start, end, maxNumber, tblCandleList);
-	if (ret > 0) {
-		char buf[256];
-		tm tmStart = CUtils::getUTCCal(start);
-		tm tmEnd = CUtils::getUTCCal(end);
-		tm tmOutStart = CUtils::getUTCCal(tblCandleList.front()->StartDate);
-		tm tmOutEnd = CUtils::getUTCCal(tblCandleList.back()->StartDate);
-		sprintf(buf, "[GetHistoricalData] Count:%d StartDate:%s EndDate:%s OutStartDate:%s OutEndDate:%s",
-			ret,
-			CUtils::strOfTime(&tmStart, TimeFormat).c_str(),
-			CUtils::strOfTime(&tmEnd, TimeFormat).c_str(),
-			CUtils::strOfTime(&tmOutStart, TimeFormat).c_str(),
-			CUtils::strOfTime(&tmOutEnd, TimeFormat).c_str());
-		m_pPluginProxy->onMessage(MSG_DEBUG, buf);
-	}
-	return ret;
-}
-
-int COrder2Go::getHistoricalData(const char* symbol, const char* period, time_t start, time_t end, int maxNumber, vector<TblCandle*>& tblCandleList)
-{
-	DATE dtStart = CTableListener::time2Date(CUtils::getUTCCal(start));
-	DATE dtEnd = CTableListener::time2Date(CUtils::getUTCCal(end));
-	return getHistoricalData(symbol, period, dtStart, dtEnd, maxNumber, tblCandleList);
-}
-
-int COrder2Go::getHistoricalData(const char* symbol, const char* period, double start, double end, int maxNumber, vector<TblCandle*>& tblCandleList)
+int COrder2Go::getHistoricalData(const char* symbol, const char* period, vector<pair<time_t, time_t> >& windows, vector<vector<TblCandle*> >& tblCandleLists)
 {
+	tblCandleLists.assign(windows.size(), vector<TblCandle*>());
 	IO2GRequestFactory *requestFactory = m_pSession->getRequestFactory();
-	IO2GTimeframeCollection * timeFrames = requestFactory->getTimeFrameCollection();
-	IO2GTimeframe * timeFrame = timeFrames->get(period);
-	IO2GRequest * request = requestFactory->createMarketDataSnapshotRequestInstrument(symbol, timeFrame, maxNumber);
-	requestFactory->fillMarketDataSnapshotRequestTime(request, start, end, true);
-	m_pResponseListener->setRequestID(request->getRequestID());
-	m_pSession->sendRequest(request);
-	request->release();
+	IO2GTimeframeCollection *timeFrames = requestFactory->getTimeFrameCollection();
+	IO2GTimeframe *timeFrame = timeFrames->get(period);
+
+	vector<IO2GRequest*> requests;
+	map<string, size_t> requestIndexes;
+	vector<string> requestIDs;
+	for (size_t i = 0; i < windows.size(); i++) {
+		IO2GRequest *request = requestFactory->createMarketDataSnapshotRequestInstrument(symbol, timeFrame, CandleMaxNumber);
+		if (!request) {
+			m_pPluginProxy->onMessage(MSG_ERROR, requestFactory->getLastError());
+			continue;
+		}
+		DATE dtStart = CTableListener::time2Date(CUtils::getUTCCal(windows[i].first));
+		DATE dtEnd = CTableListener::time2Date(CUtils::getUTCCal(windows[i].second));
+		requestFactory->fillMarketDataSnapshotRequestTime(request, dtStart, dtEnd, true);
+		requestIndexes[request->getRequestID()] = i;
+		requestIDs.push_back(request->getRequestID());
+		requests.push_back(request);
+	}
+	if (timeFrame) {
+		timeFrame->release();
+	}
+	timeFrames->release();
 	requestFactory->release();
+	if (requests.empty()) {
+		return RET_FAILED;
+	}
+
+	// All windows are in flight together; each answer is matched back by its request ID.
+	vector<CResponse*> responses(windows.size(), (CResponse*)NULL);
+	{
+		CCriticalSection::Lock l(m_csRequest);
+		m_pResponseListener->setRequestIDs(requestIDs);
+		for (size_t i = 0; i < requests.size(); i++) {
+			m_pSession->sendRequest(requests[i]);
+			requests[i]->release();
+		}
+		collectResponses(requestIndexes, responses);
+	}
 
 	int ret = 0;
-	nsapi::WaitForSingleObject(m_pResponseListener->getReponseEvent(), INFINITE);
-	CResponse* response = m_pResponseListener->popResponse();
-	if (!response) {
-		return ret;
+	for (size_t i = 0; i < responses.size(); i++) {
+		if (!responses[i]) {
+			continue;
+		}
+		if (candleOfResponse(symbol, period, responses[i], tblCandleLists[i]) > 0) {
+			logHistoricalData(windows[i].first, windows[i].second, tblCandleLists[i]);
+			ret += tblCandleLists[i].size();
+		}
+		delete responses[i];
 	}
+	return ret;
+}
 
+int COrder2Go::candleOfResponse(const char* symbol, const char* period, CResponse* response, vector<TblCandle*>& tblCandleList)
+{
+	int ret = 0;
 	if (response->getResponseStatus() == CResponse::COMPLETED) {
 		IO2GResponseReaderFactory *factory = m_pSession->getResponseReaderFactory();
 		if (factory) {
@@ -690,11 +1034,25 @@ int COrder2Go::getHistoricalData(const char* symbol, const char* period, double
 			m_pPluginProxy->onMessage(MSG_ERROR, error.c_str());
 		}
 	}
-
-	delete response;
 	return ret;
 }
 
+void COrder2Go::logHistoricalData(time_t start, time_t end, vector<TblCandle*>& tblCandleList)
+{
+	char buf[256];
+	tm tmStart = CUtils::getUTCCal(start);
+	tm tmEnd = CUtils::getUTCCal(end);
+	tm tmOutStart = CUtils::getUTCCal(tblCandleList.front()->StartDate);
+	tm tmOutEnd = CUtils::getUTCCal(tblCandleList.back()->StartDate);
+	sprintf(buf, "[GetHistoricalData] Count:%d StartDate:%s EndDate:%s OutStartDate:%s OutEndDate:%s",
+		(int)tblCandleList.size(),
+		CUtils::strOfTime(&tmStart, TimeFormat).c_str(),
+		CUtils::strOfTime(&tmEnd, TimeFormat).c_str(),
+		CUtils::strOfTime(&tmOutStart, TimeFormat).c_str(),
+		CUtils::strOfTime(&tmOutEnd, TimeFormat).c_str());
+	m_pPluginProxy->onMessage(MSG_DEBUG, buf);
+}
+
 int COrder2Go::candleOfReader(const char* symbol, const char* period, IO2GMarketDataSnapshotResponseReader* reader, vector<TblCandle*>& tblCandleList)
 {
 	if (!reader->isBar()) {
@@ -764,6 +1122,26 @@ const char* COrder2Go::getMarketInfo(const char* key, const char* defval)
 	return m_SimpleIni.GetValue("Market", key, defval);
 }
 
+const char* COrder2Go::getJournalInfo(const char* key, const char* defval)
+{
+	return m_SimpleIni.GetValue("Journal", key, defval);
+}
+
+const char* COrder2Go::getRecorderInfo(const char* key, const char* defval)
+{
+	return m_SimpleIni.GetValue("Recorder", key, defval);
+}
+
+const char* COrder2Go::getUpdatesInfo(const char* key, const char* defval)
+{
+	return m_SimpleIni.GetValue("Updates", key, defval);
+}
+
+const char* COrder2Go::getDepthInfo(const char* key, const char* defval)
+{
+	return m_SimpleIni.GetValue("Depth", key, defval);
+}
+
 time_t COrder2Go::getTimetByPeriod(const char* period)
 {
 	for (int i = 0; period2time[i].period; i++) {
@@ -6,6 +6,12 @@
 #include "SessionStatusListener.h"
 #include "ResponseListener.h"
 #include "TableListener.h"
+#include "DepthBook.h"
+#include "ProxyRecorder.h"
+#include "TickJournal.h"
+#include "TrailingStop.h"
+#include "MarketCalendar.h"
+#include "Tracer.h"
 
 class COrder2Go : public IBaseOrder
 {
@@ -13,13 +19,21 @@ private:
 	IO2GSession *m_pSession;
 	CSessionStatusListener *m_pSessionStatusListener;
 	CResponseListener *m_pResponseListener;
+	CCriticalSection m_csRequest;
 	CTableListener *m_pTableListener;
+	CDepthBook *m_pDepthBook;
 	bool m_bSubscribed;
+	bool m_bRawUpdates;
 	CSimpleIniCaseA m_SimpleIni;
 	IPluginProxy *m_pPluginProxy;
+	CProxyRecorder *m_pProxyRecorder;
+	CTickJournal *m_pTickJournal;
+	CTrailingStop *m_pTrailingStop;
+	CMarketCalendar m_MarketCalendar;
 
 public:
 	COrder2Go();
+	~COrder2Go();
 
 	int init(const char* iniFile);
 	int login();
@@ -27,6 +41,7 @@ public:
 	time_t getServerTime();
 	int getAccount(const char* accountID, TblAccount** tblAccount);
 	int getPrice(const char* symbols[], TblPrice** pTblPrice[]);
+	int getDepth(const char* symbol, TblDepth** tblDepth);
 	int getOpenedTrades(TblTrade** pTblTrade[]);
 	int getClosedTrades(TblTrade** pTblTrade[]);
 	int getHistoricalData(const char* symbol, const char* period, time_t start, time_t end, bool maxRange, TblCandle** pTblCandle[]);
@@ -34,24 +49,50 @@ public:
 	int changeStopLoss(TblTrade* tblTrade);
 	int changeTakeProfit(TblTrade* tblTrade);
 	int closeTrade(TblTrade* tblTrade);
+	int openMarketOrders(TblOrder* tblOrders[]);
+	int changeStopLosses(TblTrade* tblTrades[]);
+	int changeTakeProfits(TblTrade* tblTrades[]);
+	int closeTrades(TblTrade* tblTrades[]);
+	int setTrailingStop(TblTrade* tblTrade, double distance, double step);
+	int removeTrailingStop(TblTrade* tblTrade);
+	int subscribe(const char* symbols[]);
+	int unsubscribe(const char* symbols[]);
 
 private:
 	int logout();
+	void initMarketCalendar();
 	void onConnected();
 	void logTimeFrames();
 	void printSettings();
 	void onSystemPropertiesReceived(IO2GResponse *response);
 	int subscribeTableListener(IO2GTableManager *manager, IO2GTableListener *listener);
+	void addDepthSymbols(IO2GOffersTable *offersTable);
 	void unsubscribeTableListener(IO2GTableManager *manager, IO2GTableListener *listener);
-	int getHistoricalData(const char* symbol, const char* period, time_t start, int maxNumber, vector<TblCandle*>& tblCandleList);
-	int getHistoricalData(const char* symbol, const char* period, time_t start, time_t end, int maxNumber, vector<TblCandle*>& tblCandleList);
-	int getHistoricalData(const char* symbol, const char* period, double start, double end, int maxNumber, vector<TblCandle*>& tblCandleList);
+	int getHistoricalData(const char* symbol, const char* period, vector<pair<time_t, time_t> >& windows, vector<vector<TblCandle*> >& tblCandleLists);
+	int candleOfResponse(const char* symbol, const char* period, CResponse* response, vector<TblCandle*>& tblCandleList);
+	void logHistoricalData(time_t start, time_t end, vector<TblCandle*>& tblCandleList);
+	int changeOrder(TblTrade* tblTrade, const char* orderType);
+	int changeOrders(TblTrade* tblTrades[], const char* orderType);
+	void fillOpenMarketOrder(IO2GValueMap *valuemap, TblOrder* tblOrder);
+	bool fillChangeOrder(IO2GValueMap *valuemap, TblTrade* tblTrade, const char* orderType);
+	void fillCloseTrade(IO2GValueMap *valuemap, TblTrade* tblTrade);
+	int sendBatchRequest(IO2GRequestFactory *requestFactory, const char* command, vector<IO2GValueMap*>& valuemaps, vector<CResponse*>& responses);
+	IO2GRequest* createBatchRequest(IO2GRequestFactory *requestFactory, const char* command, vector<IO2GValueMap*>& valuemaps,
+		size_t offset, map<string, size_t>& requestIndexes, vector<string>& requestIDs);
+	int collectResponses(map<string, size_t>& requestIndexes, vector<CResponse*>& responses);
+	int countCompleted(vector<CResponse*>& responses);
+	void releaseValueMaps(vector<IO2GValueMap*>& valuemaps);
+	string orderIDOfResponse(CResponse* response);
 	int candleOfReader(const char* symbol, const char* period, IO2GMarketDataSnapshotResponseReader* reader, vector<TblCandle*>& tblCandleList);
 	string getOrderID(string tradeID, string orderType);
 	string getLimitOrderID(string tradeID);
 	string getStopOrderID(string tradeID);
 	const char* getLoginInfo(const char* key, const char* defval = "");
 	const char* getMarketInfo(const char* key, const char* defval = "");
+	const char* getDepthInfo(const char* key, const char* defval = "");
+	const char* getUpdatesInfo(const char* key, const char* defval = "");
+	const char* getRecorderInfo(const char* key, const char* defval = "");
+	const char* getJournalInfo(const char* key, const char* defval = "");
 	static time_t getTimetByPeriod(const char* period);
 };
 
@@ -15,8 +15,10 @@
 */
 #include "stdafx.h"
 #include "ResponseListener.h"
+#include "Tracer.h"
 
-CResponseListener::CResponseListener()
+CResponseListener::CResponseListener(IO2GSession *session, CDepthBook *depthBook, CTableListener *tableListener)
+	: m_pSession(session), m_pDepthBook(depthBook), m_pTableListener(tableListener)
 {
 	m_hResponse = nsapi::CreateEvent(NULL, FALSE, FALSE, NULL);
 }
@@ -29,28 +31,74 @@ CResponseListener::~CResponseListener()
 
 void CResponseListener::setRequestID(const char* requestID)
 {
-	m_sRequestID = requestID;
+	CCriticalSection::Lock l(m_csQueue);
+	m_setRequestIDs.clear();
+	m_setRequestIDs.insert(requestID);
+}
+
+void CResponseListener::setRequestIDs(vector<string>& requestIDs)
+{
+	CCriticalSection::Lock l(m_csQueue);
+	m_setRequestIDs.clear();
+	m_setRequestIDs.insert(requestIDs.begin(), requestIDs.end());
 }
 
 void CResponseListener::onRequestCompleted(const char* requestID, IO2GResponse* response)
 {
-	if (requestID && m_sRequestID == requestID) {
+	TRACE_INSTANT("onRequestCompleted", requestID);
+	if (requestID && completeRequestID(requestID)) {
 		response->addRef();
 		pushResponse(new CResponse(CResponse::COMPLETED, response, requestID, ""));
-		nsapi::SetEvent(m_hResponse);
+		signalIfCompleted();
 	}
 }
 
 void CResponseListener::onRequestFailed(const char* requestID , const char* error)
 {
-	if (requestID && m_sRequestID == requestID) {
+	TRACE_INSTANT("onRequestFailed", requestID);
+	if (requestID && completeRequestID(requestID)) {
 		pushResponse(new CResponse(CResponse::FAILED, NULL, requestID, error));
-		nsapi::SetEvent(m_hResponse);
+		signalIfCompleted();
 	}
 }
 
 void CResponseListener::onTablesUpdates(IO2GResponse* data)
 {
+	if (data->getType() == Level2MarketData) {
+		onLevel2MarketData(data);
+	}
+	else if (data->getType() == TablesUpdates && m_pTableListener) {
+		onRawTablesUpdates(data);
+	}
+}
+
+void CResponseListener::onLevel2MarketData(IO2GResponse* data)
+{
+	if (m_pDepthBook->empty()) {
+		return;
+	}
+	IO2GResponseReaderFactory *factory = m_pSession->getResponseReaderFactory();
+	if (factory) {
+		IO2GLevel2MarketDataUpdatesReader *reader = factory->createLevel2MarketDataReader(data);
+		if (reader) {
+			m_pDepthBook->onLevel2MarketData(reader);
+			reader->release();
+		}
+		factory->release();
+	}
+}
+
+void CResponseListener::onRawTablesUpdates(IO2GResponse* data)
+{
+	IO2GResponseReaderFactory *factory = m_pSession->getResponseReaderFactory();
+	if (factory) {
+		IO2GTablesUpdatesReader *reader = factory->createTablesUpdatesReader(data);
+		if (reader) {
+			m_pTableListener->onTablesUpdates(reader);
+			reader->release();
+		}
+		factory->release();
+	}
 }
 
 void CResponseListener::pushResponse(CResponse* response)
@@ -70,6 +118,22 @@ CResponse* CResponseListener::popResponse()
 	return response;
 }
 
+bool CResponseListener::completeRequestID(const char* requestID)
+{
+	CCriticalSection::Lock l(m_csQueue);
+	return m_setRequestIDs.erase(requestID) > 0;
+}
+
+// The waiting thread is woken once every awaited request has answered,
+// so a batch of child requests costs a single wait.
+void CResponseListener::signalIfCompleted()
+{
+	CCriticalSection::Lock l(m_csQueue);
+	if (m_setRequestIDs.empty()) {
+		nsapi::SetEvent(m_hResponse);
+	}
+}
+
 void CResponseListener::clearResponseQueue()
 {
 	CCriticalSection::Lock l(m_csQueue);
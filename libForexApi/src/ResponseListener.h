@@ -3,6 +3,8 @@
 
 #include "ForexConnect/ForexConnect.h"
 #include "CriticalSection.h"
+#include "DepthBook.h"
+#include "TableListener.h"
 
 class CResponse
 {
@@ -37,16 +39,20 @@ class CResponseListener : public IO2GResponseListener
 {
 private:
 	HANDLE m_hResponse;
-	string m_sRequestID;
+	IO2GSession *m_pSession;
+	CDepthBook *m_pDepthBook;
+	CTableListener *m_pTableListener;
+	set<string> m_setRequestIDs;
 	queue<CResponse*> m_qeResponses;
 	CCriticalSection m_csQueue;
 
 public:
-	CResponseListener();
+	CResponseListener(IO2GSession *session, CDepthBook *depthBook, CTableListener *tableListener);
 	~CResponseListener();
 
 	HANDLE getReponseEvent() const { return m_hResponse; };
 	void setRequestID(const char* requestID);
+	void setRequestIDs(vector<string>& requestIDs);
 
 	long addRef() { return 0; };
 	long release() { return 0; };
@@ -59,6 +65,10 @@ public:
 
 private:
 	void clearResponseQueue();
+	void onLevel2MarketData(IO2GResponse* data);
+	void onRawTablesUpdates(IO2GResponse* data);
+	bool completeRequestID(const char* requestID);
+	void signalIfCompleted();
 };
 
 #endif
@@ -16,6 +16,7 @@
 #include "stdafx.h"
 #include "Utils.h"
 #include "TableListener.h"
+#include "Tracer.h"
 
 void CTableListener::onStatusChanged(O2GTableStatus status)
 {
@@ -41,9 +42,18 @@ void CTableListener::onTableRowAdded(TableStatus status, IO2GRow* row)
 	switch (row->getTableType()) {
 	case Offers:
 		{
-			TblPrice* tblPrice = makTblPrice((IO2GOfferTableRow*)row);
+			// Ticks only refresh the changing fields of the cached price.
+			CCriticalSection::Lock l(m_csPrices);
+			TblPrice* tblPrice = mergeTblPrice((IO2GOfferRow*)row, CUtils::getRealtimeNs());
+			if (!tblPrice) {
+				tblPrice = addTblPrice((IO2GOfferTableRow*)row);
+			}
+			tblPrice->PipCost = ((IO2GOfferTableRow*)row)->getPipCost();
 			m_pPluginProxy->onPrice(status, tblPrice);
-			delete tblPrice;
+			if (m_pTickJournal) {
+				m_pTickJournal->append(tblPrice, CTickJournal::getRealtimeNs());
+			}
+			m_pTrailingStop->onPrice(tblPrice);
 		}
 		break;
 	case Accounts:
@@ -56,6 +66,7 @@ void CTableListener::onTableRowAdded(TableStatus status, IO2GRow* row)
 	case Orders:
 		{
 			TblOrder* tblOrder = makTblOrder((IO2GOrderTableRow*)row);
+			TRACE_INSTANT("onOrder", tblOrder->OrderID);
 			m_pPluginProxy->onOrder(status, tblOrder);
 			delete tblOrder;
 		}
@@ -63,7 +74,11 @@ void CTableListener::onTableRowAdded(TableStatus status, IO2GRow* row)
 	case Trades:
 		{
 			TblTrade* tblTrade = makOpenTblTrade((IO2GTradeTableRow*)row);
+			TRACE_INSTANT("onOpenedTrade", tblTrade->TradeID);
 			m_pPluginProxy->onOpenedTrade(status, tblTrade);
+			if (status == ST_DEL) {
+				m_pTrailingStop->remove(tblTrade->TradeID);
+			}
 			delete tblTrade;
 		}
 		break;
@@ -81,14 +96,184 @@ void CTableListener::onTableRowAdded(TableStatus status, IO2GRow* row)
 	}
 }
 
+// Symbol, SymbolType, PointSize and PipCost are formatted once per offer here.
+void CTableListener::loadPrices(IO2GOffersTable* offersTable)
+{
+	CCriticalSection::Lock l(m_csPrices);
+	IO2GOfferTableRow *offerRow = NULL;
+	IO2GTableIterator tableIterator;
+	while (offersTable->getNextRow(tableIterator, offerRow)) {
+		addTblPrice(offerRow);
+		offerRow->release();
+	}
+}
+
+TblPrice* CTableListener::addTblPrice(IO2GOfferTableRow* offerRow)
+{
+	return cacheTblPrice(makTblPrice(offerRow));
+}
+
+// Takes ownership of tblPrice.
+TblPrice* CTableListener::cacheTblPrice(TblPrice* tblPrice)
+{
+	TblPrice& cached = m_mapPrices[tblPrice->OfferID];
+	cached = *tblPrice;
+	delete tblPrice;
+	return &cached;
+}
+
+// Reads the raw server batch in two passes. Offer rows only carry the changed
+// columns, so the first pass merges them into the cached prices; an offer not
+// cached yet (inserted, or unknown at login) is seeded from its row. The
+// second pass sends the rows in batch order, each offer once at its last row
+// with its latest values. The whole batch shares one receive time.
+void CTableListener::onTablesUpdates(IO2GTablesUpdatesReader* reader)
+{
+	CCriticalSection::Lock l(m_csPrices);
+	int64_t recvTimeNs = CTickJournal::getRealtimeNs();
+	int size = reader->size();
+	m_vtBatchPrices.assign(size, NULL);
+
+	for (int i = 0; i < size; i++) {
+		if (reader->getUpdateTable(i) != Offers || reader->getUpdateType(i) == Delete) {
+			continue;
+		}
+		O2G2Ptr<IO2GOfferRow> offerRow = reader->getOfferRow(i);
+		TblPrice* tblPrice = mergeTblPrice(offerRow, recvTimeNs);
+		if (!tblPrice && offerRow->isOfferIDValid() && offerRow->isInstrumentValid()) {
+			tblPrice = cacheTblPrice(makTblPrice(offerRow));
+		}
+		m_vtBatchPrices[i] = tblPrice;
+	}
+	m_vtSentPrices.clear();
+	for (int i = size - 1; i >= 0; i--) {
+		if (!m_vtBatchPrices[i]) {
+			continue;
+		}
+		if (std::find(m_vtSentPrices.begin(), m_vtSentPrices.end(), m_vtBatchPrices[i]) != m_vtSentPrices.end()) {
+			m_vtBatchPrices[i] = NULL;
+		}
+		else {
+			m_vtSentPrices.push_back(m_vtBatchPrices[i]);
+		}
+	}
+
+	for (int i = 0; i < size; i++) {
+		TableStatus status = statusOfUpdate(reader->getUpdateType(i));
+		switch (reader->getUpdateTable(i)) {
+		case Offers:
+			if (m_vtBatchPrices[i]) {
+				m_pPluginProxy->onPrice(status, m_vtBatchPrices[i]);
+				if (m_pTickJournal) {
+					m_pTickJournal->append(m_vtBatchPrices[i], recvTimeNs);
+				}
+				m_pTrailingStop->onPrice(m_vtBatchPrices[i]);
+			}
+			break;
+		case Accounts:
+			if (status == ST_UPD) {
+				O2G2Ptr<IO2GAccountRow> accountRow = reader->getAccountRow(i);
+				TblAccount* tblAccount = makTblAccount(accountRow);
+				m_pPluginProxy->onAccount(status, tblAccount);
+				delete tblAccount;
+			}
+			break;
+		case Orders:
+			{
+				O2G2Ptr<IO2GOrderRow> orderRow = reader->getOrderRow(i);
+				TblOrder* tblOrder = makTblOrder(orderRow);
+				TRACE_INSTANT("onOrder", tblOrder->OrderID);
+				m_pPluginProxy->onOrder(status, tblOrder);
+				delete tblOrder;
+			}
+			break;
+		case Trades:
+			{
+				O2G2Ptr<IO2GTradeRow> tradeRow = reader->getTradeRow(i);
+				TblTrade* tblTrade = makOpenTblTrade(tradeRow);
+				TRACE_INSTANT("onOpenedTrade", tblTrade->TradeID);
+				m_pPluginProxy->onOpenedTrade(status, tblTrade);
+				if (status == ST_DEL) {
+					m_pTrailingStop->remove(tblTrade->TradeID);
+				}
+				delete tblTrade;
+			}
+			break;
+		case ClosedTrades:
+			if (status == ST_NEW) {
+				O2G2Ptr<IO2GClosedTradeRow> tradeRow = reader->getClosedTradeRow(i);
+				TblTrade* tblTrade = makClosedTblTrade(tradeRow);
+				if (strlen(tblTrade->CloseOrderID) > 0) {
+					m_pPluginProxy->onClosedTrade(status, tblTrade);
+				}
+				delete tblTrade;
+			}
+			break;
+		default:
+			break;
+		}
+	}
+}
+
+TblPrice* CTableListener::mergeTblPrice(IO2GOfferRow* offerRow, int64_t recvNs)
+{
+	map<string, TblPrice>::iterator mpos = m_mapPrices.find(offerRow->getOfferID());
+	if (mpos == m_mapPrices.end()) {
+		return NULL;
+	}
+
+	TblPrice& tblPrice = mpos->second;
+	if (offerRow->isBidValid()) {
+		tblPrice.Bid = offerRow->getBid();
+	}
+	if (offerRow->isAskValid()) {
+		tblPrice.Ask = offerRow->getAsk();
+	}
+	if (offerRow->isHighValid()) {
+		tblPrice.High = offerRow->getHigh();
+	}
+	if (offerRow->isLowValid()) {
+		tblPrice.Low = offerRow->getLow();
+	}
+	TblTimeExt ext;
+	int64_t timeNs = getTimeExt(&tblPrice, &ext) ? ext.TimeNs : 0;
+	if (offerRow->isTimeValid()) {
+		tblPrice.Time = date2Time(offerRow->getTime());
+		timeNs = date2TimeNs(offerRow->getTime());
+	}
+	setTimeExt(&tblPrice, timeNs, 0, recvNs);
+	return &tblPrice;
+}
+
+TableStatus CTableListener::statusOfUpdate(O2GTableUpdateType updateType)
+{
+	switch (updateType) {
+	case Insert:
+		return ST_NEW;
+	case Update:
+		return ST_UPD;
+	case Delete:
+		return ST_DEL;
+	default:
+		return ST_UNKNOWN;
+	}
+}
+
+// Truncated from date2TimeNs, so Time and TimeNs name the same second.
 time_t CTableListener::date2Time(DATE date)
 {
-	tm cal;
-	if (CO2GDateUtils::OleTimeToCTime(date, &cal)) {
-		return CUtils::getUTCTime(&cal);
-	} else {
+	return (time_t)(date2TimeNs(date) / 1000000000);
+}
+
+// OLE dates count days from 1899-12-30, 25569 days before the epoch.
+// A DATE keeps about a microsecond of precision for current dates, rounding
+// to it keeps whole seconds whole.
+int64_t CTableListener::date2TimeNs(DATE date)
+{
+	if (date < 25569) {
 		return 0;
 	}
+	return (int64_t)((date - 25569) * 86400e6 + 0.5) * 1000;
 }
 
 DATE CTableListener::time2Date(tm t)
@@ -142,6 +327,7 @@ TblPrice* CTableListener::makTblPrice(IO2GOfferRow *offerRow)
 		tblPrice->PointSize = offerRow->getPointSize();
 	}
 	tblPrice->Reserve[0] = '\0';
+	setTimeExt(tblPrice, date2TimeNs(offerRow->getTime()), 0, CUtils::getRealtimeNs());
 	return tblPrice;
 }
 
@@ -168,6 +354,7 @@ TblOrder* CTableListener::makTblOrder(IO2GOrderRow *orderRow)
 	tblOrder->Rate = orderRow->getRate();
 	tblOrder->Time = date2Time(orderRow->getStatusTime());
 	tblOrder->Reserve[0] = '\0';
+	setTimeExt(tblOrder, date2TimeNs(orderRow->getStatusTime()), 0, CUtils::getRealtimeNs());
 	return tblOrder;
 }
 
@@ -197,6 +384,7 @@ TblTrade* CTableListener::makOpenTblTrade(IO2GTradeRow *tradeRow)
 	tblTrade->StopOrderID[0] = '\0';
 	tblTrade->LimitOrderID[0] = '\0';
 	tblTrade->Reserve[0] = '\0';
+	setTimeExt(tblTrade, date2TimeNs(tradeRow->getOpenTime()), 0, CUtils::getRealtimeNs());
 	return tblTrade;
 }
 
@@ -236,6 +424,7 @@ TblTrade* CTableListener::makClosedTblTrade(IO2GClosedTradeRow *tradeRow)
 	tblTrade->StopOrderID[0] = '\0';
 	tblTrade->LimitOrderID[0] = '\0';
 	tblTrade->Reserve[0] = '\0';
+	setTimeExt(tblTrade, date2TimeNs(tradeRow->getOpenTime()), date2TimeNs(tradeRow->getCloseTime()), CUtils::getRealtimeNs());
 	return tblTrade;
 }
 
@@ -7,15 +7,23 @@
 #include "CriticalSection.h"
 #include "IPluginProxy.h"
 #include "Table.h"
+#include "TickJournal.h"
+#include "TrailingStop.h"
 
 class CTableListener : public IO2GTableListener
 {
 private:
 	IPluginProxy *m_pPluginProxy;
+	CTickJournal *m_pTickJournal;
+	CTrailingStop *m_pTrailingStop;
+	map<string, TblPrice> m_mapPrices;
+	vector<TblPrice*> m_vtBatchPrices;
+	vector<TblPrice*> m_vtSentPrices;
+	CCriticalSection m_csPrices;
 
 public:
-	CTableListener(IPluginProxy* pluginProxy)
-		: m_pPluginProxy(pluginProxy) {};
+	CTableListener(IPluginProxy* pluginProxy, CTickJournal* tickJournal, CTrailingStop* trailingStop)
+		: m_pPluginProxy(pluginProxy), m_pTickJournal(tickJournal), m_pTrailingStop(trailingStop) {};
 
 	long addRef() { return 0; };
 	long release() { return 0; };
@@ -23,8 +31,11 @@ public:
 	void onAdded(const char* rowID, IO2GRow* row);
 	void onChanged(const char* rowID,IO2GRow* row);
 	void onDeleted(const char* rowID,IO2GRow* row);
+	void loadPrices(IO2GOffersTable* offersTable);
+	void onTablesUpdates(IO2GTablesUpdatesReader* reader);
 
 	static time_t date2Time(DATE date);
+	static int64_t date2TimeNs(DATE date);
 	static DATE time2Date(tm t);
 	static TblAccount* makTblAccount(IO2GAccountRow* accountRow);
 	static TblAccount* makTblAccount(IO2GAccountTableRow* accountRow);
@@ -39,6 +50,10 @@ public:
 
 private:
 	void onTableRowAdded(TableStatus status, IO2GRow* row);
+	TblPrice* addTblPrice(IO2GOfferTableRow* offerRow);
+	TblPrice* cacheTblPrice(TblPrice* tblPrice);
+	TblPrice* mergeTblPrice(IO2GOfferRow* offerRow, int64_t recvNs);
+	static TableStatus statusOfUpdate(O2GTableUpdateType updateType);
 };
 
 #endif
\ No newline at end of file
@@ -45,22 +45,25 @@ time_t CUtils::getUTCTime(tm* t)
 	return mktime(t) - getTimeZone();
 }
 
-time_t CUtils::overDayoff(time_t start, int marketOpenWday, int marketOpenHour, int marketCloseWday, int marketCloseHour)
+int64_t CUtils::getMonotonicNs()
 {
-	time_t next = start;
-	tm dtStart = getUTCCal(next);
-	while ((dtStart.tm_wday == marketCloseWday && dtStart.tm_hour > marketCloseHour) ||
-		dtStart.tm_wday == 0 ||
-		(dtStart.tm_wday == marketOpenWday && dtStart.tm_hour < marketOpenHour)) {
-		next += 60;
-		dtStart = getUTCCal(next);
-	}
+	return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
 
-	if (next == start) {
-		next += 3600;	// 1 hour
-	}
+int64_t CUtils::getRealtimeNs()
+{
+	return chrono::duration_cast<chrono::nanoseconds>(chrono::system_clock::now().time_since_epoch()).count();
+}
 
-	return next;
+// Days since 1970-01-01 of a proleptic Gregorian date (H. Hinnant's days_from_civil).
+int64_t CUtils::daysFromCivil(int y, int m, int d)
+{
+	y -= m <= 2;
+	int64_t era = (y >= 0 ? y : y - 399) / 400;
+	int yoe = (int)(y - era * 400);
+	int doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+	int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+	return era * 146097 + doe - 719468;
 }
 
 string CUtils::strOfTime(tm* t, const char* format)
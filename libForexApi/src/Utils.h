@@ -7,8 +7,10 @@ public:
 	static long getTimeZone();
 	static tm getUTCCal(time_t time);
 	static time_t getUTCTime(tm* t);
-	static time_t overDayoff(time_t start, int marketOpenWday, int marketOpenHour, int marketCloseWday, int marketCloseHour);
 	static string strOfTime(tm* t, const char* format);
+	static int64_t getMonotonicNs();
+	static int64_t getRealtimeNs();
+	static int64_t daysFromCivil(int y, int m, int d);
 };
 
 #endif
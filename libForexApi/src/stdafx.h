@@ -9,11 +9,16 @@
 #include <vector>
 #include <queue>
 #include <set>
+#include <map>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
 using namespace std;
 
 #ifdef WIN32
 
 #include <windows.h>
+#include <process.h>
 #define nsapi
 
 #else
@@ -47,7 +52,9 @@ typedef const WCHAR         *LPCWCH, *PCWCH, *LPCWSTR, *PCWSTR;
 #define nsapi gwin
 #define GNUC
 
+#include <signal.h>
 #include <unistd.h>
+#include <pthread.h>
 #include <string.h>
 #include <dirent.h>
 #include <stdint.h>
@@ -55,6 +62,9 @@ typedef const WCHAR         *LPCWCH, *PCWCH, *LPCWSTR, *PCWSTR;
 #include <error.h>
 #include <errno.h>
 #include <sys/timeb.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
 #include "WinEvent.h"
 
 #endif
@@ -0,0 +1,822 @@
+﻿/*
+* Copyright 2020 FXDaemon
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include "stdafx.h"
+#include "SimpleIni.h"
+#include "Thread.h"
+#include "Utils.h"
+#include "Order2Replay.h"
+
+static const struct {
+	const char* period;
+	time_t timet;
+} period2time[] = {
+	{ "m1", 1 * 60 },
+	{ "m5", 5 * 60 },
+	{ "m15", 15 * 60 },
+	{ "m30", 30 * 60 },
+	{ "H1", 1 * 3600 },
+	{ "H2", 2 * 3600 },
+	{ "H3", 3 * 3600 },
+	{ "H4", 4 * 3600 },
+	{ "H6", 6 * 3600 },
+	{ "H8", 8 * 3600 },
+	{ "D1", 24 * 3600 },
+	{ "W1", 7 * 24 * 3600 },
+	{ 0, 0 }
+};
+
+static const int64_t NsPerSec = 1000000000LL;
+static const int64_t NsPerMs = 1000000LL;
+static const uint64_t ExitCheckMask = 0xFFF;
+
+static COrder2Replay order2Replay;
+
+COrder2Replay::COrder2Replay()
+{
+	m_pPluginProxy = getPluginProxy();
+	m_pPluginProxy->registerPlugin("Order2Replay", this);
+
+	m_pProxyRecorder = NULL;
+	m_hExitEvent = nsapi::CreateEvent(NULL, FALSE, FALSE, NULL);
+	ThreadFunAttr threadFunAttr = { replayProcess, this };
+	m_pReplayThread = new CThread(threadFunAttr);
+	m_pTrailingStop = new CTrailingStop(this);
+	m_nVirtualTimeNs.store(0);
+	m_lSequence.store(0);
+	memset(&m_stAccount, 0, sizeof(m_stAccount));
+	m_dbSpeed = 0;
+	m_dbSlippage = 0;
+	m_dbSlippageRandom = 0;
+	m_lLatency = 0;
+	m_lLatencyJitter = 0;
+}
+
+COrder2Replay::~COrder2Replay()
+{
+	nsapi::CloseHandle(m_hExitEvent);
+	delete m_pReplayThread;
+	delete m_pTrailingStop;
+}
+
+int COrder2Replay::init(const char* iniFile)
+{
+	m_SimpleIni.SetUnicode();
+	if (m_SimpleIni.LoadFile(iniFile) < 0) {
+		m_pPluginProxy->onMessage(MSG_ERROR, "Config file open failed.");
+		return RET_FAILED;
+	}
+
+	if (atoi(getRecorderInfo("Enable", "0")) != 0) {
+		m_pProxyRecorder = new CProxyRecorder(m_pPluginProxy, atol(getRecorderInfo("Capacity", "65536")));
+		m_pPluginProxy = m_pProxyRecorder;
+	}
+
+	m_dbSpeed = atof(getReplayInfo("Speed", "0"));
+	m_dbSlippage = atof(getFillInfo("Slippage", "0"));
+	m_dbSlippageRandom = atof(getFillInfo("SlippageRandom", "0"));
+	m_lLatency = atol(getFillInfo("Latency", "0"));
+	m_lLatencyJitter = atol(getFillInfo("LatencyJitter", "0"));
+	m_Random.seed(strtoul(getFillInfo("Seed", "1"), NULL, 10));
+
+	strcpy(m_stAccount.AccountID, getAccountInfo("AccountID", "replay"));
+	strcpy(m_stAccount.AccountName, m_stAccount.AccountID);
+	strcpy(m_stAccount.AccountType, "Replay");
+	strcpy(m_stAccount.Hedging, "Y");
+	strcpy(m_stAccount.Currency, getAccountInfo("Currency", "USD"));
+	strcpy(m_stAccount.Broker, "replay");
+	m_stAccount.Balance = atof(getAccountInfo("Balance", "100000"));
+	return RET_SUCCESS;
+}
+
+int COrder2Replay::login()
+{
+	time_t start = str2Date(getReplayInfo("StartDate"));
+	if (start == 0) {
+		m_pPluginProxy->onMessage(MSG_ERROR, "Replay StartDate is not set.");
+		return RET_FAILED;
+	}
+
+	m_nVirtualTimeNs.store((int64_t)start * NsPerSec);
+	m_pReplayThread->_start();
+	return RET_SUCCESS;
+}
+
+int COrder2Replay::close()
+{
+	nsapi::SetEvent(m_hExitEvent);
+	m_pReplayThread->join();
+
+	if (m_pProxyRecorder) {
+		m_pProxyRecorder->dump(getRecorderInfo("DumpFile", "proxy-recorder.log"));
+	}
+	return RET_SUCCESS;
+}
+
+time_t COrder2Replay::getServerTime()
+{
+	return (time_t)(m_nVirtualTimeNs.load() / NsPerSec);
+}
+
+int COrder2Replay::getAccount(const char* /*accountID*/, TblAccount** tblAccount)
+{
+	CCriticalSection::Lock lock(m_csState);
+	TblAccount* account = new TblAccount(m_stAccount);
+	for (map<string, TblTrade>::iterator it = m_mapOpenedTrades.begin(); it != m_mapOpenedTrades.end(); it++) {
+		updateTradePL(it->second);
+		account->GrossPL += it->second.GrossPL;
+	}
+	account->Equity = account->Balance + account->GrossPL;
+	account->UsableMargin = account->Equity;
+	account->UsableMarginInPercent = 100;
+	account->UsableMaintMarginInPercent = 100;
+	*tblAccount = account;
+	return 1;
+}
+
+int COrder2Replay::getPrice(const char* symbol[], TblPrice** pTblPrice[])
+{
+	vector<TblPrice*> tblPriceList;
+	{
+		CCriticalSection::Lock lock(m_csState);
+		for (int i = 0; symbol[i]; i++) {
+			TblPrice* tblPrice = findPrice(symbol[i]);
+			if (tblPrice) {
+				tblPriceList.push_back(new TblPrice(*tblPrice));
+			}
+		}
+	}
+
+	if (tblPriceList.size() > 0) {
+		*pTblPrice = new TblPrice*[tblPriceList.size()];
+		std::copy(tblPriceList.begin(), tblPriceList.end(), *pTblPrice);
+	}
+	return tblPriceList.size();
+}
+
+// The tick journal records top of book only.
+int COrder2Replay::getDepth(const char* /*symbol*/, TblDepth** /*tblDepth*/)
+{
+	return 0;
+}
+
+int COrder2Replay::getOpenedTrades(TblTrade** pTblTrade[])
+{
+	vector<TblTrade*> tblTradeList;
+	{
+		CCriticalSection::Lock lock(m_csState);
+		for (map<string, TblTrade>::iterator it = m_mapOpenedTrades.begin(); it != m_mapOpenedTrades.end(); it++) {
+			updateTradePL(it->second);
+			tblTradeList.push_back(new TblTrade(it->second));
+		}
+	}
+
+	if (tblTradeList.size() > 0) {
+		*pTblTrade = new TblTrade*[tblTradeList.size()];
+		std::copy(tblTradeList.begin(), tblTradeList.end(), *pTblTrade);
+	}
+	return tblTradeList.size();
+}
+
+int COrder2Replay::getClosedTrades(TblTrade** pTblTrade[])
+{
+	vector<TblTrade*> tblTradeList;
+	{
+		CCriticalSection::Lock lock(m_csState);
+		for (vector<TblTrade>::iterator it = m_vtClosedTrades.begin(); it != m_vtClosedTrades.end(); it++) {
+			tblTradeList.push_back(new TblTrade(*it));
+		}
+	}
+
+	if (tblTradeList.size() > 0) {
+		*pTblTrade = new TblTrade*[tblTradeList.size()];
+		std::copy(tblTradeList.begin(), tblTradeList.end(), *pTblTrade);
+	}
+	return tblTradeList.size();
+}
+
+// Candles are read from CandlePath/<symbol>_<period>.csv, sorted by time, one per line:
+// "YYYY-MM-DD HH:MM:SS,BidOpen,BidHigh,BidLow,BidClose,AskOpen,AskHigh,AskLow,AskClose" (UTC).
+// Only candles completed before the virtual clock are returned.
+int COrder2Replay::getHistoricalData(const char* symbol, const char* period, time_t start, time_t end, bool /*maxRange*/, TblCandle** pTblCandle[])
+{
+	time_t interval = getTimetByPeriod(period);
+	if (interval == 0) {
+		m_pPluginProxy->onMessage(MSG_ERROR, (string("Unsupported period: ") + period).c_str());
+		return RET_FAILED;
+	}
+
+	string name = symbol;
+	CUtils::replace(name, "/", "");
+	string file = string(getReplayInfo("CandlePath", "./dat/candles/")) + name + "_" + period + ".csv";
+	FILE* fp = fopen(file.c_str(), "r");
+	if (!fp) {
+		m_pPluginProxy->onMessage(MSG_ERROR, ("Candle file open failed: " + file).c_str());
+		return RET_FAILED;
+	}
+
+	time_t now = getServerTime();
+	if (end > now - interval) {
+		end = now - interval;
+	}
+
+	vector<TblCandle*> tblCandleList;
+	char line[256];
+	char date[32];
+	while (fgets(line, sizeof(line), fp)) {
+		TblCandle candle;
+		memset(&candle, 0, sizeof(candle));
+		if (sscanf(line, "%31[^,],%lf,%lf,%lf,%lf,%lf,%lf,%lf,%lf", date,
+			&candle.BidOpen, &candle.BidHigh, &candle.BidLow, &candle.BidClose,
+			&candle.AskOpen, &candle.AskHigh, &candle.AskLow, &candle.AskClose) != 9) {
+			continue;
+		}
+		candle.StartDate = CUtils::str2Time(date);
+		if (candle.StartDate < start) {
+			continue;
+		}
+		if (candle.StartDate > end) {
+			break;
+		}
+		strcpy(candle.Symbol, symbol);
+		strcpy(candle.Period, period);
+		tblCandleList.push_back(new TblCandle(candle));
+	}
+	fclose(fp);
+
+	if (tblCandleList.size() > 0) {
+		*pTblCandle = new TblCandle*[tblCandleList.size()];
+		std::copy(tblCandleList.begin(), tblCandleList.end(), *pTblCandle);
+	}
+	return tblCandleList.size();
+}
+
+int COrder2Replay::openMarketOrder(TblOrder* tblOrder)
+{
+	strcpy(tblOrder->OrderType, "OM");
+	return submitFill(FILL_OPEN, tblOrder, NULL);
+}
+
+int COrder2Replay::changeStopLoss(TblTrade* tblTrade)
+{
+	TblTrade trade;
+	{
+		CCriticalSection::Lock lock(m_csState);
+		map<string, TblTrade>::iterator it = m_mapOpenedTrades.find(tblTrade->TradeID);
+		if (it == m_mapOpenedTrades.end()) {
+			return RET_FAILED;
+		}
+		it->second.Stop = tblTrade->Stop;
+		trade = it->second;
+	}
+	m_pPluginProxy->onOpenedTrade(TableStatus::ST_UPD, &trade);
+	return RET_SUCCESS;
+}
+
+int COrder2Replay::changeTakeProfit(TblTrade* tblTrade)
+{
+	TblTrade trade;
+	{
+		CCriticalSection::Lock lock(m_csState);
+		map<string, TblTrade>::iterator it = m_mapOpenedTrades.find(tblTrade->TradeID);
+		if (it == m_mapOpenedTrades.end()) {
+			return RET_FAILED;
+		}
+		it->second.Limit = tblTrade->Limit;
+		trade = it->second;
+	}
+	m_pPluginProxy->onOpenedTrade(TableStatus::ST_UPD, &trade);
+	return RET_SUCCESS;
+}
+
+int COrder2Replay::closeTrade(TblTrade* tblTrade)
+{
+	TblOrder tblOrder;
+	memset(&tblOrder, 0, sizeof(tblOrder));
+	strcpy(tblOrder.AccountID, m_stAccount.AccountID);
+	strcpy(tblOrder.OfferID, tblTrade->OfferID);
+	strcpy(tblOrder.Symbol, tblTrade->Symbol);
+	strcpy(tblOrder.BS, isBuy(tblTrade->BS) ? "S" : "B");
+	strcpy(tblOrder.OrderType, "CM");
+	tblOrder.Amount = tblTrade->Amount;
+	return submitFill(FILL_CLOSE, &tblOrder, tblTrade->TradeID);
+}
+
+int COrder2Replay::openMarketOrders(TblOrder* tblOrders[])
+{
+	int count = 0;
+	for (int i = 0; tblOrders[i]; i++) {
+		if (openMarketOrder(tblOrders[i]) == RET_SUCCESS) {
+			count++;
+		}
+	}
+	return count;
+}
+
+int COrder2Replay::changeStopLosses(TblTrade* tblTrades[])
+{
+	int count = 0;
+	for (int i = 0; tblTrades[i]; i++) {
+		if (changeStopLoss(tblTrades[i]) == RET_SUCCESS) {
+			count++;
+		}
+	}
+	return count;
+}
+
+int COrder2Replay::changeTakeProfits(TblTrade* tblTrades[])
+{
+	int count = 0;
+	for (int i = 0; tblTrades[i]; i++) {
+		if (changeTakeProfit(tblTrades[i]) == RET_SUCCESS) {
+			count++;
+		}
+	}
+	return count;
+}
+
+int COrder2Replay::closeTrades(TblTrade* tblTrades[])
+{
+	int count = 0;
+	for (int i = 0; tblTrades[i]; i++) {
+		if (closeTrade(tblTrades[i]) == RET_SUCCESS) {
+			count++;
+		}
+	}
+	return count;
+}
+
+int COrder2Replay::setTrailingStop(TblTrade* tblTrade, double distance, double step)
+{
+	return m_pTrailingStop->add(tblTrade, distance, step);
+}
+
+int COrder2Replay::removeTrailingStop(TblTrade* tblTrade)
+{
+	return m_pTrailingStop->remove(tblTrade->TradeID);
+}
+
+// Every recorded symbol is replayed, there is nothing to poll.
+int COrder2Replay::subscribe(const char* /*symbols*/[])
+{
+	return RET_SUCCESS;
+}
+
+int COrder2Replay::unsubscribe(const char* /*symbols*/[])
+{
+	return RET_SUCCESS;
+}
+
+void COrder2Replay::replayProcess(void* pv)
+{
+	COrder2Replay* p = (COrder2Replay*)pv;
+	p->replay();
+}
+
+void COrder2Replay::replay()
+{
+	time_t start = str2Date(getReplayInfo("StartDate"));
+	time_t end = str2Date(getReplayInfo("EndDate"));
+	if (end < start) {
+		end = start;
+	}
+
+	int64_t endNs = ((int64_t)end + 24 * 3600) * NsPerSec;
+	int64_t baseTimeNs = 0;
+	int64_t baseWallNs = 0;
+	for (int64_t day = start / (24 * 3600); day <= end / (24 * 3600); day++) {
+		if (!replayDay(day, endNs, baseTimeNs, baseWallNs)) {
+			return;
+		}
+	}
+	m_pPluginProxy->onMessage(MSG_INFO, "Replay finished.");
+}
+
+bool COrder2Replay::replayDay(int64_t day, int64_t endNs, int64_t& baseTimeNs, int64_t& baseWallNs)
+{
+	CTickJournalReader reader;
+	if (!reader.open(getReplayInfo("TickPath", "./dat/ticks/"), day)) {
+		return nsapi::WaitForSingleObject(m_hExitEvent, 0) != WAIT_OBJECT_0;
+	}
+
+	// Journal symbol IDs are per day, so the price slots are resolved once per day.
+	vector<TblPrice*> symbolPrices;
+	vector<ReplayEvent> events;
+	TblPrice snapshot;
+	for (uint64_t pos = 0; pos < reader.size(); pos++) {
+		const TickRecord* tickRecord = reader.get(pos);
+		if (tickRecord->RecvTimeNs >= endNs) {
+			break;
+		}
+		if ((pos & ExitCheckMask) == 0 && nsapi::WaitForSingleObject(m_hExitEvent, 0) == WAIT_OBJECT_0) {
+			return false;
+		}
+		if (baseWallNs == 0) {
+			baseTimeNs = tickRecord->RecvTimeNs;
+			baseWallNs = CUtils::getMonotonicNs();
+		}
+		if (m_dbSpeed > 0 && !waitVirtualTime(tickRecord->RecvTimeNs, baseTimeNs, baseWallNs)) {
+			return false;
+		}
+
+		if (tickRecord->SymbolID >= symbolPrices.size()) {
+			symbolPrices.resize(tickRecord->SymbolID + 1, NULL);
+		}
+		TblPrice*& tblPrice = symbolPrices[tickRecord->SymbolID];
+		if (!tblPrice) {
+			const char* symbol = reader.getSymbol(tickRecord->SymbolID);
+			if (!symbol) {
+				continue;
+			}
+			CCriticalSection::Lock lock(m_csState);
+			tblPrice = &m_mapPrices[symbol];
+			if (strlen(tblPrice->Symbol) == 0) {
+				memset(tblPrice, 0, sizeof(TblPrice));
+				sprintf_s(tblPrice->OfferID, sizeof(tblPrice->OfferID), "%d", (int)m_mapPrices.size());
+				strcpy(tblPrice->Symbol, symbol);
+				strcpy(tblPrice->SymbolType, "FX");
+				tblPrice->PointSize = getPointSize(symbol);
+				tblPrice->PipCost = atof(getPipCostInfo(symbol, "1"));
+				tblPrice->High = tickRecord->Bid;
+				tblPrice->Low = tickRecord->Bid;
+			}
+		}
+
+		onTick(tblPrice, tickRecord, snapshot, events);
+		m_pPluginProxy->onPrice(TableStatus::ST_UPD, &snapshot);
+		if (!events.empty()) {
+			fireEvents(events);
+		}
+		// Due stops are sent at once, so they are in place for the next tick.
+		if (m_pTrailingStop->onPrice(&snapshot)) {
+			m_pTrailingStop->flush();
+		}
+	}
+	return true;
+}
+
+bool COrder2Replay::waitVirtualTime(int64_t timeNs, int64_t baseTimeNs, int64_t baseWallNs)
+{
+	int64_t dueWallNs = baseWallNs + (int64_t)((timeNs - baseTimeNs) / m_dbSpeed);
+	int64_t waitNs = dueWallNs - CUtils::getMonotonicNs();
+	if (waitNs < NsPerMs) {
+		return true;
+	}
+	return nsapi::WaitForSingleObject(m_hExitEvent, (DWORD)(waitNs / NsPerMs)) != WAIT_OBJECT_0;
+}
+
+void COrder2Replay::onTick(TblPrice* tblPrice, const TickRecord* tickRecord, TblPrice& snapshot, vector<ReplayEvent>& events)
+{
+	CCriticalSection::Lock lock(m_csState);
+	int64_t now = tickRecord->RecvTimeNs;
+	m_nVirtualTimeNs.store(now);
+
+	tblPrice->Bid = tickRecord->Bid;
+	tblPrice->Ask = tickRecord->Ask;
+	tblPrice->High = max(tblPrice->High, tickRecord->Bid);
+	tblPrice->Low = min(tblPrice->Low, tickRecord->Bid);
+	tblPrice->Time = (time_t)((tickRecord->ServerTimeNs ? tickRecord->ServerTimeNs : now) / NsPerSec);
+	setTimeExt(tblPrice, tickRecord->ServerTimeNs ? tickRecord->ServerTimeNs : now, 0, now);
+	snapshot = *tblPrice;
+
+	deque<ReplayFill>::iterator fit = m_queFills.begin();
+	while (fit != m_queFills.end()) {
+		if (fit->DueTimeNs <= now) {
+			ReplayFill fill = *fit;
+			fit = m_queFills.erase(fit);
+			doFill(fill, events);
+		}
+		else {
+			fit++;
+		}
+	}
+
+	vector<pair<string, const char*> > triggered;
+	for (map<string, TblTrade>::iterator it = m_mapOpenedTrades.begin(); it != m_mapOpenedTrades.end(); it++) {
+		TblTrade& trade = it->second;
+		if (strcmp(trade.Symbol, tblPrice->Symbol) != 0) {
+			continue;
+		}
+		double rate = isBuy(trade.BS) ? tblPrice->Bid : tblPrice->Ask;
+		trade.High = max(trade.High, rate);
+		trade.Low = min(trade.Low, rate);
+		if (trade.Stop != 0 && (isBuy(trade.BS) ? rate <= trade.Stop : rate >= trade.Stop)) {
+			triggered.push_back(pair<string, const char*>(it->first, "S"));
+		}
+		else if (trade.Limit != 0 && (isBuy(trade.BS) ? rate >= trade.Limit : rate <= trade.Limit)) {
+			triggered.push_back(pair<string, const char*>(it->first, "L"));
+		}
+	}
+
+	// Stops and limits are filled at the tick that crossed them, without slippage.
+	for (size_t i = 0; i < triggered.size(); i++) {
+		TblTrade& trade = m_mapOpenedTrades[triggered[i].first];
+		TblOrder order;
+		memset(&order, 0, sizeof(order));
+		strcpy(order.OrderID, nextID().c_str());
+		strcpy(order.AccountID, m_stAccount.AccountID);
+		strcpy(order.OfferID, trade.OfferID);
+		strcpy(order.Symbol, trade.Symbol);
+		strcpy(order.BS, isBuy(trade.BS) ? "S" : "B");
+		strcpy(order.OrderType, triggered[i].second);
+		order.Amount = trade.Amount;
+		fillClose(order, triggered[i].first.c_str(), isBuy(trade.BS) ? tblPrice->Bid : tblPrice->Ask, events);
+	}
+}
+
+void COrder2Replay::fireEvents(vector<ReplayEvent>& events)
+{
+	for (vector<ReplayEvent>::iterator it = events.begin(); it != events.end(); it++) {
+		switch (it->Type) {
+		case EVENT_ORDER:
+			m_pPluginProxy->onOrder(it->Status, &it->Order);
+			break;
+		case EVENT_OPENED_TRADE:
+			m_pPluginProxy->onOpenedTrade(it->Status, &it->Trade);
+			break;
+		case EVENT_CLOSED_TRADE:
+			m_pPluginProxy->onClosedTrade(it->Status, &it->Trade);
+			break;
+		}
+	}
+	events.clear();
+}
+
+int COrder2Replay::submitFill(ReplayFillType type, TblOrder* tblOrder, const char* tradeID)
+{
+	vector<ReplayEvent> events;
+	bool ret = true;
+	{
+		CCriticalSection::Lock lock(m_csState);
+		if (type == FILL_CLOSE && m_mapOpenedTrades.find(tradeID) == m_mapOpenedTrades.end()) {
+			return RET_FAILED;
+		}
+
+		ReplayFill fill;
+		memset(&fill, 0, sizeof(fill));
+		fill.Type = type;
+		fill.Order = *tblOrder;
+		strcpy(fill.Order.OrderID, nextID().c_str());
+		strcpy(fill.Order.AccountID, m_stAccount.AccountID);
+		if (tradeID) {
+			strcpy(fill.TradeID, tradeID);
+		}
+		strcpy(tblOrder->OrderID, fill.Order.OrderID);
+
+		long latency = getLatency();
+		if (latency == 0) {
+			ret = doFill(fill, events);
+		}
+		else {
+			fill.DueTimeNs = m_nVirtualTimeNs.load() + latency * NsPerMs;
+			m_queFills.push_back(fill);
+		}
+	}
+	fireEvents(events);
+	return ret ? RET_SUCCESS : RET_FAILED;
+}
+
+bool COrder2Replay::doFill(ReplayFill& fill, vector<ReplayEvent>& events)
+{
+	bool ret = (fill.Type == FILL_OPEN) ? fillOpen(fill.Order, events) : fillClose(fill.Order, fill.TradeID, 0, events);
+	if (!ret && fill.DueTimeNs != 0) {
+		// A delayed order can no longer fail the call that sent it, so reject it as an order event.
+		ReplayEvent event;
+		memset(&event, 0, sizeof(event));
+		event.Type = EVENT_ORDER;
+		event.Status = TableStatus::ST_NEW;
+		event.Order = fill.Order;
+		strcpy(event.Order.OrderStatus, "R");
+		event.Order.Time = getServerTime();
+		events.push_back(event);
+	}
+	return ret;
+}
+
+bool COrder2Replay::fillOpen(TblOrder& tblOrder, vector<ReplayEvent>& events)
+{
+	TblPrice* tblPrice = findPrice(tblOrder.Symbol);
+	if (!tblPrice) {
+		return false;
+	}
+
+	double slippage = getSlippage(tblOrder.Symbol);
+	double rate = isBuy(tblOrder.BS) ? tblPrice->Ask + slippage : tblPrice->Bid - slippage;
+	time_t now = getServerTime();
+
+	ReplayEvent event;
+	memset(&event, 0, sizeof(event));
+	TblTrade& trade = event.Trade;
+	strcpy(trade.TradeID, nextID().c_str());
+	strcpy(trade.AccountID, m_stAccount.AccountID);
+	strcpy(trade.OfferID, tblPrice->OfferID);
+	strcpy(trade.Symbol, tblOrder.Symbol);
+	strcpy(trade.BS, isBuy(tblOrder.BS) ? "B" : "S");
+	strcpy(trade.OpenOrderID, tblOrder.OrderID);
+	trade.Amount = tblOrder.Amount;
+	trade.Open = rate;
+	trade.Stop = tblOrder.Stop;
+	trade.Limit = tblOrder.Limit;
+	trade.High = rate;
+	trade.Low = rate;
+	trade.OpenTime = now;
+	setTimeExt(&trade, m_nVirtualTimeNs.load(), 0, m_nVirtualTimeNs.load());
+	updateTradePL(trade);
+	m_mapOpenedTrades[trade.TradeID] = trade;
+
+	strcpy(tblOrder.OfferID, tblPrice->OfferID);
+	strcpy(tblOrder.TradeID, trade.TradeID);
+	strcpy(tblOrder.OrderStatus, "F");
+	tblOrder.Rate = rate;
+	tblOrder.Time = now;
+	setTimeExt(&tblOrder, m_nVirtualTimeNs.load(), 0, m_nVirtualTimeNs.load());
+
+	event.Type = EVENT_ORDER;
+	event.Status = TableStatus::ST_NEW;
+	event.Order = tblOrder;
+	events.push_back(event);
+	event.Type = EVENT_OPENED_TRADE;
+	events.push_back(event);
+	return true;
+}
+
+// rate is the fill price of a triggered stop or limit, 0 for a market close.
+bool COrder2Replay::fillClose(TblOrder& tblOrder, const char* tradeID, double rate, vector<ReplayEvent>& events)
+{
+	map<string, TblTrade>::iterator it = m_mapOpenedTrades.find(tradeID);
+	if (it == m_mapOpenedTrades.end()) {
+		return false;
+	}
+
+	TblTrade& trade = it->second;
+	if (rate == 0) {
+		TblPrice* tblPrice = findPrice(trade.Symbol);
+		if (!tblPrice) {
+			return false;
+		}
+		double slippage = getSlippage(trade.Symbol);
+		rate = isBuy(trade.BS) ? tblPrice->Bid - slippage : tblPrice->Ask + slippage;
+	}
+	time_t now = getServerTime();
+
+	TblTimeExt ext;
+	int64_t openTimeNs = getTimeExt(&trade, &ext) ? ext.TimeNs : (int64_t)trade.OpenTime * NsPerSec;
+	trade.Close = rate;
+	trade.CloseTime = now;
+	setTimeExt(&trade, openTimeNs, m_nVirtualTimeNs.load(), m_nVirtualTimeNs.load());
+	strcpy(trade.CloseOrderID, tblOrder.OrderID);
+	updateTradePL(trade);
+	m_stAccount.Balance += trade.GrossPL;
+
+	strcpy(tblOrder.TradeID, trade.TradeID);
+	strcpy(tblOrder.OrderStatus, "F");
+	tblOrder.Rate = rate;
+	tblOrder.Time = now;
+	setTimeExt(&tblOrder, m_nVirtualTimeNs.load(), 0, m_nVirtualTimeNs.load());
+
+	ReplayEvent event;
+	memset(&event, 0, sizeof(event));
+	event.Type = EVENT_ORDER;
+	event.Status = TableStatus::ST_NEW;
+	event.Order = tblOrder;
+	event.Trade = trade;
+	events.push_back(event);
+	event.Type = EVENT_OPENED_TRADE;
+	event.Status = TableStatus::ST_DEL;
+	events.push_back(event);
+	event.Type = EVENT_CLOSED_TRADE;
+	event.Status = TableStatus::ST_NEW;
+	events.push_back(event);
+
+	m_pTrailingStop->remove(trade.TradeID);
+	m_vtClosedTrades.push_back(trade);
+	m_mapOpenedTrades.erase(it);
+	return true;
+}
+
+// Slippage always works against the order, in points of the symbol.
+double COrder2Replay::getSlippage(const char* symbol)
+{
+	double points = m_dbSlippage;
+	if (m_dbSlippageRandom > 0) {
+		points += uniform_real_distribution<double>(0, m_dbSlippageRandom)(m_Random);
+	}
+	return points * getPointSize(symbol);
+}
+
+long COrder2Replay::getLatency()
+{
+	long latency = m_lLatency;
+	if (m_lLatencyJitter > 0) {
+		latency += uniform_int_distribution<long>(0, m_lLatencyJitter)(m_Random);
+	}
+	return latency;
+}
+
+// PL is in pips and GrossPL in the quote currency of the symbol.
+void COrder2Replay::updateTradePL(TblTrade& tblTrade)
+{
+	double close = tblTrade.Close;
+	if (tblTrade.CloseTime == 0) {
+		TblPrice* tblPrice = findPrice(tblTrade.Symbol);
+		if (!tblPrice) {
+			return;
+		}
+		close = isBuy(tblTrade.BS) ? tblPrice->Bid : tblPrice->Ask;
+	}
+
+	double diff = isBuy(tblTrade.BS) ? close - tblTrade.Open : tblTrade.Open - close;
+	tblTrade.PL = diff / getPointSize(tblTrade.Symbol);
+	tblTrade.GrossPL = diff * tblTrade.Amount;
+}
+
+string COrder2Replay::nextID()
+{
+	char id[40];
+	sprintf_s(id, sizeof(id), "%ld", ++m_lSequence);
+	return id;
+}
+
+TblPrice* COrder2Replay::findPrice(const char* symbol)
+{
+	map<string, TblPrice>::iterator it = m_mapPrices.find(symbol);
+	if (it == m_mapPrices.end() || it->second.Bid == 0) {
+		return NULL;
+	}
+	return &it->second;
+}
+
+bool COrder2Replay::isBuy(const char* bs)
+{
+	return strcmp(bs, "B") == 0;
+}
+
+time_t COrder2Replay::getTimetByPeriod(const char* period)
+{
+	for (int i = 0; period2time[i].period; i++) {
+		if (strcmp(period, period2time[i].period) == 0) {
+			return period2time[i].timet;
+		}
+	}
+	return 0;
+}
+
+// format: "YYYY-MM-DD" (UTC)
+time_t COrder2Replay::str2Date(const char* s)
+{
+	if (strlen(s) == 0) {
+		return 0;
+	}
+	return CUtils::str2Time((string(s) + " 00:00:00").c_str());
+}
+
+double COrder2Replay::getPointSize(const char* symbol)
+{
+	map<string, TblPrice>::iterator it = m_mapPrices.find(symbol);
+	if (it != m_mapPrices.end() && it->second.PointSize != 0) {
+		return it->second.PointSize;
+	}
+	return atof(getPointSizeInfo(symbol, strstr(symbol, "JPY") ? "0.01" : "0.0001"));
+}
+
+const char* COrder2Replay::getReplayInfo(const char* key, const char* defval)
+{
+	return m_SimpleIni.GetValue("Replay", key, defval);
+}
+
+const char* COrder2Replay::getAccountInfo(const char* key, const char* defval)
+{
+	return m_SimpleIni.GetValue("Account", key, defval);
+}
+
+const char* COrder2Replay::getFillInfo(const char* key, const char* defval)
+{
+	return m_SimpleIni.GetValue("Fill", key, defval);
+}
+
+const char* COrder2Replay::getPointSizeInfo(const char* key, const char* defval)
+{
+	return m_SimpleIni.GetValue("PointSize", key, defval);
+}
+
+const char* COrder2Replay::getPipCostInfo(const char* key, const char* defval)
+{
+	return m_SimpleIni.GetValue("PipCost", key, defval);
+}
+
+const char* COrder2Replay::getRecorderInfo(const char* key, const char* defval)
+{
+	return m_SimpleIni.GetValue("Recorder", key, defval);
+}
@@ -0,0 +1,121 @@
+#ifndef ORDER2REPLAY_H
+#define ORDER2REPLAY_H
+
+#include "IBaseOrder.h"
+#include "IPluginProxy.h"
+#include "ProxyRecorder.h"
+#include "TickJournal.h"
+#include "TrailingStop.h"
+
+typedef enum {
+	FILL_OPEN,
+	FILL_CLOSE
+} ReplayFillType;
+
+typedef enum {
+	EVENT_ORDER,
+	EVENT_OPENED_TRADE,
+	EVENT_CLOSED_TRADE
+} ReplayEventType;
+
+typedef struct {
+	ReplayFillType Type;
+	int64_t DueTimeNs;
+	TblOrder Order;
+	char TradeID[40];
+} ReplayFill;
+
+typedef struct {
+	ReplayEventType Type;
+	TableStatus Status;
+	TblOrder Order;
+	TblTrade Trade;
+} ReplayEvent;
+
+// Replays the tick journal (see CTickJournal) as a broker, either as fast as
+// possible or in virtual time accelerated by [Replay] Speed.
+// Market orders are filled against the replayed prices with the slippage and
+// latency of the [Fill] section.
+class COrder2Replay : public IBaseOrder
+{
+private:
+	CSimpleIniCaseA m_SimpleIni;
+	IPluginProxy *m_pPluginProxy;
+	CProxyRecorder *m_pProxyRecorder;
+	CTrailingStop *m_pTrailingStop;
+	HANDLE m_hExitEvent;
+	CThread *m_pReplayThread;
+	atomic<int64_t> m_nVirtualTimeNs;
+	atomic<long> m_lSequence;
+	CCriticalSection m_csState;
+	map<string, TblPrice> m_mapPrices;
+	map<string, TblTrade> m_mapOpenedTrades;
+	vector<TblTrade> m_vtClosedTrades;
+	deque<ReplayFill> m_queFills;
+	TblAccount m_stAccount;
+	double m_dbSpeed;
+	double m_dbSlippage;
+	double m_dbSlippageRandom;
+	long m_lLatency;
+	long m_lLatencyJitter;
+	mt19937 m_Random;
+
+public:
+	COrder2Replay();
+	~COrder2Replay();
+
+	int init(const char* iniFile);
+	int login();
+	int close();
+	time_t getServerTime();
+	int getAccount(const char* accountID, TblAccount** tblAccount);
+	int getPrice(const char* symbol[], TblPrice** pTblPrice[]);
+	int getDepth(const char* symbol, TblDepth** tblDepth);
+	int getOpenedTrades(TblTrade** pTblTrade[]);
+	int getClosedTrades(TblTrade** pTblTrade[]);
+	int getHistoricalData(const char* symbol, const char* period, time_t start, time_t end, bool maxRange, TblCandle** pTblCandle[]);
+	int openMarketOrder(TblOrder* tblOrder);
+	int changeStopLoss(TblTrade* tblTrade);
+	int changeTakeProfit(TblTrade* tblTrade);
+	int closeTrade(TblTrade* tblTrade);
+	int openMarketOrders(TblOrder* tblOrders[]);
+	int changeStopLosses(TblTrade* tblTrades[]);
+	int changeTakeProfits(TblTrade* tblTrades[]);
+	int closeTrades(TblTrade* tblTrades[]);
+	int setTrailingStop(TblTrade* tblTrade, double distance, double step);
+	int removeTrailingStop(TblTrade* tblTrade);
+	int subscribe(const char* symbols[]);
+	int unsubscribe(const char* symbols[]);
+
+private:
+	static void replayProcess(void* pv);
+	void replay();
+	bool replayDay(int64_t day, int64_t endNs, int64_t& baseTimeNs, int64_t& baseWallNs);
+	bool waitVirtualTime(int64_t timeNs, int64_t baseTimeNs, int64_t baseWallNs);
+	void onTick(TblPrice* tblPrice, const TickRecord* tickRecord, TblPrice& snapshot, vector<ReplayEvent>& events);
+	void fireEvents(vector<ReplayEvent>& events);
+
+	int submitFill(ReplayFillType type, TblOrder* tblOrder, const char* tradeID);
+	bool doFill(ReplayFill& fill, vector<ReplayEvent>& events);
+	bool fillOpen(TblOrder& tblOrder, vector<ReplayEvent>& events);
+	bool fillClose(TblOrder& tblOrder, const char* tradeID, double rate, vector<ReplayEvent>& events);
+	double getSlippage(const char* symbol);
+	long getLatency();
+	void updateTradePL(TblTrade& tblTrade);
+	string nextID();
+
+	TblPrice* findPrice(const char* symbol);
+	static bool isBuy(const char* bs);
+	static time_t getTimetByPeriod(const char* period);
+	static time_t str2Date(const char* s);
+	double getPointSize(const char* symbol);
+
+	const char* getReplayInfo(const char* key, const char* defval = "");
+	const char* getAccountInfo(const char* key, const char* defval = "");
+	const char* getFillInfo(const char* key, const char* defval = "");
+	const char* getPointSizeInfo(const char* key, const char* defval = "");
+	const char* getPipCostInfo(const char* key, const char* defval = "");
+	const char* getRecorderInfo(const char* key, const char* defval = "");
+};
+
+#endif
@@ -0,0 +1,277 @@
+﻿/*
+* Copyright 2020 FXDaemon
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include "stdafx.h"
+#include "Utils.h"
+
+static const char* MONTHS[] = { "Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec" };
+
+long CUtils::getTimeZone()
+{
+#ifdef WIN32
+	TIME_ZONE_INFORMATION timeZoneInfo;
+	DWORD dwRet = ::GetTimeZoneInformation(&timeZoneInfo);
+	if (dwRet == TIME_ZONE_ID_STANDARD || dwRet == TIME_ZONE_ID_UNKNOWN) {
+		return timeZoneInfo.Bias * 60;
+	}
+	return 0;
+#else
+	time_t t = time(NULL);
+	struct tm lt = { 0 };
+	localtime_r(&t, &lt);
+	return -lt.tm_gmtoff;
+#endif
+}
+
+tm CUtils::getUTCCal(time_t time)
+{
+	tm tmCal;
+	memset(&tmCal, 0, sizeof(tmCal));
+	gmtime_s(&tmCal, &time);
+	return tmCal;
+}
+
+time_t CUtils::getUTCTime(tm* t)
+{
+	return mktime(t) - getTimeZone();
+}
+
+int64_t CUtils::getMonotonicNs()
+{
+	return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+int64_t CUtils::getRealtimeNs()
+{
+	return chrono::duration_cast<chrono::nanoseconds>(chrono::system_clock::now().time_since_epoch()).count();
+}
+
+string CUtils::strOfTime(tm* t, const char* format)
+{
+	char buf[256];
+	strftime(buf, sizeof(buf), format, t);
+	return buf;
+}
+
+string CUtils::strOfTime(time_t t, const char* format)
+{
+	tm tmCal = getUTCCal(t);
+	return strOfTime(&tmCal, format);
+}
+
+string CUtils::strOfTimeWithRFC3339(time_t t)
+{
+	tm tmCal = getUTCCal(t);
+	return strOfTime(&tmCal, "%Y-%m-%dT%H:%M:%S");
+}
+
+time_t CUtils::str2Time(const char* s)
+{
+	int64_t ns;
+	if (parseRFC3339Ns(s, &ns)) {
+		return (time_t)(ns / 1000000000);
+	}
+
+	struct tm tmCal;
+	memset(&tmCal, 0, sizeof(tmCal));
+
+	int ret =sscanf(s, "%d-%d-%dT%d:%d:%d",
+		&tmCal.tm_year, &tmCal.tm_mon, &tmCal.tm_mday,
+		&tmCal.tm_hour, &tmCal.tm_min, &tmCal.tm_sec);
+	if (ret != 6) {
+		ret = sscanf(s, "%d-%d-%d %d:%d:%d",
+			&tmCal.tm_year, &tmCal.tm_mon, &tmCal.tm_mday,
+			&tmCal.tm_hour, &tmCal.tm_min, &tmCal.tm_sec);
+	}
+	if (ret != 6) {
+		ret = sscanf(s, "%d/%d/%d %d:%d:%d",
+			&tmCal.tm_year, &tmCal.tm_mon, &tmCal.tm_mday,
+			&tmCal.tm_hour, &tmCal.tm_min, &tmCal.tm_sec);
+	}
+	if (ret != 6) {
+		return 0;
+	}
+	
+	tmCal.tm_year -= 1900;
+	tmCal.tm_mon -= 1;
+
+	time_t t = mktime(&tmCal);
+	t -= getTimeZone();
+	return t;
+}
+
+// Nanoseconds since the epoch, 0 on a malformed string.
+int64_t CUtils::str2TimeNs(const char* s)
+{
+	int64_t ns;
+	if (parseRFC3339Ns(s, &ns)) {
+		return ns;
+	}
+	return (int64_t)str2Time(s) * 1000000000;
+}
+
+static inline bool digits(const char* s, int n, int* val)
+{
+	int v = 0;
+	for (int i = 0; i < n; i++) {
+		unsigned d = (unsigned)(s[i] - '0');
+		if (d > 9) {
+			return false;
+		}
+		v = v * 10 + d;
+	}
+	*val = v;
+	return true;
+}
+
+// format: "2016-12-27T13:25:49.123456789Z", the separator may also be a blank,
+// the fraction (up to 9 digits) and the Z are optional. No libc time zone calls.
+bool CUtils::parseRFC3339Ns(const char* s, int64_t* ns)
+{
+	int year, mon, mday, hour, min, sec;
+	if (!digits(s, 4, &year) || s[4] != '-' || !digits(s + 5, 2, &mon) || s[7] != '-' || !digits(s + 8, 2, &mday)
+		|| (s[10] != 'T' && s[10] != ' ') || !digits(s + 11, 2, &hour) || s[13] != ':' || !digits(s + 14, 2, &min)
+		|| s[16] != ':' || !digits(s + 17, 2, &sec)) {
+		return false;
+	}
+	if (mon < 1 || mon > 12 || mday < 1 || mday > 31 || hour > 23 || min > 59 || sec > 60) {
+		return false;
+	}
+
+	const char* p = s + 19;
+	int64_t frac = 0;
+	if (*p == '.') {
+		static const int64_t scale[] = { 1, 100000000, 10000000, 1000000, 100000, 10000, 1000, 100, 10, 1 };
+		int n = 0;
+		for (p++; (unsigned)(*p - '0') <= 9; p++) {
+			if (n < 9) {
+				frac = frac * 10 + (*p - '0');
+				n++;
+			}
+		}
+		if (n == 0) {
+			return false;
+		}
+		frac *= scale[n];
+	}
+	if (*p == 'Z') {
+		p++;
+	}
+	if (*p != 0) {
+		return false;
+	}
+
+	int64_t secs = daysFromCivil(year, mon, mday) * 86400 + hour * 3600 + min * 60 + sec;
+	*ns = secs * 1000000000 + frac;
+	return true;
+}
+
+// Days since 1970-01-01 of a proleptic Gregorian date (H. Hinnant's days_from_civil).
+int64_t CUtils::daysFromCivil(int y, int m, int d)
+{
+	y -= m <= 2;
+	int64_t era = (y >= 0 ? y : y - 399) / 400;
+	int yoe = (int)(y - era * 400);
+	int doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+	int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+	return era * 146097 + doe - 719468;
+}
+
+// format: "Date: Tue, 27 Dec 2016 13:25:49 GMT"
+time_t CUtils::HStr2Time(const char* s)
+{
+	tm tmCal;
+	char s1[256], s2[256];
+
+	string dstr = s;
+	string::size_type pos = dstr.find("Date: ");
+	if (pos != string::npos) {
+		dstr = dstr.substr(pos);
+	}
+
+	memset(&tmCal, 0, sizeof(tmCal));
+	if (sscanf(dstr.c_str(), "Date: %s %d %s %d %d:%d:%d",
+		s1, &tmCal.tm_mday, s2, &tmCal.tm_year,
+		&tmCal.tm_hour, &tmCal.tm_min, &tmCal.tm_sec) != 7) {
+		return 0;
+	}
+	for (unsigned int i = 0; i < sizeof(MONTHS) / sizeof(MONTHS[0]); i++) {
+		if (strcmp(MONTHS[i], s2) == 0) {
+			tmCal.tm_mon = i;
+			break;
+		}
+	}
+
+	// The Date header is always GMT.
+	return (time_t)(daysFromCivil(tmCal.tm_year, tmCal.tm_mon + 1, tmCal.tm_mday) * 86400
+		+ tmCal.tm_hour * 3600 + tmCal.tm_min * 60 + tmCal.tm_sec);
+}
+
+time_t CUtils::getWeekFirstDate()
+{
+	time_t t;
+	tm tmNow, tmWeek;
+
+	time(&t);
+	localtime_s(&tmNow, &t);
+
+	memset(&tmWeek, 0, sizeof(tmWeek));
+	tmWeek.tm_year = tmNow.tm_year;
+	tmWeek.tm_mon = tmNow.tm_mon;
+	tmWeek.tm_mday = tmNow.tm_mday;
+
+	return mktime(&tmWeek) - tmNow.tm_wday * 24 * 3600;
+}
+
+int CUtils::getTimeOfDay(struct timeval *tv, struct timezone *tz)
+{
+#ifdef WIN32
+	FILETIME ft;
+	unsigned __int64 tmpres = 0;
+	static int tzflag = 0;
+	if (NULL != tv) {
+		GetSystemTimeAsFileTime(&ft);
+		tmpres |= ft.dwHighDateTime;
+		tmpres <<= 32;
+		tmpres |= ft.dwLowDateTime;
+		tmpres /= 10;
+		tmpres -= DELTA_EPOCH_IN_MICROSECS;
+		tv->tv_sec = (long)(tmpres / 1000000UL);
+		tv->tv_usec = (long)(tmpres % 1000000UL);
+	}
+	if (NULL != tz) {
+		if (!tzflag) {
+			_tzset();
+			tzflag++;
+		}
+		tz->tz_minuteswest = _timezone / 60;
+		tz->tz_dsttime = _daylight;
+	}
+	return 0;
+#else
+	return gettimeofday(tv, tz);
+#endif
+}
+
+void CUtils::replace(string &s, const char *src, const char *dst)
+{
+	string::size_type pos = 0;
+	string::size_type srclen = strlen(src);
+	string::size_type dstlen = strlen(dst);
+	while ((pos = s.find(src, pos)) != string::npos) {
+		s.replace(pos, srclen, dst);
+		pos += dstlen;
+	}
+}
@@ -0,0 +1,25 @@
+﻿#ifndef UTILS_H
+#define UTILS_H
+
+class CUtils
+{
+public:
+	static long getTimeZone();
+	static tm getUTCCal(time_t time);
+	static time_t getUTCTime(tm* t);
+	static string strOfTime(tm* t, const char* format);
+	static int64_t getMonotonicNs();
+	static int64_t getRealtimeNs();
+	static string strOfTime(time_t t, const char* format);
+	static string strOfTimeWithRFC3339(time_t t);
+	static time_t str2Time(const char* s);
+	static int64_t str2TimeNs(const char* s);
+	static bool parseRFC3339Ns(const char* s, int64_t* ns);
+	static int64_t daysFromCivil(int y, int m, int d);
+	static time_t HStr2Time(const char* s);
+	static time_t getWeekFirstDate();
+	static int getTimeOfDay(struct timeval *tv, struct timezone *tz);
+	static void replace(string &s, const char *src, const char *dst);
+};
+
+#endif
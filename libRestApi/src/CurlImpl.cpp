@@ -25,12 +25,18 @@ CCurlImpl::CCurlImpl(const char* host, bool sslVerify)
 {
 	m_pCurlHandle = NULL;
 	m_bGetHeader = false;
-	m_stResHeader = { NULL, 0 };
-	m_stResContents = { NULL, 0 };
+	m_stResHeader = { NULL, 0, 0 };
+	m_stResContents = { NULL, 0, 0 };
 	m_fpResListener = NULL;
 	m_pChunk = NULL;
 	m_tImplTime = { 0, 0 };
+	m_nRecvNs = 0;
+	m_nRecvMonoNs = 0;
+	m_pLatencyStats = NULL;
+	m_nEndpoint = -1;
 	m_bSslVerify = false;
+	m_lConnectTimeout = 0;
+	m_lTimeout = 0;
 	m_lRefreshInterval.store(0);
 
 	m_sHost.assign(host);
@@ -42,7 +48,8 @@ CCurlImpl::~CCurlImpl()
 	if (m_pCurlHandle) {
 		curl_easy_cleanup(m_pCurlHandle);
 	}
-	clear();
+	free(m_stResHeader.buf);
+	free(m_stResContents.buf);
 	
 	if (m_pChunk) {
 		curl_slist_free_all(m_pChunk);
@@ -69,6 +76,39 @@ const size_t CCurlImpl::getResSize() const
 	return m_stResContents.buf ? m_stResContents.size : 0;
 }
 
+// Local time the first byte of the last response arrived.
+int64_t CCurlImpl::getRecvNs() const
+{
+	return m_nRecvNs;
+}
+
+int64_t CCurlImpl::getRecvMonoNs() const
+{
+	return m_nRecvMonoNs;
+}
+
+// From the request being sent to the first byte of the response, without connect and TLS setup.
+int64_t CCurlImpl::getRequestRttNs() const
+{
+	double pretransfer = 0, starttransfer = 0;
+	if (curl_easy_getinfo(m_pCurlHandle, CURLINFO_PRETRANSFER_TIME, &pretransfer) != CURLE_OK ||
+		curl_easy_getinfo(m_pCurlHandle, CURLINFO_STARTTRANSFER_TIME, &starttransfer) != CURLE_OK ||
+		starttransfer < pretransfer) {
+		return -1;
+	}
+	return (int64_t)((starttransfer - pretransfer) * 1e9);
+}
+
+int CCurlImpl::getEndpoint() const
+{
+	return m_nEndpoint;
+}
+
+const char* CCurlImpl::getEndpointName() const
+{
+	return m_sEndpoint.c_str();
+}
+
 _curlResponseListener CCurlImpl::getResListener() const
 {
 	return m_fpResListener;
@@ -101,17 +141,15 @@ CURLcode CCurlImpl::init(string method, string request, bool getHeader, _curlRes
 	}
 
 	m_sMethod.assign(method);
-	m_sReqString.assign(request);
+	m_tmplRequest.compile(request.c_str());
 	m_bGetHeader = getHeader;
 	m_fpResListener = listener;
 	CUtils::getTimeOfDay(&m_tImplTime, NULL);
 
-	if (m_bGetHeader) {
-		curl_easy_setopt(m_pCurlHandle, CURLOPT_HEADERFUNCTION, writeCallBack);
-		curl_easy_setopt(m_pCurlHandle, CURLOPT_HEADERDATA, &m_stResHeader);
-	}
-	curl_easy_setopt(m_pCurlHandle, CURLOPT_WRITEFUNCTION, writeCallBack);
-	curl_easy_setopt(m_pCurlHandle, CURLOPT_WRITEDATA, &m_stResContents);
+	curl_easy_setopt(m_pCurlHandle, CURLOPT_HEADERFUNCTION, writeHeaderCallBack);
+	curl_easy_setopt(m_pCurlHandle, CURLOPT_HEADERDATA, this);
+	curl_easy_setopt(m_pCurlHandle, CURLOPT_WRITEFUNCTION, writeContentsCallBack);
+	curl_easy_setopt(m_pCurlHandle, CURLOPT_WRITEDATA, this);
 	curl_easy_setopt(m_pCurlHandle, CURLOPT_USERAGENT, CurlAgent);
 	if (m_pChunk) {
 		curl_easy_setopt(m_pCurlHandle, CURLOPT_HTTPHEADER, m_pChunk);
@@ -120,22 +158,28 @@ CURLcode CCurlImpl::init(string method, string request, bool getHeader, _curlRes
 		curl_easy_setopt(m_pCurlHandle, CURLOPT_SSL_VERIFYPEER, 0L);
 		curl_easy_setopt(m_pCurlHandle, CURLOPT_SSL_VERIFYHOST, 0L);
 	}
+	if (m_lConnectTimeout > 0) {
+		curl_easy_setopt(m_pCurlHandle, CURLOPT_CONNECTTIMEOUT_MS, m_lConnectTimeout);
+	}
+	if (m_lTimeout > 0) {
+		curl_easy_setopt(m_pCurlHandle, CURLOPT_TIMEOUT_MS, m_lTimeout);
+	}
 
 	return CURLE_OK;
 }
 
 void CCurlImpl::setPath(map<string, string>& params)
 {
-	map<string, string>::const_iterator mpos = params.begin();
-	while (mpos != params.end()) {
-		CUtils::replace(m_sPath, mpos->first.c_str(), mpos->second.c_str());
-		mpos++;
-	}
+	m_sPath.clear();
+	m_tmplPath.render(params, m_sPath);
 }
 
+// The template is only compiled again when the path changes.
 void CCurlImpl::setPath(const char* path, map<string, string>& params)
 {
-	m_sPath.assign(path);
+	if (m_tmplPath.getText() != path) {
+		m_tmplPath.compile(path);
+	}
 	setPath(params);
 }
 
@@ -144,7 +188,7 @@ void CCurlImpl::addHeader(const char* header)
 	m_pChunk = curl_slist_append(m_pChunk, header);
 }
 
-void CCurlImpl::addHeaders(vector<const char*>& headers)
+void CCurlImpl::addHeaders(const vector<const char*>& headers)
 {
 	for (int i = 0; i < headers.size(); i++) {
 		addHeader(headers[i]);
@@ -197,6 +241,63 @@ void CCurlImpl::setRefreshInterval(long interval)
 	m_lRefreshInterval.store(interval);
 }
 
+long CCurlImpl::getRefreshInterval()
+{
+	return m_lRefreshInterval.load();
+}
+
+// Must be called before init(), a value of 0 keeps the curl default.
+void CCurlImpl::setTimeout(long connectTimeout, long timeout)
+{
+	m_lConnectTimeout = connectTimeout;
+	m_lTimeout = timeout;
+}
+
+void CCurlImpl::setLatencyStats(CLatencyStats* latencyStats, const char* endpoint)
+{
+	m_pLatencyStats = latencyStats;
+	m_nEndpoint = latencyStats->endpoint(endpoint);
+	m_sEndpoint = endpoint;
+}
+
+// Connection phases are only recorded when the transfer opened a new connection,
+// a reused one reports them as zero.
+void CCurlImpl::recordTiming()
+{
+	if (!m_pLatencyStats) {
+		return;
+	}
+	double namelookup = 0, connect = 0, appconnect = 0, pretransfer = 0, starttransfer = 0, total = 0;
+	long connects = 0;
+	curl_easy_getinfo(m_pCurlHandle, CURLINFO_NAMELOOKUP_TIME, &namelookup);
+	curl_easy_getinfo(m_pCurlHandle, CURLINFO_CONNECT_TIME, &connect);
+	curl_easy_getinfo(m_pCurlHandle, CURLINFO_APPCONNECT_TIME, &appconnect);
+	curl_easy_getinfo(m_pCurlHandle, CURLINFO_PRETRANSFER_TIME, &pretransfer);
+	curl_easy_getinfo(m_pCurlHandle, CURLINFO_STARTTRANSFER_TIME, &starttransfer);
+	curl_easy_getinfo(m_pCurlHandle, CURLINFO_TOTAL_TIME, &total);
+	curl_easy_getinfo(m_pCurlHandle, CURLINFO_NUM_CONNECTS, &connects);
+
+	if (connects > 0) {
+		m_pLatencyStats->record(m_nEndpoint, LAT_DNS, (int64_t)(namelookup * 1e6));
+		m_pLatencyStats->record(m_nEndpoint, LAT_CONNECT, (int64_t)((connect - namelookup) * 1e6));
+		if (appconnect > 0) {
+			m_pLatencyStats->record(m_nEndpoint, LAT_TLS, (int64_t)((appconnect - connect) * 1e6));
+		}
+	}
+	if (starttransfer >= pretransfer) {
+		m_pLatencyStats->record(m_nEndpoint, LAT_TTFB, (int64_t)((starttransfer - pretransfer) * 1e6));
+	}
+	m_pLatencyStats->record(m_nEndpoint, LAT_TOTAL, (int64_t)(total * 1e6));
+
+#ifdef PLUGIN_TRACE
+	int64_t sentNs = m_nStartNs + (int64_t)(pretransfer * 1e9);
+	int64_t firstByteNs = m_nStartNs + (int64_t)(starttransfer * 1e9);
+	TRACE_SPAN("send", m_nStartNs, sentNs, m_sEndpoint.c_str());
+	TRACE_SPAN("wait", sentNs, firstByteNs, m_sEndpoint.c_str());
+	TRACE_SPAN("receive", firstByteNs, m_nStartNs + (int64_t)(total * 1e9), m_sEndpoint.c_str());
+#endif
+}
+
 bool CCurlImpl::chkRefresh()
 {
 	long interval = m_lRefreshInterval.load();
@@ -211,15 +312,21 @@ bool CCurlImpl::chkRefresh()
 	return false;
 }
 
+// The buffers keep their capacity, a handle stops allocating once it has seen its largest response.
 void CCurlImpl::clear()
 {
+#ifdef PLUGIN_TRACE
+	m_nStartNs = CUtils::getMonotonicNs();
+#endif
+	m_nRecvNs = 0;
+	m_nRecvMonoNs = 0;
+	m_stResHeader.size = 0;
 	if (m_stResHeader.buf) {
-		free(m_stResHeader.buf);
-		m_stResHeader.buf = NULL;
+		m_stResHeader.buf[0] = 0;
 	}
+	m_stResContents.size = 0;
 	if (m_stResContents.buf) {
-		free(m_stResContents.buf);
-		m_stResContents.buf = NULL;
+		m_stResContents.buf[0] = 0;
 	}
 }
 
@@ -227,20 +334,15 @@ CURLcode CCurlImpl::setEasyPerform(vector<ReqParam>* params)
 {
 	CURLcode ret = CURLE_OK;
 
-	m_sFields.assign(m_sReqString.c_str());
-	if (params) {
-		vector<ReqParam>::const_iterator pos = params->begin();
-		while (pos != params->end()) {
-			CUtils::replace(m_sFields, (*pos).key.c_str(), (*pos).value.c_str());
-			pos++;
-		}
-	}
+	// The buffers keep their capacity from one request to the next.
+	m_sFields.clear();
+	m_tmplRequest.render(params, m_sFields);
 
-	string url = m_sHost;
-	url.append(m_sPath);
+	m_sUrl.assign(m_sHost);
+	m_sUrl.append(m_sPath);
 	if (m_sMethod == "GET") {
 		if (!m_sFields.empty()) {
-			url.append("?").append(m_sFields);
+			m_sUrl.append(1, '?').append(m_sFields);
 		}		
 	} else {
 		if (m_sMethod != "POST") {
@@ -252,7 +354,7 @@ CURLcode CCurlImpl::setEasyPerform(vector<ReqParam>* params)
 		}
 
 	}
-	ret = curl_easy_setopt(m_pCurlHandle, CURLOPT_URL, url.c_str());
+	ret = curl_easy_setopt(m_pCurlHandle, CURLOPT_URL, m_sUrl.c_str());
 
 	return ret;
 }
@@ -260,7 +362,11 @@ CURLcode CCurlImpl::setEasyPerform(vector<ReqParam>* params)
 CURLcode CCurlImpl::doEasyPerform()
 {
 	clear();
-	return curl_easy_perform(m_pCurlHandle);
+	CURLcode ret = curl_easy_perform(m_pCurlHandle);
+	if (ret == CURLE_OK) {
+		recordTiming();
+	}
+	return ret;
 }
 
 void CCurlImpl::onResListener(void* listener)
@@ -287,23 +393,63 @@ size_t CCurlImpl::writeCallBack(void *contents, size_t size, size_t nmemb, void
 {
 	size_t realsize = size * nmemb;
 	ResBuffer *resbuf = (ResBuffer *)buf;
-	char *ptr;
 
-	if (resbuf->buf) {
-		ptr = (char*)realloc(resbuf->buf, resbuf->size + realsize + 1);
-		if (!ptr) {
+	if (resbuf->size + realsize + 1 > resbuf->capacity) {
+		size_t capacity = resbuf->capacity > 0 ? resbuf->capacity * 2 : 1024;
+		while (capacity < resbuf->size + realsize + 1) {
+			capacity *= 2;
+		}
+		if (!reserve(resbuf, capacity)) {
 			return 0;
 		}
 	}
-	else {
-		resbuf->size = 0;
-		ptr = (char*)malloc(realsize + 1);
-	}
 
-	memcpy(ptr + resbuf->size, contents, realsize);
-	resbuf->buf = ptr;
+	memcpy(resbuf->buf + resbuf->size, contents, realsize);
 	resbuf->size += realsize;
 	resbuf->buf[resbuf->size] = 0;
 
 	return realsize;
 }
+
+// The status line is the first byte of the response, so the receive time is
+// taken here. Header lines are only kept when the handle asked for them.
+size_t CCurlImpl::writeHeaderCallBack(void *contents, size_t size, size_t nmemb, void *curlobj)
+{
+	CCurlImpl* curlImpl = (CCurlImpl*)curlobj;
+
+	if (curlImpl->m_nRecvNs == 0) {
+		curlImpl->m_nRecvNs = CUtils::getRealtimeNs();
+		curlImpl->m_nRecvMonoNs = CUtils::getMonotonicNs();
+	}
+	if (!curlImpl->m_bGetHeader) {
+		return size * nmemb;
+	}
+	return writeCallBack(contents, size, nmemb, &curlImpl->m_stResHeader);
+}
+
+// Sizes the buffer from Content-Length on the first chunk of a response.
+size_t CCurlImpl::writeContentsCallBack(void *contents, size_t size, size_t nmemb, void *curlobj)
+{
+	CCurlImpl* curlImpl = (CCurlImpl*)curlobj;
+	ResBuffer *resbuf = &curlImpl->m_stResContents;
+
+	if (resbuf->size == 0) {
+		double contentLength = -1;
+		if (curl_easy_getinfo(curlImpl->m_pCurlHandle, CURLINFO_CONTENT_LENGTH_DOWNLOAD, &contentLength) == CURLE_OK
+			&& contentLength > 0 && (size_t)contentLength + 1 > resbuf->capacity) {
+			reserve(resbuf, (size_t)contentLength + 1);
+		}
+	}
+	return writeCallBack(contents, size, nmemb, resbuf);
+}
+
+bool CCurlImpl::reserve(ResBuffer *resbuf, size_t capacity)
+{
+	char *ptr = (char*)realloc(resbuf->buf, capacity);
+	if (!ptr) {
+		return false;
+	}
+	resbuf->buf = ptr;
+	resbuf->capacity = capacity;
+	return true;
+}
@@ -2,18 +2,17 @@
 #define CURLIMPL_H
 
 #include "curl/curl.h"
+#include "ReqTemplate.h"
+#include "LatencyStats.h"
+#include "Tracer.h"
 
 typedef struct {
 	char *buf;
 	size_t size;
+	size_t capacity;
 } ResBuffer;
 typedef void (*_curlResponseListener)(void* curlobj, void *listener);
 
-typedef struct {
-	string key;
-	string value;
-} ReqParam;
-
 class CCurlImpl
 {
 private:
@@ -24,14 +23,26 @@ private:
 	_curlResponseListener m_fpResListener;
 	struct curl_slist* m_pChunk;
 	struct timeval m_tImplTime;
+	int64_t m_nRecvNs;
+	int64_t m_nRecvMonoNs;
+	CLatencyStats* m_pLatencyStats;
+	int m_nEndpoint;
+	string m_sEndpoint;
+#ifdef PLUGIN_TRACE
+	int64_t m_nStartNs;
+#endif
 
 	bool m_bSslVerify;
+	long m_lConnectTimeout;
+	long m_lTimeout;
 	atomic<long> m_lRefreshInterval;
 	string m_sHost;
 	string m_sMethod;
+	CReqTemplate m_tmplPath;
+	CReqTemplate m_tmplRequest;
 	string m_sPath;
-	string m_sReqString;
 	string m_sFields;
+	string m_sUrl;
 	map<string, string> m_mapResFields;
 
 public:
@@ -47,6 +58,11 @@ public:
 	const char* getResHeader() const;
 	const char* getResContents() const;
 	const size_t getResSize() const;
+	int64_t getRecvNs() const;
+	int64_t getRecvMonoNs() const;
+	int64_t getRequestRttNs() const;
+	int getEndpoint() const;
+	const char* getEndpointName() const;
 	_curlResponseListener getResListener() const;
 	string getUrl() const;
 	string getResField(const char* key) const;
@@ -55,9 +71,13 @@ public:
 	void setPath(map<string, string>& params);
 	void setPath(const char* path, map<string, string>& params);
 	void addHeader(const char* header);
-	void addHeaders(vector<const char*>& headers);
+	void addHeaders(const vector<const char*>& headers);
 	void parseResFileds(const char* response);
 	void setRefreshInterval(long interval);
+	long getRefreshInterval();
+	void setTimeout(long connectTimeout, long timeout);
+	void setLatencyStats(CLatencyStats* latencyStats, const char* endpoint);
+	void recordTiming();
 	bool chkRefresh();
 	void clear();
 	
@@ -68,6 +88,9 @@ public:
 
 private:
 	static size_t writeCallBack(void *contents, size_t size, size_t nmemb, void *buf);
+	static size_t writeHeaderCallBack(void *contents, size_t size, size_t nmemb, void *curlobj);
+	static size_t writeContentsCallBack(void *contents, size_t size, size_t nmemb, void *curlobj);
+	static bool reserve(ResBuffer *resbuf, size_t capacity);
 };
 
 #endif
@@ -0,0 +1,188 @@
+﻿/*
+* Copyright 2020 FXDaemon
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include "stdafx.h"
+#include "LatencyStats.h"
+
+static const char* PhaseNames[LAT_PHASE_COUNT] = { "dns", "connect", "tls", "ttfb", "total", "parse" };
+
+CLatencyHistogram::CLatencyHistogram()
+{
+	for (int i = 0; i < BucketCount; i++) {
+		m_nCounts[i].store(0);
+	}
+	m_nTotal.store(0);
+	m_nSumUs.store(0);
+	m_nMinUs.store(INT64_MAX);
+	m_nMaxUs.store(0);
+}
+
+void CLatencyHistogram::record(int64_t us)
+{
+	if (us < 0) {
+		us = 0;
+	}
+	m_nCounts[bucketOf(us)].fetch_add(1, std::memory_order_relaxed);
+	m_nTotal.fetch_add(1, std::memory_order_relaxed);
+	m_nSumUs.fetch_add((uint64_t)us, std::memory_order_relaxed);
+
+	int64_t v = m_nMinUs.load(std::memory_order_relaxed);
+	while (us < v && !m_nMinUs.compare_exchange_weak(v, us, std::memory_order_relaxed));
+	v = m_nMaxUs.load(std::memory_order_relaxed);
+	while (us > v && !m_nMaxUs.compare_exchange_weak(v, us, std::memory_order_relaxed));
+}
+
+// Counts recorded during the walk may make the percentiles slightly off, never wrong by more than that.
+void CLatencyHistogram::summary(LatencySummary* latencySummary) const
+{
+	uint64_t counts[BucketCount];
+	uint64_t total = 0;
+	for (int i = 0; i < BucketCount; i++) {
+		counts[i] = m_nCounts[i].load(std::memory_order_relaxed);
+		total += counts[i];
+	}
+
+	memset(latencySummary, 0, sizeof(LatencySummary));
+	latencySummary->Count = total;
+	if (total == 0) {
+		return;
+	}
+	latencySummary->MinUs = m_nMinUs.load(std::memory_order_relaxed);
+	latencySummary->MaxUs = m_nMaxUs.load(std::memory_order_relaxed);
+	latencySummary->MeanUs = (int64_t)(m_nSumUs.load(std::memory_order_relaxed) / max(total, m_nTotal.load(std::memory_order_relaxed)));
+
+	const double quantiles[3] = { 0.50, 0.90, 0.99 };
+	int64_t* values[3] = { &latencySummary->P50Us, &latencySummary->P90Us, &latencySummary->P99Us };
+	uint64_t seen = 0;
+	int q = 0;
+	for (int i = 0; i < BucketCount && q < 3; i++) {
+		seen += counts[i];
+		while (q < 3 && seen >= (uint64_t)ceil(quantiles[q] * total)) {
+			*values[q] = min(highestOf(i), latencySummary->MaxUs);
+			q++;
+		}
+	}
+}
+
+int CLatencyHistogram::bucketOf(int64_t us)
+{
+	if (us < SubBuckets) {
+		return (int)us;
+	}
+	int shift = 0;
+	while ((us >> shift) >= 2 * SubBuckets) {
+		shift++;
+	}
+	int bucket = SubBuckets + shift * SubBuckets + (int)((us >> shift) - SubBuckets);
+	return min(bucket, BucketCount - 1);
+}
+
+int64_t CLatencyHistogram::highestOf(int bucket)
+{
+	if (bucket < SubBuckets) {
+		return bucket;
+	}
+	int shift = (bucket - SubBuckets) / SubBuckets;
+	int64_t sub = SubBuckets + (bucket - SubBuckets) % SubBuckets;
+	return ((sub + 1) << shift) - 1;
+}
+
+CLatencyStats::CLatencyStats()
+{
+	m_nEndpoints.store(0);
+	for (int i = 0; i < MaxEndpoints; i++) {
+		for (int j = 0; j < LAT_PHASE_COUNT; j++) {
+			m_pHistograms[i][j] = NULL;
+		}
+	}
+}
+
+CLatencyStats::~CLatencyStats()
+{
+	for (int i = 0; i < MaxEndpoints; i++) {
+		for (int j = 0; j < LAT_PHASE_COUNT; j++) {
+			delete m_pHistograms[i][j];
+		}
+	}
+}
+
+// Returns the index of the endpoint, -1 when all are taken.
+int CLatencyStats::endpoint(const char* name)
+{
+	CCriticalSection::Lock l(m_csEndpoints);
+	int count = m_nEndpoints.load(std::memory_order_relaxed);
+	for (int i = 0; i < count; i++) {
+		if (m_sNames[i] == name) {
+			return i;
+		}
+	}
+	if (count == MaxEndpoints) {
+		return -1;
+	}
+	m_sNames[count] = name;
+	for (int j = 0; j < LAT_PHASE_COUNT; j++) {
+		m_pHistograms[count][j] = new CLatencyHistogram();
+	}
+	m_nEndpoints.store(count + 1, std::memory_order_release);
+	return count;
+}
+
+void CLatencyStats::record(int endpoint, LatencyPhase phase, int64_t us)
+{
+	if (endpoint >= 0 && endpoint < m_nEndpoints.load(std::memory_order_acquire)) {
+		m_pHistograms[endpoint][phase]->record(us);
+	}
+}
+
+void CLatencyStats::snapshot(vector<LatencySnapshot>& snapshots) const
+{
+	int count = m_nEndpoints.load(std::memory_order_acquire);
+	snapshots.resize(count);
+	for (int i = 0; i < count; i++) {
+		snapshots[i].Endpoint = m_sNames[i];
+		for (int j = 0; j < LAT_PHASE_COUNT; j++) {
+			m_pHistograms[i][j]->summary(&snapshots[i].Phases[j]);
+		}
+	}
+}
+
+// One line per endpoint that has completed requests, p50/p99 in milliseconds.
+string CLatencyStats::toString() const
+{
+	vector<LatencySnapshot> snapshots;
+	snapshot(snapshots);
+
+	string s;
+	char buf[128];
+	for (size_t i = 0; i < snapshots.size(); i++) {
+		if (snapshots[i].Phases[LAT_TOTAL].Count == 0) {
+			continue;
+		}
+		if (!s.empty()) {
+			s.append("\n");
+		}
+		sprintf(buf, "[Latency] %s n:%llu", snapshots[i].Endpoint.c_str(),
+			(unsigned long long)snapshots[i].Phases[LAT_TOTAL].Count);
+		s.append(buf);
+		for (int j = 0; j < LAT_PHASE_COUNT; j++) {
+			const LatencySummary& summary = snapshots[i].Phases[j];
+			if (summary.Count > 0) {
+				sprintf(buf, " %s:%.3f/%.3f", PhaseNames[j], summary.P50Us / 1000.0, summary.P99Us / 1000.0);
+				s.append(buf);
+			}
+		}
+	}
+	return s;
+}
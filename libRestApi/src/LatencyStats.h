@@ -0,0 +1,79 @@
+#ifndef LATENCYSTATS_H
+#define LATENCYSTATS_H
+
+#include "CriticalSection.h"
+
+typedef enum {
+	LAT_DNS,		// name lookup, new connections only
+	LAT_CONNECT,	// TCP connect, new connections only
+	LAT_TLS,		// TLS handshake, new connections only
+	LAT_TTFB,		// request sent to first response byte
+	LAT_TOTAL,		// whole transfer
+	LAT_PARSE,		// JSON parse of the response
+	LAT_PHASE_COUNT
+} LatencyPhase;
+
+typedef struct {
+	uint64_t Count;
+	int64_t MinUs;
+	int64_t MaxUs;
+	int64_t MeanUs;
+	int64_t P50Us;
+	int64_t P90Us;
+	int64_t P99Us;
+} LatencySummary;
+
+typedef struct {
+	string Endpoint;
+	LatencySummary Phases[LAT_PHASE_COUNT];
+} LatencySnapshot;
+
+// Log-linear histogram of microseconds, 16 sub-buckets per power of two
+// (values within 6.25%), as in HdrHistogram. Recording is a few relaxed atomic
+// adds, so it can be done on every request.
+class CLatencyHistogram
+{
+private:
+	static const int SubBuckets = 16;
+	static const int BucketCount = SubBuckets + 37 * SubBuckets;	// up to 2^40 us
+
+	atomic<uint64_t> m_nCounts[BucketCount];
+	atomic<uint64_t> m_nTotal;
+	atomic<uint64_t> m_nSumUs;
+	atomic<int64_t> m_nMinUs;
+	atomic<int64_t> m_nMaxUs;
+
+public:
+	CLatencyHistogram();
+
+	void record(int64_t us);
+	void summary(LatencySummary* latencySummary) const;
+
+private:
+	static int bucketOf(int64_t us);
+	static int64_t highestOf(int bucket);
+};
+
+// Histograms per endpoint (config section) and phase. Endpoints are registered
+// when their handles are created; their indexes never change.
+class CLatencyStats
+{
+private:
+	static const int MaxEndpoints = 32;
+
+	string m_sNames[MaxEndpoints];
+	CLatencyHistogram* m_pHistograms[MaxEndpoints][LAT_PHASE_COUNT];
+	atomic<int> m_nEndpoints;
+	CCriticalSection m_csEndpoints;
+
+public:
+	CLatencyStats();
+	~CLatencyStats();
+
+	int endpoint(const char* name);
+	void record(int endpoint, LatencyPhase phase, int64_t us);
+	void snapshot(vector<LatencySnapshot>& snapshots) const;
+	string toString() const;
+};
+
+#endif
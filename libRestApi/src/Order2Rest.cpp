@@ -50,12 +50,15 @@ COrder2Rest::COrder2Rest()
 	m_pPluginProxy = getPluginProxy();
 	m_pPluginProxy->registerPlugin("Order2Rest", this);
 	
+	m_pProxyRecorder = NULL;
+	m_pTickJournal = NULL;
+	m_pPositionBook = NULL;
 	m_pCurlMulti = NULL;
 	m_hExitEvent = nsapi::CreateEvent(NULL, FALSE, FALSE, NULL);
 	m_hOverEvent = nsapi::CreateEvent(NULL, FALSE, FALSE, NULL);
 	ThreadFunAttr threadFunAttr = { tradeEventsProcess, this };
 	m_pTradeEventsProcessThread = new CThread(threadFunAttr);
-	m_tmStdTime.store(0);
+	m_pTrailingStop = new CTrailingStop(this);
 }
 
 COrder2Rest::~COrder2Rest()
@@ -63,15 +66,41 @@ COrder2Rest::~COrder2Rest()
 	nsapi::CloseHandle(m_hExitEvent);
 	nsapi::CloseHandle(m_hOverEvent);
 	delete m_pTradeEventsProcessThread;
+	delete m_pTrailingStop;
 }
 
 int COrder2Rest::init(const char* iniFile)
 {
-	m_SimpleIni.SetUnicode();
-	if (m_SimpleIni.LoadFile(iniFile) < 0) {
+	if (m_Config.load(iniFile) != RET_SUCCESS) {
 		m_pPluginProxy->onMessage(MSG_ERROR, "Config file open failed.");
 		return RET_FAILED;
 	}
+	m_nNextReloadNs = 0;
+	m_nNextStatsNs = 0;
+	m_Symbols.setCombination(m_Config.get()->Combination.c_str());
+	if (m_Config.get()->ReloadInterval > 0 && m_Config.get()->SignalReload) {
+		m_Config.catchSignal();
+	}
+
+	if (atoi(getRecorderInfo("Enable", "0")) != 0) {
+		m_pProxyRecorder = new CProxyRecorder(m_pPluginProxy, atol(getRecorderInfo("Capacity", "65536")));
+		m_pPluginProxy = m_pProxyRecorder;
+	}
+
+	if (atoi(getJournalInfo("Enable", "0")) != 0) {
+		m_pTickJournal = new CTickJournal(getJournalInfo("Path", "./"),
+			strtoull(getJournalInfo("Capacity", "4194304"), NULL, 10), atol(getJournalInfo("FlushInterval", "1000")));
+		if (m_pTickJournal->start() != RET_SUCCESS) {
+			m_pPluginProxy->onMessage(MSG_ERROR, "Tick journal open failed.");
+			delete m_pTickJournal;
+			m_pTickJournal = NULL;
+		}
+	}
+
+	if (atoi(getPositionInfo("Enable", "0")) != 0) {
+		initPositionBook();
+	}
+	initMarketCalendar();
 
 	curl_global_init(CURL_GLOBAL_ALL);
 	if (strcmp(getBaseInfo("parallel"), "true") == 0) {
@@ -85,13 +114,15 @@ int COrder2Rest::init(const char* iniFile)
 		}
 	}
 
-	m_mapPathParams.insert(pair<string, string>("$account_id", getBaseInfo("AccountID")));
+	m_mapPathParams.insert(pair<string, string>("$account_id", m_Config.get()->AccountID));
 	return initCurl();
 }
 
 int COrder2Rest::login()
 {
+	m_Symbols.addSymbols(m_Config.get()->Symbols.c_str());
 	m_pTradeEventsProcessThread->_start();
+	m_pTrailingStop->start();
 	return RET_SUCCESS;
 }
 
@@ -99,6 +130,7 @@ int COrder2Rest::close()
 {
 	nsapi::SetEvent(m_hExitEvent);
 	nsapi::WaitForSingleObject(m_hOverEvent, INFINITE);
+	m_pTrailingStop->stop();
 
 	if (m_pCurlMulti) {
 		curl_multi_cleanup(m_pCurlMulti);
@@ -108,17 +140,34 @@ int COrder2Rest::close()
 			delete m_CurlList[i];
 		}
 	}
+	for (size_t i = 0; i < m_vtCandleCurls.size(); i++) {
+		delete m_vtCandleCurls[i];
+	}
+	m_vtCandleCurls.clear();
 	curl_global_cleanup();
+	if (m_pTickJournal) {
+		delete m_pTickJournal;
+		m_pTickJournal = NULL;
+	}
+	if (m_pPositionBook) {
+		delete m_pPositionBook;
+		m_pPositionBook = NULL;
+	}
+	if (m_pProxyRecorder) {
+		m_pProxyRecorder->dump(getRecorderInfo("DumpFile", "proxy-recorder.log"));
+	}
+	TRACE_DUMP(getBaseInfo("TraceFile", "restapi-trace.json"));
 	return RET_SUCCESS;
 }
 
 time_t COrder2Rest::getServerTime()
 {
-	return m_tmStdTime.load();
+	return (time_t)(m_ServerClock.nowNs() / 1000000000);
 }
 
 int COrder2Rest::getAccount(const char* accountID, TblAccount** tblAccount)
 {
+	CCriticalSection::Lock l(m_csCurlList[CURL_GET_ACCOUNT]);
 	CCurlImpl* curlObj = m_CurlList[CURL_GET_ACCOUNT];
 	CURLcode ret = curlObj->doEasyPerform();
 	if (ret != CURLE_OK) {
@@ -133,48 +182,51 @@ int COrder2Rest::getAccount(const char* accountID, TblAccount** tblAccount)
 	}
 	
 	*tblAccount = newTblAccount(obj, curlObj);
-	curlObj->setRefreshInterval(atol(getAccountInfo("Refresh")));
+	if (m_pPositionBook) {
+		m_pPositionBook->setAccount(*tblAccount);
+	}
+	curlObj->setRefreshInterval(m_Config.get()->AccountRefresh);
 	return 1;
 }
 
+// Subscribed symbols are answered from the quote cache. The others are fetched
+// with one request and left out of the poll.
 int COrder2Rest::getPrice(const char* symbol[], TblPrice** pTblPrice[])
 {
-	CCurlImpl* curlObj = m_CurlList[CURL_GET_PRICE];
-
-	vector<ReqParam> params;
-	params.push_back(ReqParam{"$symbols", transfSymbols(symbol)});
-	curlObj->setEasyPerform(&params);
-
-	CURLcode ret = curlObj->doEasyPerform();
-	if (ret != CURLE_OK) {
-		m_pPluginProxy->onMessage(MSG_ERROR, curl_easy_strerror(ret));
-		return RET_FAILED;
-	}
-
-	picojson::value json;
-	picojson::array& list = parseJsonArray(curlObj, json);
-	if (list.empty()) {
-		return 0;
+	vector<TblPrice*> tblPriceList;
+	vector<int> missingIDs;
+	for (int i = 0; symbol[i]; i++) {
+		int id = m_Symbols.intern(symbol[i]);
+		TblPrice tblPrice;
+		if (isPolled(id) && m_QuoteCache.get(id, &tblPrice)) {
+			tblPriceList.push_back(new TblPrice(tblPrice));
+		}
+		else if (id != SYMBOL_INVALID) {
+			missingIDs.push_back(id);
+		}
 	}
 
-	vector<TblPrice*> tblPriceList;
-	for (picojson::array::iterator it = list.begin(); it != list.end(); it++) {
-		picojson::object& o = it->get<picojson::object>();
-		tblPriceList.push_back(newTblPrice(o, curlObj));
+	if (!missingIDs.empty() && fetchPrices(missingIDs, tblPriceList) == RET_FAILED && tblPriceList.empty()) {
+		return RET_FAILED;
 	}
 
 	if (tblPriceList.size() > 0) {
 		*pTblPrice = new TblPrice*[tblPriceList.size()];
 		std::copy(tblPriceList.begin(), tblPriceList.end(), *pTblPrice);
 	}
-
-	m_tmStdTime.store(reqServerTime());
-	curlObj->setRefreshInterval(atol(getPriceInfo("Refresh")));
 	return tblPriceList.size();
 }
 
+// The v20 REST API publishes no level 2 book.
+int COrder2Rest::getDepth(const char* /*symbol*/, TblDepth** tblDepth)
+{
+	*tblDepth = NULL;
+	return 0;
+}
+
 int COrder2Rest::getOpenedTrades(TblTrade** pTblTrade[])
 {
+	CCriticalSection::Lock l(m_csCurlList[CURL_GET_OPENTRADES]);
 	CCurlImpl* curlObj = m_CurlList[CURL_GET_OPENTRADES];
 	CURLcode ret = curlObj->doEasyPerform();
 	if (ret != CURLE_OK) {
@@ -184,30 +236,38 @@ int COrder2Rest::getOpenedTrades(TblTrade** pTblTrade[])
 
 	picojson::value json;
 	picojson::array& list = parseJsonArray(curlObj, json);
+	vector<TblTrade*> tblTradeList;
 	if (list.empty()) {
-		curlObj->setRefreshInterval(atol(GetOpenedTradesInfo("Refresh")));
+		if (m_pPositionBook && json.contains(curlObj->getResField(CCurlImpl::ResTargetName))) {
+			m_pPositionBook->setTrades(tblTradeList);
+		}
+		curlObj->setRefreshInterval(m_Config.get()->OpenedTradesRefresh);
 		return 0;
 	}
 	
-	vector<TblTrade*> tblTradeList;
+	const RestSettings* settings = m_Config.get();
 	for (picojson::array::iterator it = list.begin(); it != list.end(); it++) {
 		picojson::object& o = it->get<picojson::object>();
 		TblTrade* tblTrade = newTblTrade(o, curlObj);
-		strcpy(tblTrade->AccountID, getBaseInfo("AccountID"));
+		strcpy(tblTrade->AccountID, settings->AccountID.c_str());
 		tblTradeList.push_back(tblTrade);
 	}
+	if (m_pPositionBook) {
+		m_pPositionBook->setTrades(tblTradeList);
+	}
 
 	if (tblTradeList.size() > 0) {
 		*pTblTrade = new TblTrade*[tblTradeList.size()];
 		std::copy(tblTradeList.begin(), tblTradeList.end(), *pTblTrade);
 	}
 
-	curlObj->setRefreshInterval(atol(GetOpenedTradesInfo("Refresh")));
+	curlObj->setRefreshInterval(settings->OpenedTradesRefresh);
 	return tblTradeList.size();
 }
 
 int COrder2Rest::getClosedTrades(TblTrade** pTblTrade[])
 {
+	CCriticalSection::Lock l(m_csCurlList[CURL_GET_CLOSEDTRADES]);
 	CCurlImpl* curlObj = m_CurlList[CURL_GET_CLOSEDTRADES];
 	CURLcode ret = curlObj->doEasyPerform();
 	if (ret != CURLE_OK) {
@@ -218,17 +278,18 @@ int COrder2Rest::getClosedTrades(TblTrade** pTblTrade[])
 	picojson::value json;
 	picojson::array& list = parseJsonArray(curlObj, json);
 	if (list.empty()) {
-		curlObj->setRefreshInterval(atol(GetClosedTradesInfo("Refresh")));
+		curlObj->setRefreshInterval(m_Config.get()->ClosedTradesRefresh);
 		return 0;
 	}
 
 	vector<TblTrade*> tblTradeList;
+	const RestSettings* settings = m_Config.get();
 	time_t weekFirstDay = CUtils::getWeekFirstDate();
 	for (picojson::array::iterator it = list.begin(); it != list.end(); it++) {
 		picojson::object& o = it->get<picojson::object>();
 		TblTrade* tblTrade = newTblTrade(o, curlObj);
 		if (tblTrade->CloseTime > weekFirstDay) {
-			strcpy(tblTrade->AccountID, getBaseInfo("AccountID"));
+			strcpy(tblTrade->AccountID, settings->AccountID.c_str());
 			tblTradeList.push_back(tblTrade);
 		}
 		else {
@@ -241,63 +302,42 @@ int COrder2Rest::getClosedTrades(TblTrade** pTblTrade[])
 		std::copy(tblTradeList.begin(), tblTradeList.end(), *pTblTrade);
 	}
 
-	curlObj->setRefreshInterval(atol(GetClosedTradesInfo("Refresh")));
+	curlObj->setRefreshInterval(settings->ClosedTradesRefresh);
 	return tblTradeList.size();
 }
 
 int COrder2Rest::getHistoricalData(const char* symbol, const char* period, time_t start, time_t end, bool maxRange, TblCandle** pTblCandle[])
 {
-	// UTC (Sunday 19:00 - Friday 21:00)
-	int marketOpenWday = atoi(getMarketInfo("OpenWday", "0"));
-	int marketOpenHour = atoi(getMarketInfo("OpenHour", "19"));
-	int marketCloseWday = atoi(getMarketInfo("CloseWday", "5"));
-	int marketCloseHour = atoi(getMarketInfo("CloseHour", "21"));
 	time_t interval = getTimetByPeriod(period);
-	int adjustmentTimezone = getAdjustmentTimezone();	// 2023/10/09 add by yld
+	int adjustmentTimezone = m_Config.get()->AdjustmentTimezone;	// 2023/10/09 add by yld
+
+	// Each window holds at most CandleMaxNumber bars of trading time, closed periods are not counted.
+	time_t last = end;
+	if (m_ServerClock.isSynced() && getServerTime() < last) {
+		last = getServerTime();
+	}
+	vector<pair<time_t, time_t> > windows;
+	m_MarketCalendar.planWindows(start - interval, last, CandleMaxNumber * interval, windows);
 
 	vector<TblCandle*> outCandleList;
-	time_t cur = start - interval;
 	time_t addLastTime = start;
-
-	while (cur <= end) {
-		time_t to = cur + CandleMaxNumber * interval;
-		time_t tmStdTime = m_tmStdTime.load();
-		if (to > tmStdTime && tmStdTime > 0) {
-			to = tmStdTime;
-		}
-		if (cur > to) {
-			break;
-		}
-		
+	for (size_t i = 0; i < windows.size(); i++) {
 		vector<TblCandle*> tmpCandleList;
-		if (getHistoricalData(symbol, period, cur, to, adjustmentTimezone, tmpCandleList) < 0) {
+		if (getHistoricalData(symbol, period, windows[i].first, windows[i].second, adjustmentTimezone, tmpCandleList) < 0) {
 			return RET_FAILED;
 		}
-		
-		if (!tmpCandleList.empty()) {
-			if (!outCandleList.empty()) {
-				addLastTime = outCandleList.back()->StartDate;
-			}
 
-			bool isAddNew = false;
-			vector<TblCandle*>::iterator vpos = tmpCandleList.begin();
-			while (vpos != tmpCandleList.end()) {
-				if ((*vpos)->StartDate > addLastTime && (*vpos)->StartDate <= end - interval) {
-					outCandleList.push_back(*vpos);
-					isAddNew = true;
-				}
-				else {
-					delete *vpos;
-				}
-				++vpos;
+		vector<TblCandle*>::iterator vpos = tmpCandleList.begin();
+		while (vpos != tmpCandleList.end()) {
+			if ((*vpos)->StartDate > addLastTime && (*vpos)->StartDate <= end - interval) {
+				outCandleList.push_back(*vpos);
+				addLastTime = (*vpos)->StartDate;
 			}
-
-			if (isAddNew) {
-				cur = outCandleList.back()->StartDate - interval;
-				continue;
+			else {
+				delete *vpos;
 			}
+			++vpos;
 		}
-		cur = CUtils::overDayoff(cur, marketOpenWday, marketOpenHour, marketCloseWday, marketCloseHour);
 	}
 
 	if (outCandleList.size() > 0) {
@@ -310,53 +350,23 @@ int COrder2Rest::getHistoricalData(const char* symbol, const char* period, time_
 
 int COrder2Rest::openMarketOrder(TblOrder* tblOrder)
 {
-	vector<const char*> headers;
-	getHeaders(headers);
-
-	CCurlImpl m_curlTradeImpl(getBaseInfo("Host"), getSslVerify());
-	m_curlTradeImpl.addHeaders(headers);
-	m_curlTradeImpl.setPath(getOpenMarketOrderInfo("Path"), m_mapPathParams);
-	m_curlTradeImpl.parseResFileds(getOpenMarketOrderInfo("Response"));
-	if (m_curlTradeImpl.init(
-		getOpenMarketOrderInfo("Method"), getOpenMarketOrderInfo("Request"), false) != CURLE_OK) {
-		m_pPluginProxy->onMessage(MSG_ERROR, "Can't init [OpenMarketOrder] curl.");
+	TRACE_SCOPE("openMarketOrder", tblOrder->Symbol);
+	CCurlImpl* curlImpl = newOpenMarketOrderCurl(tblOrder);
+	if (!curlImpl) {
 		return RET_FAILED;
 	}
+	TRACE_INSTANT("requestBuilt", tblOrder->Symbol);
 
-	vector<ReqParam> params;
-	params.push_back(ReqParam{"$symbol", transfSymbol(tblOrder->Symbol)});
-	string side = getSideInfo(tblOrder->BS);
-	if (side.length() > 0) {
-		params.push_back(ReqParam{"$amount", std::to_string((long)tblOrder->Amount)});
-		params.push_back(ReqParam{"$bs", side});
-	}
-	else {
-		if (strcmp(tblOrder->BS, "B") == 0) {
-			params.push_back(ReqParam{"$amount", std::to_string(tblOrder->Amount)});
-		}
-		else {
-			params.push_back(ReqParam{"$amount", std::to_string(tblOrder->Amount * -1)});
-		}
-	}
-	m_curlTradeImpl.setEasyPerform(&params);
-
-	CURLcode ret = m_curlTradeImpl.doEasyPerform();
-	if (ret != CURLE_OK) {
-		m_pPluginProxy->onMessage(MSG_ERROR, curl_easy_strerror(ret));
-		return RET_FAILED;
+	TblOrder* resOrder = NULL;
+	TblTrade* openedTrade = NULL;
+	if (doTradePerform(curlImpl) == CURLE_OK) {
+		resOrder = onOpenMarketOrder(curlImpl, &openedTrade);
 	}
-	
-	picojson::value json;
-	picojson::object& obj = parseJsonObject(&m_curlTradeImpl, json);
-	if (obj.empty()) {
+	delete curlImpl;
+	if (!resOrder) {
 		return RET_FAILED;
 	}
 
-	TblOrder* resOrder = newTblOrder(obj, &m_curlTradeImpl);
-	m_pPluginProxy->onOrder(TableStatus::ST_NEW, resOrder);
-
-	TblTrade* openedTrade = newTblTrade(obj, &m_curlTradeImpl);
-
 	if (tblOrder->Stop != 0) {
 		TblOrder* stopLossOrder = new TblOrder();
 		strcpy(stopLossOrder->TradeID, resOrder->TradeID);
@@ -381,254 +391,230 @@ int COrder2Rest::openMarketOrder(TblOrder* tblOrder)
 		delete takeProfitOrder;
 	}
 
-	strcpy(openedTrade->OpenOrderID, resOrder->OrderID);
-	m_pPluginProxy->onOpenedTrade(TableStatus::ST_NEW, openedTrade);
-	delete openedTrade;
-
-	strcpy(tblOrder->OrderID, resOrder->OrderID);
-	delete resOrder;
+	onOpenedMarketOrder(tblOrder, resOrder, openedTrade);
 	return RET_SUCCESS;
 }
 
 int COrder2Rest::openStopLossOrder(TblOrder* tblOrder)
 {
-	vector<const char*> headers;
-	getHeaders(headers);
-
-	CCurlImpl m_curlTradeImpl(getBaseInfo("Host"), getSslVerify());
-	m_curlTradeImpl.addHeaders(headers);
-	m_curlTradeImpl.setPath(getStopLossOrderInfo("Path"), m_mapPathParams);
-	m_curlTradeImpl.parseResFileds(getStopLossOrderInfo("Response"));
-	if (m_curlTradeImpl.init(
-		getStopLossOrderInfo("Method"), getStopLossOrderInfo("Request"), false) != CURLE_OK) {
-		m_pPluginProxy->onMessage(MSG_ERROR, "Can't init [openStopLossOrder] curl.");
-		return RET_FAILED;
-	}
-
-	vector<ReqParam> params;
-	params.push_back(ReqParam{"$stop", std::to_string(tblOrder->Stop)});
-	params.push_back(ReqParam{"$trade_id", tblOrder->TradeID});
-	m_curlTradeImpl.setEasyPerform(&params);
-
-	CURLcode ret = m_curlTradeImpl.doEasyPerform();
-	if (ret != CURLE_OK) {
-		m_pPluginProxy->onMessage(MSG_ERROR, curl_easy_strerror(ret));
-		return RET_FAILED;
-	}
-
-	picojson::value json;
-	picojson::object& obj = parseJsonObject(&m_curlTradeImpl, json);
-	if (obj.empty()) {
+	TRACE_SCOPE("openStopLossOrder", tblOrder->TradeID);
+	CCurlImpl* curlImpl = newStopLossOrderCurl(tblOrder);
+	if (!curlImpl) {
 		return RET_FAILED;
 	}
-
-	TblOrder* resOrder = newTblOrder(obj, &m_curlTradeImpl);
-	if (strlen(resOrder->Symbol) == 0) {
-		strcpy(resOrder->Symbol, tblOrder->Symbol);
+	int ret = RET_FAILED;
+	if (doTradePerform(curlImpl) == CURLE_OK) {
+		ret = onStopLossOrder(curlImpl, tblOrder);
 	}
-	m_pPluginProxy->onOrder(TableStatus::ST_NEW, resOrder);
-	strcpy(tblOrder->OrderID, resOrder->OrderID);
-	tblOrder->Stop = resOrder->Stop;
-	delete resOrder;
-
-	return RET_SUCCESS;
+	delete curlImpl;
+	return ret;
 }
 
 int COrder2Rest::openTakeProfitOrder(TblOrder* tblOrder)
 {
-	vector<const char*> headers;
-	getHeaders(headers);
-
-	CCurlImpl m_curlTradeImpl(getBaseInfo("Host"), getSslVerify());
-	m_curlTradeImpl.addHeaders(headers);
-	m_curlTradeImpl.setPath(getTakeProfitOrderInfo("Path"), m_mapPathParams);
-	m_curlTradeImpl.parseResFileds(getTakeProfitOrderInfo("Response"));
-	if (m_curlTradeImpl.init(
-		getTakeProfitOrderInfo("Method"), getTakeProfitOrderInfo("Request"), false) != CURLE_OK) {
-		m_pPluginProxy->onMessage(MSG_ERROR, "Can't init [openTakeProfitOrder] curl.");
+	TRACE_SCOPE("openTakeProfitOrder", tblOrder->TradeID);
+	CCurlImpl* curlImpl = newTakeProfitOrderCurl(tblOrder);
+	if (!curlImpl) {
 		return RET_FAILED;
 	}
+	int ret = RET_FAILED;
+	if (doTradePerform(curlImpl) == CURLE_OK) {
+		ret = onTakeProfitOrder(curlImpl, tblOrder);
+	}
+	delete curlImpl;
+	return ret;
+}
 
-	vector<ReqParam> params;
-	params.push_back(ReqParam{"$limit", std::to_string(tblOrder->Limit)});
-	params.push_back(ReqParam{"$trade_id", tblOrder->TradeID});
-	m_curlTradeImpl.setEasyPerform(&params);
+int COrder2Rest::changeStopLoss(TblTrade* tblTrade)
+{
+	TblTrade* tblTrades[] = { tblTrade, NULL };
+	return changeOrders(tblTrades, true) == 1 ? RET_SUCCESS : RET_FAILED;
+}
 
-	CURLcode ret = m_curlTradeImpl.doEasyPerform();
-	if (ret != CURLE_OK) {
-		m_pPluginProxy->onMessage(MSG_ERROR, curl_easy_strerror(ret));
-		return RET_FAILED;
-	}
+int COrder2Rest::changeTakeProfit(TblTrade* tblTrade)
+{
+	TblTrade* tblTrades[] = { tblTrade, NULL };
+	return changeOrders(tblTrades, false) == 1 ? RET_SUCCESS : RET_FAILED;
+}
 
-	picojson::value json;
-	picojson::object& obj = parseJsonObject(&m_curlTradeImpl, json);
-	if (obj.empty()) {
+int COrder2Rest::closeTrade(TblTrade* tblTrade)
+{
+	CCurlImpl* curlImpl = newCloseTradeCurl(tblTrade);
+	if (!curlImpl) {
 		return RET_FAILED;
 	}
-
-	TblOrder* resOrder = newTblOrder(obj, &m_curlTradeImpl);
-	if (strlen(resOrder->Symbol) == 0) {
-		strcpy(resOrder->Symbol, tblOrder->Symbol);
+	int ret = RET_FAILED;
+	if (doTradePerform(curlImpl) == CURLE_OK) {
+		ret = onCloseTrade(curlImpl, tblTrade);
 	}
-	m_pPluginProxy->onOrder(TableStatus::ST_NEW, resOrder);
-	strcpy(tblOrder->OrderID, resOrder->OrderID);
-	tblOrder->Limit = resOrder->Limit;
-	delete resOrder;
-
-	return RET_SUCCESS;
+	delete curlImpl;
+	return ret;
 }
 
-int COrder2Rest::changeStopLoss(TblTrade* tblTrade)
+int COrder2Rest::openMarketOrders(TblOrder* tblOrders[])
 {
-	vector<const char*> headers;
-	getHeaders(headers);
-
-	CCurlImpl m_curlTradeImpl(getBaseInfo("Host"), getSslVerify());
-	m_curlTradeImpl.addHeaders(headers);
-	m_mapPathParams["$order_id"] = tblTrade->StopOrderID;
-	m_curlTradeImpl.setPath(getChangeStopLossInfo("Path"), m_mapPathParams);
-	m_curlTradeImpl.parseResFileds(getChangeStopLossInfo("Response"));
-	if (m_curlTradeImpl.init(
-		getChangeStopLossInfo("Method"), getChangeStopLossInfo("Request"), false) != CURLE_OK) {
-		m_pPluginProxy->onMessage(MSG_ERROR, "Can't init [changeStop] curl.");
-		return RET_FAILED;
+	vector<CCurlImpl*> curlList;
+	for (int i = 0; tblOrders[i]; i++) {
+		curlList.push_back(newOpenMarketOrderCurl(tblOrders[i]));
 	}
+	vector<CURLcode> results;
+	doMultiPerform(curlList, results);
 
-	vector<ReqParam> params;
-	params.push_back(ReqParam{"$stop", std::to_string(tblTrade->Stop)});
-	params.push_back(ReqParam{"$trade_id", tblTrade->TradeID});
-	m_curlTradeImpl.setEasyPerform(&params);
-
-	CURLcode ret = m_curlTradeImpl.doEasyPerform();
-	if (ret != CURLE_OK) {
-		m_pPluginProxy->onMessage(MSG_ERROR, curl_easy_strerror(ret));
-		return RET_FAILED;
+	vector<TblOrder*> resOrders(curlList.size(), NULL);
+	vector<TblTrade*> openedTrades(curlList.size(), NULL);
+	for (size_t i = 0; i < curlList.size(); i++) {
+		if (curlList[i] && results[i] == CURLE_OK) {
+			resOrders[i] = onOpenMarketOrder(curlList[i], &openedTrades[i]);
+		}
+		delete curlList[i];
 	}
 
-	picojson::value json;
-	picojson::object& obj = parseJsonObject(&m_curlTradeImpl, json);
-	if (obj.empty()) {
-		return RET_FAILED;
+	// Stop loss and take profit orders of all filled trades go out as a second wave.
+	vector<TblOrder*> attachOrders;
+	vector<size_t> attachIndexes;
+	curlList.clear();
+	for (size_t i = 0; i < resOrders.size(); i++) {
+		if (!resOrders[i]) {
+			continue;
+		}
+		if (tblOrders[i]->Stop != 0) {
+			TblOrder* stopLossOrder = new TblOrder();
+			strcpy(stopLossOrder->TradeID, resOrders[i]->TradeID);
+			strcpy(stopLossOrder->Symbol, tblOrders[i]->Symbol);
+			stopLossOrder->Stop = tblOrders[i]->Stop;
+			attachOrders.push_back(stopLossOrder);
+			attachIndexes.push_back(i);
+			curlList.push_back(newStopLossOrderCurl(stopLossOrder));
+		}
+		if (tblOrders[i]->Limit != 0) {
+			TblOrder* takeProfitOrder = new TblOrder();
+			strcpy(takeProfitOrder->TradeID, resOrders[i]->TradeID);
+			strcpy(takeProfitOrder->Symbol, tblOrders[i]->Symbol);
+			takeProfitOrder->Limit = tblOrders[i]->Limit;
+			attachOrders.push_back(takeProfitOrder);
+			attachIndexes.push_back(i);
+			curlList.push_back(newTakeProfitOrderCurl(takeProfitOrder));
+		}
 	}
+	doMultiPerform(curlList, results);
 
-	TblOrder* resOrder = newTblOrder(obj, &m_curlTradeImpl);
-	if (strlen(resOrder->Symbol) == 0) {
-		strcpy(resOrder->Symbol, tblTrade->Symbol);
+	for (size_t i = 0; i < curlList.size(); i++) {
+		TblOrder* attachOrder = attachOrders[i];
+		TblTrade* openedTrade = openedTrades[attachIndexes[i]];
+		if (curlList[i] && results[i] == CURLE_OK) {
+			if (attachOrder->Stop != 0) {
+				if (onStopLossOrder(curlList[i], attachOrder) == RET_SUCCESS) {
+					strcpy(openedTrade->StopOrderID, attachOrder->OrderID);
+					openedTrade->Stop = attachOrder->Stop;
+				}
+			}
+			else if (onTakeProfitOrder(curlList[i], attachOrder) == RET_SUCCESS) {
+				strcpy(openedTrade->LimitOrderID, attachOrder->OrderID);
+				openedTrade->Limit = attachOrder->Limit;
+			}
+		}
+		delete curlList[i];
+		delete attachOrder;
 	}
-	m_pPluginProxy->onOrder(TableStatus::ST_NEW, resOrder);
-	strcpy(tblTrade->StopOrderID, resOrder->OrderID);
-	delete resOrder;
 
-	return RET_SUCCESS;
+	int count = 0;
+	for (size_t i = 0; i < resOrders.size(); i++) {
+		if (resOrders[i]) {
+			onOpenedMarketOrder(tblOrders[i], resOrders[i], openedTrades[i]);
+			count++;
+		}
+	}
+	return count;
 }
 
-int COrder2Rest::changeTakeProfit(TblTrade* tblTrade)
+int COrder2Rest::changeStopLosses(TblTrade* tblTrades[])
 {
-	vector<const char*> headers;
-	getHeaders(headers);
-
-	CCurlImpl m_curlTradeImpl(getBaseInfo("Host"), getSslVerify());
-	m_curlTradeImpl.addHeaders(headers);
-	m_mapPathParams["$order_id"] = tblTrade->LimitOrderID;
-	m_curlTradeImpl.setPath(getChangeTakeProfitInfo("Path"), m_mapPathParams);
-	m_curlTradeImpl.parseResFileds(getChangeTakeProfitInfo("Response"));
-	if (m_curlTradeImpl.init(
-		getChangeTakeProfitInfo("Method"), getChangeTakeProfitInfo("Request"), false) != CURLE_OK) {
-		m_pPluginProxy->onMessage(MSG_ERROR, "Can't init [changeLimit] curl.");
-		return RET_FAILED;
-	}
+	return changeOrders(tblTrades, true);
+}
 
-	vector<ReqParam> params;
-	params.push_back(ReqParam{"$limit", std::to_string(tblTrade->Limit)});
-	params.push_back(ReqParam{"$trade_id", tblTrade->TradeID});
-	m_curlTradeImpl.setEasyPerform(&params);
+int COrder2Rest::changeTakeProfits(TblTrade* tblTrades[])
+{
+	return changeOrders(tblTrades, false);
+}
 
-	CURLcode ret = m_curlTradeImpl.doEasyPerform();
-	if (ret != CURLE_OK) {
-		m_pPluginProxy->onMessage(MSG_ERROR, curl_easy_strerror(ret));
-		return RET_FAILED;
+int COrder2Rest::closeTrades(TblTrade* tblTrades[])
+{
+	vector<CCurlImpl*> curlList;
+	for (int i = 0; tblTrades[i]; i++) {
+		curlList.push_back(newCloseTradeCurl(tblTrades[i]));
 	}
+	vector<CURLcode> results;
+	doMultiPerform(curlList, results);
 
-	picojson::value json;
-	picojson::object& obj = parseJsonObject(&m_curlTradeImpl, json);
-	if (obj.empty()) {
-		return RET_FAILED;
+	int count = 0;
+	for (size_t i = 0; i < curlList.size(); i++) {
+		if (curlList[i] && results[i] == CURLE_OK && onCloseTrade(curlList[i], tblTrades[i]) == RET_SUCCESS) {
+			count++;
+		}
+		delete curlList[i];
 	}
+	return count;
+}
 
-	TblOrder* resOrder = newTblOrder(obj, &m_curlTradeImpl);
-	if (strlen(resOrder->Symbol) == 0) {
-		strcpy(resOrder->Symbol, tblTrade->Symbol);
-	}
-	m_pPluginProxy->onOrder(TableStatus::ST_NEW, resOrder);
-	strcpy(tblTrade->LimitOrderID, resOrder->OrderID);
-	delete resOrder;
+int COrder2Rest::setTrailingStop(TblTrade* tblTrade, double distance, double step)
+{
+	return m_pTrailingStop->add(tblTrade, distance, step);
+}
 
-	return RET_SUCCESS;
+int COrder2Rest::removeTrailingStop(TblTrade* tblTrade)
+{
+	return m_pTrailingStop->remove(tblTrade->TradeID);
 }
 
-int COrder2Rest::closeTrade(TblTrade* tblTrade)
+// Subscriptions are counted per symbol, a symbol is polled while any caller holds one.
+int COrder2Rest::subscribe(const char* symbols[])
 {
-	vector<const char*> headers;
-	getHeaders(headers);
-
-	CCurlImpl m_curlTradeImpl(getBaseInfo("Host"), getSslVerify());
-	m_curlTradeImpl.addHeaders(headers);
-	m_mapPathParams["$trade_id"] = tblTrade->TradeID;
-	m_curlTradeImpl.setPath(getCloseTradeInfo("Path"), m_mapPathParams);
-	m_curlTradeImpl.parseResFileds(getCloseTradeInfo("Response"));
-	if (m_curlTradeImpl.init(
-		getCloseTradeInfo("Method"), getCloseTradeInfo("Request"), false) != CURLE_OK) {
-		m_pPluginProxy->onMessage(MSG_ERROR, "Can't init [CloseTrade] curl.");
-		return RET_FAILED;
+	bool changed = false;
+	for (int i = 0; symbols[i]; i++) {
+		int id = m_Symbols.intern(symbols[i]);
+		if (id != SYMBOL_INVALID) {
+			changed |= addSubscription(id);
+		}
 	}
-
-	vector<ReqParam> params;
-	params.push_back(ReqParam{"$amount", std::to_string((long)tblTrade->Amount)});
-	m_curlTradeImpl.setEasyPerform(&params);
-
-	CURLcode ret = m_curlTradeImpl.doEasyPerform();
-	if (ret != CURLE_OK) {
-		m_pPluginProxy->onMessage(MSG_ERROR, curl_easy_strerror(ret));
-		return RET_FAILED;
+	if (changed) {
+		updatePriceRequest();
 	}
+	return RET_SUCCESS;
+}
 
-	picojson::value json;
-	picojson::object& obj = parseJsonObject(&m_curlTradeImpl, json);
-	if (obj.empty()) {
-		return RET_FAILED;
+int COrder2Rest::unsubscribe(const char* symbols[])
+{
+	bool changed = false;
+	{
+		CCriticalSection::Lock l(m_csSubscribe);
+		for (int i = 0; symbols[i]; i++) {
+			int id = m_Symbols.find(symbols[i]);
+			if (id == SYMBOL_INVALID || id >= (int)m_vtSubscribeRefs.size()) {
+				continue;
+			}
+			if (m_vtSubscribeRefs[id] > 0 && --m_vtSubscribeRefs[id] == 0) {
+				m_QuoteCache.clear(id);
+				changed = true;
+			}
+		}
+	}
+	if (changed) {
+		updatePriceRequest();
 	}
-
-	TblOrder* resOrder = newTblOrder(obj, &m_curlTradeImpl);
-	strcpy(resOrder->TradeID, tblTrade->TradeID);
-	m_pPluginProxy->onOrder(TableStatus::ST_NEW, resOrder);
-	delete resOrder;
-
-	TblTrade* closedTrade = newTblTrade(obj, &m_curlTradeImpl);
-	strcpy(closedTrade->TradeID, tblTrade->TradeID);
-	closedTrade->Open = tblTrade->Open;
-	closedTrade->Stop = tblTrade->Stop;
-	closedTrade->Limit = tblTrade->Limit;
-	closedTrade->High = tblTrade->High;
-	closedTrade->Low = tblTrade->Low;
-	closedTrade->OpenTime = tblTrade->OpenTime;
-	strcpy(closedTrade->OpenOrderID, tblTrade->OpenOrderID);
-	strcpy(closedTrade->StopOrderID, tblTrade->StopOrderID);
-	strcpy(closedTrade->LimitOrderID, tblTrade->LimitOrderID);
-	m_pPluginProxy->onOpenedTrade(TableStatus::ST_DEL, closedTrade);
-	m_pPluginProxy->onClosedTrade(TableStatus::ST_NEW, closedTrade);
-	delete closedTrade;
-
 	return RET_SUCCESS;
 }
 
 int COrder2Rest::initCurl()
 {
-	bool sslVerify = getSslVerify();
-	vector<const char*> headers;
-	getHeaders(headers);
+	const RestSettings* settings = m_Config.get();
+	bool sslVerify = settings->SslVerify;
+	long connectTimeout = settings->ConnectTimeout;
+	long timeout = settings->Timeout;
+	const vector<const char*>& headers = settings->Headers;
 
 	// ==== GetPrice Curl init ====
-	m_CurlList[CURL_GET_PRICE] = new CCurlImpl(getBaseInfo("Host"), sslVerify);
+	m_CurlList[CURL_GET_PRICE] = new CCurlImpl(settings->Host.c_str(), sslVerify);
+	m_CurlList[CURL_GET_PRICE]->setTimeout(connectTimeout, timeout);
 	m_CurlList[CURL_GET_PRICE]->addHeaders(headers);
 	m_CurlList[CURL_GET_PRICE]->setPath(getPriceInfo("Path"), m_mapPathParams);
 	m_CurlList[CURL_GET_PRICE]->parseResFileds(getPriceInfo("Response"));
@@ -641,9 +627,11 @@ int COrder2Rest::initCurl()
 		return RET_FAILED;
 	}
 	m_CurlList[CURL_GET_PRICE]->setEasyPerform();
+	m_CurlList[CURL_GET_PRICE]->setLatencyStats(&m_LatencyStats, "GetPrice");
 
 	// ==== GetAccount Curl init ====
-	m_CurlList[CURL_GET_ACCOUNT] = new CCurlImpl(getBaseInfo("Host"), sslVerify);
+	m_CurlList[CURL_GET_ACCOUNT] = new CCurlImpl(settings->Host.c_str(), sslVerify);
+	m_CurlList[CURL_GET_ACCOUNT]->setTimeout(connectTimeout, timeout);
 	m_CurlList[CURL_GET_ACCOUNT]->addHeaders(headers);
 	m_CurlList[CURL_GET_ACCOUNT]->setPath(getAccountInfo("Path"), m_mapPathParams);
 	m_CurlList[CURL_GET_ACCOUNT]->parseResFileds(getAccountInfo("Response"));
@@ -656,9 +644,11 @@ int COrder2Rest::initCurl()
 		return RET_FAILED;
 	}
 	m_CurlList[CURL_GET_ACCOUNT]->setEasyPerform();
+	m_CurlList[CURL_GET_ACCOUNT]->setLatencyStats(&m_LatencyStats, "GetAccount");
 
 	// ==== GetOpenedTrades Curl init ====
-	m_CurlList[CURL_GET_OPENTRADES] = new CCurlImpl(getBaseInfo("Host"), sslVerify);
+	m_CurlList[CURL_GET_OPENTRADES] = new CCurlImpl(settings->Host.c_str(), sslVerify);
+	m_CurlList[CURL_GET_OPENTRADES]->setTimeout(connectTimeout, timeout);
 	m_CurlList[CURL_GET_OPENTRADES]->addHeaders(headers);
 	m_CurlList[CURL_GET_OPENTRADES]->setPath(GetOpenedTradesInfo("Path"), m_mapPathParams);
 	m_CurlList[CURL_GET_OPENTRADES]->parseResFileds(GetOpenedTradesInfo("Response"));
@@ -671,9 +661,11 @@ int COrder2Rest::initCurl()
 		return RET_FAILED;
 	}
 	m_CurlList[CURL_GET_OPENTRADES]->setEasyPerform();
+	m_CurlList[CURL_GET_OPENTRADES]->setLatencyStats(&m_LatencyStats, "GetOpenedTrades");
 
 	// ==== GetClosedTrades Curl init ====
-	m_CurlList[CURL_GET_CLOSEDTRADES] = new CCurlImpl(getBaseInfo("Host"), sslVerify);
+	m_CurlList[CURL_GET_CLOSEDTRADES] = new CCurlImpl(settings->Host.c_str(), sslVerify);
+	m_CurlList[CURL_GET_CLOSEDTRADES]->setTimeout(connectTimeout, timeout);
 	m_CurlList[CURL_GET_CLOSEDTRADES]->addHeaders(headers);
 	m_CurlList[CURL_GET_CLOSEDTRADES]->setPath(GetClosedTradesInfo("Path"), m_mapPathParams);
 	m_CurlList[CURL_GET_CLOSEDTRADES]->parseResFileds(GetClosedTradesInfo("Response"));
@@ -686,24 +678,40 @@ int COrder2Rest::initCurl()
 		return RET_FAILED;
 	}
 	m_CurlList[CURL_GET_CLOSEDTRADES]->setEasyPerform();
+	m_CurlList[CURL_GET_CLOSEDTRADES]->setLatencyStats(&m_LatencyStats, "GetClosedTrades");
 
 	// ==== GetHistoricalData Curl init ====
-	m_CurlList[CURL_GET_CANDLES] = new CCurlImpl(getBaseInfo("Host"), sslVerify);
-	m_CurlList[CURL_GET_CANDLES]->addHeaders(headers);
-	m_CurlList[CURL_GET_CANDLES]->parseResFileds(GetHistoricalDataInfo("Response"));
-	if (m_CurlList[CURL_GET_CANDLES]->init(
-		GetHistoricalDataInfo("Method"), GetHistoricalDataInfo("Request"), false) == CURLE_OK) {
-		m_pPluginProxy->onMessage(MSG_DEBUG, "[GetHistoricalData] curl_easy_init succeeded.");
-	}
-	else {
-		m_pPluginProxy->onMessage(MSG_ERROR, "Can't init [GetHistoricalData] curl.");
+	CCurlImpl* candleCurl = newCandleCurl();
+	if (!candleCurl) {
 		return RET_FAILED;
 	}
-	m_CurlList[CURL_GET_CANDLES]->setEasyPerform();
+	m_pPluginProxy->onMessage(MSG_DEBUG, "[GetHistoricalData] curl_easy_init succeeded.");
+	releaseCandleCurl(candleCurl);
 
 	return RET_SUCCESS;
 }
 
+void COrder2Rest::initPositionBook()
+{
+	m_pPositionBook = new CPositionBook(atof(getPositionInfo("PLThreshold", "1")),
+		atof(getPositionInfo("EquityThreshold", "1")), atof(getPositionInfo("PipCostAmount", "1")));
+
+	CSimpleIniCaseA::TNamesDepend keys;
+	m_Config.get()->Ini.GetAllKeys("PointSize", keys);
+	for (CSimpleIniCaseA::TNamesDepend::iterator it = keys.begin(); it != keys.end(); it++) {
+		m_pPositionBook->setPointSize(it->pItem, atof(getPointSizeInfo(it->pItem)));
+	}
+}
+
+// UTC (Sunday 19:00 - Friday 21:00) by default.
+void COrder2Rest::initMarketCalendar()
+{
+	m_MarketCalendar.setWeek(atoi(getMarketInfo("OpenWday", "0")), atoi(getMarketInfo("OpenHour", "19")),
+		atoi(getMarketInfo("CloseWday", "5")), atoi(getMarketInfo("CloseHour", "21")));
+	m_MarketCalendar.addHolidays(getMarketInfo("Holidays"));
+	m_MarketCalendar.addEarlyCloses(getMarketInfo("EarlyCloses"));
+}
+
 int COrder2Rest::startTradeEventThread()
 {
 	return m_pTradeEventsProcessThread->_start();
@@ -727,18 +735,187 @@ void COrder2Rest::waitNextEvent()
 		}
 		else if (dwRes == WAIT_TIMEOUT) {
 			onTableListener();
+			checkConfig();
+			reportStats();
 		}
 	}
 }
 
-void COrder2Rest::onTableListener()
+// The file is checked every ReloadInterval. With SignalReload, SIGHUP forces the
+// next check to reload.
+void COrder2Rest::checkConfig()
 {
-	if (m_pCurlMulti) {
-
-		for (int i = 0; i < sizeof(m_CurlList) / sizeof(m_CurlList[0]); i++) {
-			if (m_CurlList[i]->getResListener() && m_CurlList[i]->chkRefresh()) {
-				m_CurlList[i]->clear();
-				curl_multi_add_handle(m_pCurlMulti, m_CurlList[i]->getCurlHandle());
+	long reloadInterval = m_Config.get()->ReloadInterval;
+	if (reloadInterval <= 0) {
+		return;
+	}
+	int64_t nowNs = CUtils::getMonotonicNs();
+	if (nowNs < m_nNextReloadNs) {
+		return;
+	}
+	m_nNextReloadNs = nowNs + (int64_t)reloadInterval * 1000000;
+	if (m_Config.changed()) {
+		reloadConfig();
+	}
+}
+
+// Connections stay open. Headers and timeouts apply to handles created
+// after the reload, paths and request templates of the polled handles at login.
+void COrder2Rest::reloadConfig()
+{
+	string error;
+	if (m_Config.reload(error) != RET_SUCCESS) {
+		error += ", the previous settings are kept.";
+		m_pPluginProxy->onMessage(MSG_ERROR, error.c_str());
+		return;
+	}
+
+	const RestSettings* settings = m_Config.get();
+	m_Symbols.setCombination(settings->Combination.c_str());
+	m_Symbols.addSymbols(settings->Symbols.c_str());
+	updatePriceRequest();
+
+	long refresh[CURL_POLL_COUNT];
+	refresh[CURL_GET_PRICE] = settings->PriceRefresh;
+	refresh[CURL_GET_ACCOUNT] = settings->AccountRefresh;
+	refresh[CURL_GET_OPENTRADES] = settings->OpenedTradesRefresh;
+	refresh[CURL_GET_CLOSEDTRADES] = settings->ClosedTradesRefresh;
+	for (int i = 0; i < CURL_POLL_COUNT; i++) {
+		if (m_CurlList[i]->getRefreshInterval() > 0) {
+			m_CurlList[i]->setRefreshInterval(refresh[i]);
+		}
+	}
+	m_pPluginProxy->onMessage(MSG_INFO, "Config reloaded.");
+}
+
+// Cumulative since init, one MSG_INFO line per endpoint every StatsInterval.
+void COrder2Rest::reportStats()
+{
+	long statsInterval = m_Config.get()->StatsInterval;
+	if (statsInterval <= 0) {
+		return;
+	}
+	int64_t nowNs = CUtils::getMonotonicNs();
+	if (m_nNextStatsNs == 0) {
+		m_nNextStatsNs = nowNs + (int64_t)statsInterval * 1000000;
+	}
+	if (nowNs < m_nNextStatsNs) {
+		return;
+	}
+	m_nNextStatsNs = nowNs + (int64_t)statsInterval * 1000000;
+	string s = m_LatencyStats.toString();
+	if (!s.empty()) {
+		m_pPluginProxy->onMessage(MSG_INFO, s.c_str());
+	}
+}
+
+void COrder2Rest::getLatencyStats(vector<LatencySnapshot>& snapshots)
+{
+	m_LatencyStats.snapshot(snapshots);
+}
+
+// Returns true when the symbol was not polled before.
+bool COrder2Rest::addSubscription(int id)
+{
+	CCriticalSection::Lock l(m_csSubscribe);
+	if (id >= (int)m_vtSubscribeRefs.size()) {
+		m_vtSubscribeRefs.resize(id + 1, 0);
+	}
+	return m_vtSubscribeRefs[id]++ == 0;
+}
+
+bool COrder2Rest::isPolled(int id)
+{
+	CCriticalSection::Lock l(m_csSubscribe);
+	return id != SYMBOL_INVALID && id < (int)m_vtSubscribeRefs.size() && m_vtSubscribeRefs[id] > 0;
+}
+
+// Swaps the symbols of the price handle under its lock, so a poll round sees
+// either the old or the new set. An empty set stops the polling.
+void COrder2Rest::updatePriceRequest()
+{
+	CCriticalSection::Lock l(m_csCurlList[CURL_GET_PRICE]);
+	const RestSettings* settings = m_Config.get();
+	string symbols;
+	{
+		CCriticalSection::Lock ls(m_csSubscribe);
+		for (size_t i = 0; i < m_vtSubscribeRefs.size(); i++) {
+			if (m_vtSubscribeRefs[i] > 0) {
+				if (!symbols.empty()) {
+					symbols.append(settings->Delimiter);
+				}
+				symbols.append(m_Symbols.brokerSymbol((int)i));
+			}
+		}
+	}
+	if (symbols == m_sPolledSymbols) {
+		return;
+	}
+	m_sPolledSymbols = symbols;
+
+	CCurlImpl* curlObj = m_CurlList[CURL_GET_PRICE];
+	vector<ReqParam> params;
+	params.push_back(ReqParam{"$symbols", m_sPolledSymbols});
+	curlObj->setEasyPerform(&params);
+	curlObj->setRefreshInterval(m_sPolledSymbols.empty() ? 0 : settings->PriceRefresh);
+}
+
+// One request for symbols without a cached quote, the polled set is restored after it.
+// Only subscribed symbols are cached, a one-off quote would go stale unpolled.
+int COrder2Rest::fetchPrices(vector<int>& ids, vector<TblPrice*>& tblPriceList)
+{
+	CCriticalSection::Lock l(m_csCurlList[CURL_GET_PRICE]);
+	CCurlImpl* curlObj = m_CurlList[CURL_GET_PRICE];
+
+	const string& delimiter = m_Config.get()->Delimiter;
+	string symbols;
+	for (size_t i = 0; i < ids.size(); i++) {
+		if (i > 0) {
+			symbols.append(delimiter);
+		}
+		symbols.append(m_Symbols.brokerSymbol(ids[i]));
+	}
+	vector<ReqParam> params;
+	params.push_back(ReqParam{"$symbols", symbols});
+	curlObj->setEasyPerform(&params);
+
+	int ret = RET_SUCCESS;
+	CURLcode code = curlObj->doEasyPerform();
+	if (code != CURLE_OK) {
+		m_pPluginProxy->onMessage(MSG_ERROR, curl_easy_strerror(code));
+		ret = RET_FAILED;
+	}
+	else {
+		picojson::value json;
+		picojson::array& list = parseJsonArray(curlObj, json);
+		for (picojson::array::iterator it = list.begin(); it != list.end(); it++) {
+			picojson::object& o = it->get<picojson::object>();
+			TblPrice* tblPrice = newTblPrice(o, curlObj);
+			int id = m_Symbols.find(tblPrice->Symbol);
+			if (isPolled(id)) {
+				m_QuoteCache.update(id, tblPrice);
+			}
+			tblPriceList.push_back(tblPrice);
+		}
+		sampleServerTime(curlObj);
+	}
+
+	params[0].value = m_sPolledSymbols;
+	curlObj->setEasyPerform(&params);
+	return ret;
+}
+
+// A polled handle busy in a get call is skipped until the next round.
+void COrder2Rest::onTableListener()
+{
+	if (m_pCurlMulti) {
+
+		vector<int> lockedList;
+		for (int i = 0; i < sizeof(m_CurlList) / sizeof(m_CurlList[0]); i++) {
+			if (m_CurlList[i]->getResListener() && m_CurlList[i]->chkRefresh() && m_csCurlList[i].tryLock()) {
+				lockedList.push_back(i);
+				m_CurlList[i]->clear();
+				curl_multi_add_handle(m_pCurlMulti, m_CurlList[i]->getCurlHandle());
 			}
 		}
 
@@ -798,6 +975,9 @@ void COrder2Rest::onTableListener()
 			if(msg->msg == CURLMSG_DONE) {
 				for (int i = 0; i < sizeof(m_CurlList) / sizeof(m_CurlList[0]); i++) {
 					if (msg->easy_handle == m_CurlList[i]->getCurlHandle()) {
+						if (msg->data.result == CURLE_OK) {
+							m_CurlList[i]->recordTiming();
+						}
 						m_CurlList[i]->onResListener(this);
 						curl_multi_remove_handle(m_pCurlMulti, msg->easy_handle);
 						break;
@@ -806,13 +986,18 @@ void COrder2Rest::onTableListener()
 			}
 		}
 
+		for (size_t i = 0; i < lockedList.size(); i++) {
+			curl_multi_remove_handle(m_pCurlMulti, m_CurlList[lockedList[i]]->getCurlHandle());
+			m_csCurlList[lockedList[i]].unlock();
+		}
 	}
 	else {
 		for (int i = 0; i < sizeof(m_CurlList) / sizeof(m_CurlList[0]); i++) {
-			if (m_CurlList[i]->getResListener() && m_CurlList[i]->chkRefresh()) {
+			if (m_CurlList[i]->getResListener() && m_CurlList[i]->chkRefresh() && m_csCurlList[i].tryLock()) {
 				if (m_CurlList[i]->doEasyPerform() == CURLE_OK) {
 					m_CurlList[i]->onResListener(this);
 				}
+				m_csCurlList[i].unlock();
 			}
 		}
 	}
@@ -829,262 +1014,785 @@ void COrder2Rest::onGetPrice(void* curlobj, void* listener)
 		return;
 	}
 
+	int64_t recvTimeNs = curlObj->getRecvNs();
 	for (picojson::array::iterator it = list.begin(); it != list.end(); it++) {
 		picojson::object& o = it->get<picojson::object>();
 		TblPrice* tblPrice = order2Rest->newTblPrice(o, curlObj);
+		order2Rest->m_QuoteCache.update(order2Rest->m_Symbols.find(tblPrice->Symbol), tblPrice);
 		order2Rest->m_pPluginProxy->onPrice(TableStatus::ST_UPD, tblPrice);
+		if (order2Rest->m_pTickJournal) {
+			order2Rest->m_pTickJournal->append(tblPrice, recvTimeNs);
+		}
+		order2Rest->m_pTrailingStop->onPrice(tblPrice);
+		if (order2Rest->m_pPositionBook) {
+			vector<TblTrade> tblTradeList;
+			TblAccount tblAccount;
+			bool accountChanged = order2Rest->m_pPositionBook->onPrice(tblPrice, tblTradeList, &tblAccount);
+			for (vector<TblTrade>::iterator tit = tblTradeList.begin(); tit != tblTradeList.end(); tit++) {
+				order2Rest->m_pPluginProxy->onOpenedTrade(TableStatus::ST_UPD, &(*tit));
+			}
+			if (accountChanged) {
+				order2Rest->m_pPluginProxy->onAccount(TableStatus::ST_UPD, &tblAccount);
+			}
+		}
 		delete tblPrice;
 	}
 
-	order2Rest->m_tmStdTime.store(order2Rest->reqServerTime());
+	order2Rest->sampleServerTime(curlObj);
+}
+
+void COrder2Rest::onGetAccount(void* curlobj, void* listener)
+{
+	CCurlImpl* curlObj = (CCurlImpl*)curlobj;
+	COrder2Rest* order2Rest = (COrder2Rest*)listener;
+
+	picojson::value json;
+	picojson::object& obj = order2Rest->parseJson(curlObj, json);
+	if (obj.empty()) {
+		return;
+	}
+
+	TblAccount *tblAccount = order2Rest->newTblAccount(obj, curlObj);
+	if (order2Rest->m_Config.get()->AccountID == tblAccount->AccountID) {
+		if (order2Rest->m_pPositionBook) {
+			order2Rest->m_pPositionBook->setAccount(tblAccount);
+		}
+		order2Rest->m_pPluginProxy->onAccount(TableStatus::ST_UPD, tblAccount);
+	}
+	delete tblAccount;
+}
+
+void COrder2Rest::onGetOpenTrades(void* curlobj, void* listener)
+{
+	CCurlImpl* curlObj = (CCurlImpl*)curlobj;
+	COrder2Rest* order2Rest = (COrder2Rest*)listener;
+	
+	picojson::value json;
+	picojson::array& list = order2Rest->parseJsonArray(curlObj, json);
+	vector<TblTrade*> tblTradeList;
+	if (list.empty()) {
+		if (order2Rest->m_pPositionBook && json.contains(curlObj->getResField(CCurlImpl::ResTargetName))) {
+			order2Rest->m_pPositionBook->setTrades(tblTradeList);
+		}
+		return;
+	}
+
+	for (picojson::array::iterator it = list.begin(); it != list.end(); it++) {
+		picojson::object& o = it->get<picojson::object>();
+		tblTradeList.push_back(order2Rest->newTblTrade(o, curlObj));
+	}
+	if (order2Rest->m_pPositionBook) {
+		order2Rest->m_pPositionBook->setTrades(tblTradeList);
+	}
+	for (vector<TblTrade*>::iterator it = tblTradeList.begin(); it != tblTradeList.end(); it++) {
+		order2Rest->m_pPluginProxy->onOpenedTrade(TableStatus::ST_UPD, *it);
+		delete *it;
+	}
+}
+	
+void COrder2Rest::onGetClosedTrades(void* curlobj, void* listener)
+{
+	CCurlImpl* curlObj = (CCurlImpl*)curlobj;
+	COrder2Rest* order2Rest = (COrder2Rest*)listener;
+
+	picojson::value json;
+	picojson::array& list = order2Rest->parseJsonArray(curlObj, json);
+	if (list.empty()) {
+		return;
+	}
+
+	time_t weekFirstDay = CUtils::getWeekFirstDate();
+	for (picojson::array::iterator it = list.begin(); it != list.end(); it++) {
+		picojson::object& o = it->get<picojson::object>();
+		TblTrade* tblTrade = order2Rest->newTblTrade(o, curlObj);
+		if (tblTrade->CloseTime > weekFirstDay) {
+			order2Rest->m_pPluginProxy->onClosedTrade(TableStatus::ST_UPD, tblTrade);
+		}
+		delete tblTrade;
+	}
+}
+
+int COrder2Rest::onJsonError(picojson::object& o)
+{
+	string message;
+	if (COrder2Rest::json2Str(o, m_Config.get()->ErrorMessage.c_str(), message)) {
+		message = "[onJsonError] " + message;
+		m_pPluginProxy->onMessage(MSG_ERROR, message.c_str());
+		return RET_FAILED;
+	}
+	return RET_SUCCESS;
+}
+
+picojson::object& COrder2Rest::parseJson(CCurlImpl* curlImpl, picojson::value& json)
+{
+	static picojson::object nullopt;
+
+	if (curlImpl->getResSize() == 0) {
+		return nullopt;
+	}
+
+	string err;
+	int64_t parseNs = CUtils::getMonotonicNs();
+	picojson::parse(json, curlImpl->getResContents(),
+		curlImpl->getResContents() + curlImpl->getResSize(), &err);
+	m_LatencyStats.record(curlImpl->getEndpoint(), LAT_PARSE, (CUtils::getMonotonicNs() - parseNs) / 1000);
+	if (!err.empty() || json.is<picojson::null>()) {
+		err = err + "\n" + curlImpl->getResContents();
+		m_pPluginProxy->onMessage(MSG_ERROR, err.c_str());
+		return nullopt;
+	}
+
+	picojson::object& obj = json.get<picojson::object>();
+	if (onJsonError(obj) == RET_FAILED) {
+		m_pPluginProxy->onMessage(MSG_ERROR, curlImpl->toString().c_str());
+		return nullopt;
+	}
+
+	return obj;
+}
+
+picojson::object& COrder2Rest::parseJsonObject(CCurlImpl* curlImpl, picojson::value& json)
+{
+	static picojson::object nullopt;
+
+	picojson::object& obj = parseJson(curlImpl, json);
+	if (obj.empty()) {
+		return nullopt;
+	}
+	string resTargetName = curlImpl->getResField(CCurlImpl::ResTargetName);
+	if (resTargetName.empty()) {
+		return obj;
+	}
+	map<string, picojson::value>::iterator mpos = obj.find(resTargetName);
+	if (mpos == obj.end()) {
+		string s = "Can't find object " + resTargetName;
+		m_pPluginProxy->onMessage(MSG_ERROR, s.c_str());
+		return nullopt;
+	}
+	return mpos->second.get<picojson::object>();
+}
+
+picojson::array& COrder2Rest::parseJsonArray(CCurlImpl* curlImpl, picojson::value& json)
+{
+	static picojson::array nullopt;
+
+	picojson::object& obj = parseJson(curlImpl, json);
+	if (obj.empty()) {
+		return nullopt;
+	}
+	
+	string resTargetName = curlImpl->getResField(CCurlImpl::ResTargetName);
+	map<string, picojson::value>::iterator mpos = obj.find(resTargetName);
+	if (mpos == obj.end()) {
+		string s = "Can't find array " + resTargetName;
+		m_pPluginProxy->onMessage(MSG_ERROR, s.c_str());
+		return nullopt;
+	}
+	if (!mpos->second.is<picojson::array>()) {
+		string s = resTargetName + " is not array.";
+		m_pPluginProxy->onMessage(MSG_ERROR, s.c_str());
+		return nullopt;
+	}
+	return mpos->second.get<picojson::array>();
+}
+
+// The Date header of a price response is one sample of the server clock.
+void COrder2Rest::sampleServerTime(CCurlImpl* curlImpl)
+{
+	long resCode;
+	CURLcode res = curl_easy_getinfo(curlImpl->getCurlHandle(), CURLINFO_RESPONSE_CODE, &resCode);
+	if (res != CURLE_OK || resCode != 200) {
+		return;
+	}
+	time_t serverTime = CUtils::HStr2Time(curlImpl->getResHeader());
+	int64_t recvNs = curlImpl->getRecvMonoNs();
+	int64_t rttNs = curlImpl->getRequestRttNs();
+	if (serverTime > 0 && recvNs > 0 && rttNs >= 0) {
+		m_ServerClock.addSample(recvNs - rttNs, recvNs, (int64_t)serverTime * 1000000000, 1000000000);
+	}
+}
+
+int COrder2Rest::getHistoricalData(const char* symbol, const char* period, time_t start, time_t end, int adjustmentTimezone, vector<TblCandle*>& tblCandleList)
+{
+	CCurlImpl* curlObj = acquireCandleCurl();
+	if (!curlObj) {
+		return RET_FAILED;
+	}
+
+	map<string, string> pathParams(m_mapPathParams);
+	pathParams["$symbol"] = transfSymbol(symbol);
+	curlObj->setPath(GetHistoricalDataInfo("Path"), pathParams);
+
+	vector<ReqParam> params;
+	params.push_back(ReqParam{"$symbol", transfSymbol(symbol)});
+	params.push_back(ReqParam{"$period", transfPeriod(period)});
+	params.push_back(ReqParam{"$start", transfTime(start + adjustmentTimezone) });
+	params.push_back(ReqParam{"$end", transfTime(end + adjustmentTimezone) });
+	curlObj->setEasyPerform(&params);
+
+	CURLcode ret = curlObj->doEasyPerform();
+	if (ret != CURLE_OK) {
+		m_pPluginProxy->onMessage(MSG_ERROR, curl_easy_strerror(ret));
+		releaseCandleCurl(curlObj);
+		return RET_FAILED;
+	}
+
+	picojson::value json;
+	picojson::array& list = parseJsonArray(curlObj, json);
+	for (picojson::array::iterator it = list.begin(); it != list.end(); it++) {
+		picojson::object& o = it->get<picojson::object>();
+		TblCandle* tblCandle = COrder2Rest::newTblCandle(o, curlObj);
+		strcpy(tblCandle->Symbol, symbol);
+		strcpy(tblCandle->Period, period);
+		tblCandleList.push_back(tblCandle);
+	}
+	releaseCandleCurl(curlObj);
+	if (tblCandleList.empty()) {
+		return 0;
+	}
+
+	char buf[256];
+	tm tmStart = CUtils::getUTCCal(start);
+	tm tmEnd = CUtils::getUTCCal(end);
+	tm tmOutStart = CUtils::getUTCCal(tblCandleList.front()->StartDate);
+	tm tmOutEnd = CUtils::getUTCCal(tblCandleList.back()->StartDate);
+	sprintf(buf, "[GetHistoricalData] Count:%d StartDate:%s EndDate:%s OutStartDate:%s OutEndDate:%s",
+		tblCandleList.size(),
+		CUtils::strOfTime(&tmStart, TimeFormat).c_str(),
+		CUtils::strOfTime(&tmEnd, TimeFormat).c_str(),
+		CUtils::strOfTime(&tmOutStart, TimeFormat).c_str(),
+		CUtils::strOfTime(&tmOutEnd, TimeFormat).c_str());
+	m_pPluginProxy->onMessage(MSG_DEBUG, buf);
+
+	return tblCandleList.size();
+}
+
+CCurlImpl* COrder2Rest::newCandleCurl()
+{
+	const RestSettings* settings = m_Config.get();
+	CCurlImpl* curlImpl = new CCurlImpl(settings->Host.c_str(), settings->SslVerify);
+	curlImpl->setTimeout(settings->ConnectTimeout, settings->Timeout);
+	curlImpl->addHeaders(settings->Headers);
+	curlImpl->parseResFileds(settings->Ini.GetValue("GetHistoricalData", "Response", CCurlImpl::Blank));
+	if (curlImpl->init(settings->Ini.GetValue("GetHistoricalData", "Method", CCurlImpl::Blank),
+		settings->Ini.GetValue("GetHistoricalData", "Request", CCurlImpl::Blank), false) != CURLE_OK) {
+		m_pPluginProxy->onMessage(MSG_ERROR, "Can't init [GetHistoricalData] curl.");
+		delete curlImpl;
+		return NULL;
+	}
+	curlImpl->setEasyPerform();
+	curlImpl->setLatencyStats(&m_LatencyStats, "GetHistoricalData");
+	return curlImpl;
+}
+
+// Candle handles are pooled, so concurrent getHistoricalData calls each get a
+// handle of their own and still reuse the connections of earlier calls.
+CCurlImpl* COrder2Rest::acquireCandleCurl()
+{
+	{
+		CCriticalSection::Lock l(m_csCandleCurls);
+		if (!m_vtCandleCurls.empty()) {
+			CCurlImpl* curlImpl = m_vtCandleCurls.back();
+			m_vtCandleCurls.pop_back();
+			return curlImpl;
+		}
+	}
+	return newCandleCurl();
+}
+
+void COrder2Rest::releaseCandleCurl(CCurlImpl* curlImpl)
+{
+	CCriticalSection::Lock l(m_csCandleCurls);
+	m_vtCandleCurls.push_back(curlImpl);
+}
+
+CCurlImpl* COrder2Rest::newTradeCurl(const char* section, map<string, string>& pathParams)
+{
+	const RestSettings* settings = m_Config.get();
+	CCurlImpl* curlImpl = new CCurlImpl(settings->Host.c_str(), settings->SslVerify);
+	curlImpl->setTimeout(settings->ConnectTimeout, settings->OrderTimeout);
+	curlImpl->addHeaders(settings->Headers);
+	curlImpl->setPath(settings->Ini.GetValue(section, "Path", CCurlImpl::Blank), pathParams);
+	curlImpl->parseResFileds(settings->Ini.GetValue(section, "Response", CCurlImpl::Blank));
+	if (curlImpl->init(
+		settings->Ini.GetValue(section, "Method", CCurlImpl::Blank), settings->Ini.GetValue(section, "Request", CCurlImpl::Blank), false) != CURLE_OK) {
+		string s = string("Can't init [") + section + "] curl.";
+		m_pPluginProxy->onMessage(MSG_ERROR, s.c_str());
+		delete curlImpl;
+		return NULL;
+	}
+	curlImpl->setLatencyStats(&m_LatencyStats, section);
+	return curlImpl;
+}
+
+CCurlImpl* COrder2Rest::newOpenMarketOrderCurl(TblOrder* tblOrder)
+{
+	map<string, string> pathParams(m_mapPathParams);
+	CCurlImpl* curlImpl = newTradeCurl("OpenMarketOrder", pathParams);
+	if (!curlImpl) {
+		return NULL;
+	}
+
+	vector<ReqParam> params;
+	params.push_back(ReqParam{"$symbol", transfSymbol(tblOrder->Symbol)});
+	string side = getSideInfo(tblOrder->BS);
+	if (side.length() > 0) {
+		params.push_back(ReqParam{"$amount", std::to_string((long)tblOrder->Amount)});
+		params.push_back(ReqParam{"$bs", side});
+	}
+	else {
+		if (strcmp(tblOrder->BS, "B") == 0) {
+			params.push_back(ReqParam{"$amount", std::to_string(tblOrder->Amount)});
+		}
+		else {
+			params.push_back(ReqParam{"$amount", std::to_string(tblOrder->Amount * -1)});
+		}
+	}
+	curlImpl->setEasyPerform(&params);
+	return curlImpl;
+}
+
+CCurlImpl* COrder2Rest::newStopLossOrderCurl(TblOrder* tblOrder)
+{
+	map<string, string> pathParams(m_mapPathParams);
+	CCurlImpl* curlImpl = newTradeCurl("StopLossOrder", pathParams);
+	if (!curlImpl) {
+		return NULL;
+	}
+
+	vector<ReqParam> params;
+	params.push_back(ReqParam{"$stop", std::to_string(tblOrder->Stop)});
+	params.push_back(ReqParam{"$trade_id", tblOrder->TradeID});
+	curlImpl->setEasyPerform(&params);
+	return curlImpl;
+}
+
+CCurlImpl* COrder2Rest::newTakeProfitOrderCurl(TblOrder* tblOrder)
+{
+	map<string, string> pathParams(m_mapPathParams);
+	CCurlImpl* curlImpl = newTradeCurl("TakeProfitOrder", pathParams);
+	if (!curlImpl) {
+		return NULL;
+	}
+
+	vector<ReqParam> params;
+	params.push_back(ReqParam{"$limit", std::to_string(tblOrder->Limit)});
+	params.push_back(ReqParam{"$trade_id", tblOrder->TradeID});
+	curlImpl->setEasyPerform(&params);
+	return curlImpl;
+}
+
+CCurlImpl* COrder2Rest::newChangeStopLossCurl(TblTrade* tblTrade)
+{
+	map<string, string> pathParams(m_mapPathParams);
+	pathParams["$order_id"] = tblTrade->StopOrderID;
+	CCurlImpl* curlImpl = newTradeCurl("ChangeStopLoss", pathParams);
+	if (!curlImpl) {
+		return NULL;
+	}
+
+	vector<ReqParam> params;
+	params.push_back(ReqParam{"$stop", std::to_string(tblTrade->Stop)});
+	params.push_back(ReqParam{"$trade_id", tblTrade->TradeID});
+	curlImpl->setEasyPerform(&params);
+	return curlImpl;
+}
+
+CCurlImpl* COrder2Rest::newChangeTakeProfitCurl(TblTrade* tblTrade)
+{
+	map<string, string> pathParams(m_mapPathParams);
+	pathParams["$order_id"] = tblTrade->LimitOrderID;
+	CCurlImpl* curlImpl = newTradeCurl("ChangeTakeProfit", pathParams);
+	if (!curlImpl) {
+		return NULL;
+	}
+
+	vector<ReqParam> params;
+	params.push_back(ReqParam{"$limit", std::to_string(tblTrade->Limit)});
+	params.push_back(ReqParam{"$trade_id", tblTrade->TradeID});
+	curlImpl->setEasyPerform(&params);
+	return curlImpl;
+}
+
+CCurlImpl* COrder2Rest::newCloseTradeCurl(TblTrade* tblTrade)
+{
+	map<string, string> pathParams(m_mapPathParams);
+	pathParams["$trade_id"] = tblTrade->TradeID;
+	CCurlImpl* curlImpl = newTradeCurl("CloseTrade", pathParams);
+	if (!curlImpl) {
+		return NULL;
+	}
+
+	vector<ReqParam> params;
+	params.push_back(ReqParam{"$amount", std::to_string((long)tblTrade->Amount)});
+	curlImpl->setEasyPerform(&params);
+	return curlImpl;
+}
+
+TblOrder* COrder2Rest::onOpenMarketOrder(CCurlImpl* curlImpl, TblTrade** openedTrade)
+{
+	picojson::value json;
+	picojson::object& obj = parseJsonObject(curlImpl, json);
+	if (obj.empty()) {
+		return NULL;
+	}
+	TRACE_INSTANT("parsed", curlImpl->getEndpointName());
+
+	TblOrder* resOrder = newTblOrder(obj, curlImpl);
+	TRACE_INSTANT("onOrder", resOrder->OrderID);
+	m_pPluginProxy->onOrder(TableStatus::ST_NEW, resOrder);
+	*openedTrade = newTblTrade(obj, curlImpl);
+	return resOrder;
+}
+
+void COrder2Rest::onOpenedMarketOrder(TblOrder* tblOrder, TblOrder* resOrder, TblTrade* openedTrade)
+{
+	strcpy(openedTrade->OpenOrderID, resOrder->OrderID);
+	if (m_pPositionBook) {
+		m_pPositionBook->setTrade(openedTrade);
+	}
+	TRACE_INSTANT("onOpenedTrade", openedTrade->TradeID);
+	m_pPluginProxy->onOpenedTrade(TableStatus::ST_NEW, openedTrade);
+	delete openedTrade;
+
+	strcpy(tblOrder->OrderID, resOrder->OrderID);
+	delete resOrder;
+}
+
+int COrder2Rest::onStopLossOrder(CCurlImpl* curlImpl, TblOrder* tblOrder)
+{
+	picojson::value json;
+	picojson::object& obj = parseJsonObject(curlImpl, json);
+	if (obj.empty()) {
+		return RET_FAILED;
+	}
+
+	TblOrder* resOrder = newTblOrder(obj, curlImpl);
+	if (strlen(resOrder->Symbol) == 0) {
+		strcpy(resOrder->Symbol, tblOrder->Symbol);
+	}
+	TRACE_INSTANT("onOrder", resOrder->OrderID);
+	m_pPluginProxy->onOrder(TableStatus::ST_NEW, resOrder);
+	strcpy(tblOrder->OrderID, resOrder->OrderID);
+	tblOrder->Stop = resOrder->Stop;
+	delete resOrder;
+
+	return RET_SUCCESS;
+}
+
+int COrder2Rest::onTakeProfitOrder(CCurlImpl* curlImpl, TblOrder* tblOrder)
+{
+	picojson::value json;
+	picojson::object& obj = parseJsonObject(curlImpl, json);
+	if (obj.empty()) {
+		return RET_FAILED;
+	}
+
+	TblOrder* resOrder = newTblOrder(obj, curlImpl);
+	if (strlen(resOrder->Symbol) == 0) {
+		strcpy(resOrder->Symbol, tblOrder->Symbol);
+	}
+	TRACE_INSTANT("onOrder", resOrder->OrderID);
+	m_pPluginProxy->onOrder(TableStatus::ST_NEW, resOrder);
+	strcpy(tblOrder->OrderID, resOrder->OrderID);
+	tblOrder->Limit = resOrder->Limit;
+	delete resOrder;
+
+	return RET_SUCCESS;
 }
 
-void COrder2Rest::onGetAccount(void* curlobj, void* listener)
+int COrder2Rest::onChangeStopLoss(CCurlImpl* curlImpl, TblTrade* tblTrade)
 {
-	CCurlImpl* curlObj = (CCurlImpl*)curlobj;
-	COrder2Rest* order2Rest = (COrder2Rest*)listener;
-
 	picojson::value json;
-	picojson::object& obj = order2Rest->parseJson(curlObj, json);
+	picojson::object& obj = parseJsonObject(curlImpl, json);
 	if (obj.empty()) {
-		return;
+		return RET_FAILED;
 	}
 
-	TblAccount *tblAccount = order2Rest->newTblAccount(obj, curlObj);
-	if (strcmp(tblAccount->AccountID, order2Rest->getBaseInfo("AccountID")) == 0) {
-		order2Rest->m_pPluginProxy->onAccount(TableStatus::ST_UPD, tblAccount);
+	TblOrder* resOrder = newTblOrder(obj, curlImpl);
+	if (strlen(resOrder->Symbol) == 0) {
+		strcpy(resOrder->Symbol, tblTrade->Symbol);
 	}
-	delete tblAccount;
+	m_pPluginProxy->onOrder(TableStatus::ST_NEW, resOrder);
+	strcpy(tblTrade->StopOrderID, resOrder->OrderID);
+	if (m_pPositionBook) {
+		m_pPositionBook->setStop(tblTrade->TradeID, tblTrade->Stop, tblTrade->StopOrderID);
+	}
+	delete resOrder;
+
+	return RET_SUCCESS;
 }
 
-void COrder2Rest::onGetOpenTrades(void* curlobj, void* listener)
+int COrder2Rest::onChangeTakeProfit(CCurlImpl* curlImpl, TblTrade* tblTrade)
 {
-	CCurlImpl* curlObj = (CCurlImpl*)curlobj;
-	COrder2Rest* order2Rest = (COrder2Rest*)listener;
-	
 	picojson::value json;
-	picojson::array& list = order2Rest->parseJsonArray(curlObj, json);
-	if (list.empty()) {
-		return;
+	picojson::object& obj = parseJsonObject(curlImpl, json);
+	if (obj.empty()) {
+		return RET_FAILED;
 	}
 
-	for (picojson::array::iterator it = list.begin(); it != list.end(); it++) {
-		picojson::object& o = it->get<picojson::object>();
-		TblTrade* tblTrade = order2Rest->newTblTrade(o, curlObj);
-		order2Rest->m_pPluginProxy->onOpenedTrade(TableStatus::ST_UPD, tblTrade);
-		delete tblTrade;
+	TblOrder* resOrder = newTblOrder(obj, curlImpl);
+	if (strlen(resOrder->Symbol) == 0) {
+		strcpy(resOrder->Symbol, tblTrade->Symbol);
 	}
-}
-	
-void COrder2Rest::onGetClosedTrades(void* curlobj, void* listener)
-{
-	CCurlImpl* curlObj = (CCurlImpl*)curlobj;
-	COrder2Rest* order2Rest = (COrder2Rest*)listener;
-
-	picojson::value json;
-	picojson::array& list = order2Rest->parseJsonArray(curlObj, json);
-	if (list.empty()) {
-		return;
+	m_pPluginProxy->onOrder(TableStatus::ST_NEW, resOrder);
+	strcpy(tblTrade->LimitOrderID, resOrder->OrderID);
+	if (m_pPositionBook) {
+		m_pPositionBook->setLimit(tblTrade->TradeID, tblTrade->Limit, tblTrade->LimitOrderID);
 	}
+	delete resOrder;
 
-	time_t weekFirstDay = CUtils::getWeekFirstDate();
-	for (picojson::array::iterator it = list.begin(); it != list.end(); it++) {
-		picojson::object& o = it->get<picojson::object>();
-		TblTrade* tblTrade = order2Rest->newTblTrade(o, curlObj);
-		if (tblTrade->CloseTime > weekFirstDay) {
-			order2Rest->m_pPluginProxy->onClosedTrade(TableStatus::ST_UPD, tblTrade);
-		}
-		delete tblTrade;
-	}
+	return RET_SUCCESS;
 }
 
-int COrder2Rest::onJsonError(picojson::object& o)
+int COrder2Rest::onCloseTrade(CCurlImpl* curlImpl, TblTrade* tblTrade)
 {
-	string message;
-	if (COrder2Rest::json2Str(o, getErrorInfo("Message"), message)) {
-		message = "[onJsonError] " + message;
-		m_pPluginProxy->onMessage(MSG_ERROR, message.c_str());
+	picojson::value json;
+	picojson::object& obj = parseJsonObject(curlImpl, json);
+	if (obj.empty()) {
 		return RET_FAILED;
 	}
-	return RET_SUCCESS;
-}
 
-picojson::object& COrder2Rest::parseJson(CCurlImpl* curlImpl, picojson::value& json)
-{
-	static picojson::object nullopt;
+	TblOrder* resOrder = newTblOrder(obj, curlImpl);
+	strcpy(resOrder->TradeID, tblTrade->TradeID);
+	m_pPluginProxy->onOrder(TableStatus::ST_NEW, resOrder);
+	delete resOrder;
 
-	if (curlImpl->getResSize() == 0) {
-		return nullopt;
+	TblTrade* closedTrade = newTblTrade(obj, curlImpl);
+	strcpy(closedTrade->TradeID, tblTrade->TradeID);
+	closedTrade->Open = tblTrade->Open;
+	closedTrade->Stop = tblTrade->Stop;
+	closedTrade->Limit = tblTrade->Limit;
+	closedTrade->High = tblTrade->High;
+	closedTrade->Low = tblTrade->Low;
+	closedTrade->OpenTime = tblTrade->OpenTime;
+	strcpy(closedTrade->OpenOrderID, tblTrade->OpenOrderID);
+	strcpy(closedTrade->StopOrderID, tblTrade->StopOrderID);
+	strcpy(closedTrade->LimitOrderID, tblTrade->LimitOrderID);
+	if (m_pPositionBook) {
+		m_pPositionBook->closeTrade(tblTrade->TradeID, closedTrade->GrossPL);
 	}
+	m_pTrailingStop->remove(tblTrade->TradeID);
+	m_pPluginProxy->onOpenedTrade(TableStatus::ST_DEL, closedTrade);
+	m_pPluginProxy->onClosedTrade(TableStatus::ST_NEW, closedTrade);
+	delete closedTrade;
 
-	string err;
-	picojson::parse(json, curlImpl->getResContents(),
-		curlImpl->getResContents() + curlImpl->getResSize(), &err);
-	if (!err.empty() || json.is<picojson::null>()) {
-		err = err + "\n" + curlImpl->getResContents();
-		m_pPluginProxy->onMessage(MSG_ERROR, err.c_str());
-		return nullopt;
-	}
+	return RET_SUCCESS;
+}
 
-	picojson::object& obj = json.get<picojson::object>();
-	if (onJsonError(obj) == RET_FAILED) {
-		m_pPluginProxy->onMessage(MSG_ERROR, curlImpl->toString().c_str());
-		return nullopt;
+// Only one stop (limit) change per trade is in flight. Changes that arrive meanwhile
+// are queued on the trade; once the in-flight one completes, the caller that sent it
+// sends the latest queued change and hands its result and order ID to every caller
+// queued since, who wait for that before returning.
+// Returns the number of changes sent successfully, by this call or on its behalf.
+int COrder2Rest::changeOrders(TblTrade* tblTrades[], bool isStop)
+{
+	const char* kind = isStop ? "S" : "L";
+	int size = 0;
+	while (tblTrades[size]) {
+		size++;
+	}
+
+	vector<TblTrade*> sendList;
+	vector<QueuedChange> queuedList;
+	queuedList.reserve(size);
+	{
+		CCriticalSection::Lock lock(m_csPendingChanges);
+		for (int i = 0; i < size; i++) {
+			string key = string(kind) + tblTrades[i]->TradeID;
+			map<string, vector<QueuedChange*> >::iterator it = m_mapPendingChanges.find(key);
+			if (it != m_mapPendingChanges.end()) {
+				QueuedChange queued = { tblTrades[i], nsapi::CreateEvent(NULL, TRUE, FALSE, NULL), false };
+				queuedList.push_back(queued);
+				it->second.push_back(&queuedList.back());
+			}
+			else {
+				m_mapPendingChanges[key];
+				sendList.push_back(tblTrades[i]);
+			}
+		}
 	}
 
-	return obj;
-}
-
-picojson::object& COrder2Rest::parseJsonObject(CCurlImpl* curlImpl, picojson::value& json)
-{
-	static picojson::object nullopt;
+	int count = 0;
+	// The callers each sent change is reported to, none for this call's own.
+	vector<vector<QueuedChange*> > waiterList(sendList.size());
+	// This call's own trade for each sent change, kept up to date with the order ID.
+	vector<TblTrade*> ownerList(sendList);
+	while (!sendList.empty()) {
+		vector<bool> results;
+		sendChangeOrders(sendList, isStop, results);
+
+		vector<TblTrade*> nextList;
+		vector<vector<QueuedChange*> > nextWaiterList;
+		vector<TblTrade*> nextOwnerList;
+		CCriticalSection::Lock lock(m_csPendingChanges);
+		for (size_t i = 0; i < sendList.size(); i++) {
+			const char* sentOrderID = isStop ? sendList[i]->StopOrderID : sendList[i]->LimitOrderID;
+			if (ownerList[i] != sendList[i] && strlen(sentOrderID) > 0) {
+				strcpy(isStop ? ownerList[i]->StopOrderID : ownerList[i]->LimitOrderID, sentOrderID);
+			}
+			map<string, vector<QueuedChange*> >::iterator it = m_mapPendingChanges.find(string(kind) + sendList[i]->TradeID);
+			if (it != m_mapPendingChanges.end() && it->second.empty()) {
+				m_mapPendingChanges.erase(it);
+			}
+			else if (it != m_mapPendingChanges.end()) {
+				// The queued change may predate the order created by this one.
+				TblTrade* next = it->second.back()->Trade;
+				if (strlen(sentOrderID) > 0) {
+					strcpy(isStop ? next->StopOrderID : next->LimitOrderID, sentOrderID);
+				}
+				nextList.push_back(next);
+				nextWaiterList.push_back(it->second);
+				nextOwnerList.push_back(ownerList[i]);
+				it->second.clear();
+			}
 
-	picojson::object& obj = parseJson(curlImpl, json);
-	if (obj.empty()) {
-		return nullopt;
-	}
-	string resTargetName = curlImpl->getResField(CCurlImpl::ResTargetName);
-	if (resTargetName.empty()) {
-		return obj;
+			if (waiterList[i].empty()) {
+				count += results[i] ? 1 : 0;
+				continue;
+			}
+			// Once signaled, a waiter may release its trade, the sent one included.
+			for (size_t j = 0; j < waiterList[i].size(); j++) {
+				QueuedChange* waiter = waiterList[i][j];
+				if (waiter->Trade != sendList[i]) {
+					strcpy(isStop ? waiter->Trade->StopOrderID : waiter->Trade->LimitOrderID, sentOrderID);
+				}
+				waiter->Result = results[i];
+			}
+			for (size_t j = 0; j < waiterList[i].size(); j++) {
+				nsapi::SetEvent(waiterList[i][j]->Done);
+			}
+		}
+		sendList.swap(nextList);
+		waiterList.swap(nextWaiterList);
+		ownerList.swap(nextOwnerList);
 	}
-	map<string, picojson::value>::iterator mpos = obj.find(resTargetName);
-	if (mpos == obj.end()) {
-		string s = "Can't find object " + resTargetName;
-		m_pPluginProxy->onMessage(MSG_ERROR, s.c_str());
-		return nullopt;
+
+	for (size_t i = 0; i < queuedList.size(); i++) {
+		nsapi::WaitForSingleObject(queuedList[i].Done, INFINITE);
+		nsapi::CloseHandle(queuedList[i].Done);
+		count += queuedList[i].Result ? 1 : 0;
 	}
-	return mpos->second.get<picojson::object>();
+	return count;
 }
 
-picojson::array& COrder2Rest::parseJsonArray(CCurlImpl* curlImpl, picojson::value& json)
+void COrder2Rest::sendChangeOrders(vector<TblTrade*>& tblTrades, bool isStop, vector<bool>& results)
 {
-	static picojson::array nullopt;
+	vector<CCurlImpl*> curlList;
+	for (size_t i = 0; i < tblTrades.size(); i++) {
+		curlList.push_back(isStop ? newChangeStopLossCurl(tblTrades[i]) : newChangeTakeProfitCurl(tblTrades[i]));
+	}
 
-	picojson::object& obj = parseJson(curlImpl, json);
-	if (obj.empty()) {
-		return nullopt;
+	vector<CURLcode> codes;
+	if (curlList.size() == 1) {
+		codes.push_back(curlList[0] ? doTradePerform(curlList[0]) : CURLE_FAILED_INIT);
 	}
-	
-	string resTargetName = curlImpl->getResField(CCurlImpl::ResTargetName);
-	map<string, picojson::value>::iterator mpos = obj.find(resTargetName);
-	if (mpos == obj.end()) {
-		string s = "Can't find array " + resTargetName;
-		m_pPluginProxy->onMessage(MSG_ERROR, s.c_str());
-		return nullopt;
+	else {
+		doMultiPerform(curlList, codes);
 	}
-	if (!mpos->second.is<picojson::array>()) {
-		string s = resTargetName + " is not array.";
-		m_pPluginProxy->onMessage(MSG_ERROR, s.c_str());
-		return nullopt;
+
+	results.assign(curlList.size(), false);
+	for (size_t i = 0; i < curlList.size(); i++) {
+		if (curlList[i] && codes[i] == CURLE_OK) {
+			int ret = isStop ? onChangeStopLoss(curlList[i], tblTrades[i]) : onChangeTakeProfit(curlList[i], tblTrades[i]);
+			results[i] = ret == RET_SUCCESS;
+		}
+		delete curlList[i];
 	}
-	return mpos->second.get<picojson::array>();
 }
 
-time_t COrder2Rest::reqServerTime()
+CURLcode COrder2Rest::doTradePerform(CCurlImpl* curlImpl)
 {
-	long resCode;
-	CURLcode res = curl_easy_getinfo(m_CurlList[CURL_GET_PRICE]->getCurlHandle(), CURLINFO_RESPONSE_CODE, &resCode);
-	if (res == CURLE_OK && resCode == 200) {
-		return CUtils::HStr2Time(m_CurlList[CURL_GET_PRICE]->getResHeader());
+	CURLcode ret = curlImpl->doEasyPerform();
+	if (ret != CURLE_OK) {
+		m_pPluginProxy->onMessage(MSG_ERROR, curl_easy_strerror(ret));
 	}
-	return 0;
+	return ret;
 }
 
-int COrder2Rest::getHistoricalData(const char* symbol, const char* period, time_t start, time_t end, int adjustmentTimezone, vector<TblCandle*>& tblCandleList)
+void COrder2Rest::doMultiPerform(vector<CCurlImpl*>& curlList, vector<CURLcode>& results)
 {
-	CCurlImpl* curlObj = m_CurlList[CURL_GET_CANDLES];
-	
-	m_mapPathParams["$symbol"] = transfSymbol(symbol);
-	curlObj->setPath(GetHistoricalDataInfo("Path"), m_mapPathParams);
-
-	vector<ReqParam> params;
-	params.push_back(ReqParam{"$symbol", transfSymbol(symbol)});
-	params.push_back(ReqParam{"$period", transfPeriod(period)});
-	params.push_back(ReqParam{"$start", transfTime(start + adjustmentTimezone) });
-	params.push_back(ReqParam{"$end", transfTime(end + adjustmentTimezone) });
-	curlObj->setEasyPerform(&params);
-
-	CURLcode ret = curlObj->doEasyPerform();
-	if (ret != CURLE_OK) {
-		m_pPluginProxy->onMessage(MSG_ERROR, curl_easy_strerror(ret));
-		return RET_FAILED;
+	results.assign(curlList.size(), CURLE_FAILED_INIT);
+	if (curlList.empty()) {
+		return;
 	}
 
-	picojson::value json;
-	picojson::array& list = parseJsonArray(curlObj, json);
-	if (list.empty()) {
-		return 0;
+	// A private multi handle per call, so trade batches never touch the poll thread's one.
+	CURLM* curlMulti = curl_multi_init();
+	if (!curlMulti) {
+		m_pPluginProxy->onMessage(MSG_ERROR, "Can't init multi curl.");
+		return;
 	}
-	for (picojson::array::iterator it = list.begin(); it != list.end(); it++) {
-		picojson::object& o = it->get<picojson::object>();
-		TblCandle* tblCandle = COrder2Rest::newTblCandle(o, curlObj);
-		strcpy(tblCandle->Symbol, symbol);
-		strcpy(tblCandle->Period, period);
-		tblCandleList.push_back(tblCandle);
+	for (size_t i = 0; i < curlList.size(); i++) {
+		if (curlList[i]) {
+			curlList[i]->clear();
+			curl_multi_add_handle(curlMulti, curlList[i]->getCurlHandle());
+		}
 	}
 
-	char buf[256];
-	tm tmStart = CUtils::getUTCCal(start);
-	tm tmEnd = CUtils::getUTCCal(end);
-	tm tmOutStart = CUtils::getUTCCal(tblCandleList.front()->StartDate);
-	tm tmOutEnd = CUtils::getUTCCal(tblCandleList.back()->StartDate);
-	sprintf(buf, "[GetHistoricalData] Count:%d StartDate:%s EndDate:%s OutStartDate:%s OutEndDate:%s",
-		tblCandleList.size(),
-		CUtils::strOfTime(&tmStart, TimeFormat).c_str(),
-		CUtils::strOfTime(&tmEnd, TimeFormat).c_str(),
-		CUtils::strOfTime(&tmOutStart, TimeFormat).c_str(),
-		CUtils::strOfTime(&tmOutEnd, TimeFormat).c_str());
-	m_pPluginProxy->onMessage(MSG_DEBUG, buf);
-
-	return tblCandleList.size();
-}
-
-bool COrder2Rest::getSslVerify()
-{
-	return strcmp(getBaseInfo("SslVerify"), "true") == 0 ? true : false;
-}
-
-void COrder2Rest::getHeaders(vector<const char*>& headers)
-{
-	CSimpleIniCaseA::TNamesDepend keys;
-	m_SimpleIni.GetAllKeys("Header", keys);
-	CSimpleIniCaseA::TNamesDepend::const_iterator it = keys.begin();
-	while (it != keys.end()) {
-		headers.push_back(getHeaderInfo(it->pItem));
-		it++;
+	int running = 0;
+	do {
+		CURLMcode mc = curl_multi_perform(curlMulti, &running);
+		if (mc == CURLM_OK && running) {
+			mc = curl_multi_wait(curlMulti, NULL, 0, 1000, NULL);
+		}
+		if (mc != CURLM_OK) {
+			string s = "curl_multi_wait failed, code: " + std::to_string(mc);
+			m_pPluginProxy->onMessage(MSG_ERROR, s.c_str());
+			break;
+		}
+	} while (running);
+
+	CURLMsg *msg;
+	int msgs_left;
+	while ((msg = curl_multi_info_read(curlMulti, &msgs_left))) {
+		if (msg->msg == CURLMSG_DONE) {
+			for (size_t i = 0; i < curlList.size(); i++) {
+				if (curlList[i] && msg->easy_handle == curlList[i]->getCurlHandle()) {
+					results[i] = msg->data.result;
+					if (results[i] == CURLE_OK) {
+						curlList[i]->recordTiming();
+					}
+					break;
+				}
+			}
+		}
 	}
-}
 
-// 2023/10/09 add by yld
-int COrder2Rest::getAdjustmentTimezone()
-{
-	return std::stoi(getBaseInfo("AdjustmentTimezone", 0)) * 3600;
+	for (size_t i = 0; i < curlList.size(); i++) {
+		if (curlList[i]) {
+			curl_multi_remove_handle(curlMulti, curlList[i]->getCurlHandle());
+			if (results[i] != CURLE_OK) {
+				m_pPluginProxy->onMessage(MSG_ERROR, curl_easy_strerror(results[i]));
+			}
+		}
+	}
+	curl_multi_cleanup(curlMulti);
 }
 
 string COrder2Rest::transfSymbol(const char* symbol)
 {
-	string s = symbol;
-	CUtils::replace(s, "/", getSymbolInfo("Combination"));
-	return s;
+	return m_Symbols.brokerSymbol(m_Symbols.intern(symbol));
 }
 
 string COrder2Rest::transfSymbols(const char* symbols[])
 {
+	const string& delimiter = m_Config.get()->Delimiter;
 	string s;
 	for (int i = 0; symbols[i]; i++) {
-		if (s.empty()) {
-			s = transfSymbol(symbols[i]);
-		}
-		else {
-			s = s + getSymbolInfo("Delimiter") + transfSymbol(symbols[i]);
+		if (i > 0) {
+			s.append(delimiter);
 		}
+		s.append(m_Symbols.brokerSymbol(m_Symbols.intern(symbols[i])));
 	}
 	return s;
 }
 
 string COrder2Rest::transfPeriod(const char* period)
 {
-	return getPeriodInfo(period);
+	const RestSettings* settings = m_Config.get();
+	map<string, string>::const_iterator it = settings->Periods.find(period);
+	return it == settings->Periods.end() ? CCurlImpl::Blank : it->second;
 }
 
 string COrder2Rest::transfSide(const char* side)
@@ -1092,7 +1800,7 @@ string COrder2Rest::transfSide(const char* side)
 	if (strlen(side) == 0) {
 		return "";
 	}
-	if (strcmp(side, getSideInfo("B")) == 0) {
+	if (m_Config.get()->BuySide == side) {
 		return "B";
 	}
 	return "S";
@@ -1112,7 +1820,7 @@ string COrder2Rest::transfSide(double amount)
 string COrder2Rest::transfTime(time_t t)
 {
 	string s;
-	if (strcmp(getBaseInfo("TimeFormat"), "RFC3339") == 0) {
+	if (m_Config.get()->RFC3339) {
 		s = CUtils::strOfTimeWithRFC3339(t);
 	}
 	else {
@@ -1255,21 +1963,32 @@ bool COrder2Rest::json2Str(picojson::object& o, const char* key, string& val)
 }
 
 bool COrder2Rest::json2Time(picojson::object& o, const char* key, time_t* val)
+{
+	int64_t ns;
+	return json2Time(o, key, val, &ns);
+}
+
+bool COrder2Rest::json2Time(picojson::object& o, const char* key, time_t* val, int64_t* ns)
 {
 	picojson::value& jval = findJsonValue(o, key);
 	if (jval.is<picojson::null>()) {
 		*val = 0;
+		*ns = 0;
 		return false;
 	}
 	if (jval.is<bool>()) {
-		*val = (time_t)jval.get<bool>();
+		*ns = (int64_t)jval.get<bool>() * 1000000000;
 	}
 	else if (jval.is<double>()) {
-		*val = (time_t)jval.get<double>();
+		*ns = (int64_t)(jval.get<double>() * 1e9);
 	}
 	else if (jval.is<string>()) {
-		*val = CUtils::str2Time(jval.get<string>().c_str());
+		*ns = CUtils::str2TimeNs(jval.get<string>().c_str());
+	}
+	else {
+		*ns = 0;
 	}
+	*val = (time_t)(*ns / 1000000000);
 	return true;
 }
 
@@ -1328,7 +2047,7 @@ TblAccount* COrder2Rest::newTblAccount(picojson::object& o, CCurlImpl* curlImpl)
 	json2Str(o, curlImpl->getResField("Currency").c_str(), s);
 	strcpy(tblAccount->Currency, s.c_str());
 	// Broker
-	strcpy(tblAccount->Broker, getBaseInfo("Broker"));
+	strcpy(tblAccount->Broker, m_Config.get()->Broker.c_str());
 	// Reserve
 	json2Str(o, curlImpl->getResField("Reserve").c_str(), s);
 	strcpy(tblAccount->Reserve, s.c_str());
@@ -1341,8 +2060,7 @@ TblPrice* COrder2Rest::newTblPrice(picojson::object& o, CCurlImpl* curlImpl)
 	string s;
 	// Symbol
 	json2Str(o, curlImpl->getResField("Symbol").c_str(), s);
-	CUtils::replace(s, getSymbolInfo("Combination"), "/");
-	strcpy(tblPrice->Symbol, s.c_str());
+	strcpy(tblPrice->Symbol, m_Symbols.symbol(m_Symbols.internBroker(s.c_str())));
 	// SymbolType
 	json2Str(o, curlImpl->getResField("SymbolType").c_str(), s);
 	strcpy(tblPrice->SymbolType, s.c_str());
@@ -1354,7 +2072,8 @@ TblPrice* COrder2Rest::newTblPrice(picojson::object& o, CCurlImpl* curlImpl)
 	// Ask
 	json2Dbl(o, curlImpl->getResField("Ask").c_str(), &tblPrice->Ask);
 	// Time
-	json2Time(o, curlImpl->getResField("Time").c_str(), &tblPrice->Time);
+	int64_t timeNs;
+	json2Time(o, curlImpl->getResField("Time").c_str(), &tblPrice->Time, &timeNs);
 	// High
 	json2Dbl(o, curlImpl->getResField("High").c_str(), &tblPrice->High);
 	// Low
@@ -1366,6 +2085,7 @@ TblPrice* COrder2Rest::newTblPrice(picojson::object& o, CCurlImpl* curlImpl)
 	// Reserve
 	json2Str(o, curlImpl->getResField("Reserve").c_str(), s);
 	strcpy(tblPrice->Reserve, s.c_str());
+	setTimeExt(tblPrice, timeNs, 0, curlImpl->getRecvNs());
 	return tblPrice;
 }
 
@@ -1387,8 +2107,7 @@ TblOrder* COrder2Rest::newTblOrder(picojson::object& o, CCurlImpl* curlImpl)
 	strcpy(tblOrder->OfferID, s.c_str());
 	// Symbol
 	json2Str(o, curlImpl->getResField("Symbol").c_str(), s);
-	CUtils::replace(s, getSymbolInfo("Combination"), "/");
-	strcpy(tblOrder->Symbol, s.c_str());
+	strcpy(tblOrder->Symbol, m_Symbols.symbol(m_Symbols.internBroker(s.c_str())));
 	// TradeID
 	json2Str(o, curlImpl->getResField("TradeID").c_str(), s);
 	strcpy(tblOrder->TradeID, s.c_str());
@@ -1417,10 +2136,12 @@ TblOrder* COrder2Rest::newTblOrder(picojson::object& o, CCurlImpl* curlImpl)
 	// Limit
 	json2Dbl(o, curlImpl->getResField("Limit").c_str(), &tblOrder->Limit);
 	// Time
-	json2Time(o, curlImpl->getResField("Time").c_str(), &tblOrder->Time);
+	int64_t timeNs;
+	json2Time(o, curlImpl->getResField("Time").c_str(), &tblOrder->Time, &timeNs);
 	// Reserve
 	json2Str(o, curlImpl->getResField("Reserve").c_str(), s);
 	strcpy(tblOrder->Reserve, s.c_str());
+	setTimeExt(tblOrder, timeNs, 0, curlImpl->getRecvNs());
 	return tblOrder;
 }
 
@@ -1434,7 +2155,7 @@ TblTrade* COrder2Rest::newTblTrade(picojson::object& o, CCurlImpl* curlImpl)
 	// AccountID
 	json2Str(o, curlImpl->getResField("AccountID").c_str(), s);
 	if (s.length() == 0) {
-		strcpy(tblTrade->AccountID, getBaseInfo("AccountID"));
+		strcpy(tblTrade->AccountID, m_Config.get()->AccountID.c_str());
 	}
 	else {
 		strcpy(tblTrade->AccountID, s.c_str());
@@ -1444,8 +2165,7 @@ TblTrade* COrder2Rest::newTblTrade(picojson::object& o, CCurlImpl* curlImpl)
 	strcpy(tblTrade->OfferID, s.c_str());
 	// Symbol
 	json2Str(o, curlImpl->getResField("Symbol").c_str(), s);
-	CUtils::replace(s, getSymbolInfo("Combination"), "/");
-	strcpy(tblTrade->Symbol, s.c_str());
+	strcpy(tblTrade->Symbol, m_Symbols.symbol(m_Symbols.internBroker(s.c_str())));
 	// Amount
 	json2Dbl(o, curlImpl->getResField("Amount").c_str(), &tblTrade->Amount);
 	// BS
@@ -1480,9 +2200,11 @@ TblTrade* COrder2Rest::newTblTrade(picojson::object& o, CCurlImpl* curlImpl)
 	// Interest
 	json2Dbl(o, curlImpl->getResField("Interest").c_str(), &tblTrade->Interest);
 	// OpenTime
-	json2Time(o, curlImpl->getResField("OpenTime").c_str(), &tblTrade->OpenTime);
+	int64_t openTimeNs;
+	json2Time(o, curlImpl->getResField("OpenTime").c_str(), &tblTrade->OpenTime, &openTimeNs);
 	// CloseTime
-	json2Time(o, curlImpl->getResField("CloseTime").c_str(), &tblTrade->CloseTime);
+	int64_t closeTimeNs;
+	json2Time(o, curlImpl->getResField("CloseTime").c_str(), &tblTrade->CloseTime, &closeTimeNs);
 	// OpenOrderID
 	json2Str(o, curlImpl->getResField("OpenOrderID").c_str(), s);
 	strcpy(tblTrade->OpenOrderID, s.c_str());
@@ -1498,6 +2220,7 @@ TblTrade* COrder2Rest::newTblTrade(picojson::object& o, CCurlImpl* curlImpl)
 	// Reserve
 	json2Str(o, curlImpl->getResField("Reserve").c_str(), s);
 	strcpy(tblTrade->Reserve, s.c_str());
+	setTimeExt(tblTrade, openTimeNs, closeTimeNs, curlImpl->getRecvNs());
 	return tblTrade;
 }
 
@@ -1513,90 +2236,60 @@ time_t COrder2Rest::getTimetByPeriod(const char* period)
 
 const char* COrder2Rest::getBaseInfo(const char* key, const char* defval)
 {
-	return m_SimpleIni.GetValue("Base", key, defval);
+	return m_Config.get()->Ini.GetValue("Base", key, defval);
 }
 
-const char* COrder2Rest::getHeaderInfo(const char* key, const char* defval)
+const char* COrder2Rest::getSideInfo(const char* key, const char* defval)
 {
-	return m_SimpleIni.GetValue("Header", key, defval);
+	return m_Config.get()->Ini.GetValue("Side", key, defval);
 }
 
-const char* COrder2Rest::getSymbolInfo(const char* key, const char* defval)
+const char* COrder2Rest::getMarketInfo(const char* key, const char* defval)
 {
-	return m_SimpleIni.GetValue("Symbol", key, defval);
+	return m_Config.get()->Ini.GetValue("Market", key, defval);
 }
 
-const char* COrder2Rest::getPeriodInfo(const char* key, const char* defval)
+const char* COrder2Rest::getAccountInfo(const char* key, const char* defval)
 {
-	return m_SimpleIni.GetValue("Period", key, defval);
+	return m_Config.get()->Ini.GetValue("GetAccount", key, defval);
 }
 
-const char* COrder2Rest::getSideInfo(const char* key, const char* defval)
+const char* COrder2Rest::getJournalInfo(const char* key, const char* defval)
 {
-	return m_SimpleIni.GetValue("Side", key, defval);
+	return m_Config.get()->Ini.GetValue("Journal", key, defval);
 }
 
-const char* COrder2Rest::getErrorInfo(const char* key, const char* defval)
+const char* COrder2Rest::getPositionInfo(const char* key, const char* defval)
 {
-	return m_SimpleIni.GetValue("Error", key, defval);
+	return m_Config.get()->Ini.GetValue("Position", key, defval);
 }
 
-const char* COrder2Rest::getMarketInfo(const char* key, const char* defval)
+const char* COrder2Rest::getPointSizeInfo(const char* key, const char* defval)
 {
-	return m_SimpleIni.GetValue("Market", key, defval);
+	return m_Config.get()->Ini.GetValue("PointSize", key, defval);
 }
 
-const char* COrder2Rest::getAccountInfo(const char* key, const char* defval)
+const char* COrder2Rest::getRecorderInfo(const char* key, const char* defval)
 {
-	return m_SimpleIni.GetValue("GetAccount", key, defval);
+	return m_Config.get()->Ini.GetValue("Recorder", key, defval);
 }
 
 const char* COrder2Rest::getPriceInfo(const char* key, const char* defval)
 {
-	return m_SimpleIni.GetValue("GetPrice", key, defval);
+	return m_Config.get()->Ini.GetValue("GetPrice", key, defval);
 }
 
 const char* COrder2Rest::GetHistoricalDataInfo(const char* key, const char* defval)
 {
-	return m_SimpleIni.GetValue("GetHistoricalData", key, defval);
+	return m_Config.get()->Ini.GetValue("GetHistoricalData", key, defval);
 }
 
 const char* COrder2Rest::GetOpenedTradesInfo(const char* key, const char* defval)
 {
-	return m_SimpleIni.GetValue("GetOpenedTrades", key, defval);
+	return m_Config.get()->Ini.GetValue("GetOpenedTrades", key, defval);
 }
 
 const char* COrder2Rest::GetClosedTradesInfo(const char* key, const char* defval)
 {
-	return m_SimpleIni.GetValue("GetClosedTrades", key, defval);
-}
-
-const char* COrder2Rest::getOpenMarketOrderInfo(const char* key, const char* defval)
-{
-	return m_SimpleIni.GetValue("OpenMarketOrder", key, defval);
-}
-
-const char* COrder2Rest::getStopLossOrderInfo(const char* key, const char* defval)
-{
-	return m_SimpleIni.GetValue("StopLossOrder", key, defval);
-}
-
-const char* COrder2Rest::getTakeProfitOrderInfo(const char* key, const char* defval)
-{
-	return m_SimpleIni.GetValue("TakeProfitOrder", key, defval);
-}
-
-const char* COrder2Rest::getChangeStopLossInfo(const char* key, const char* defval)
-{
-	return m_SimpleIni.GetValue("ChangeStopLoss", key, defval);
-}
-
-const char* COrder2Rest::getChangeTakeProfitInfo(const char* key, const char* defval)
-{
-	return m_SimpleIni.GetValue("ChangeTakeProfit", key, defval);
-}
-
-const char* COrder2Rest::getCloseTradeInfo(const char* key, const char* defval)
-{
-	return m_SimpleIni.GetValue("CloseTrade", key, defval);
+	return m_Config.get()->Ini.GetValue("GetClosedTrades", key, defval);
 }
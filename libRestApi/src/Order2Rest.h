@@ -3,29 +3,62 @@
 
 #include "IBaseOrder.h"
 #include "IPluginProxy.h"
-
-#define PL_INVALID DBL_MAX
+#include "ProxyRecorder.h"
+#include "TickJournal.h"
+#include "PositionBook.h"
+#include "TrailingStop.h"
+#include "ServerClock.h"
+#include "MarketCalendar.h"
+#include "RestConfig.h"
+#include "SymbolRegistry.h"
+#include "QuoteCache.h"
 
 typedef enum {
 	CURL_GET_PRICE,
 	CURL_GET_ACCOUNT,
 	CURL_GET_OPENTRADES,
 	CURL_GET_CLOSEDTRADES,
-	CURL_GET_CANDLES
+	CURL_POLL_COUNT
 };
 
+// A change queued behind the one in flight of its trade. Its caller waits on
+// Done until the change, or a later one that replaced it, has been sent.
+typedef struct {
+	TblTrade* Trade;
+	HANDLE Done;
+	bool Result;
+} QueuedChange;
+
 class COrder2Rest : public IBaseOrder
 {
 private:
-	CSimpleIniCaseA m_SimpleIni;
+	CRestConfig m_Config;
+	CSymbolRegistry m_Symbols;
+	CQuoteCache m_QuoteCache;
+	vector<int> m_vtSubscribeRefs;	// by symbol ID
+	CCriticalSection m_csSubscribe;
+	string m_sPolledSymbols;		// guarded by m_csCurlList[CURL_GET_PRICE]
 	IPluginProxy *m_pPluginProxy;
+	CProxyRecorder *m_pProxyRecorder;
+	CTickJournal *m_pTickJournal;
+	CPositionBook *m_pPositionBook;
+	CTrailingStop *m_pTrailingStop;
 	CURLM *m_pCurlMulti;
-	CCurlImpl* m_CurlList[5];
-	map<string, string> m_mapPathParams;
+	CCurlImpl* m_CurlList[CURL_POLL_COUNT];
+	CCriticalSection m_csCurlList[CURL_POLL_COUNT];
+	vector<CCurlImpl*> m_vtCandleCurls;
+	CCriticalSection m_csCandleCurls;
+	map<string, string> m_mapPathParams;	// read-only after init
 	HANDLE m_hExitEvent;
 	HANDLE m_hOverEvent;
 	CThread *m_pTradeEventsProcessThread;
-	atomic<time_t> m_tmStdTime;
+	CServerClock m_ServerClock;
+	CMarketCalendar m_MarketCalendar;
+	int64_t m_nNextReloadNs;
+	CLatencyStats m_LatencyStats;
+	int64_t m_nNextStatsNs;
+	map<string, vector<QueuedChange*> > m_mapPendingChanges;
+	CCriticalSection m_csPendingChanges;
 
 public:
 	COrder2Rest();
@@ -37,6 +70,7 @@ public:
 	time_t getServerTime();
 	int getAccount(const char* accountID, TblAccount** tblAccount);
 	int getPrice(const char* symbol[], TblPrice** pTblPrice[]);
+	int getDepth(const char* symbol, TblDepth** tblDepth);
 	int getOpenedTrades(TblTrade** pTblTrade[]);
 	int getClosedTrades(TblTrade** pTblTrade[]);
 	int getHistoricalData(const char* symbol, const char* period, time_t start, time_t end, bool maxRange, TblCandle** pTblCandle[]);
@@ -46,12 +80,30 @@ public:
 	int changeStopLoss(TblTrade* tblTrade);
 	int changeTakeProfit(TblTrade* tblTrade);
 	int closeTrade(TblTrade* tblTrade);
+	int openMarketOrders(TblOrder* tblOrders[]);
+	int changeStopLosses(TblTrade* tblTrades[]);
+	int changeTakeProfits(TblTrade* tblTrades[]);
+	int closeTrades(TblTrade* tblTrades[]);
+	int setTrailingStop(TblTrade* tblTrade, double distance, double step);
+	int removeTrailingStop(TblTrade* tblTrade);
+	int subscribe(const char* symbols[]);
+	int unsubscribe(const char* symbols[]);
+	void getLatencyStats(vector<LatencySnapshot>& snapshots);
 
 private:
 	int initCurl();
+	void initPositionBook();
+	void initMarketCalendar();
 	int startTradeEventThread();	
 	static void tradeEventsProcess(void *pv);
 	void waitNextEvent();
+	void checkConfig();
+	void reloadConfig();
+	void reportStats();
+	bool addSubscription(int id);
+	bool isPolled(int id);
+	void updatePriceRequest();
+	int fetchPrices(vector<int>& ids, vector<TblPrice*>& tblPriceList);
 	void onTableListener();
 	static void onGetPrice(void* curlobj, void* listener);
 	static void onGetAccount(void* curlobj, void* listener);
@@ -62,12 +114,31 @@ private:
 	picojson::object& parseJson(CCurlImpl* curlImpl, picojson::value& json);
 	picojson::object& parseJsonObject(CCurlImpl* curlImpl, picojson::value& json);
 	picojson::array& parseJsonArray(CCurlImpl* curlImpl, picojson::value& json);
-	time_t reqServerTime();
+	void sampleServerTime(CCurlImpl* curlImpl);
 	int getHistoricalData(const char* symbol, const char* period, time_t start, time_t end, int adjustmentTimezone, vector<TblCandle*>& tblCandleList);
 
-	bool getSslVerify();
-	void getHeaders(vector<const char*>& headers);
-	int getAdjustmentTimezone();	// 2023/10/09 add by yld
+	CCurlImpl* newCandleCurl();
+	CCurlImpl* acquireCandleCurl();
+	void releaseCandleCurl(CCurlImpl* curlImpl);
+	CCurlImpl* newTradeCurl(const char* section, map<string, string>& pathParams);
+	CCurlImpl* newOpenMarketOrderCurl(TblOrder* tblOrder);
+	CCurlImpl* newStopLossOrderCurl(TblOrder* tblOrder);
+	CCurlImpl* newTakeProfitOrderCurl(TblOrder* tblOrder);
+	CCurlImpl* newChangeStopLossCurl(TblTrade* tblTrade);
+	CCurlImpl* newChangeTakeProfitCurl(TblTrade* tblTrade);
+	CCurlImpl* newCloseTradeCurl(TblTrade* tblTrade);
+	TblOrder* onOpenMarketOrder(CCurlImpl* curlImpl, TblTrade** openedTrade);
+	void onOpenedMarketOrder(TblOrder* tblOrder, TblOrder* resOrder, TblTrade* openedTrade);
+	int onStopLossOrder(CCurlImpl* curlImpl, TblOrder* tblOrder);
+	int onTakeProfitOrder(CCurlImpl* curlImpl, TblOrder* tblOrder);
+	int onChangeStopLoss(CCurlImpl* curlImpl, TblTrade* tblTrade);
+	int onChangeTakeProfit(CCurlImpl* curlImpl, TblTrade* tblTrade);
+	int onCloseTrade(CCurlImpl* curlImpl, TblTrade* tblTrade);
+	int changeOrders(TblTrade* tblTrades[], bool isStop);
+	void sendChangeOrders(vector<TblTrade*>& tblTrades, bool isStop, vector<bool>& results);
+	CURLcode doTradePerform(CCurlImpl* curlImpl);
+	void doMultiPerform(vector<CCurlImpl*>& curlList, vector<CURLcode>& results);
+
 	string transfSymbol(const char* symbol);
 	string transfSymbols(const char* symbols[]);
 	string transfPeriod(const char* period);
@@ -88,26 +159,21 @@ private:
 	static bool json2Dbl(picojson::object& o, const char* key, double* val);
 	static bool json2Str(picojson::object& o, const char* key, string& val);
 	static bool json2Time(picojson::object& o, const char* key, time_t* val);
+	static bool json2Time(picojson::object& o, const char* key, time_t* val, int64_t* ns);
 	static time_t getTimetByPeriod(const char* period);
 
 	const char* getBaseInfo(const char* key, const char* defval = CCurlImpl::Blank);
-	const char* getHeaderInfo(const char* key, const char* defval = CCurlImpl::Blank);
-	const char* getSymbolInfo(const char* key, const char* defval = CCurlImpl::Blank);
-	const char* getPeriodInfo(const char* key, const char* defval = CCurlImpl::Blank);
 	const char* getSideInfo(const char* key, const char* defval = CCurlImpl::Blank);
-	const char* getErrorInfo(const char* key, const char* defval = CCurlImpl::Blank);
 	const char* getMarketInfo(const char* key, const char* defval = CCurlImpl::Blank);
 	const char* getAccountInfo(const char* key, const char* defval = CCurlImpl::Blank);
+	const char* getRecorderInfo(const char* key, const char* defval = CCurlImpl::Blank);
+	const char* getJournalInfo(const char* key, const char* defval = CCurlImpl::Blank);
+	const char* getPositionInfo(const char* key, const char* defval = CCurlImpl::Blank);
+	const char* getPointSizeInfo(const char* key, const char* defval = CCurlImpl::Blank);
 	const char* getPriceInfo(const char* key, const char* defval = CCurlImpl::Blank);
 	const char* GetHistoricalDataInfo(const char* key, const char* defval = CCurlImpl::Blank);
 	const char* GetOpenedTradesInfo(const char* key, const char* defval = CCurlImpl::Blank);
 	const char* GetClosedTradesInfo(const char* key, const char* defval = CCurlImpl::Blank);
-	const char* getOpenMarketOrderInfo(const char* key, const char* defval = CCurlImpl::Blank);
-	const char* getStopLossOrderInfo(const char* key, const char* defval = CCurlImpl::Blank);
-	const char* getTakeProfitOrderInfo(const char* key, const char* defval = CCurlImpl::Blank);
-	const char* getChangeStopLossInfo(const char* key, const char* defval = CCurlImpl::Blank);
-	const char* getChangeTakeProfitInfo(const char* key, const char* defval = CCurlImpl::Blank);
-	const char* getCloseTradeInfo(const char* key, const char* defval = CCurlImpl::Blank);
 };
 
 #endif
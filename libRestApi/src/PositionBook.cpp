@@ -0,0 +1,220 @@
+/*
+* Copyright 2020 FXDaemon
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include "stdafx.h"
+#include "PositionBook.h"
+
+CPositionBook::CPositionBook(double plThreshold, double equityThreshold, double pipCostAmount)
+{
+	m_dbPLThreshold = plThreshold;
+	m_dbEquityThreshold = equityThreshold;
+	m_dbPipCostAmount = pipCostAmount > 0 ? pipCostAmount : 1;
+	memset(&m_stAccount, 0, sizeof(m_stAccount));
+	m_bAccount = false;
+	m_dbLastEquity = 0;
+}
+
+void CPositionBook::setPointSize(const char* symbol, double pointSize)
+{
+	CCriticalSection::Lock lock(m_csBook);
+	m_mapPointSizes[symbol] = pointSize;
+}
+
+// Takes Balance and margins from the broker and recalculates GrossPL (unrealized)
+// and Equity from the open trades, writing them back to tblAccount.
+void CPositionBook::setAccount(TblAccount* tblAccount)
+{
+	CCriticalSection::Lock lock(m_csBook);
+	m_stAccount = *tblAccount;
+	m_bAccount = true;
+	sumAccount(m_stAccount);
+	m_dbLastEquity = m_stAccount.Equity;
+	*tblAccount = m_stAccount;
+}
+
+void CPositionBook::setTrade(TblTrade* tblTrade)
+{
+	CCriticalSection::Lock lock(m_csBook);
+	PositionTrade& position = m_mapTrades[tblTrade->TradeID];
+	position.Trade = *tblTrade;
+	if (position.Trade.GrossPL == PL_INVALID && revalue(position.Trade)) {
+		tblTrade->PL = position.Trade.PL;
+		tblTrade->GrossPL = position.Trade.GrossPL;
+	}
+	position.LastGrossPL = position.Trade.GrossPL;
+}
+
+// Replaces all trades, trades missing from the list were closed by the broker.
+void CPositionBook::setTrades(vector<TblTrade*>& tblTrades)
+{
+	CCriticalSection::Lock lock(m_csBook);
+	m_mapTrades.clear();
+	for (vector<TblTrade*>::iterator it = tblTrades.begin(); it != tblTrades.end(); it++) {
+		PositionTrade& position = m_mapTrades[(*it)->TradeID];
+		position.Trade = **it;
+		if (position.Trade.GrossPL == PL_INVALID && revalue(position.Trade)) {
+			(*it)->PL = position.Trade.PL;
+			(*it)->GrossPL = position.Trade.GrossPL;
+		}
+		position.LastGrossPL = position.Trade.GrossPL;
+	}
+}
+
+void CPositionBook::setStop(const char* tradeID, double stop, const char* stopOrderID)
+{
+	CCriticalSection::Lock lock(m_csBook);
+	map<string, PositionTrade>::iterator it = m_mapTrades.find(tradeID);
+	if (it != m_mapTrades.end()) {
+		it->second.Trade.Stop = stop;
+		strcpy(it->second.Trade.StopOrderID, stopOrderID);
+	}
+}
+
+void CPositionBook::setLimit(const char* tradeID, double limit, const char* limitOrderID)
+{
+	CCriticalSection::Lock lock(m_csBook);
+	map<string, PositionTrade>::iterator it = m_mapTrades.find(tradeID);
+	if (it != m_mapTrades.end()) {
+		it->second.Trade.Limit = limit;
+		strcpy(it->second.Trade.LimitOrderID, limitOrderID);
+	}
+}
+
+void CPositionBook::closeTrade(const char* tradeID, double grossPL)
+{
+	CCriticalSection::Lock lock(m_csBook);
+	m_mapTrades.erase(tradeID);
+	if (m_bAccount && grossPL != PL_INVALID) {
+		m_stAccount.Balance += grossPL;
+	}
+}
+
+// Revalues the trades of the symbol. Returns the trades whose GrossPL moved by
+// PLThreshold since last reported, and true with tblAccount when Equity moved by EquityThreshold.
+bool CPositionBook::onPrice(const TblPrice* tblPrice, vector<TblTrade>& tblTrades, TblAccount* tblAccount)
+{
+	CCriticalSection::Lock lock(m_csBook);
+	m_mapPrices[tblPrice->Symbol] = *tblPrice;
+	if (m_mapTrades.empty() && !m_bAccount) {
+		return false;
+	}
+
+	for (map<string, PositionTrade>::iterator it = m_mapTrades.begin(); it != m_mapTrades.end(); it++) {
+		PositionTrade& position = it->second;
+		if (strcmp(position.Trade.Symbol, tblPrice->Symbol) != 0 || !revalue(position.Trade)) {
+			continue;
+		}
+		if (position.LastGrossPL == PL_INVALID || fabs(position.Trade.GrossPL - position.LastGrossPL) >= m_dbPLThreshold) {
+			position.LastGrossPL = position.Trade.GrossPL;
+			tblTrades.push_back(position.Trade);
+		}
+	}
+
+	if (!m_bAccount) {
+		return false;
+	}
+	sumAccount(m_stAccount);
+	if (fabs(m_stAccount.Equity - m_dbLastEquity) < m_dbEquityThreshold) {
+		return false;
+	}
+	m_dbLastEquity = m_stAccount.Equity;
+	*tblAccount = m_stAccount;
+	return true;
+}
+
+bool CPositionBook::revalue(TblTrade& tblTrade)
+{
+	const TblPrice* tblPrice = findPrice(tblTrade.Symbol);
+	if (!tblPrice) {
+		return false;
+	}
+
+	bool buy = strcmp(tblTrade.BS, "B") == 0;
+	double diff = buy ? tblPrice->Bid - tblTrade.Open : tblTrade.Open - tblPrice->Ask;
+	double pl = diff / getPointSize(tblTrade.Symbol);
+	double conversion = getConversion(tblTrade.Symbol);
+	if (conversion > 0) {
+		tblTrade.GrossPL = diff * tblTrade.Amount * conversion;
+	}
+	else if (tblPrice->PipCost > 0) {
+		tblTrade.GrossPL = pl * tblPrice->PipCost * tblTrade.Amount / m_dbPipCostAmount;
+	}
+	else {
+		return false;
+	}
+	tblTrade.PL = pl;
+	return true;
+}
+
+void CPositionBook::sumAccount(TblAccount& tblAccount)
+{
+	double grossPL = 0;
+	for (map<string, PositionTrade>::iterator it = m_mapTrades.begin(); it != m_mapTrades.end(); it++) {
+		if (it->second.Trade.GrossPL != PL_INVALID) {
+			grossPL += it->second.Trade.GrossPL;
+		}
+	}
+	tblAccount.GrossPL = grossPL;
+	tblAccount.Equity = tblAccount.Balance + grossPL;
+	tblAccount.UsableMargin = tblAccount.Equity - tblAccount.UsedMargin;
+	if (tblAccount.Equity > 0) {
+		tblAccount.UsableMarginInPercent = tblAccount.UsableMargin / tblAccount.Equity * 100;
+	}
+}
+
+double CPositionBook::getPointSize(const char* symbol)
+{
+	const TblPrice* tblPrice = findPrice(symbol);
+	if (tblPrice && tblPrice->PointSize > 0) {
+		return tblPrice->PointSize;
+	}
+	map<string, double>::iterator it = m_mapPointSizes.find(symbol);
+	if (it != m_mapPointSizes.end() && it->second > 0) {
+		return it->second;
+	}
+	return strstr(symbol, "JPY") ? 0.01 : 0.0001;
+}
+
+// Account currency per unit of the quote currency, 0 if no rate is known.
+double CPositionBook::getConversion(const char* symbol)
+{
+	const char* quote = strchr(symbol, '/');
+	if (!quote || !m_bAccount || strlen(m_stAccount.Currency) == 0) {
+		return 0;
+	}
+	quote++;
+	if (strcmp(quote, m_stAccount.Currency) == 0) {
+		return 1;
+	}
+
+	const TblPrice* tblPrice = findPrice((string(quote) + "/" + m_stAccount.Currency).c_str());
+	if (tblPrice) {
+		return (tblPrice->Bid + tblPrice->Ask) / 2;
+	}
+	tblPrice = findPrice((string(m_stAccount.Currency) + "/" + quote).c_str());
+	if (tblPrice) {
+		return 2 / (tblPrice->Bid + tblPrice->Ask);
+	}
+	return 0;
+}
+
+const TblPrice* CPositionBook::findPrice(const char* symbol)
+{
+	map<string, TblPrice>::iterator it = m_mapPrices.find(symbol);
+	if (it == m_mapPrices.end() || it->second.Bid <= 0 || it->second.Ask <= 0) {
+		return NULL;
+	}
+	return &it->second;
+}
@@ -0,0 +1,52 @@
+#ifndef POSITIONBOOK_H
+#define POSITIONBOOK_H
+
+#include "CriticalSection.h"
+#include "IBaseOrder.h"
+
+#define PL_INVALID DBL_MAX
+
+typedef struct {
+	TblTrade Trade;
+	double LastGrossPL;
+} PositionTrade;
+
+// Local mark-to-market of the open trades and the account.
+// Seeded by the GetOpenedTrades/GetAccount responses and the order fills,
+// then revalued on every price. Changes smaller than the thresholds
+// (in account currency) are not reported.
+class CPositionBook
+{
+private:
+	double m_dbPLThreshold;
+	double m_dbEquityThreshold;
+	double m_dbPipCostAmount;
+	map<string, double> m_mapPointSizes;
+	map<string, TblPrice> m_mapPrices;
+	map<string, PositionTrade> m_mapTrades;
+	TblAccount m_stAccount;
+	bool m_bAccount;
+	double m_dbLastEquity;
+	CCriticalSection m_csBook;
+
+public:
+	CPositionBook(double plThreshold, double equityThreshold, double pipCostAmount);
+
+	void setPointSize(const char* symbol, double pointSize);
+	void setAccount(TblAccount* tblAccount);
+	void setTrade(TblTrade* tblTrade);
+	void setTrades(vector<TblTrade*>& tblTrades);
+	void setStop(const char* tradeID, double stop, const char* stopOrderID);
+	void setLimit(const char* tradeID, double limit, const char* limitOrderID);
+	void closeTrade(const char* tradeID, double grossPL);
+	bool onPrice(const TblPrice* tblPrice, vector<TblTrade>& tblTrades, TblAccount* tblAccount);
+
+private:
+	bool revalue(TblTrade& tblTrade);
+	void sumAccount(TblAccount& tblAccount);
+	double getPointSize(const char* symbol);
+	double getConversion(const char* symbol);
+	const TblPrice* findPrice(const char* symbol);
+};
+
+#endif
@@ -0,0 +1,124 @@
+﻿/*
+* Copyright 2020 FXDaemon
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include "stdafx.h"
+#include "QuoteCache.h"
+
+CQuoteCache::CQuoteCache()
+{
+	for (int i = 0; i < MaxChunks; i++) {
+		m_pChunks[i].store(NULL);
+	}
+}
+
+CQuoteCache::~CQuoteCache()
+{
+	for (int i = 0; i < MaxChunks; i++) {
+		delete[] m_pChunks[i].load();
+	}
+}
+
+void CQuoteCache::update(int id, const TblPrice* tblPrice)
+{
+	CCriticalSection::Lock l(m_csWrite);
+	QuoteSlot* quoteSlot = allocSlot(id);
+	if (quoteSlot) {
+		write(quoteSlot, tblPrice, true);
+	}
+}
+
+bool CQuoteCache::get(int id, TblPrice* tblPrice) const
+{
+	QuoteSlot* quoteSlot = slot(id);
+	if (!quoteSlot) {
+		return false;
+	}
+
+	uint64_t words[QUOTE_WORDS];
+	uint32_t seq, valid;
+	do {
+		seq = quoteSlot->Seq.load(std::memory_order_acquire);
+		valid = quoteSlot->Valid.load(std::memory_order_relaxed);
+		for (size_t i = 0; i < QUOTE_WORDS; i++) {
+			words[i] = quoteSlot->Words[i].load(std::memory_order_relaxed);
+		}
+		std::atomic_thread_fence(std::memory_order_acquire);
+	} while ((seq & 1) || seq != quoteSlot->Seq.load(std::memory_order_relaxed));
+
+	if (!valid) {
+		return false;
+	}
+	memcpy(tblPrice, words, sizeof(TblPrice));
+	return true;
+}
+
+// A symbol no longer polled would otherwise keep answering with its last quote.
+void CQuoteCache::clear(int id)
+{
+	CCriticalSection::Lock l(m_csWrite);
+	QuoteSlot* quoteSlot = slot(id);
+	if (quoteSlot) {
+		write(quoteSlot, NULL, false);
+	}
+}
+
+QuoteSlot* CQuoteCache::slot(int id) const
+{
+	if (id < 0 || id >= ChunkSize * MaxChunks) {
+		return NULL;
+	}
+	QuoteSlot* chunk = m_pChunks[id / ChunkSize].load(std::memory_order_acquire);
+	return chunk ? &chunk[id % ChunkSize] : NULL;
+}
+
+// Called with m_csWrite held.
+QuoteSlot* CQuoteCache::allocSlot(int id)
+{
+	if (id < 0 || id >= ChunkSize * MaxChunks) {
+		return NULL;
+	}
+	QuoteSlot* chunk = m_pChunks[id / ChunkSize].load(std::memory_order_relaxed);
+	if (!chunk) {
+		chunk = new QuoteSlot[ChunkSize];
+		for (int i = 0; i < ChunkSize; i++) {
+			chunk[i].Seq.store(0, std::memory_order_relaxed);
+			chunk[i].Valid.store(0, std::memory_order_relaxed);
+			for (size_t j = 0; j < QUOTE_WORDS; j++) {
+				chunk[i].Words[j].store(0, std::memory_order_relaxed);
+			}
+		}
+		m_pChunks[id / ChunkSize].store(chunk, std::memory_order_release);
+	}
+	return &chunk[id % ChunkSize];
+}
+
+void CQuoteCache::write(QuoteSlot* quoteSlot, const TblPrice* tblPrice, bool valid)
+{
+	uint64_t words[QUOTE_WORDS] = { 0 };
+	if (tblPrice) {
+		memcpy(words, tblPrice, sizeof(TblPrice));
+	}
+
+	uint32_t seq = quoteSlot->Seq.load(std::memory_order_relaxed);
+	quoteSlot->Seq.store(seq + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	quoteSlot->Valid.store(valid ? 1 : 0, std::memory_order_relaxed);
+	if (tblPrice) {
+		for (size_t i = 0; i < QUOTE_WORDS; i++) {
+			quoteSlot->Words[i].store(words[i], std::memory_order_relaxed);
+		}
+	}
+	quoteSlot->Seq.store(seq + 2, std::memory_order_release);
+}
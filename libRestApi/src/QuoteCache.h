@@ -0,0 +1,42 @@
+#ifndef QUOTECACHE_H
+#define QUOTECACHE_H
+
+#include "CriticalSection.h"
+#include "Table.h"
+
+#define QUOTE_WORDS	((sizeof(TblPrice) + sizeof(uint64_t) - 1) / sizeof(uint64_t))
+
+typedef struct {
+	atomic<uint32_t> Seq;	// odd while a write is in progress
+	atomic<uint32_t> Valid;
+	atomic<uint64_t> Words[QUOTE_WORDS];
+} QuoteSlot;
+
+// Latest quote of each symbol, indexed by the IDs of CSymbolRegistry.
+// Each slot is a seqlock: readers copy it and retry if a write overlapped, so
+// getPrice never waits on the poll thread. Slots live in fixed chunks that are
+// never moved or freed before the cache, writers serialize on m_csWrite.
+class CQuoteCache
+{
+private:
+	static const int ChunkSize = 256;
+	static const int MaxChunks = 64;
+
+	atomic<QuoteSlot*> m_pChunks[MaxChunks];
+	CCriticalSection m_csWrite;
+
+public:
+	CQuoteCache();
+	~CQuoteCache();
+
+	void update(int id, const TblPrice* tblPrice);
+	bool get(int id, TblPrice* tblPrice) const;
+	void clear(int id);
+
+private:
+	QuoteSlot* slot(int id) const;
+	QuoteSlot* allocSlot(int id);
+	static void write(QuoteSlot* slot, const TblPrice* tblPrice, bool valid);
+};
+
+#endif
@@ -0,0 +1,109 @@
+﻿/*
+* Copyright 2020 FXDaemon
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include "stdafx.h"
+#include "ReqTemplate.h"
+
+static bool isNameChar(char c)
+{
+	return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+}
+
+// A parameter is '$' followed by the longest run of [A-Za-z0-9_].
+void CReqTemplate::compile(const char* text)
+{
+	m_sText.assign(text);
+	m_vtSegments.clear();
+
+	size_t literal = 0, i = 0;
+	while (i < m_sText.size()) {
+		if (m_sText[i] != '$' || i + 1 >= m_sText.size() || !isNameChar(m_sText[i + 1])) {
+			i++;
+			continue;
+		}
+		size_t end = i + 1;
+		while (end < m_sText.size() && isNameChar(m_sText[end])) {
+			end++;
+		}
+		if (i > literal) {
+			m_vtSegments.push_back(Segment{ literal, i - literal, false });
+		}
+		m_vtSegments.push_back(Segment{ i, end - i, true });
+		literal = i = end;
+	}
+	if (m_sText.size() > literal) {
+		m_vtSegments.push_back(Segment{ literal, m_sText.size() - literal, false });
+	}
+}
+
+const string& CReqTemplate::getText() const
+{
+	return m_sText;
+}
+
+bool CReqTemplate::empty() const
+{
+	return m_sText.empty();
+}
+
+// Appends the template to out, a parameter without a value is kept as written.
+void CReqTemplate::render(const vector<ReqParam>* params, string& out) const
+{
+	for (size_t i = 0; i < m_vtSegments.size(); i++) {
+		const Segment& seg = m_vtSegments[i];
+		const string* value = NULL;
+		if (seg.Param && params) {
+			for (size_t j = 0; j < params->size(); j++) {
+				if (isName((*params)[j].key, seg)) {
+					value = &(*params)[j].value;
+					break;
+				}
+			}
+		}
+		appendSegment(seg, value, out);
+	}
+}
+
+void CReqTemplate::render(const map<string, string>& params, string& out) const
+{
+	for (size_t i = 0; i < m_vtSegments.size(); i++) {
+		const Segment& seg = m_vtSegments[i];
+		const string* value = NULL;
+		if (seg.Param) {
+			for (map<string, string>::const_iterator it = params.begin(); it != params.end(); it++) {
+				if (isName(it->first, seg)) {
+					value = &it->second;
+					break;
+				}
+			}
+		}
+		appendSegment(seg, value, out);
+	}
+}
+
+bool CReqTemplate::isName(const string& key, const Segment& seg) const
+{
+	return key.size() == seg.Length && m_sText.compare(seg.Offset, seg.Length, key) == 0;
+}
+
+void CReqTemplate::appendSegment(const Segment& seg, const string* value, string& out) const
+{
+	if (value) {
+		out.append(*value);
+	}
+	else {
+		out.append(m_sText, seg.Offset, seg.Length);
+	}
+}
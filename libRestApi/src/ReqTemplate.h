@@ -0,0 +1,35 @@
+#ifndef REQTEMPLATE_H
+#define REQTEMPLATE_H
+
+typedef struct {
+	string key;
+	string value;
+} ReqParam;
+
+// A Path/Request template split once into literals and $parameters,
+// so a request is rendered in a single pass over the segments.
+class CReqTemplate
+{
+private:
+	typedef struct {
+		size_t Offset;
+		size_t Length;
+		bool Param;
+	} Segment;
+
+	string m_sText;
+	vector<Segment> m_vtSegments;
+
+public:
+	void compile(const char* text);
+	const string& getText() const;
+	bool empty() const;
+	void render(const vector<ReqParam>* params, string& out) const;
+	void render(const map<string, string>& params, string& out) const;
+
+private:
+	bool isName(const string& key, const Segment& seg) const;
+	void appendSegment(const Segment& seg, const string* value, string& out) const;
+};
+
+#endif
@@ -0,0 +1,169 @@
+﻿/*
+* Copyright 2020 FXDaemon
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include "stdafx.h"
+#include "SimpleIni.h"
+#include "IBaseOrder.h"
+#include "Utils.h"
+#ifdef WIN32
+#include <sys/types.h>
+#include <sys/stat.h>
+#endif
+#include "RestConfig.h"
+
+atomic<bool> CRestConfig::m_bSignaled(false);
+
+CRestConfig::CRestConfig()
+{
+	m_pSettings.store(NULL);
+	m_tmModified = 0;
+}
+
+CRestConfig::~CRestConfig()
+{
+	release();
+}
+
+int CRestConfig::load(const char* iniFile)
+{
+	CCriticalSection::Lock l(m_csReload);
+	m_sIniFile = iniFile;
+	m_tmModified = modifiedTime(iniFile);
+	RestSettings* settings = parse(iniFile);
+	if (!settings) {
+		return RET_FAILED;
+	}
+	RestSettings* old = m_pSettings.exchange(settings, memory_order_acq_rel);
+	if (old) {
+		m_vtRetired.push_back(old);
+	}
+	return RET_SUCCESS;
+}
+
+// On a parse error the current snapshot stays in place. AccountID and Host are
+// bound into the path parameters and handles at init, so a file that changes
+// them is rejected as well until the plugin is restarted.
+int CRestConfig::reload(string& error)
+{
+	CCriticalSection::Lock l(m_csReload);
+	m_bSignaled.store(false);
+	m_tmModified = modifiedTime(m_sIniFile.c_str());
+	RestSettings* settings = parse(m_sIniFile.c_str());
+	if (!settings) {
+		error = "Config file open failed";
+		return RET_FAILED;
+	}
+	const RestSettings* current = m_pSettings.load(memory_order_acquire);
+	if (settings->AccountID != current->AccountID || settings->Host != current->Host) {
+		error = "AccountID and Host can't change without a restart";
+		delete settings;
+		return RET_FAILED;
+	}
+	m_vtRetired.push_back(m_pSettings.exchange(settings, memory_order_acq_rel));
+	return RET_SUCCESS;
+}
+
+bool CRestConfig::changed()
+{
+	CCriticalSection::Lock l(m_csReload);
+	if (m_bSignaled.load()) {
+		return true;
+	}
+	time_t modified = modifiedTime(m_sIniFile.c_str());
+	return modified != 0 && modified != m_tmModified;
+}
+
+// SIGHUP requests a reload, unless the host already handles it.
+void CRestConfig::catchSignal()
+{
+#ifndef WIN32
+	struct sigaction sa;
+	if (sigaction(SIGHUP, NULL, &sa) == 0 && sa.sa_handler == SIG_DFL) {
+		memset(&sa, 0, sizeof(sa));
+		sa.sa_handler = onSignal;
+		sigemptyset(&sa.sa_mask);
+		sigaction(SIGHUP, &sa, NULL);
+	}
+#endif
+}
+
+void CRestConfig::release()
+{
+	CCriticalSection::Lock l(m_csReload);
+	delete m_pSettings.exchange(NULL);
+	for (size_t i = 0; i < m_vtRetired.size(); i++) {
+		delete m_vtRetired[i];
+	}
+	m_vtRetired.clear();
+}
+
+RestSettings* CRestConfig::parse(const char* iniFile)
+{
+	RestSettings* settings = new RestSettings();
+	CSimpleIniCaseA& ini = settings->Ini;
+	ini.SetUnicode();
+	if (ini.LoadFile(iniFile) < 0) {
+		delete settings;
+		return NULL;
+	}
+
+	settings->AccountID = ini.GetValue("Base", "AccountID", "");
+	settings->Broker = ini.GetValue("Base", "Broker", "");
+	settings->Host = ini.GetValue("Base", "Host", "");
+	settings->SslVerify = strcmp(ini.GetValue("Base", "SslVerify", ""), "true") == 0;
+	settings->ConnectTimeout = atol(ini.GetValue("Base", "ConnectTimeout", "0"));
+	settings->Timeout = atol(ini.GetValue("Base", "Timeout", "0"));
+	settings->OrderTimeout = atol(ini.GetValue("Base", "OrderTimeout", "0"));
+	settings->AdjustmentTimezone = atoi(ini.GetValue("Base", "AdjustmentTimezone", "0")) * 3600;
+	settings->RFC3339 = strcmp(ini.GetValue("Base", "TimeFormat", ""), "RFC3339") == 0;
+	settings->ReloadInterval = atol(ini.GetValue("Base", "ReloadInterval", "0"));
+	settings->SignalReload = atoi(ini.GetValue("Base", "SignalReload", "0")) != 0;
+	settings->StatsInterval = atol(ini.GetValue("Base", "StatsInterval", "0"));
+	settings->Combination = ini.GetValue("Symbol", "Combination", "");
+	settings->Delimiter = ini.GetValue("Symbol", "Delimiter", "");
+	settings->Symbols = ini.GetValue("Symbol", "Symbols", "");
+	settings->BuySide = ini.GetValue("Side", "B", "");
+	settings->ErrorMessage = ini.GetValue("Error", "Message", "");
+	settings->AccountRefresh = atol(ini.GetValue("GetAccount", "Refresh", "0"));
+	settings->PriceRefresh = atol(ini.GetValue("GetPrice", "Refresh", "0"));
+	settings->OpenedTradesRefresh = atol(ini.GetValue("GetOpenedTrades", "Refresh", "0"));
+	settings->ClosedTradesRefresh = atol(ini.GetValue("GetClosedTrades", "Refresh", "0"));
+
+	CSimpleIniCaseA::TNamesDepend keys;
+	ini.GetAllKeys("Period", keys);
+	for (CSimpleIniCaseA::TNamesDepend::iterator it = keys.begin(); it != keys.end(); it++) {
+		settings->Periods[it->pItem] = ini.GetValue("Period", it->pItem, "");
+	}
+	keys.clear();
+	ini.GetAllKeys("Header", keys);
+	for (CSimpleIniCaseA::TNamesDepend::iterator it = keys.begin(); it != keys.end(); it++) {
+		settings->Headers.push_back(ini.GetValue("Header", it->pItem, ""));
+	}
+	return settings;
+}
+
+time_t CRestConfig::modifiedTime(const char* file)
+{
+	struct stat st;
+	if (stat(file, &st) != 0) {
+		return 0;
+	}
+	return st.st_mtime;
+}
+
+void CRestConfig::onSignal(int /*sig*/)
+{
+	m_bSignaled.store(true);
+}
@@ -0,0 +1,67 @@
+#ifndef RESTCONFIG_H
+#define RESTCONFIG_H
+
+#include "CriticalSection.h"
+
+// Values of the config file used on every request, parsed once per load.
+// Ini keeps the whole file for values read only when a handle is created.
+typedef struct {
+	CSimpleIniCaseA Ini;
+	string AccountID;
+	string Broker;
+	string Host;
+	bool SslVerify;
+	long ConnectTimeout;
+	long Timeout;
+	long OrderTimeout;
+	int AdjustmentTimezone;		// seconds
+	bool RFC3339;
+	string Combination;
+	string Delimiter;
+	string Symbols;			// interned at login
+	string BuySide;
+	string ErrorMessage;
+	long AccountRefresh;
+	long PriceRefresh;
+	long OpenedTradesRefresh;
+	long ClosedTradesRefresh;
+	long ReloadInterval;		// milliseconds, 0 = no reload
+	bool SignalReload;			// SIGHUP forces a reload, off by default
+	long StatsInterval;			// milliseconds, 0 = no latency summary
+	map<string, string> Periods;
+	vector<const char*> Headers;
+} RestSettings;
+
+// Publishes the settings as an immutable snapshot behind an atomic pointer.
+// Readers load the pointer and never lock; a reload parses a new snapshot and
+// swaps it in. Readers hold a snapshot across whole requests and keep strings
+// from its Ini, so replaced snapshots are kept until release(). Reloads only
+// happen on file edits or SIGHUP, which bounds what is kept.
+class CRestConfig
+{
+private:
+	atomic<RestSettings*> m_pSettings;
+	vector<RestSettings*> m_vtRetired;
+	CCriticalSection m_csReload;
+	string m_sIniFile;
+	time_t m_tmModified;
+	static atomic<bool> m_bSignaled;
+
+public:
+	CRestConfig();
+	~CRestConfig();
+
+	int load(const char* iniFile);
+	int reload(string& error);
+	bool changed();
+	void catchSignal();
+	void release();
+	const RestSettings* get() const { return m_pSettings.load(memory_order_acquire); }
+
+private:
+	static RestSettings* parse(const char* iniFile);
+	static time_t modifiedTime(const char* file);
+	static void onSignal(int sig);
+};
+
+#endif
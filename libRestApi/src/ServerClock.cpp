@@ -0,0 +1,134 @@
+﻿/*
+* Copyright 2020 FXDaemon
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include "stdafx.h"
+#include "Utils.h"
+#include "ServerClock.h"
+
+static const size_t WindowSize = 900;
+static const int64_t MinDriftSpanNs = 300 * 1000000000LL;
+static const int64_t MaxDriftPpb = 200000;	// 200 ppm
+
+CServerClock::CServerClock()
+{
+	m_nSeq.store(0);
+	m_bSynced.store(false);
+	publish(CUtils::getMonotonicNs(), CUtils::getRealtimeNs() - CUtils::getMonotonicNs(), 0);
+}
+
+// sendNs/recvNs are monotonic, serverNs is the server time truncated to resolutionNs.
+void CServerClock::addSample(int64_t sendNs, int64_t recvNs, int64_t serverNs, int64_t resolutionNs)
+{
+	if (recvNs < sendNs || serverNs <= 0) {
+		return;
+	}
+
+	CCriticalSection::Lock l(m_csSamples);
+	ClockSample sample = { recvNs, serverNs - recvNs, serverNs + resolutionNs - sendNs };
+
+	// No common offset with the previous sample, the server or the local clock was stepped.
+	if (!m_deqSamples.empty()) {
+		const ClockSample& last = m_deqSamples.back();
+		int64_t shift = (recvNs - last.LocalNs) / 1000 * m_nDriftPpb.load() / 1000000;
+		if (sample.LowNs > last.HighNs + shift || sample.HighNs < last.LowNs + shift) {
+			m_deqSamples.clear();
+		}
+	}
+	m_deqSamples.push_back(sample);
+	if (m_deqSamples.size() > WindowSize) {
+		m_deqSamples.pop_front();
+	}
+
+	// The whole window feeds the drift, the bounds are intersected from the newest
+	// sample back while they still overlap. Older samples fall out of the bounds
+	// when the drift is not known yet, but stay in the window to estimate it.
+	int64_t driftPpb = estimateDrift();
+	int64_t lowNs = INT64_MIN, highNs = INT64_MAX;
+	for (size_t i = m_deqSamples.size(); i-- > 0;) {
+		const ClockSample& s = m_deqSamples[i];
+		int64_t shift = (recvNs - s.LocalNs) / 1000 * driftPpb / 1000000;
+		int64_t low = max(lowNs, s.LowNs + shift);
+		int64_t high = min(highNs, s.HighNs + shift);
+		if (low > high) {
+			break;
+		}
+		lowNs = low;
+		highNs = high;
+	}
+
+	publish(recvNs, lowNs + (highNs - lowNs) / 2, driftPpb);
+	m_bSynced.store(true);
+}
+
+int64_t CServerClock::nowNs() const
+{
+	int64_t localNs = CUtils::getMonotonicNs();
+	uint32_t seq;
+	int64_t baseNs, offsetNs, driftPpb;
+	do {
+		seq = m_nSeq.load(std::memory_order_acquire);
+		baseNs = m_nBaseNs.load(std::memory_order_relaxed);
+		offsetNs = m_nOffsetNs.load(std::memory_order_relaxed);
+		driftPpb = m_nDriftPpb.load(std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_acquire);
+	} while ((seq & 1) || seq != m_nSeq.load(std::memory_order_relaxed));
+
+	return localNs + offsetNs + (localNs - baseNs) / 1000 * driftPpb / 1000000;
+}
+
+bool CServerClock::isSynced() const
+{
+	return m_bSynced.load();
+}
+
+// Least squares slope of the sample midpoints, once the window spans long enough
+// for the resolution of the server time to average out.
+int64_t CServerClock::estimateDrift() const
+{
+	size_t n = m_deqSamples.size();
+	if (n < 2 || m_deqSamples.back().LocalNs - m_deqSamples.front().LocalNs < MinDriftSpanNs) {
+		return 0;
+	}
+
+	const ClockSample& first = m_deqSamples.front();
+	double firstMid = (double)first.LowNs + (double)(first.HighNs - first.LowNs) / 2;
+	double sx = 0, sy = 0, sxx = 0, sxy = 0;
+	for (size_t i = 0; i < n; i++) {
+		const ClockSample& s = m_deqSamples[i];
+		double x = (double)(s.LocalNs - first.LocalNs);
+		double y = (double)s.LowNs + (double)(s.HighNs - s.LowNs) / 2 - firstMid;
+		sx += x;
+		sy += y;
+		sxx += x * x;
+		sxy += x * y;
+	}
+	double d = n * sxx - sx * sx;
+	if (d <= 0) {
+		return 0;
+	}
+	int64_t driftPpb = (int64_t)((n * sxy - sx * sy) / d * 1e9);
+	return max(-MaxDriftPpb, min(MaxDriftPpb, driftPpb));
+}
+
+void CServerClock::publish(int64_t baseNs, int64_t offsetNs, int64_t driftPpb)
+{
+	uint32_t seq = m_nSeq.load(std::memory_order_relaxed);
+	m_nSeq.store(seq + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+	m_nBaseNs.store(baseNs, std::memory_order_relaxed);
+	m_nOffsetNs.store(offsetNs, std::memory_order_relaxed);
+	m_nDriftPpb.store(driftPpb, std::memory_order_relaxed);
+	m_nSeq.store(seq + 2, std::memory_order_release);
+}
@@ -0,0 +1,41 @@
+#ifndef SERVERCLOCK_H
+#define SERVERCLOCK_H
+
+#include "CriticalSection.h"
+
+typedef struct {
+	int64_t LocalNs;	// monotonic time the server time was read
+	int64_t LowNs;		// bounds of server minus monotonic time
+	int64_t HighNs;
+} ClockSample;
+
+// Server time as the monotonic clock plus an offset (and drift) estimated from
+// request samples. A sample bounds the offset by its send and receive times and the
+// resolution of the server time; the bounds of the latest samples that still agree
+// are intersected NTP-style.
+// Readers go through a seqlock and never block. Until the first sample the local
+// wall clock is returned.
+class CServerClock
+{
+private:
+	deque<ClockSample> m_deqSamples;
+	CCriticalSection m_csSamples;
+	atomic<uint32_t> m_nSeq;
+	atomic<int64_t> m_nBaseNs;
+	atomic<int64_t> m_nOffsetNs;
+	atomic<int64_t> m_nDriftPpb;
+	atomic<bool> m_bSynced;
+
+public:
+	CServerClock();
+
+	void addSample(int64_t sendNs, int64_t recvNs, int64_t serverNs, int64_t resolutionNs);
+	int64_t nowNs() const;
+	bool isSynced() const;
+
+private:
+	int64_t estimateDrift() const;
+	void publish(int64_t baseNs, int64_t offsetNs, int64_t driftPpb);
+};
+
+#endif
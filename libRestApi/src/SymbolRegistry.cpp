@@ -0,0 +1,216 @@
+﻿/*
+* Copyright 2020 FXDaemon
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include "stdafx.h"
+#include "SymbolRegistry.h"
+
+CSymbolRegistry::CSymbolRegistry()
+{
+	SymbolTable* table = new SymbolTable();
+	table->Combination = "/";
+	m_pTable.store(table);
+}
+
+CSymbolRegistry::~CSymbolRegistry()
+{
+	delete m_pTable.load();
+	for (size_t i = 0; i < m_vtRetired.size(); i++) {
+		delete m_vtRetired[i];
+	}
+}
+
+// Respells every broker symbol, the IDs stay the same.
+void CSymbolRegistry::setCombination(const char* combination)
+{
+	CCriticalSection::Lock l(m_csTable);
+	const SymbolTable* current = m_pTable.load(memory_order_acquire);
+	if (current->Combination == combination) {
+		return;
+	}
+	SymbolTable* table = new SymbolTable(*current);
+	table->Combination = combination;
+	for (size_t i = 0; i < table->Entries.size(); i++) {
+		table->Entries[i].BrokerSymbol = toBroker(table->Entries[i].Symbol, table->Combination);
+	}
+	sortTable(table);
+	publish(table);
+}
+
+// symbols: "EUR/USD,USD/JPY,...", returns the number of symbols interned.
+int CSymbolRegistry::addSymbols(const char* symbols)
+{
+	int count = 0;
+	const char* p = symbols;
+	while (*p) {
+		const char* e = strchr(p, ',');
+		string s = e ? string(p, e - p) : string(p);
+		size_t first = s.find_first_not_of(" \t");
+		if (first != string::npos) {
+			s = s.substr(first, s.find_last_not_of(" \t") - first + 1);
+			if (intern(s.c_str()) != SYMBOL_INVALID) {
+				count++;
+			}
+		}
+		if (!e) {
+			break;
+		}
+		p = e + 1;
+	}
+	return count;
+}
+
+int CSymbolRegistry::intern(const char* symbol)
+{
+	int id = find(symbol);
+	if (id != SYMBOL_INVALID || !*symbol) {
+		return id;
+	}
+	CCriticalSection::Lock l(m_csTable);
+	const SymbolTable* table = m_pTable.load(memory_order_acquire);
+	return add(symbol, toBroker(symbol, table->Combination));
+}
+
+int CSymbolRegistry::internBroker(const char* brokerSymbol)
+{
+	int id = findBroker(brokerSymbol);
+	if (id != SYMBOL_INVALID || !*brokerSymbol) {
+		return id;
+	}
+	CCriticalSection::Lock l(m_csTable);
+	const SymbolTable* table = m_pTable.load(memory_order_acquire);
+	return add(toSymbol(brokerSymbol, table->Combination), brokerSymbol);
+}
+
+int CSymbolRegistry::find(const char* symbol) const
+{
+	const SymbolTable* table = m_pTable.load(memory_order_acquire);
+	return search(table, table->BySymbol, false, symbol);
+}
+
+int CSymbolRegistry::findBroker(const char* brokerSymbol) const
+{
+	const SymbolTable* table = m_pTable.load(memory_order_acquire);
+	return search(table, table->ByBroker, true, brokerSymbol);
+}
+
+const char* CSymbolRegistry::symbol(int id) const
+{
+	const SymbolTable* table = m_pTable.load(memory_order_acquire);
+	if (id < 0 || id >= (int)table->Entries.size()) {
+		return "";
+	}
+	return table->Entries[id].Symbol.c_str();
+}
+
+const char* CSymbolRegistry::brokerSymbol(int id) const
+{
+	const SymbolTable* table = m_pTable.load(memory_order_acquire);
+	if (id < 0 || id >= (int)table->Entries.size()) {
+		return "";
+	}
+	return table->Entries[id].BrokerSymbol.c_str();
+}
+
+int CSymbolRegistry::size() const
+{
+	return (int)m_pTable.load(memory_order_acquire)->Entries.size();
+}
+
+// Called with m_csTable held. Another thread may have added the symbol meanwhile.
+int CSymbolRegistry::add(const string& symbol, const string& brokerSymbol)
+{
+	const SymbolTable* current = m_pTable.load(memory_order_acquire);
+	int id = search(current, current->BySymbol, false, symbol.c_str());
+	if (id != SYMBOL_INVALID) {
+		return id;
+	}
+
+	SymbolTable* table = new SymbolTable(*current);
+	SymbolEntry entry = { symbol, brokerSymbol };
+	table->Entries.push_back(entry);
+	sortTable(table);
+	publish(table);
+	return (int)table->Entries.size() - 1;
+}
+
+void CSymbolRegistry::publish(SymbolTable* table)
+{
+	m_vtRetired.push_back(m_pTable.exchange(table, memory_order_acq_rel));
+}
+
+void CSymbolRegistry::sortTable(SymbolTable* table)
+{
+	vector<pair<string, int> > symbols, brokerSymbols;
+	for (size_t i = 0; i < table->Entries.size(); i++) {
+		symbols.push_back(make_pair(table->Entries[i].Symbol, (int)i));
+		brokerSymbols.push_back(make_pair(table->Entries[i].BrokerSymbol, (int)i));
+	}
+	sort(symbols.begin(), symbols.end());
+	sort(brokerSymbols.begin(), brokerSymbols.end());
+
+	table->BySymbol.clear();
+	table->ByBroker.clear();
+	for (size_t i = 0; i < symbols.size(); i++) {
+		table->BySymbol.push_back(symbols[i].second);
+		table->ByBroker.push_back(brokerSymbols[i].second);
+	}
+}
+
+int CSymbolRegistry::search(const SymbolTable* table, const vector<int>& index, bool broker, const char* key)
+{
+	int lo = 0, hi = (int)index.size() - 1;
+	while (lo <= hi) {
+		int mid = (lo + hi) / 2;
+		const SymbolEntry& entry = table->Entries[index[mid]];
+		int cmp = strcmp(broker ? entry.BrokerSymbol.c_str() : entry.Symbol.c_str(), key);
+		if (cmp == 0) {
+			return index[mid];
+		}
+		if (cmp < 0) {
+			lo = mid + 1;
+		}
+		else {
+			hi = mid - 1;
+		}
+	}
+	return SYMBOL_INVALID;
+}
+
+string CSymbolRegistry::toBroker(const string& symbol, const string& combination)
+{
+	string s;
+	s.reserve(symbol.size() + combination.size());
+	for (size_t i = 0; i < symbol.size(); i++) {
+		if (symbol[i] == '/') {
+			s.append(combination);
+		}
+		else {
+			s.append(1, symbol[i]);
+		}
+	}
+	return s;
+}
+
+string CSymbolRegistry::toSymbol(const string& brokerSymbol, const string& combination)
+{
+	if (combination.empty()) {
+		return brokerSymbol;
+	}
+	string s = brokerSymbol;
+	for (size_t pos = s.find(combination); pos != string::npos; pos = s.find(combination, pos + 1)) {
+		s.replace(pos, combination.size(), "/");
+	}
+	return s;
+}
@@ -0,0 +1,55 @@
+#ifndef SYMBOLREGISTRY_H
+#define SYMBOLREGISTRY_H
+
+#include "CriticalSection.h"
+
+#define SYMBOL_INVALID	-1
+
+typedef struct {
+	string Symbol;			// EUR/USD
+	string BrokerSymbol;	// EUR_USD
+} SymbolEntry;
+
+// Interns symbols to dense IDs (0, 1, 2, ...) with both spellings precomputed, so
+// per-symbol state can live in arrays indexed by ID. Lookups binary search sorted
+// tables behind an atomic pointer and never lock; a new symbol copies the tables
+// under a lock and publishes them. Replaced tables are freed with the registry,
+// which keeps the returned strings valid. IDs never change once given.
+class CSymbolRegistry
+{
+private:
+	typedef struct {
+		string Combination;
+		vector<SymbolEntry> Entries;	// by ID
+		vector<int> BySymbol;			// IDs sorted by Symbol
+		vector<int> ByBroker;			// IDs sorted by BrokerSymbol
+	} SymbolTable;
+
+	atomic<SymbolTable*> m_pTable;
+	vector<SymbolTable*> m_vtRetired;
+	CCriticalSection m_csTable;
+
+public:
+	CSymbolRegistry();
+	~CSymbolRegistry();
+
+	void setCombination(const char* combination);
+	int addSymbols(const char* symbols);
+	int intern(const char* symbol);
+	int internBroker(const char* brokerSymbol);
+	int find(const char* symbol) const;
+	int findBroker(const char* brokerSymbol) const;
+	const char* symbol(int id) const;
+	const char* brokerSymbol(int id) const;
+	int size() const;
+
+private:
+	int add(const string& symbol, const string& brokerSymbol);
+	void publish(SymbolTable* table);
+	static void sortTable(SymbolTable* table);
+	static int search(const SymbolTable* table, const vector<int>& index, bool broker, const char* key);
+	static string toBroker(const string& symbol, const string& combination);
+	static string toSymbol(const string& brokerSymbol, const string& combination);
+};
+
+#endif
@@ -48,22 +48,14 @@ time_t CUtils::getUTCTime(tm* t)
 	return mktime(t) - getTimeZone();
 }
 
-time_t CUtils::overDayoff(time_t start, int marketOpenWday, int marketOpenHour, int marketCloseWday, int marketCloseHour)
+int64_t CUtils::getMonotonicNs()
 {
-	time_t next = start;
-	tm dtStart = getUTCCal(next);
-	while ((dtStart.tm_wday == marketCloseWday && dtStart.tm_hour > marketCloseHour) ||
-		dtStart.tm_wday == 0 ||
-		(dtStart.tm_wday == marketOpenWday && dtStart.tm_hour < marketOpenHour)) {
-		next += 60;
-		dtStart = getUTCCal(next);
-	}
-
-	if (next == start) {
-		next += 3600;	// 1 hour
-	}
+	return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
 
-	return next;
+int64_t CUtils::getRealtimeNs()
+{
+	return chrono::duration_cast<chrono::nanoseconds>(chrono::system_clock::now().time_since_epoch()).count();
 }
 
 string CUtils::strOfTime(tm* t, const char* format)
@@ -87,6 +79,11 @@ string CUtils::strOfTimeWithRFC3339(time_t t)
 
 time_t CUtils::str2Time(const char* s)
 {
+	int64_t ns;
+	if (parseRFC3339Ns(s, &ns)) {
+		return (time_t)(ns / 1000000000);
+	}
+
 	struct tm tmCal;
 	memset(&tmCal, 0, sizeof(tmCal));
 
@@ -115,6 +112,83 @@ time_t CUtils::str2Time(const char* s)
 	return t;
 }
 
+// Nanoseconds since the epoch, 0 on a malformed string.
+int64_t CUtils::str2TimeNs(const char* s)
+{
+	int64_t ns;
+	if (parseRFC3339Ns(s, &ns)) {
+		return ns;
+	}
+	return (int64_t)str2Time(s) * 1000000000;
+}
+
+static inline bool digits(const char* s, int n, int* val)
+{
+	int v = 0;
+	for (int i = 0; i < n; i++) {
+		unsigned d = (unsigned)(s[i] - '0');
+		if (d > 9) {
+			return false;
+		}
+		v = v * 10 + d;
+	}
+	*val = v;
+	return true;
+}
+
+// format: "2016-12-27T13:25:49.123456789Z", the separator may also be a blank,
+// the fraction (up to 9 digits) and the Z are optional. No libc time zone calls.
+bool CUtils::parseRFC3339Ns(const char* s, int64_t* ns)
+{
+	int year, mon, mday, hour, min, sec;
+	if (!digits(s, 4, &year) || s[4] != '-' || !digits(s + 5, 2, &mon) || s[7] != '-' || !digits(s + 8, 2, &mday)
+		|| (s[10] != 'T' && s[10] != ' ') || !digits(s + 11, 2, &hour) || s[13] != ':' || !digits(s + 14, 2, &min)
+		|| s[16] != ':' || !digits(s + 17, 2, &sec)) {
+		return false;
+	}
+	if (mon < 1 || mon > 12 || mday < 1 || mday > 31 || hour > 23 || min > 59 || sec > 60) {
+		return false;
+	}
+
+	const char* p = s + 19;
+	int64_t frac = 0;
+	if (*p == '.') {
+		static const int64_t scale[] = { 1, 100000000, 10000000, 1000000, 100000, 10000, 1000, 100, 10, 1 };
+		int n = 0;
+		for (p++; (unsigned)(*p - '0') <= 9; p++) {
+			if (n < 9) {
+				frac = frac * 10 + (*p - '0');
+				n++;
+			}
+		}
+		if (n == 0) {
+			return false;
+		}
+		frac *= scale[n];
+	}
+	if (*p == 'Z') {
+		p++;
+	}
+	if (*p != 0) {
+		return false;
+	}
+
+	int64_t secs = daysFromCivil(year, mon, mday) * 86400 + hour * 3600 + min * 60 + sec;
+	*ns = secs * 1000000000 + frac;
+	return true;
+}
+
+// Days since 1970-01-01 of a proleptic Gregorian date (H. Hinnant's days_from_civil).
+int64_t CUtils::daysFromCivil(int y, int m, int d)
+{
+	y -= m <= 2;
+	int64_t era = (y >= 0 ? y : y - 399) / 400;
+	int yoe = (int)(y - era * 400);
+	int doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+	int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+	return era * 146097 + doe - 719468;
+}
+
 // format: "Date: Tue, 27 Dec 2016 13:25:49 GMT"
 time_t CUtils::HStr2Time(const char* s)
 {
@@ -133,7 +207,6 @@ time_t CUtils::HStr2Time(const char* s)
 		&tmCal.tm_hour, &tmCal.tm_min, &tmCal.tm_sec) != 7) {
 		return 0;
 	}
-	tmCal.tm_year -= 1900;
 	for (unsigned int i = 0; i < sizeof(MONTHS) / sizeof(MONTHS[0]); i++) {
 		if (strcmp(MONTHS[i], s2) == 0) {
 			tmCal.tm_mon = i;
@@ -141,9 +214,9 @@ time_t CUtils::HStr2Time(const char* s)
 		}
 	}
 
-	time_t t = mktime(&tmCal);
-	t -= getTimeZone();
-	return t;
+	// The Date header is always GMT.
+	return (time_t)(daysFromCivil(tmCal.tm_year, tmCal.tm_mon + 1, tmCal.tm_mday) * 86400
+		+ tmCal.tm_hour * 3600 + tmCal.tm_min * 60 + tmCal.tm_sec);
 }
 
 time_t CUtils::getWeekFirstDate()
@@ -5,12 +5,15 @@
 #include <stdlib.h>
 #include <time.h>
 #include <cfloat>
+#include <cmath>
 #include <string>
 #include <vector>
 #include <queue>
 #include <set>
 #include <map>
 #include <atomic>
+#include <chrono>
+#include <algorithm>
 using namespace std;
 
 #ifdef WIN32
@@ -65,6 +68,7 @@ typedef const WCHAR         *LPCWCH, *PCWCH, *LPCWSTR, *PCWSTR;
 
 #include <signal.h>
 #include <unistd.h>
+#include <pthread.h>
 #include <string.h>
 #include <dirent.h>
 #include <stdint.h>
@@ -73,6 +77,9 @@ typedef const WCHAR         *LPCWCH, *PCWCH, *LPCWSTR, *PCWSTR;
 #include <errno.h>
 #include <sys/time.h>
 #include <sys/timeb.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
 #include "WinEvent.h"
 
 #endif
@@ -0,0 +1,166 @@
+﻿/*
+* Copyright 2020 FXDaemon
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include "stdafx.h"
+#include "DepthBook.h"
+#include "ForexMocks.h"
+#include "Test.h"
+
+// 2024-01-10 12:00:00 UTC
+static const DATE Jan10 = 45301.5;
+static const time_t Jan10Time = 1704888000;
+
+TEST(DepthInsertLevel)
+{
+	double rates[DEPTH_MAX], amounts[DEPTH_MAX];
+	int levels = 0;
+	CDepthBook::insertLevel(rates, amounts, levels, 1.1002, 1, true);
+	CDepthBook::insertLevel(rates, amounts, levels, 1.1004, 2, true);
+	CDepthBook::insertLevel(rates, amounts, levels, 1.1003, 3, true);
+	CDepthBook::insertLevel(rates, amounts, levels, 1.1004, 4, true);
+	CHECK(levels == 3);
+	CHECK(rates[0] == 1.1004 && amounts[0] == 6);
+	CHECK(rates[1] == 1.1003 && amounts[1] == 3);
+	CHECK(rates[2] == 1.1002 && amounts[2] == 1);
+
+	// Full: a worse rate is dropped, a better one pushes the worst out.
+	levels = 0;
+	for (int i = 0; i < DEPTH_MAX; i++) {
+		CDepthBook::insertLevel(rates, amounts, levels, 1.2000 + i * 0.0001, 1, false);
+	}
+	CDepthBook::insertLevel(rates, amounts, levels, 1.3000, 1, false);
+	CHECK(levels == DEPTH_MAX);
+	CHECK(rates[DEPTH_MAX - 1] == 1.2000 + (DEPTH_MAX - 1) * 0.0001);
+	CDepthBook::insertLevel(rates, amounts, levels, 1.1999, 5, false);
+	CHECK(levels == DEPTH_MAX);
+	CHECK(rates[0] == 1.1999 && amounts[0] == 5);
+	CHECK(rates[DEPTH_MAX - 1] == 1.2000 + (DEPTH_MAX - 2) * 0.0001);
+}
+
+TEST(DepthMergeLevels)
+{
+	double rates[3][DEPTH_MAX], amounts[3][DEPTH_MAX];
+	int levels[3] = { 0, 0, 0 };
+	CDepthBook::insertLevel(rates[0], amounts[0], levels[0], 1.1004, 1, true);
+	CDepthBook::insertLevel(rates[0], amounts[0], levels[0], 1.1002, 1, true);
+	CDepthBook::insertLevel(rates[1], amounts[1], levels[1], 1.1003, 2, true);
+	CDepthBook::insertLevel(rates[1], amounts[1], levels[1], 1.1002, 2, true);
+	CDepthBook::insertLevel(rates[2], amounts[2], levels[2], 1.1004, 4, true);
+
+	double outRates[DEPTH_MAX], outAmounts[DEPTH_MAX];
+	int count = CDepthBook::mergeLevels(rates, amounts, levels, 3, outRates, outAmounts, true);
+	CHECK(count == 3);
+	CHECK(outRates[0] == 1.1004 && outAmounts[0] == 5);
+	CHECK(outRates[1] == 1.1003 && outAmounts[1] == 2);
+	CHECK(outRates[2] == 1.1002 && outAmounts[2] == 3);
+
+	// Only the best DEPTH_MAX rates of all ladders are kept.
+	levels[0] = levels[1] = 0;
+	for (int i = 0; i < DEPTH_MAX; i++) {
+		CDepthBook::insertLevel(rates[0], amounts[0], levels[0], 1.2000 + i * 0.0002, 1, false);
+		CDepthBook::insertLevel(rates[1], amounts[1], levels[1], 1.2001 + i * 0.0002, 1, false);
+	}
+	count = CDepthBook::mergeLevels(rates, amounts, levels, 2, outRates, outAmounts, false);
+	CHECK(count == DEPTH_MAX);
+	for (int i = 0; i < DEPTH_MAX; i++) {
+		CHECK_NEAR(outRates[i], 1.2000 + i * 0.0001, 1e-9);
+	}
+	CHECK(CDepthBook::mergeLevels(rates, amounts, levels, 0, outRates, outAmounts, false) == 0);
+}
+
+// An update replaces the ladders of the originators it names and keeps the others.
+TEST(DepthBookOriginators)
+{
+	CDepthBook book;
+	CHECK(book.empty());
+	book.addSymbol(1, "EUR/USD");
+	CHECK(!book.empty());
+
+	CMockLevel2Reader first;
+	first.addQuote(1, Jan10);
+	first.addPrice(true, 1.1000, 1, "A");
+	first.addPrice(true, 1.0999, 2, "A");
+	first.addPrice(false, 1.1002, 1, "A");
+	first.addPrice(true, 1.1000, 3, "B");
+	first.addPrice(false, 1.1003, 3, "B");
+	book.onLevel2MarketData(&first);
+
+	TblDepth depth;
+	CHECK(book.getDepth("EUR/USD", &depth));
+	CHECK(depth.Time == Jan10Time);
+	CHECK(depth.BidLevels == 2 && depth.AskLevels == 2);
+	CHECK(depth.BidRate[0] == 1.1000 && depth.BidAmount[0] == 4);
+	CHECK(depth.BidRate[1] == 1.0999 && depth.BidAmount[1] == 2);
+	CHECK(depth.AskRate[0] == 1.1002 && depth.AskAmount[0] == 1);
+	CHECK(depth.AskRate[1] == 1.1003 && depth.AskAmount[1] == 3);
+
+	CMockLevel2Reader second;
+	second.addQuote(1, Jan10 + 1.0 / 86400);
+	second.addPrice(true, 1.1001, 5, "A");
+	second.addQuote(7, Jan10);
+	second.addPrice(true, 2.0, 1, "A");
+	book.onLevel2MarketData(&second);
+
+	CHECK(book.getDepth("EUR/USD", &depth));
+	CHECK(depth.Time == Jan10Time + 1);
+	CHECK(depth.BidLevels == 2 && depth.AskLevels == 1);
+	CHECK(depth.BidRate[0] == 1.1001 && depth.BidAmount[0] == 5);
+	CHECK(depth.BidRate[1] == 1.1000 && depth.BidAmount[1] == 3);
+	CHECK(depth.AskRate[0] == 1.1003 && depth.AskAmount[0] == 3);
+	CHECK(!book.getDepth("USD/JPY", &depth));
+}
+
+// Two quotes of one symbol in a batch add to the same ladder.
+TEST(DepthBookSameBatch)
+{
+	CDepthBook book;
+	book.addSymbol(1, "EUR/USD");
+	CMockLevel2Reader reader;
+	reader.addQuote(1, Jan10);
+	reader.addPrice(true, 1.1000, 1, "A");
+	reader.addQuote(1, Jan10);
+	reader.addPrice(true, 1.0998, 1, "A");
+	book.onLevel2MarketData(&reader);
+
+	TblDepth depth;
+	CHECK(book.getDepth("EUR/USD", &depth));
+	CHECK(depth.BidLevels == 2);
+	CHECK(depth.BidRate[1] == 1.0998);
+}
+
+// Levels of originators past DEPTH_ORIGINATORS are dropped.
+TEST(DepthBookOriginatorLimit)
+{
+	CDepthBook book;
+	book.addSymbol(1, "EUR/USD");
+	CMockLevel2Reader reader;
+	reader.addQuote(1, Jan10);
+	for (int i = 0; i <= DEPTH_ORIGINATORS; i++) {
+		reader.addPrice(true, 1.1000 - i * 0.0001, 1, std::to_string(i).c_str());
+	}
+	book.onLevel2MarketData(&reader);
+
+	TblDepth depth;
+	CHECK(book.getDepth("EUR/USD", &depth));
+	CHECK(depth.BidLevels == DEPTH_MAX);
+	CHECK_NEAR(depth.BidRate[DEPTH_MAX - 1], 1.1000 - (DEPTH_MAX - 1) * 0.0001, 1e-9);
+
+	CMockLevel2Reader last;
+	last.addQuote(1, Jan10);
+	last.addPrice(true, 1.2, 1, std::to_string(DEPTH_ORIGINATORS).c_str());
+	book.onLevel2MarketData(&last);
+	CHECK(book.getDepth("EUR/USD", &depth));
+	CHECK(depth.BidRate[0] == 1.1000);
+}
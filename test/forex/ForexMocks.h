@@ -0,0 +1,225 @@
+#ifndef FOREXMOCKS_H
+#define FOREXMOCKS_H
+
+#include "ForexConnect/ForexConnect.h"
+
+// Stand-ins for the ForexConnect objects the plugin reads, filled in by the
+// tests and benchmarks. Owned by their callers, addRef/release do nothing.
+
+typedef struct {
+	bool Bid;
+	double Rate;
+	double Amount;
+	string Originator;
+} Level2Price;
+
+typedef struct {
+	int SymbolID;
+	DATE Date;
+	vector<Level2Price> Prices;
+} Level2Quote;
+
+class CMockLevel2Reader : public IO2GLevel2MarketDataUpdatesReader
+{
+public:
+	vector<Level2Quote> m_vtQuotes;
+
+	long addRef() { return 1; }
+	long release() { return 1; }
+
+	void addQuote(int symbolID, DATE date)
+	{
+		Level2Quote quote = { symbolID, date, vector<Level2Price>() };
+		m_vtQuotes.push_back(quote);
+	}
+
+	void addPrice(bool bid, double rate, double amount, const char* originator)
+	{
+		Level2Price price = { bid, rate, amount, originator };
+		m_vtQuotes.back().Prices.push_back(price);
+	}
+
+	int getPriceQuotesCount() { return (int)m_vtQuotes.size(); }
+	double getDateTime(int quoteIdx) { return m_vtQuotes[quoteIdx].Date; }
+	int getSymbolID(int quoteIdx) { return m_vtQuotes[quoteIdx].SymbolID; }
+	int getVolume(int /*quoteIdx*/) { return 0; }
+	int getPricesCount(int quoteIdx) { return (int)m_vtQuotes[quoteIdx].Prices.size(); }
+	bool isBid(int quoteIdx, int priceIdx) { return m_vtQuotes[quoteIdx].Prices[priceIdx].Bid; }
+	bool isAsk(int quoteIdx, int priceIdx) { return !m_vtQuotes[quoteIdx].Prices[priceIdx].Bid; }
+	bool isLow(int /*quoteIdx*/, int /*priceIdx*/) { return false; }
+	bool isHigh(int /*quoteIdx*/, int /*priceIdx*/) { return false; }
+	double getRate(int quoteIdx, int priceIdx) { return m_vtQuotes[quoteIdx].Prices[priceIdx].Rate; }
+	double getAmount(int quoteIdx, int priceIdx) { return m_vtQuotes[quoteIdx].Prices[priceIdx].Amount; }
+	const char *getCondition(int /*quoteIdx*/, int /*priceIdx*/) { return ""; }
+	const char *getOriginator(int quoteIdx, int priceIdx) { return m_vtQuotes[quoteIdx].Prices[priceIdx].Originator.c_str(); }
+};
+
+// libForexConnect only exports the constructors of the interfaces it hands
+// out itself, these are supplied here.
+inline IO2GOfferTableRow::IO2GOfferTableRow() {}
+inline IO2GTablesUpdatesReader::IO2GTablesUpdatesReader() {}
+inline IO2GTableManager::IO2GTableManager() {}
+
+// A full offer as the offers table holds it, or with Partial set, a server
+// update that only carries Bid, Ask and Time.
+class CMockOfferRow : public IO2GOfferTableRow
+{
+public:
+	string m_strOfferID;
+	string m_strInstrument;
+	double m_dBid;
+	double m_dAsk;
+	DATE m_dtTime;
+	bool m_bPartial;
+
+	CMockOfferRow(const char* offerID, const char* instrument, double bid, double ask, DATE time, bool partial)
+		: m_strOfferID(offerID), m_strInstrument(instrument), m_dBid(bid), m_dAsk(ask), m_dtTime(time), m_bPartial(partial) {}
+
+	long addRef() { return 1; }
+	long release() { return 1; }
+
+	const void *getCell(int /*column*/) { return NULL; }
+	bool isCellChanged(int /*column*/) { return false; }
+	IO2GTableColumnCollection *columns() { return NULL; }
+	O2GTable getTableType() { return Offers; }
+
+	const char* getOfferID() { return m_strOfferID.c_str(); }
+	const char* getInstrument() { return m_bPartial ? "" : m_strInstrument.c_str(); }
+	const char* getQuoteID() { return ""; }
+	double getBid() { return m_dBid; }
+	double getAsk() { return m_dAsk; }
+	double getLow() { return m_bPartial ? 0 : m_dBid; }
+	double getHigh() { return m_bPartial ? 0 : m_dAsk; }
+	int getVolume() { return 0; }
+	DATE getTime() { return m_dtTime; }
+	const char* getBidTradable() { return "T"; }
+	const char* getAskTradable() { return "T"; }
+	double getSellInterest() { return 0; }
+	double getBuyInterest() { return 0; }
+	const char* getContractCurrency() { return ""; }
+	int getDigits() { return 5; }
+	double getPointSize() { return m_bPartial ? 0 : 0.0001; }
+	const char* getSubscriptionStatus() { return "T"; }
+	int getInstrumentType() { return 1; }
+	double getContractMultiplier() { return 1; }
+	const char* getTradingStatus() { return "O"; }
+	const char* getValueDate() { return ""; }
+	const char* getBidID() { return ""; }
+	const char* getAskID() { return ""; }
+	DATE getBidExpireDate() { return 0; }
+	DATE getAskExpireDate() { return 0; }
+	double getDividendSell() { return 0; }
+	double getDividendBuy() { return 0; }
+
+	bool isOfferIDValid() { return true; }
+	bool isInstrumentValid() { return !m_bPartial; }
+	bool isQuoteIDValid() { return false; }
+	bool isBidValid() { return true; }
+	bool isAskValid() { return true; }
+	bool isLowValid() { return !m_bPartial; }
+	bool isHighValid() { return !m_bPartial; }
+	bool isVolumeValid() { return false; }
+	bool isTimeValid() { return true; }
+	bool isBidTradableValid() { return !m_bPartial; }
+	bool isAskTradableValid() { return !m_bPartial; }
+	bool isSellInterestValid() { return !m_bPartial; }
+	bool isBuyInterestValid() { return !m_bPartial; }
+	bool isContractCurrencyValid() { return !m_bPartial; }
+	bool isDigitsValid() { return !m_bPartial; }
+	bool isPointSizeValid() { return !m_bPartial; }
+	bool isSubscriptionStatusValid() { return !m_bPartial; }
+	bool isInstrumentTypeValid() { return !m_bPartial; }
+	bool isContractMultiplierValid() { return !m_bPartial; }
+	bool isTradingStatusValid() { return !m_bPartial; }
+	bool isValueDateValid() { return !m_bPartial; }
+	bool isBidIDValid() { return false; }
+	bool isAskIDValid() { return false; }
+	bool isBidExpireDateValid() { return false; }
+	bool isAskExpireDateValid() { return false; }
+	bool isDividendSellValid() { return false; }
+	bool isDividendBuyValid() { return false; }
+
+	double getPipCost() { return 1; }
+	int getBidChangeDirection() { return 0; }
+	int getAskChangeDirection() { return 0; }
+	int getHiChangeDirection() { return 0; }
+	int getLowChangeDirection() { return 0; }
+	int getDefaultSortOrder() { return 0; }
+	int getFractionalPipSize() { return 1; }
+	bool isBidChangeDirectionValid() { return false; }
+	bool isAskChangeDirectionValid() { return false; }
+	bool isHiChangeDirectionValid() { return false; }
+	bool isLowChangeDirectionValid() { return false; }
+	bool isDefaultSortOrderValid() { return false; }
+	bool isFractionalPipSizeValid() { return false; }
+};
+
+class CMockAccountRow : public IO2GAccountRow
+{
+public:
+	string m_strAccountID;
+	double m_dBalance;
+
+	CMockAccountRow(const char* accountID, double balance) : m_strAccountID(accountID), m_dBalance(balance) {}
+
+	long addRef() { return 1; }
+	long release() { return 1; }
+
+	const void *getCell(int /*column*/) { return NULL; }
+	bool isCellChanged(int /*column*/) { return false; }
+	IO2GTableColumnCollection *columns() { return NULL; }
+	O2GTable getTableType() { return Accounts; }
+
+	const char* getAccountID() { return m_strAccountID.c_str(); }
+	const char* getAccountName() { return m_strAccountID.c_str(); }
+	const char* getAccountKind() { return "32"; }
+	double getBalance() { return m_dBalance; }
+	double getNonTradeEquity() { return 0; }
+	double getM2MEquity() { return m_dBalance; }
+	const char* getMarginCallFlag() { return "N"; }
+	DATE getLastMarginCallDate() { return 0; }
+	const char* getMaintenanceType() { return "Y"; }
+	int getAmountLimit() { return 0; }
+	int getBaseUnitSize() { return 1000; }
+	bool getMaintenanceFlag() { return false; }
+	const char* getManagerAccountID() { return ""; }
+	const char* getLeverageProfileID() { return ""; }
+	double getHadgeMarginPCT() { return 0; }
+	const char* getATPID() { return ""; }
+	const char* getARPID() { return ""; }
+};
+
+typedef struct {
+	O2GTable Table;
+	O2GTableUpdateType Type;
+	IO2GRow* Row;
+} TablesUpdate;
+
+// A raw server batch over rows owned by the caller.
+class CMockTablesUpdatesReader : public IO2GTablesUpdatesReader
+{
+public:
+	vector<TablesUpdate> m_vtUpdates;
+
+	long addRef() { return 1; }
+	long release() { return 1; }
+
+	void add(O2GTableUpdateType type, IO2GRow* row)
+	{
+		TablesUpdate update = { row->getTableType(), type, row };
+		m_vtUpdates.push_back(update);
+	}
+
+	DATE getServerTime() { return 0; }
+	int size() { return (int)m_vtUpdates.size(); }
+	O2GTableUpdateType getUpdateType(int index) { return m_vtUpdates[index].Type; }
+	O2GTable getUpdateTable(int index) { return m_vtUpdates[index].Table; }
+	IO2GOfferRow *getOfferRow(int index) { return m_vtUpdates[index].Table == Offers ? (IO2GOfferRow*)m_vtUpdates[index].Row : NULL; }
+	IO2GAccountRow *getAccountRow(int index) { return m_vtUpdates[index].Table == Accounts ? (IO2GAccountRow*)m_vtUpdates[index].Row : NULL; }
+	IO2GOrderRow *getOrderRow(int /*index*/) { return NULL; }
+	IO2GTradeRow *getTradeRow(int /*index*/) { return NULL; }
+	IO2GClosedTradeRow *getClosedTradeRow(int /*index*/) { return NULL; }
+	IO2GMessageRow *getMessageRow(int /*index*/) { return NULL; }
+};
+
+#endif
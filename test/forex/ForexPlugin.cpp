@@ -0,0 +1,75 @@
+﻿/*
+* Copyright 2020 FXDaemon
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include "stdafx.h"
+#include "IPluginProxy.h"
+#include "ForexPlugin.h"
+
+// Takes the plugin's registration, the rest is of no interest here.
+class CTestProxy : public IPluginProxy
+{
+public:
+	IBaseOrder* m_pBaseOrder;
+
+	CTestProxy() : m_pBaseOrder(NULL) {}
+
+	bool registerPlugin(const char* /*name*/, IBaseOrder* baseOrder) { m_pBaseOrder = baseOrder; return true; }
+	void onDisconnected() {}
+	void onMessage(MsgLevel /*level*/, const char* /*message*/) {}
+	void onPrice(TableStatus /*status*/, const TblPrice* /*tblPrice*/) {}
+	void onAccount(TableStatus /*status*/, const TblAccount* /*tblAccount*/) {}
+	void onOrder(TableStatus /*status*/, const TblOrder* /*tblOrder*/) {}
+	void onOpenedTrade(TableStatus /*status*/, const TblTrade* /*tblTrade*/) {}
+	void onClosedTrade(TableStatus /*status*/, const TblTrade* /*tblTrade*/) {}
+};
+
+// Function-local, the plugin registers from its static constructor.
+static CTestProxy* testProxy()
+{
+	static CTestProxy proxy;
+	return &proxy;
+}
+
+extern "C" IPluginProxy* getPluginProxy()
+{
+	return testProxy();
+}
+
+CMockSession* mockSession()
+{
+	static CMockSession session;
+	return &session;
+}
+
+// Linked ahead of libForexConnect, so the plugin gets the mock.
+IO2GSession* CO2GTransport::createSession()
+{
+	return mockSession();
+}
+
+IBaseOrder* forexPlugin(const char* configFile)
+{
+	static IBaseOrder* baseOrder = NULL;
+	static bool started = false;
+	if (started) {
+		return baseOrder;
+	}
+	started = true;
+	if (!testProxy()->m_pBaseOrder || testProxy()->m_pBaseOrder->init(configFile) != RET_SUCCESS) {
+		return NULL;
+	}
+	baseOrder = testProxy()->m_pBaseOrder;
+	return baseOrder;
+}
@@ -0,0 +1,17 @@
+#ifndef FOREXPLUGIN_H
+#define FOREXPLUGIN_H
+
+#include "IBaseOrder.h"
+#include "MockSession.h"
+
+// The COrder2Go linked into the binary, initialized on first use with
+// configFile over mockSession(); later calls get it as first initialized.
+// It never logs in, so only the calls that go through requests work.
+// NULL when init fails.
+IBaseOrder* forexPlugin(const char* configFile = "conf/test-forexapi.cfg");
+
+// Stands in for the ForexConnect session, CO2GTransport::createSession()
+// returns it.
+CMockSession* mockSession();
+
+#endif
@@ -0,0 +1,380 @@
+﻿/*
+* Copyright 2020 FXDaemon
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include "stdafx.h"
+#include "MockSession.h"
+#include "TableListener.h"
+
+string CMockValueMap::getString(O2GRequestParamsEnum param) const
+{
+	map<int, string>::const_iterator it = m_mapStrings.find(param);
+	return it != m_mapStrings.end() ? it->second : "";
+}
+
+double CMockSnapshotReader::getBidOpen(int index)
+{
+	return CMockSession::barPrice(m_vtBars[index]);
+}
+
+O2GTimeframeUnit CMockTimeframe::getUnit()
+{
+	switch (m_strID[0]) {
+	case 't':
+		return Tick;
+	case 'm':
+		return Min;
+	case 'H':
+		return Hour;
+	case 'D':
+		return Day;
+	case 'W':
+		return Week;
+	case 'M':
+		return Month;
+	default:
+		return Year;
+	}
+}
+
+// Months and years have no fixed length, a snapshot of them is left empty.
+time_t CMockTimeframe::getSeconds()
+{
+	switch (getUnit()) {
+	case Min:
+		return 60 * getSize();
+	case Hour:
+		return 3600 * getSize();
+	case Day:
+		return 86400 * getSize();
+	case Week:
+		return 7 * 86400 * getSize();
+	default:
+		return 0;
+	}
+}
+
+IO2GRequest *CMockRequestFactory::createMarketDataSnapshotRequestInstrument(const char *instrument, IO2GTimeframe *timeframe, int maxBars)
+{
+	if (!timeframe) {
+		return NULL;
+	}
+	CMockRequest* request = m_pSession->newRequest(NULL);
+	request->m_strInstrument = instrument;
+	request->m_nBarSeconds = ((CMockTimeframe*)timeframe)->getSeconds();
+	request->m_nMaxBars = maxBars;
+	return request;
+}
+
+void CMockRequestFactory::fillMarketDataSnapshotRequestTime(IO2GRequest *request, DATE timeFrom, DATE timeTo, bool /*isIncludeWeekends*/, O2GCandleOpenPriceMode /*mode*/)
+{
+	((CMockRequest*)request)->m_dtFrom = timeFrom;
+	((CMockRequest*)request)->m_dtTo = timeTo;
+}
+
+IO2GRequest *CMockRequestFactory::createOrderRequest(IO2GValueMap *valueMap)
+{
+	CMockValueMap* mockMap = (CMockValueMap*)valueMap;
+	CMockRequest* request = m_pSession->newRequest(mockMap);
+	for (size_t i = 0; i < mockMap->m_vtChildren.size(); i++) {
+		request->m_vtChildren.push_back(m_pSession->newRequest((CMockValueMap*)mockMap->m_vtChildren[i]));
+	}
+	return request;
+}
+
+IO2GValueMap *CMockRequestFactory::createValueMap()
+{
+	return m_pSession->newValueMap();
+}
+
+IO2GMarketDataSnapshotResponseReader *CMockReaderFactory::createMarketDataSnapshotReader(IO2GResponse *response)
+{
+	if (response->getType() != MarketDataSnapshot) {
+		return NULL;
+	}
+	return new CMockSnapshotReader(((CMockResponse*)response)->m_vtBars);
+}
+
+IO2GOrderResponseReader *CMockReaderFactory::createOrderResponseReader(IO2GResponse *response)
+{
+	return new CMockOrderReader(((CMockResponse*)response)->m_strOrderID);
+}
+
+CMockSession::CMockSession()
+	: m_pResponseListener(NULL), m_nNextID(1), m_bHold(false), m_bReverse(false), m_bStray(false),
+	m_dwLatencyMs(0), m_nFailIndex(-1), m_nInFlight(0), m_nMaxInFlight(0)
+{
+	m_RequestFactory.m_pSession = this;
+	m_hArrived = nsapi::CreateEvent(NULL, FALSE, FALSE, NULL);
+	m_hPending = nsapi::CreateEvent(NULL, FALSE, FALSE, NULL);
+	ThreadFunAttr threadFunAttr = { answerProcess, this };
+	m_pAnswerThread = new CThread(threadFunAttr);
+	m_pAnswerThread->_start();
+}
+
+// A process-wide fixture: the answer thread is left to end with the process.
+CMockSession::~CMockSession()
+{
+	freeObjects();
+}
+
+void CMockSession::holdAnswers()
+{
+	CCriticalSection::Lock l(m_csSession);
+	m_bHold = true;
+}
+
+void CMockSession::releaseAnswers()
+{
+	CCriticalSection::Lock l(m_csSession);
+	m_bHold = false;
+	nsapi::SetEvent(m_hPending);
+}
+
+void CMockSession::setReverse(bool reverse)
+{
+	CCriticalSection::Lock l(m_csSession);
+	m_bReverse = reverse;
+}
+
+// Each set of answers is led by one for a request ID nobody awaits.
+void CMockSession::setStray(bool stray)
+{
+	CCriticalSection::Lock l(m_csSession);
+	m_bStray = stray;
+}
+
+void CMockSession::setLatency(DWORD ms)
+{
+	CCriticalSection::Lock l(m_csSession);
+	m_dwLatencyMs = ms;
+}
+
+// The request sent at sentIndex, counted from the last reset(), fails with error.
+void CMockSession::failRequest(int sentIndex, const char* error)
+{
+	CCriticalSection::Lock l(m_csSession);
+	m_nFailIndex = sentIndex;
+	m_strFailError = error;
+}
+
+// True when a request was sent since the last wait.
+bool CMockSession::waitArrived(DWORD ms)
+{
+	return nsapi::WaitForSingleObject(m_hArrived, ms) == WAIT_OBJECT_0;
+}
+
+void CMockSession::getSent(vector<CMockRequest*>& sent)
+{
+	CCriticalSection::Lock l(m_csSession);
+	sent = m_vtSent;
+}
+
+// The most requests sent and not yet answered at any one time.
+int CMockSession::getMaxInFlight()
+{
+	CCriticalSection::Lock l(m_csSession);
+	return m_nMaxInFlight;
+}
+
+void CMockSession::reset()
+{
+	releaseAnswers();
+	CCriticalSection::Lock l(m_csSession);
+	m_vtSent.clear();
+	m_bReverse = false;
+	m_bStray = false;
+	m_dwLatencyMs = 0;
+	m_nFailIndex = -1;
+	m_strFailID.clear();
+	m_nMaxInFlight = 0;
+	freeObjects();
+	nsapi::ResetEvent(m_hArrived);
+}
+
+// Bar start times every m_nBarSeconds from From to To, while the market is open.
+void CMockSession::getBars(CMockRequest* request, vector<time_t>& bars) const
+{
+	bars.clear();
+	time_t from = CTableListener::date2Time(request->m_dtFrom);
+	time_t to = CTableListener::date2Time(request->m_dtTo);
+	time_t interval = request->m_nBarSeconds;
+	if (interval <= 0) {
+		return;
+	}
+	for (time_t t = (from + interval - 1) / interval * interval; t <= to; t += interval) {
+		if (m_Calendar.isOpen(t)) {
+			bars.push_back(t);
+		}
+	}
+	if (request->m_nMaxBars > 0 && bars.size() > (size_t)request->m_nMaxBars) {
+		bars.erase(bars.begin(), bars.end() - request->m_nMaxBars);
+	}
+}
+
+// A price that tells the bars apart, so a misplaced bar shows.
+double CMockSession::barPrice(time_t t)
+{
+	return 1.1 + (t / 60 % 10000) * 0.00001;
+}
+
+CMockValueMap* CMockSession::newValueMap()
+{
+	CCriticalSection::Lock l(m_csSession);
+	CMockValueMap* valueMap = new CMockValueMap();
+	m_vtValueMaps.push_back(valueMap);
+	return valueMap;
+}
+
+CMockRequest* CMockSession::newRequest(CMockValueMap* valueMap)
+{
+	CCriticalSection::Lock l(m_csSession);
+	CMockRequest* request = new CMockRequest("R" + to_string(m_nNextID++), valueMap);
+	m_vtRequests.push_back(request);
+	return request;
+}
+
+void CMockSession::sendRequest(IO2GRequest *request)
+{
+	CMockRequest* mockRequest = (CMockRequest*)request;
+	{
+		CCriticalSection::Lock l(m_csSession);
+		if ((int)m_vtSent.size() == m_nFailIndex) {
+			m_strFailID = mockRequest->m_strRequestID;
+		}
+		m_vtSent.push_back(mockRequest);
+		vector<CMockRequest*> requests(mockRequest->m_vtChildren);
+		if (requests.empty()) {
+			requests.push_back(mockRequest);
+		}
+		for (size_t i = 0; i < requests.size(); i++) {
+			requests[i]->m_dwSentMs = nsapi::GetTickCount();
+			m_qePending.push_back(requests[i]);
+		}
+		m_nInFlight += requests.size();
+		if (m_nInFlight > m_nMaxInFlight) {
+			m_nMaxInFlight = m_nInFlight;
+		}
+	}
+	nsapi::SetEvent(m_hArrived);
+	nsapi::SetEvent(m_hPending);
+}
+
+void CMockSession::freeObjects()
+{
+	for (size_t i = 0; i < m_vtValueMaps.size(); i++) {
+		delete m_vtValueMaps[i];
+	}
+	m_vtValueMaps.clear();
+	for (size_t i = 0; i < m_vtRequests.size(); i++) {
+		delete m_vtRequests[i];
+	}
+	m_vtRequests.clear();
+}
+
+// Waits out the latency of the oldest pending request, then takes them all.
+bool CMockSession::takePending(vector<CMockRequest*>& requests)
+{
+	requests.clear();
+	while (true) {
+		DWORD waitMs = 0;
+		{
+			CCriticalSection::Lock l(m_csSession);
+			if (m_bHold || m_qePending.empty()) {
+				return false;
+			}
+			DWORD waitedMs = nsapi::GetTickCount() - m_qePending.front()->m_dwSentMs;
+			if (waitedMs >= m_dwLatencyMs) {
+				requests.assign(m_qePending.begin(), m_qePending.end());
+				m_qePending.clear();
+				if (m_bReverse) {
+					reverse(requests.begin(), requests.end());
+				}
+				return true;
+			}
+			waitMs = m_dwLatencyMs - waitedMs;
+		}
+		nsapi::Sleep(waitMs);
+	}
+}
+
+void CMockSession::answer(CMockRequest* request)
+{
+	IO2GResponseListener* listener;
+	bool failed;
+	string error;
+	{
+		CCriticalSection::Lock l(m_csSession);
+		listener = m_pResponseListener;
+		failed = request->m_strRequestID == m_strFailID;
+		error = m_strFailError;
+	}
+	if (listener && failed) {
+		listener->onRequestFailed(request->m_strRequestID.c_str(), error.c_str());
+	}
+	else if (listener && !request->m_pValueMap) {
+		CMockResponse* response = new CMockResponse(MarketDataSnapshot, request->m_strRequestID);
+		getBars(request, response->m_vtBars);
+		listener->onRequestCompleted(response->getRequestID(), response);
+		response->release();
+	}
+	else if (listener) {
+		CMockResponse* response = new CMockResponse(CreateOrderResponse, request->m_strRequestID);
+		response->m_strOrderID = "O" + request->m_strRequestID;
+		listener->onRequestCompleted(response->getRequestID(), response);
+		response->release();
+	}
+	CCriticalSection::Lock l(m_csSession);
+	m_nInFlight--;
+}
+
+// Answered like the request, but under an ID of its own.
+void CMockSession::answerStray(CMockRequest* request)
+{
+	CMockResponse* response = new CMockResponse(request->m_pValueMap ? CreateOrderResponse : MarketDataSnapshot, "X" + request->m_strRequestID);
+	if (!request->m_pValueMap) {
+		getBars(request, response->m_vtBars);
+	}
+	IO2GResponseListener* listener;
+	{
+		CCriticalSection::Lock l(m_csSession);
+		listener = m_pResponseListener;
+	}
+	if (listener) {
+		listener->onRequestCompleted(response->getRequestID(), response);
+	}
+	response->release();
+}
+
+void CMockSession::answerProcess(void* pv)
+{
+	CMockSession* session = (CMockSession*)pv;
+	vector<CMockRequest*> requests;
+	while (true) {
+		nsapi::WaitForSingleObject(session->m_hPending, INFINITE);
+		while (session->takePending(requests)) {
+			bool stray;
+			{
+				CCriticalSection::Lock l(session->m_csSession);
+				stray = session->m_bStray;
+			}
+			if (stray) {
+				session->answerStray(requests.front());
+			}
+			for (size_t i = 0; i < requests.size(); i++) {
+				session->answer(requests[i]);
+			}
+		}
+	}
+}
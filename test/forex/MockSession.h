@@ -0,0 +1,310 @@
+#ifndef MOCKSESSION_H
+#define MOCKSESSION_H
+
+#include "ForexConnect/ForexConnect.h"
+#include "CriticalSection.h"
+#include "Thread.h"
+#include "MarketCalendar.h"
+#include "ForexMocks.h"
+
+class CMockValueMap : public IO2GValueMap
+{
+public:
+	map<int, string> m_mapStrings;
+	map<int, double> m_mapDoubles;
+	vector<IO2GValueMap*> m_vtChildren;
+
+	long addRef() { return 1; }
+	long release() { return 1; }
+
+	void setString(O2GRequestParamsEnum param, const char* value) { m_mapStrings[param] = value; }
+	void setDouble(O2GRequestParamsEnum param, double value) { m_mapDoubles[param] = value; }
+	void setInt(O2GRequestParamsEnum param, int value) { m_mapDoubles[param] = value; }
+	void setBoolean(O2GRequestParamsEnum param, bool value) { m_mapDoubles[param] = value; }
+	IO2GValueMap* clone() { return NULL; }
+	void clear() { m_mapStrings.clear(); m_mapDoubles.clear(); m_vtChildren.clear(); }
+	int getChildrenCount() { return (int)m_vtChildren.size(); }
+	IO2GValueMap* getChild(int index) { return m_vtChildren[index]; }
+	void appendChild(IO2GValueMap* valueMap) { m_vtChildren.push_back(valueMap); }
+
+	string getString(O2GRequestParamsEnum param) const;
+};
+
+// An order request carries its value map, a batch one child per appended map.
+// A snapshot request has no value map but its instrument, bar and time range.
+class CMockRequest : public IO2GRequest
+{
+public:
+	string m_strRequestID;
+	CMockValueMap* m_pValueMap;
+	vector<CMockRequest*> m_vtChildren;
+	string m_strInstrument;
+	time_t m_nBarSeconds;
+	int m_nMaxBars;
+	DATE m_dtFrom;
+	DATE m_dtTo;
+	DWORD m_dwSentMs;
+
+	CMockRequest(const string& requestID, CMockValueMap* valueMap)
+		: m_strRequestID(requestID), m_pValueMap(valueMap), m_nBarSeconds(0), m_nMaxBars(0), m_dtFrom(0), m_dtTo(0), m_dwSentMs(0) {}
+
+	long addRef() { return 1; }
+	long release() { return 1; }
+
+	const char *getRequestID() { return m_strRequestID.c_str(); }
+	int getChildrenCount() { return (int)m_vtChildren.size(); }
+	IO2GRequest* getChildRequest(int index) { return m_vtChildren[index]; }
+};
+
+// Deleted with its last reference, as the listener keeps the ones it awaits.
+class CMockResponse : public O2G2::TO2G2ThreadSafeAddRefImpl<IO2GResponse>
+{
+public:
+	O2GResponseType m_emType;
+	string m_strRequestID;
+	string m_strOrderID;
+	vector<time_t> m_vtBars;
+
+	CMockResponse(O2GResponseType type, const string& requestID) : m_emType(type), m_strRequestID(requestID) {}
+
+	O2GResponseType getType() { return m_emType; }
+	const char * getRequestID() { return m_strRequestID.c_str(); }
+};
+
+// Bars of a snapshot response, priced from their time by CMockSession::barPrice.
+class CMockSnapshotReader : public O2G2::TO2G2ThreadSafeAddRefImpl<IO2GMarketDataSnapshotResponseReader>
+{
+public:
+	vector<time_t> m_vtBars;
+
+	CMockSnapshotReader(const vector<time_t>& bars) : m_vtBars(bars) {}
+
+	bool isBar() { return true; }
+	int size() { return (int)m_vtBars.size(); }
+	DATE getDate(int index) { return 25569 + m_vtBars[index] / 86400.0; }
+	double getBid(int index) { return getBidClose(index); }
+	double getAsk(int index) { return getAskClose(index); }
+	double getBidOpen(int index);
+	double getBidHigh(int index) { return getBidOpen(index) + 0.0003; }
+	double getBidLow(int index) { return getBidOpen(index) - 0.0002; }
+	double getBidClose(int index) { return getBidOpen(index) + 0.0001; }
+	double getAskOpen(int index) { return getBidOpen(index) + 0.0002; }
+	double getAskHigh(int index) { return getBidHigh(index) + 0.0002; }
+	double getAskLow(int index) { return getBidLow(index) + 0.0002; }
+	double getAskClose(int index) { return getBidClose(index) + 0.0002; }
+	int getVolume(int /*index*/) { return 1; }
+	int getLastBarVolume() { return 1; }
+	DATE getLastBarTime() { return m_vtBars.empty() ? 0 : getDate((int)m_vtBars.size() - 1); }
+};
+
+// m1, H4, D1 and the like; released by deletion.
+class CMockTimeframe : public O2G2::TO2G2ThreadSafeAddRefImpl<IO2GTimeframe>
+{
+public:
+	string m_strID;
+
+	CMockTimeframe(const char* id) : m_strID(id) {}
+
+	const char *getID() { return m_strID.c_str(); }
+	O2GTimeframeUnit getUnit();
+	int getQueryDepth() { return 300; }
+	int getSize() { return atoi(m_strID.c_str() + 1); }
+	time_t getSeconds();
+};
+
+// Hands out any timeframe asked for by ID.
+class CMockTimeframeCollection : public IO2GTimeframeCollection
+{
+public:
+	long addRef() { return 1; }
+	long release() { return 1; }
+
+	int size() { return 0; }
+	IO2GTimeframe *get(int /*index*/) { return NULL; }
+	IO2GTimeframe *get(const char *id) { return new CMockTimeframe(id); }
+};
+
+class CMockOrderReader : public IO2GOrderResponseReader
+{
+public:
+	string m_strOrderID;
+
+	CMockOrderReader(const string& orderID) : m_strOrderID(orderID) {}
+
+	long addRef() { return 1; }
+	long release() { delete this; return 0; }
+
+	const char* getOrderID() { return m_strOrderID.c_str(); }
+	bool isUnderDealerIntervention() { return false; }
+};
+
+class CMockSession;
+
+class CMockRequestFactory : public IO2GRequestFactory
+{
+public:
+	CMockSession* m_pSession;
+	CMockTimeframeCollection m_Timeframes;
+
+	long addRef() { return 1; }
+	long release() { return 1; }
+
+	IO2GTimeframeCollection *getTimeFrameCollection() { return &m_Timeframes; }
+	IO2GRequest *createMarketDataSnapshotRequestInstrument(const char *instrument, IO2GTimeframe *timeframe, int maxBars);
+	void fillMarketDataSnapshotRequestTime(IO2GRequest *request, DATE timeFrom, DATE timeTo, bool /*isIncludeWeekends*/, O2GCandleOpenPriceMode /*mode*/);
+	IO2GRequest *createConfirmationMailRequest(IO2GMessageRow* /*messageRow*/) { return NULL; }
+	IO2GRequest *createRefreshTableRequest(O2GTable /*table*/) { return NULL; }
+	IO2GRequest *createRefreshTableRequestByAccount(O2GTable /*table*/, const char* /*account*/) { return NULL; }
+	IO2GRequest *createOrderRequest(IO2GValueMap *valueMap);
+	IO2GValueMap *createValueMap();
+	const char* getLastError() { return ""; }
+};
+
+class CMockReaderFactory : public IO2GResponseReaderFactory
+{
+public:
+	long addRef() { return 1; }
+	long release() { return 1; }
+
+	IO2GTablesUpdatesReader *createTablesUpdatesReader(IO2GResponse* /*response*/) { return NULL; }
+	IO2GMarketDataSnapshotResponseReader *createMarketDataSnapshotReader(IO2GResponse *response);
+	IO2GMarketDataResponseReader *createMarketDataReader(IO2GResponse* /*response*/) { return NULL; }
+	IO2GLevel2MarketDataUpdatesReader *createLevel2MarketDataReader(IO2GResponse* /*response*/) { return NULL; }
+	IO2GOffersTableResponseReader *createOffersTableReader(IO2GResponse* /*response*/) { return NULL; }
+	IO2GAccountsTableResponseReader *createAccountsTableReader(IO2GResponse* /*response*/) { return NULL; }
+	IO2GOrdersTableResponseReader *createOrdersTableReader(IO2GResponse* /*response*/) { return NULL; }
+	IO2GTradesTableResponseReader *createTradesTableReader(IO2GResponse* /*response*/) { return NULL; }
+	IO2GClosedTradesTableResponseReader *createClosedTradesTableReader(IO2GResponse* /*response*/) { return NULL; }
+	IO2GMessagesTableResponseReader *createMessagesTableReader(IO2GResponse* /*response*/) { return NULL; }
+	IO2GOrderResponseReader *createOrderResponseReader(IO2GResponse *response);
+	IO2GLastOrderUpdateResponseReader *createLastOrderUpdateResponseReader(IO2GResponse* /*response*/) { return NULL; }
+	IO2GSystemPropertiesReader *createSystemPropertiesReader(IO2GResponse* /*response*/) { return NULL; }
+	bool processMarginRequirementsResponse(IO2GResponse* /*response*/) { return false; }
+};
+
+// Tables never load, so order lookups by trade find nothing.
+class CMockTableManager : public IO2GTableManager
+{
+public:
+	long addRef() { return 1; }
+	long release() { return 1; }
+
+	IO2GTable *getTable(O2GTable /*tableType*/) { return NULL; }
+	O2GTableManagerStatus getStatus() { return TablesLoadFailed; }
+	void lockUpdates() {}
+	void unlockUpdates() {}
+	void subscribeUpdatesProcessStatus(IO2GUpdatesProcessStatusListener* /*listener*/) {}
+	void unsubscribeUpdatesProcessStatus(IO2GUpdatesProcessStatusListener* /*listener*/) {}
+	IO2GAllEventQueue* getTablesUpdateEventQueue(bool /*isNeedCopyOfRow*/) { return NULL; }
+	void releaseTablesUpdateEventQueue(IO2GAllEventQueue* /*tablesUpdateEventQueue*/) {}
+};
+
+// A session that never connects but answers the requests sent through it.
+// Each request, or each child of a batch, is answered from a thread of its
+// own through the subscribed response listener: an order with the order ID
+// "O" + its request ID, a snapshot with the bars of its range the default
+// calendar has open, the latest MaxBars of them.
+// Once the oldest pending request has waited the latency of a round trip,
+// every pending one is answered, in reverse order if asked. While held,
+// answers wait for releaseAnswers().
+// Every request sent is logged. Value maps and requests live until reset(),
+// which must not be called while a call is in flight; their release does nothing.
+class CMockSession : public IO2GSession
+{
+private:
+	CMockRequestFactory m_RequestFactory;
+	CMockReaderFactory m_ReaderFactory;
+	CMockTableManager m_TableManager;
+	CMarketCalendar m_Calendar;
+	IO2GResponseListener* m_pResponseListener;
+	vector<CMockValueMap*> m_vtValueMaps;
+	vector<CMockRequest*> m_vtRequests;
+	vector<CMockRequest*> m_vtSent;
+	deque<CMockRequest*> m_qePending;
+	int m_nNextID;
+	bool m_bHold;
+	bool m_bReverse;
+	bool m_bStray;
+	DWORD m_dwLatencyMs;
+	int m_nFailIndex;
+	string m_strFailError;
+	string m_strFailID;
+	int m_nInFlight;
+	int m_nMaxInFlight;
+	CCriticalSection m_csSession;
+	HANDLE m_hArrived;
+	HANDLE m_hPending;
+	CThread* m_pAnswerThread;
+
+public:
+	CMockSession();
+	~CMockSession();
+
+	void holdAnswers();
+	void releaseAnswers();
+	void setReverse(bool reverse);
+	void setStray(bool stray);
+	void setLatency(DWORD ms);
+	void failRequest(int sentIndex, const char* error);
+	bool waitArrived(DWORD ms);
+	void getSent(vector<CMockRequest*>& sent);
+	int getMaxInFlight();
+	void reset();
+	void getBars(CMockRequest* request, vector<time_t>& bars) const;
+	static double barPrice(time_t t);
+
+	CMockValueMap* newValueMap();
+	CMockRequest* newRequest(CMockValueMap* valueMap);
+
+	long addRef() { return 1; }
+	long release() { return 1; }
+
+	IO2GLoginRules *getLoginRules() { return NULL; }
+	void login(const char* /*user*/, const char* /*pwd*/, const char* /*url*/, const char* /*connection*/) {}
+	void logout() {}
+	void subscribeSessionStatus(IO2GSessionStatus* /*listener*/) {}
+	void unsubscribeSessionStatus(IO2GSessionStatus* /*listener*/) {}
+	IO2GSessionDescriptorCollection *getTradingSessionDescriptors() { return NULL; }
+	void setTradingSession(const char* /*sessionId*/, const char* /*pin*/) {}
+	void subscribeResponse(IO2GResponseListener *listener) { m_pResponseListener = listener; }
+	void unsubscribeResponse(IO2GResponseListener* /*listener*/) { m_pResponseListener = NULL; }
+	void subscribeSystemPropertiesChange(IO2GSystemPropertiesListener* /*listener*/) {}
+	void unsubscribeSystemPropertiesChange(IO2GSystemPropertiesListener* /*listener*/) {}
+	IO2GRequestFactory * getRequestFactory() { return &m_RequestFactory; }
+	IO2GResponseReaderFactory *getResponseReaderFactory() { return &m_ReaderFactory; }
+	void sendRequest(IO2GRequest *request);
+	void setRequestsTimeout(size_t /*timeout*/) {}
+	size_t getRequestsTimeout() { return 0; }
+	IO2GTimeConverter *getTimeConverter() { return NULL; }
+	void setPriceUpdateMode(O2GPriceUpdateMode /*mode*/) {}
+	O2GPriceUpdateMode getPriceUpdateMode() { return Default; }
+	DATE getServerTime() { return 0; }
+	IO2GTableManager *getTableManager() { return &m_TableManager; }
+	IO2GTableManager *getTableManagerByAccount(const char* /*accountID*/) { return &m_TableManager; }
+	void useTableManager(O2GTableManagerMode /*mode*/, IO2GTableManagerListener* /*tablesListener*/) {}
+	IO2GSessionStatus::O2GSessionStatus getSessionStatus() { return IO2GSessionStatus::Disconnected; }
+	bool setPriceRefreshRate(int /*priceRefreshRate*/) { return false; }
+	int getPriceRefreshRate() { return 0; }
+	int getMinPriceRefreshRate() { return 0; }
+	int getMaxPriceRefreshRate() { return 0; }
+	const char* getSessionSubID() { return ""; }
+	void setChartSessionMode(O2GChartSessionMode /*mode*/) {}
+	O2GChartSessionMode getChartSessionMode() { return NoChartSession; }
+	void subscribeChartSessionStatus(IO2GChartSessionStatus* /*listener*/) {}
+	void unsubscribeChartSessionStatus(IO2GChartSessionStatus* /*listener*/) {}
+	IO2GChartSessionStatus::O2GChartSessionStatus getChartSessionStatus() { return IO2GChartSessionStatus::Disconnected; }
+	O2GUserKind getUserKind() { return Trader; }
+	const char* getUserName() { return ""; }
+	IO2GCommissionsProvider* getCommissionsProvider() { return NULL; }
+	IO2GRolloverProvider* getRolloverProvider() { return NULL; }
+	void forceClose() {}
+
+private:
+	bool takePending(vector<CMockRequest*>& requests);
+	void answer(CMockRequest* request);
+	void answerStray(CMockRequest* request);
+	void freeObjects();
+	static void answerProcess(void* pv);
+};
+
+#endif
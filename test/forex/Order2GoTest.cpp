@@ -0,0 +1,262 @@
+﻿/*
+* Copyright 2020 FXDaemon
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include "stdafx.h"
+#include "Thread.h"
+#include "TrailingStop.h"
+#include "MarketCalendar.h"
+#include "TableListener.h"
+#include "ForexPlugin.h"
+#include "Test.h"
+
+static const DWORD WaitMs = 5000;
+
+// 2024-01-10 (Wednesday) 00:00 to 20:00 UTC, the market is open throughout.
+static const time_t RangeStart = 1704844800;
+static const time_t RangeEnd = RangeStart + 20 * 3600;
+// The round trip of every mock answer, long enough for a wave to be sent whole.
+static const DWORD LatencyMs = 20;
+
+// A plugin call on a thread of its own.
+typedef struct {
+	TblOrder Order;
+	CTrailingStop* TrailingStop;
+	int Result;
+	HANDLE Done;
+	CThread* Thread;
+} PluginCall;
+
+static void orderProcess(void* pv)
+{
+	PluginCall* call = (PluginCall*)pv;
+	call->Result = forexPlugin()->openMarketOrder(&call->Order);
+	nsapi::SetEvent(call->Done);
+}
+
+static void flushProcess(void* pv)
+{
+	PluginCall* call = (PluginCall*)pv;
+	call->Result = call->TrailingStop->flush();
+	nsapi::SetEvent(call->Done);
+}
+
+static void startCall(PluginCall* call, _threadFun threadFun)
+{
+	call->Result = -1;
+	call->Done = nsapi::CreateEvent(NULL, TRUE, FALSE, NULL);
+	ThreadFunAttr threadFunAttr = { threadFun, call };
+	call->Thread = new CThread(threadFunAttr);
+	call->Thread->_start();
+}
+
+// False when the call has not returned; its thread is then left behind.
+static bool joinCall(PluginCall* call)
+{
+	if (nsapi::WaitForSingleObject(call->Done, WaitMs) != WAIT_OBJECT_0) {
+		return false;
+	}
+	call->Thread->join();
+	delete call->Thread;
+	nsapi::CloseHandle(call->Done);
+	return true;
+}
+
+// The windows getHistoricalData asks for over start..end in m1, as COrder2Go plans them.
+static void planWindows(time_t start, time_t end, vector<pair<time_t, time_t> >& windows)
+{
+	CMarketCalendar calendar;
+	calendar.planWindows(start - 60, end, 60 * 240, windows);
+}
+
+// The m1 bars after start and before end, bar for bar as the mock prices them,
+// less those after gapFrom up to gapTo.
+static bool checkCandles(TblCandle** candles, int count, time_t start, time_t end, time_t gapFrom = 0, time_t gapTo = 0)
+{
+	int index = 0;
+	for (time_t t = start + 60; t < end; t += 60) {
+		if (t > gapFrom && t <= gapTo) {
+			continue;
+		}
+		if (index >= count) {
+			return false;
+		}
+		TblCandle* candle = candles[index++];
+		if (candle->StartDate != t || strcmp(candle->Symbol, "EUR/USD") || strcmp(candle->Period, "m1")
+			|| candle->BidOpen != CMockSession::barPrice(t) || candle->AskClose != CMockSession::barPrice(t) + 0.0001 + 0.0002) {
+			return false;
+		}
+	}
+	return index == count;
+}
+
+static void freeCandles(TblCandle** candles, int count)
+{
+	for (int i = 0; i < count; i++) {
+		delete candles[i];
+	}
+	if (count > 0) {
+		delete[] candles;
+	}
+}
+
+// Windows go out HistoryConcurrency (2) at a time and merge into one run of bars.
+TEST(ForexHistoryWaves)
+{
+	CHECK(forexPlugin() != NULL);
+	if (!forexPlugin()) {
+		return;
+	}
+	CMockSession* session = mockSession();
+	session->reset();
+	session->setLatency(LatencyMs);
+
+	vector<pair<time_t, time_t> > windows;
+	planWindows(RangeStart, RangeEnd, windows);
+	CHECK(windows.size() == 6);
+
+	TblCandle** candles = NULL;
+	int count = forexPlugin()->getHistoricalData("EUR/USD", "m1", RangeStart, RangeEnd, false, &candles);
+	CHECK(count == (int)(RangeEnd - RangeStart) / 60 - 1);
+	CHECK(checkCandles(candles, count, RangeStart, RangeEnd));
+	freeCandles(candles, count);
+
+	vector<CMockRequest*> sent;
+	session->getSent(sent);
+	CHECK(sent.size() == windows.size());
+	CHECK(session->getMaxInFlight() == 2);
+	for (size_t i = 0; i < sent.size() && i < windows.size(); i++) {
+		CHECK(CTableListener::date2Time(sent[i]->m_dtFrom) == windows[i].first);
+		CHECK(CTableListener::date2Time(sent[i]->m_dtTo) == windows[i].second);
+	}
+	session->reset();
+}
+
+// Answers of a wave in reverse order, each set led by one for an unknown
+// request ID, still land in their own windows.
+TEST(ForexHistoryOutOfOrder)
+{
+	CHECK(forexPlugin() != NULL);
+	if (!forexPlugin()) {
+		return;
+	}
+	CMockSession* session = mockSession();
+	session->reset();
+	session->setLatency(LatencyMs);
+	session->setReverse(true);
+	session->setStray(true);
+
+	TblCandle** candles = NULL;
+	int count = forexPlugin()->getHistoricalData("EUR/USD", "m1", RangeStart, RangeEnd, false, &candles);
+	CHECK(count == (int)(RangeEnd - RangeStart) / 60 - 1);
+	CHECK(checkCandles(candles, count, RangeStart, RangeEnd));
+	freeCandles(candles, count);
+	session->reset();
+}
+
+// A window the server has no data for leaves a gap of the bars only it held:
+// the next window starts on its last bar but, full, keeps the latest 240.
+// The windows after it follow in order.
+TEST(ForexHistoryFailedWindow)
+{
+	CHECK(forexPlugin() != NULL);
+	if (!forexPlugin()) {
+		return;
+	}
+	CMockSession* session = mockSession();
+	session->reset();
+	session->setLatency(LatencyMs);
+	session->setReverse(true);
+	session->failRequest(1, "unsupported scope");
+
+	vector<pair<time_t, time_t> > windows;
+	planWindows(RangeStart, RangeEnd, windows);
+	CHECK(windows.size() == 6);
+	if (windows.size() < 2) {
+		return;
+	}
+
+	TblCandle** candles = NULL;
+	int count = forexPlugin()->getHistoricalData("EUR/USD", "m1", RangeStart, RangeEnd, false, &candles);
+	int gap = (int)((windows[1].second - windows[1].first) / 60);
+	CHECK(gap > 0);
+	CHECK(count == (int)(RangeEnd - RangeStart) / 60 - 1 - gap);
+	CHECK(checkCandles(candles, count, RangeStart, RangeEnd, windows[1].first, windows[1].second));
+	freeCandles(candles, count);
+	session->reset();
+}
+
+// A market order placed while a trailing flush waits for its batch is sent
+// after the batch is answered, and each call gets the answer to its own request.
+TEST(ForexOrderDuringFlush)
+{
+	CHECK(forexPlugin() != NULL);
+	if (!forexPlugin()) {
+		return;
+	}
+	CMockSession* session = mockSession();
+	session->reset();
+	session->holdAnswers();
+
+	// Left behind with the flush thread should that one never return.
+	CTrailingStop* trailingStop = new CTrailingStop(forexPlugin());
+	TblTrade trade;
+	memset(&trade, 0, sizeof(trade));
+	strcpy(trade.TradeID, "T1");
+	strcpy(trade.AccountID, "A1");
+	strcpy(trade.OfferID, "1");
+	strcpy(trade.Symbol, "EUR/USD");
+	strcpy(trade.BS, "B");
+	trade.Amount = 1000;
+	trailingStop->add(&trade, 0.001, 0.0001);
+	TblPrice price;
+	memset(&price, 0, sizeof(price));
+	strcpy(price.Symbol, "EUR/USD");
+	price.Bid = 1.1;
+	price.Ask = 1.1002;
+	CHECK(trailingStop->onPrice(&price));
+
+	PluginCall flush;
+	flush.TrailingStop = trailingStop;
+	startCall(&flush, flushProcess);
+	CHECK(session->waitArrived(WaitMs));
+
+	PluginCall order;
+	memset(&order.Order, 0, sizeof(order.Order));
+	strcpy(order.Order.AccountID, "A1");
+	strcpy(order.Order.OfferID, "1");
+	strcpy(order.Order.Symbol, "EUR/USD");
+	strcpy(order.Order.BS, "B");
+	order.Order.Amount = 1000;
+	startCall(&order, orderProcess);
+	CHECK(!session->waitArrived(200));
+
+	session->releaseAnswers();
+	bool flushed = joinCall(&flush);
+	bool ordered = joinCall(&order);
+	CHECK(flushed && flush.Result == 1);
+	CHECK(ordered && order.Result == RET_SUCCESS);
+
+	vector<CMockRequest*> sent;
+	session->getSent(sent);
+	CHECK(sent.size() == 2);
+	if (sent.size() == 2) {
+		CHECK(sent[0]->m_vtChildren.size() == 1);
+		CHECK(sent[1]->m_pValueMap->getString(OrderType) == O2G2::Orders::TrueMarketOpen);
+		CHECK(string(order.Order.OrderID) == "O" + sent[1]->m_strRequestID);
+	}
+	if (flushed) {
+		delete trailingStop;
+	}
+}
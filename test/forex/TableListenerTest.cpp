@@ -0,0 +1,174 @@
+﻿/*
+* Copyright 2020 FXDaemon
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include "stdafx.h"
+#include "TableListener.h"
+#include "ForexMocks.h"
+#include "Test.h"
+
+// Keeps the callbacks in the order they reach the host.
+class CRecordingProxy : public IPluginProxy
+{
+public:
+	vector<string> m_vtEvents;
+	vector<TblPrice> m_vtPrices;
+
+	bool registerPlugin(const char* /*name*/, IBaseOrder* /*baseOrder*/) { return true; }
+	void onDisconnected() {}
+	void onMessage(MsgLevel /*level*/, const char* /*message*/) {}
+	void onPrice(TableStatus status, const TblPrice* tblPrice)
+	{
+		m_vtEvents.push_back(string(status == ST_NEW ? "new " : "upd ") + tblPrice->OfferID);
+		m_vtPrices.push_back(*tblPrice);
+	}
+	void onAccount(TableStatus /*status*/, const TblAccount* tblAccount) { m_vtEvents.push_back(string("account ") + tblAccount->AccountID); }
+	void onOrder(TableStatus /*status*/, const TblOrder* /*tblOrder*/) {}
+	void onOpenedTrade(TableStatus /*status*/, const TblTrade* /*tblTrade*/) {}
+	void onClosedTrade(TableStatus /*status*/, const TblTrade* /*tblTrade*/) {}
+};
+
+static string joinEvents(const vector<string>& events)
+{
+	string joined;
+	for (size_t i = 0; i < events.size(); i++) {
+		joined += (i ? ", " : "") + events[i];
+	}
+	return joined;
+}
+
+static DATE dateOfTime(time_t t)
+{
+	tm tmCal;
+	gmtime_r(&t, &tmCal);
+	return CTableListener::time2Date(tmCal);
+}
+
+// Whole seconds stay whole through the OLE date of ForexConnect, 1990-2037,
+// including the many whose nearest DATE lies a little below the second.
+TEST(DateWholeSeconds)
+{
+	int mismatches = 0;
+	int below = 0;
+	for (int64_t t = 631152000; t < 2145916800LL; t += 86400 * 3 + 7919) {
+		DATE date = dateOfTime((time_t)t);
+		below += ((long double)date - 25569) * 86400 < (long double)t;
+		if (CTableListener::date2TimeNs(date) != t * 1000000000 || CTableListener::date2Time(date) != (time_t)t) {
+			mismatches++;
+		}
+	}
+	CHECK(mismatches == 0);
+	CHECK(below > 0);
+}
+
+// Fractions round to the microsecond a DATE can hold; Time is truncated, so
+// it names the same second as TimeNs.
+TEST(DateFraction)
+{
+	time_t t = 1704888000;
+	static const int64_t us[] = { 1, 250, 123456, 500000, 999000 };
+	for (size_t i = 0; i < sizeof(us) / sizeof(us[0]); i++) {
+		DATE date = 25569 + ((double)t + us[i] / 1e6) / 86400;
+		int64_t ns = CTableListener::date2TimeNs(date);
+		CHECK(ns % 1000 == 0);
+		CHECK(llabs(ns - ((int64_t)t * 1000000000 + us[i] * 1000)) <= 1000);
+		CHECK(CTableListener::date2Time(date) == t);
+	}
+}
+
+TEST(DateBeforeEpoch)
+{
+	CHECK(CTableListener::date2TimeNs(0) == 0);
+	CHECK(CTableListener::date2TimeNs(25568.5) == 0);
+	CHECK(CTableListener::date2Time(25569) == 0);
+	CHECK(CTableListener::date2TimeNs(25569 + 1.0 / 86400) == 1000000000);
+}
+
+// An offer missing from the login snapshot is seeded from its Insert row,
+// later updates merge into it.
+TEST(RawSeedsInsertedOffer)
+{
+	CRecordingProxy proxy;
+	CTrailingStop trailingStop(NULL);
+	CTableListener listener(&proxy, NULL, &trailingStop);
+	CMockOfferRow inserted("7", "XAU/USD", 2030.1, 2030.5, 45301.5, false);
+	CMockOfferRow changed("7", "", 2031.1, 2031.6, 45301.5 + 1.0 / 86400, true);
+
+	CMockTablesUpdatesReader batch1;
+	batch1.add(Insert, &inserted);
+	listener.onTablesUpdates(&batch1);
+	CMockTablesUpdatesReader batch2;
+	batch2.add(Update, &changed);
+	listener.onTablesUpdates(&batch2);
+
+	CHECK(joinEvents(proxy.m_vtEvents) == "new 7, upd 7");
+	CHECK(proxy.m_vtPrices.size() == 2);
+	if (proxy.m_vtPrices.size() == 2) {
+		CHECK(strcmp(proxy.m_vtPrices[0].Symbol, "XAU/USD") == 0);
+		CHECK(proxy.m_vtPrices[0].Bid == 2030.1);
+		CHECK(strcmp(proxy.m_vtPrices[1].Symbol, "XAU/USD") == 0);
+		CHECK(proxy.m_vtPrices[1].Bid == 2031.1);
+		CHECK(proxy.m_vtPrices[1].Ask == 2031.6);
+		CHECK(proxy.m_vtPrices[1].Time == 1704888001);
+		CHECK(proxy.m_vtPrices[1].PointSize == 0.0001);
+	}
+}
+
+// A full Update row for an unknown offer seeds it as well; a partial one
+// cannot name its symbol and is dropped.
+TEST(RawSeedsUnknownOffer)
+{
+	CRecordingProxy proxy;
+	CTrailingStop trailingStop(NULL);
+	CTableListener listener(&proxy, NULL, &trailingStop);
+	CMockOfferRow partial("8", "", 1.25, 1.26, 45301.5, true);
+	CMockOfferRow full("9", "GBP/USD", 1.27, 1.28, 45301.5, false);
+
+	CMockTablesUpdatesReader batch;
+	batch.add(Update, &partial);
+	batch.add(Update, &full);
+	listener.onTablesUpdates(&batch);
+
+	CHECK(joinEvents(proxy.m_vtEvents) == "upd 9");
+	CHECK(proxy.m_vtPrices.size() == 1 && strcmp(proxy.m_vtPrices[0].Symbol, "GBP/USD") == 0);
+}
+
+// Callbacks follow the batch order; an offer updated twice is sent once, at
+// its last row, with its latest values.
+TEST(RawBatchOrder)
+{
+	CRecordingProxy proxy;
+	CTrailingStop trailingStop(NULL);
+	CTableListener listener(&proxy, NULL, &trailingStop);
+	CMockOfferRow snapshot("1", "EUR/USD", 1.1, 1.1001, 45301.5, false);
+	listener.onChanged("1", &snapshot);
+	proxy.m_vtEvents.clear();
+	proxy.m_vtPrices.clear();
+
+	CMockOfferRow tick1("1", "", 1.2, 1.2001, 45301.5, true);
+	CMockOfferRow tick2("1", "", 1.3, 1.3001, 45301.5, true);
+	CMockOfferRow inserted("2", "USD/JPY", 150.1, 150.2, 45301.5, false);
+	CMockAccountRow accountA("A", 1000);
+	CMockAccountRow accountB("B", 2000);
+	CMockTablesUpdatesReader batch;
+	batch.add(Insert, &inserted);
+	batch.add(Update, &tick1);
+	batch.add(Update, &accountA);
+	batch.add(Update, &tick2);
+	batch.add(Update, &accountB);
+	listener.onTablesUpdates(&batch);
+
+	CHECK(joinEvents(proxy.m_vtEvents) == "new 2, account A, upd 1, account B");
+	CHECK(proxy.m_vtPrices.size() == 2 && proxy.m_vtPrices[1].Bid == 1.3 && strcmp(proxy.m_vtPrices[1].Symbol, "EUR/USD") == 0);
+}
@@ -0,0 +1,176 @@
+﻿/*
+* Copyright 2020 FXDaemon
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include "stdafx.h"
+#include "RestPlugin.h"
+#include "Test.h"
+
+static const DWORD WaitMs = 5000;
+static const int BatchSize = 4;
+
+// Holds every market order until the whole batch has arrived, then every stop
+// and limit order until all of those have, so a batch sent one request at a
+// time times out instead of passing.
+typedef struct {
+	CCriticalSection Lock;
+	int NextID;
+	int Markets;
+	int Fills;
+	int Attaches;
+	bool Serial;			// a wave was not all in flight at once
+	bool Early;				// a stop or limit order came before every fill was answered
+	map<string, string> StopOrderIDs;	// by trade ID
+	map<string, string> LimitOrderIDs;
+	HANDLE AllMarkets;
+	HANDLE AllAttaches;
+} BatchBroker;
+
+// The string value of key in a flat JSON body.
+static string jsonField(const string& body, const char* key)
+{
+	string pattern = string("\"") + key + "\":\"";
+	size_t pos = body.find(pattern);
+	if (pos == string::npos) {
+		return "";
+	}
+	pos += pattern.size();
+	return body.substr(pos, body.find('"', pos) - pos);
+}
+
+static int answerBatch(const TestRequest& request, string& body, void* context)
+{
+	BatchBroker* broker = (BatchBroker*)context;
+	if (request.Method != "POST" || request.Path.find("/orders") == string::npos) {
+		return answerBroker(request, body);
+	}
+	string type = jsonField(request.Body, "type");
+	if (type == "MARKET") {
+		{
+			CCriticalSection::Lock l(broker->Lock);
+			if (++broker->Markets == BatchSize) {
+				nsapi::SetEvent(broker->AllMarkets);
+			}
+		}
+		bool together = nsapi::WaitForSingleObject(broker->AllMarkets, WaitMs) == WAIT_OBJECT_0;
+		CCriticalSection::Lock l(broker->Lock);
+		broker->Serial |= !together;
+		string tradeID = to_string(broker->NextID++);
+		string orderID = to_string(broker->NextID++);
+		string units = jsonField(request.Body, "units");
+		body = "{\"orderFillTransaction\":{\"id\":\"" + tradeID + "\",\"orderID\":\"" + orderID +
+			"\",\"instrument\":\"" + jsonField(request.Body, "instrument") + "\",\"type\":\"ORDER_FILL\",\"units\":\"" + units +
+			"\",\"time\":\"2024-01-10T12:00:00.000000000Z\",\"tradeOpened\":{\"tradeID\":\"" + tradeID +
+			"\",\"units\":\"" + units + "\",\"price\":\"1.10000\"}}}";
+		broker->Fills++;
+		return 200;
+	}
+
+	string tradeID = jsonField(request.Body, "tradeID");
+	{
+		CCriticalSection::Lock l(broker->Lock);
+		broker->Early |= broker->Fills < BatchSize;
+		if (++broker->Attaches == BatchSize * 2) {
+			nsapi::SetEvent(broker->AllAttaches);
+		}
+	}
+	bool together = nsapi::WaitForSingleObject(broker->AllAttaches, WaitMs) == WAIT_OBJECT_0;
+	CCriticalSection::Lock l(broker->Lock);
+	broker->Serial |= !together;
+	string orderID = to_string(broker->NextID++);
+	(type == "STOP_LOSS" ? broker->StopOrderIDs : broker->LimitOrderIDs)[tradeID] = orderID;
+	body = "{\"orderCreateTransaction\":{\"id\":\"" + orderID + "\",\"tradeID\":\"" + tradeID + "\",\"type\":\"" + type +
+		"\",\"price\":\"" + jsonField(request.Body, "price") + "\"}}";
+	return 200;
+}
+
+static void runBatch(BatchBroker* broker, TblOrder* orders, int* count)
+{
+	broker->NextID = 1000;
+	broker->Markets = broker->Fills = broker->Attaches = 0;
+	broker->Serial = broker->Early = false;
+	broker->AllMarkets = nsapi::CreateEvent(NULL, TRUE, FALSE, NULL);
+	broker->AllAttaches = nsapi::CreateEvent(NULL, TRUE, FALSE, NULL);
+	resetRestServer();
+	restServer()->setHandler(answerBatch, broker);
+
+	TblOrder* tblOrders[BatchSize + 1];
+	for (int i = 0; i < BatchSize; i++) {
+		memset(&orders[i], 0, sizeof(orders[i]));
+		strcpy(orders[i].Symbol, "EUR/USD");
+		strcpy(orders[i].BS, "B");
+		orders[i].Amount = 1000 + i;
+		orders[i].Stop = 1.0 + 0.01 * i;
+		orders[i].Limit = 1.2 + 0.01 * i;
+		tblOrders[i] = &orders[i];
+	}
+	tblOrders[BatchSize] = NULL;
+	*count = restPlugin()->openMarketOrders(tblOrders);
+
+	resetRestServer();
+	nsapi::CloseHandle(broker->AllMarkets);
+	nsapi::CloseHandle(broker->AllAttaches);
+}
+
+// The market orders of a batch are all in flight at once, and every caller's
+// order gets its own fill.
+TEST(RestBatchConcurrent)
+{
+	CHECK(restPlugin() != NULL);
+	if (!restPlugin()) {
+		return;
+	}
+	BatchBroker broker;
+	TblOrder orders[BatchSize];
+	int count;
+	runBatch(&broker, orders, &count);
+	CHECK(count == BatchSize);
+	CHECK(!broker.Serial);
+	set<string> orderIDs;
+	for (int i = 0; i < BatchSize; i++) {
+		CHECK(strlen(orders[i].OrderID) > 0);
+		orderIDs.insert(orders[i].OrderID);
+	}
+	CHECK(orderIDs.size() == BatchSize);
+}
+
+// Stop and limit orders go out as a second wave, all at once after every fill,
+// and each lands on the trade it was sent for.
+TEST(RestBatchSecondWave)
+{
+	CHECK(restPlugin() != NULL);
+	if (!restPlugin()) {
+		return;
+	}
+	BatchBroker broker;
+	TblOrder orders[BatchSize];
+	int count;
+	runBatch(&broker, orders, &count);
+	CHECK(count == BatchSize);
+	CHECK(!broker.Serial);
+	CHECK(!broker.Early);
+	CHECK(broker.Attaches == BatchSize * 2);
+	CHECK(broker.StopOrderIDs.size() == BatchSize && broker.LimitOrderIDs.size() == BatchSize);
+	for (map<string, string>::iterator it = broker.StopOrderIDs.begin(); it != broker.StopOrderIDs.end(); it++) {
+		TblTrade tblTrade;
+		CHECK(openedTrade(it->first.c_str(), &tblTrade));
+		CHECK(strcmp(tblTrade.StopOrderID, it->second.c_str()) == 0);
+		CHECK(strcmp(tblTrade.LimitOrderID, broker.LimitOrderIDs[it->first].c_str()) == 0);
+		// The stop and limit sent are the ones of the order that opened this trade.
+		int i = (int)tblTrade.Amount - 1000;
+		CHECK(i >= 0 && i < BatchSize && strcmp(orders[i].OrderID, tblTrade.OpenOrderID) == 0);
+		CHECK_NEAR(tblTrade.Stop, orders[i].Stop, 1e-9);
+		CHECK_NEAR(tblTrade.Limit, orders[i].Limit, 1e-9);
+	}
+}
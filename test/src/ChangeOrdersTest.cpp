@@ -0,0 +1,256 @@
+﻿/*
+* Copyright 2020 FXDaemon
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include "stdafx.h"
+#include "Thread.h"
+#include "RestPlugin.h"
+#include "Test.h"
+
+static const DWORD WaitMs = 5000;
+
+// One trade whose stop order is replaced by every change, as v20 does: the
+// change names the current order and the answer carries the new one's ID.
+// While Hold is set, each change waits for Release before it is answered.
+typedef struct {
+	CCriticalSection Lock;
+	string OrderID;
+	int NextID;
+	vector<string> Paths;
+	vector<string> Bodies;
+	int FailFirst;			// changes answered with an error
+	bool Hold;
+	HANDLE Arrived;
+	HANDLE Release;
+} ChangeBroker;
+
+typedef struct {
+	TblTrade Trade;
+	int Result;
+	HANDLE Done;
+	CThread* Thread;
+} ChangeCall;
+
+static int answerChange(const TestRequest& request, string& body, void* context)
+{
+	ChangeBroker* broker = (ChangeBroker*)context;
+	if (request.Method != "PUT" || request.Path.find("/orders/") == string::npos) {
+		return answerBroker(request, body);
+	}
+	int seq;
+	bool hold;
+	{
+		CCriticalSection::Lock l(broker->Lock);
+		broker->Paths.push_back(request.Path);
+		broker->Bodies.push_back(request.Body);
+		seq = broker->Paths.size();
+		hold = broker->Hold;
+	}
+	nsapi::SetEvent(broker->Arrived);
+	if (hold) {
+		nsapi::WaitForSingleObject(broker->Release, INFINITE);
+	}
+
+	CCriticalSection::Lock l(broker->Lock);
+	if (seq <= broker->FailFirst) {
+		body = "{\"errorMessage\":\"Injected error\"}";
+		return 503;
+	}
+	if (request.Path.substr(request.Path.rfind('/') + 1) != broker->OrderID) {
+		body = "{\"errorMessage\":\"Order not found\"}";
+		return 404;
+	}
+	broker->OrderID = to_string(broker->NextID++);
+	body = "{\"orderCreateTransaction\":{\"id\":\"" + broker->OrderID + "\",\"type\":\"STOP_LOSS\"}}";
+	return 200;
+}
+
+static void initBroker(ChangeBroker* broker, int failFirst)
+{
+	broker->OrderID = "100";
+	broker->NextID = 101;
+	broker->FailFirst = failFirst;
+	broker->Hold = true;
+	broker->Arrived = nsapi::CreateEvent(NULL, FALSE, FALSE, NULL);
+	broker->Release = nsapi::CreateEvent(NULL, FALSE, FALSE, NULL);
+	resetRestServer();
+	restServer()->setHandler(answerChange, broker);
+}
+
+static void freeBroker(ChangeBroker* broker)
+{
+	resetRestServer();
+	nsapi::CloseHandle(broker->Arrived);
+	nsapi::CloseHandle(broker->Release);
+}
+
+static void releaseAll(ChangeBroker* broker)
+{
+	{
+		CCriticalSection::Lock l(broker->Lock);
+		broker->Hold = false;
+	}
+	nsapi::SetEvent(broker->Release);
+}
+
+static size_t changesSeen(ChangeBroker* broker)
+{
+	CCriticalSection::Lock l(broker->Lock);
+	return broker->Paths.size();
+}
+
+static void changeProcess(void* pv)
+{
+	ChangeCall* call = (ChangeCall*)pv;
+	TblTrade* tblTrades[] = { &call->Trade, NULL };
+	call->Result = restPlugin()->changeStopLosses(tblTrades);
+	nsapi::SetEvent(call->Done);
+}
+
+static void startChange(ChangeCall* call, const char* tradeID, double stop)
+{
+	memset(&call->Trade, 0, sizeof(call->Trade));
+	strcpy(call->Trade.TradeID, tradeID);
+	strcpy(call->Trade.Symbol, "EUR/USD");
+	strcpy(call->Trade.StopOrderID, "100");
+	call->Trade.Stop = stop;
+	call->Result = -1;
+	call->Done = nsapi::CreateEvent(NULL, TRUE, FALSE, NULL);
+	ThreadFunAttr threadFunAttr = { changeProcess, call };
+	call->Thread = new CThread(threadFunAttr);
+	call->Thread->_start();
+}
+
+static bool isDone(ChangeCall* call)
+{
+	return nsapi::WaitForSingleObject(call->Done, 0) == WAIT_OBJECT_0;
+}
+
+static void joinChange(ChangeCall* call)
+{
+	nsapi::WaitForSingleObject(call->Done, WaitMs);
+	call->Thread->join();
+	delete call->Thread;
+	nsapi::CloseHandle(call->Done);
+}
+
+// The first call's change is held at the broker while the others queue behind it.
+static bool queueBehindFirst(ChangeBroker* broker, ChangeCall* calls, int count, const char* tradeID)
+{
+	startChange(&calls[0], tradeID, 0.51);
+	if (nsapi::WaitForSingleObject(broker->Arrived, WaitMs) != WAIT_OBJECT_0) {
+		return false;
+	}
+	for (int i = 1; i < count; i++) {
+		startChange(&calls[i], tradeID, 0.51 + 0.01 * i);
+		nsapi::Sleep(100);
+	}
+	return changesSeen(broker) == 1;
+}
+
+// Of the changes queued behind the one in flight only the latest is sent, and
+// every queued caller gets its result.
+TEST(RestChangeSupersede)
+{
+	CHECK(restPlugin() != NULL);
+	if (!restPlugin()) {
+		return;
+	}
+	ChangeBroker broker;
+	initBroker(&broker, 0);
+	ChangeCall calls[3];
+	CHECK(queueBehindFirst(&broker, calls, 3, "T1"));
+	releaseAll(&broker);
+	for (int i = 0; i < 3; i++) {
+		joinChange(&calls[i]);
+		CHECK(calls[i].Result == 1);
+	}
+	CHECK(broker.Paths.size() == 2);
+	CHECK(broker.Bodies.size() == 2 && broker.Bodies[1].find("\"0.530000\"") != string::npos);
+	freeBroker(&broker);
+}
+
+// The caller whose change is in flight sends the queued one, and neither
+// returns before the broker has answered it.
+TEST(RestChangeHandoff)
+{
+	CHECK(restPlugin() != NULL);
+	if (!restPlugin()) {
+		return;
+	}
+	ChangeBroker broker;
+	initBroker(&broker, 0);
+	ChangeCall calls[2];
+	CHECK(queueBehindFirst(&broker, calls, 2, "T2"));
+	nsapi::SetEvent(broker.Release);
+	CHECK(nsapi::WaitForSingleObject(broker.Arrived, WaitMs) == WAIT_OBJECT_0);
+	CHECK(!isDone(&calls[0]) && !isDone(&calls[1]));
+	releaseAll(&broker);
+	for (int i = 0; i < 2; i++) {
+		joinChange(&calls[i]);
+		CHECK(calls[i].Result == 1);
+	}
+	CHECK(broker.Paths.size() == 2);
+	freeBroker(&broker);
+}
+
+// The queued change names the order the one in flight created, and every
+// caller ends up holding the ID of the order the trade has now.
+TEST(RestChangeOrderIDs)
+{
+	CHECK(restPlugin() != NULL);
+	if (!restPlugin()) {
+		return;
+	}
+	ChangeBroker broker;
+	initBroker(&broker, 0);
+	ChangeCall calls[3];
+	CHECK(queueBehindFirst(&broker, calls, 3, "T3"));
+	releaseAll(&broker);
+	for (int i = 0; i < 3; i++) {
+		joinChange(&calls[i]);
+	}
+	CHECK(broker.Paths.size() == 2);
+	CHECK(broker.Paths.size() == 2 && broker.Paths[1].find("/orders/101") != string::npos);
+	CHECK(broker.OrderID == "102");
+	for (int i = 0; i < 3; i++) {
+		CHECK(strcmp(calls[i].Trade.StopOrderID, broker.OrderID.c_str()) == 0);
+	}
+	freeBroker(&broker);
+}
+
+// A failed change in flight fails only its own caller. The queued one goes out
+// against the order the trade still has, and both callers learn the new ID.
+TEST(RestChangeInFlightFails)
+{
+	CHECK(restPlugin() != NULL);
+	if (!restPlugin()) {
+		return;
+	}
+	ChangeBroker broker;
+	initBroker(&broker, 1);
+	ChangeCall calls[2];
+	CHECK(queueBehindFirst(&broker, calls, 2, "T4"));
+	releaseAll(&broker);
+	for (int i = 0; i < 2; i++) {
+		joinChange(&calls[i]);
+	}
+	CHECK(calls[0].Result == 0);
+	CHECK(calls[1].Result == 1);
+	CHECK(broker.Paths.size() == 2 && broker.Paths[1].find("/orders/100") != string::npos);
+	CHECK(broker.OrderID == "101");
+	CHECK(strcmp(calls[0].Trade.StopOrderID, "101") == 0);
+	CHECK(strcmp(calls[1].Trade.StopOrderID, "101") == 0);
+	freeBroker(&broker);
+}
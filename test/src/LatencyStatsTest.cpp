@@ -0,0 +1,115 @@
+﻿/*
+* Copyright 2020 FXDaemon
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include "stdafx.h"
+#include "LatencyStats.h"
+#include "Test.h"
+
+TEST(LatencyHistogramSmallValuesExact)
+{
+	CLatencyHistogram histogram;
+	LatencySummary summary;
+	histogram.summary(&summary);
+	CHECK(summary.Count == 0 && summary.P50Us == 0 && summary.MaxUs == 0);
+
+	for (int64_t us = 1; us <= 10; us++) {
+		histogram.record(us);
+	}
+	histogram.summary(&summary);
+	CHECK(summary.Count == 10);
+	CHECK(summary.MinUs == 1 && summary.MaxUs == 10 && summary.MeanUs == 5);
+	CHECK(summary.P50Us == 5 && summary.P90Us == 9 && summary.P99Us == 10);
+}
+
+// A value is reported as the top of its bucket, at most 1/16 above it.
+TEST(LatencyHistogramBucketBounds)
+{
+	int outside = 0;
+	for (int64_t us = 16; us < ((int64_t)1 << 39); us += us / 7 + 1) {
+		CLatencyHistogram histogram;
+		histogram.record(us);
+		histogram.record((int64_t)1 << 40);
+		LatencySummary summary;
+		histogram.summary(&summary);
+		if (summary.P50Us < us || summary.P50Us > us + us / 16) {
+			outside++;
+		}
+	}
+	CHECK(outside == 0);
+}
+
+TEST(LatencyHistogramPercentiles)
+{
+	CLatencyHistogram histogram;
+	for (int64_t us = 10000; us >= 1; us--) {
+		histogram.record(us);
+	}
+	LatencySummary summary;
+	histogram.summary(&summary);
+	CHECK(summary.Count == 10000 && summary.MeanUs == 5000);
+	CHECK(summary.P50Us >= 5000 && summary.P50Us <= 5000 + 5000 / 16);
+	CHECK(summary.P90Us >= 9000 && summary.P90Us <= 9000 + 9000 / 16);
+	CHECK(summary.P99Us >= 9900 && summary.P99Us <= 10000);
+}
+
+// Negative times count as 0, times past the last bucket are capped at the max.
+TEST(LatencyHistogramClamps)
+{
+	CLatencyHistogram histogram;
+	histogram.record(-5);
+	histogram.record((int64_t)1 << 50);
+	LatencySummary summary;
+	histogram.summary(&summary);
+	CHECK(summary.MinUs == 0);
+	CHECK(summary.P50Us == 0);
+	CHECK(summary.P99Us <= summary.MaxUs && summary.P99Us >= ((int64_t)1 << 40) - 1);
+}
+
+TEST(LatencyStatsEndpoints)
+{
+	CLatencyStats stats;
+	int price = stats.endpoint("GetPrice");
+	int account = stats.endpoint("GetAccount");
+	CHECK(price == 0 && account == 1);
+	CHECK(stats.endpoint("GetPrice") == price);
+	for (int i = 2; i < 32; i++) {
+		char name[16];
+		sprintf(name, "E%d", i);
+		CHECK(stats.endpoint(name) == i);
+	}
+	CHECK(stats.endpoint("OneTooMany") == -1);
+
+	stats.record(price, LAT_TOTAL, 1500);
+	stats.record(price, LAT_TOTAL, 2500);
+	stats.record(price, LAT_TTFB, 1000);
+	stats.record(-1, LAT_TOTAL, 1);
+	stats.record(32, LAT_TOTAL, 1);
+
+	vector<LatencySnapshot> snapshots;
+	stats.snapshot(snapshots);
+	CHECK(snapshots.size() == 32);
+	CHECK(snapshots[price].Endpoint == "GetPrice");
+	CHECK(snapshots[price].Phases[LAT_TOTAL].Count == 2);
+	CHECK(snapshots[price].Phases[LAT_TTFB].Count == 1);
+	CHECK(snapshots[account].Phases[LAT_TOTAL].Count == 0);
+
+	// Only endpoints with completed requests, only phases that were recorded.
+	string s = stats.toString();
+	CHECK(s.find("[Latency] GetPrice n:2 ") == 0);
+	CHECK(s.find("ttfb:") != string::npos && s.find("total:") != string::npos);
+	CHECK(s.find("dns:") == string::npos);
+	CHECK(s.find("GetAccount") == string::npos);
+	CHECK(s.find('\n') == string::npos);
+}
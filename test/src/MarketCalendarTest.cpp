@@ -0,0 +1,205 @@
+﻿/*
+* Copyright 2020 FXDaemon
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include "stdafx.h"
+#include "Utils.h"
+#include "MarketCalendar.h"
+#include "Test.h"
+
+// 2024-12-20 (Friday) 00:00 UTC
+static const time_t Dec20 = 1734652800;
+static const time_t Hour = 3600;
+static const time_t Day = 86400;
+
+static const char Holidays[] = "2024-12-25,2025-01-01";
+static const char EarlyCloses[] = "2024-12-24 18:00,2024-12-31 18:00";
+
+static void newCalendar(CMarketCalendar& calendar)
+{
+	calendar.setWeek(0, 19, 5, 21);
+	calendar.addHolidays(Holidays);
+	calendar.addEarlyCloses(EarlyCloses);
+}
+
+// The same calendar from gmtime, one rule at a time.
+static bool refOpen(time_t t)
+{
+	tm tmCal = CUtils::getUTCCal(t);
+	int secs = tmCal.tm_hour * 3600 + tmCal.tm_min * 60 + tmCal.tm_sec;
+	int pos = tmCal.tm_wday * 86400 + secs;
+	if (pos < 19 * 3600 || pos >= 5 * 86400 + 21 * 3600) {
+		return false;
+	}
+	int ymd = (tmCal.tm_year + 1900) * 10000 + (tmCal.tm_mon + 1) * 100 + tmCal.tm_mday;
+	if (ymd == 20241225 || ymd == 20250101) {
+		return false;
+	}
+	if ((ymd == 20241224 || ymd == 20241231) && secs >= 18 * 3600) {
+		return false;
+	}
+	return true;
+}
+
+// Trading seconds by the minute, from and to on whole minutes.
+static time_t refTradingSeconds(time_t from, time_t to)
+{
+	time_t secs = 0;
+	for (time_t t = from; t < to; t += 60) {
+		if (refOpen(t)) {
+			secs += 60;
+		}
+	}
+	return secs;
+}
+
+static uint32_t nextRandom(uint32_t& seed)
+{
+	seed = seed * 1664525 + 1013904223;
+	return seed >> 8;
+}
+
+TEST(MarketCalendarIsOpen)
+{
+	CMarketCalendar calendar;
+	newCalendar(calendar);
+	CHECK(calendar.isOpen(Dec20 + 21 * Hour - 1));
+	CHECK(!calendar.isOpen(Dec20 + 21 * Hour));
+	CHECK(!calendar.isOpen(Dec20 + 2 * Day + 19 * Hour - 1));
+	CHECK(calendar.isOpen(Dec20 + 2 * Day + 19 * Hour));
+	CHECK(calendar.isOpen(Dec20 + 4 * Day + 18 * Hour - 1));
+	CHECK(!calendar.isOpen(Dec20 + 4 * Day + 18 * Hour));
+	CHECK(!calendar.isOpen(Dec20 + 5 * Day + 12 * Hour));
+	CHECK(calendar.isOpen(Dec20 + 6 * Day));
+
+	int mismatches = 0;
+	for (time_t t = Dec20 - 7 * Day; t < Dec20 + 21 * Day; t += 15 * 60) {
+		if (calendar.isOpen(t) != refOpen(t)) {
+			mismatches++;
+		}
+	}
+	CHECK(mismatches == 0);
+}
+
+TEST(MarketCalendarNextOpen)
+{
+	CMarketCalendar calendar;
+	newCalendar(calendar);
+	CHECK(calendar.nextOpen(Dec20 + 12 * Hour) == Dec20 + 12 * Hour);
+	CHECK(calendar.nextOpen(Dec20 + Day) == Dec20 + 2 * Day + 19 * Hour);
+	CHECK(calendar.nextOpen(Dec20 + 4 * Day + 20 * Hour) == Dec20 + 6 * Day);
+}
+
+TEST(MarketCalendarTradingSeconds)
+{
+	CMarketCalendar calendar;
+	newCalendar(calendar);
+	CHECK(calendar.tradingSeconds(Dec20 + 21 * Hour, Dec20 + 2 * Day + 19 * Hour) == 0);
+	CHECK(calendar.tradingSeconds(Dec20 + 20 * Hour, Dec20 + 2 * Day + 20 * Hour) == 2 * Hour);
+
+	uint32_t seed = 1;
+	int mismatches = 0;
+	for (int i = 0; i < 100; i++) {
+		time_t from = Dec20 - 7 * Day + (time_t)(nextRandom(seed) % (21 * 24 * 60)) * 60;
+		time_t to = from + (time_t)(nextRandom(seed) % (14 * 24 * 60)) * 60;
+		if (calendar.tradingSeconds(from, to) != refTradingSeconds(from, to)) {
+			mismatches++;
+		}
+	}
+	CHECK(mismatches == 0);
+}
+
+// The result is the first time at which the trading time has passed, also across weeks.
+TEST(MarketCalendarAddTradingSeconds)
+{
+	CMarketCalendar calendar;
+	newCalendar(calendar);
+	CHECK(calendar.addTradingSeconds(Dec20 + 20 * Hour, 2 * Hour) == Dec20 + 2 * Day + 20 * Hour);
+	CHECK(calendar.addTradingSeconds(Dec20 + 20 * Hour, 0) == Dec20 + 20 * Hour);
+	CHECK(calendar.addTradingSeconds(Dec20 + Day, 0) == Dec20 + 2 * Day + 19 * Hour);
+
+	uint32_t seed = 7;
+	int mismatches = 0;
+	for (int i = 0; i < 200; i++) {
+		time_t from = Dec20 - 28 * Day + (time_t)(nextRandom(seed) % (42 * 24 * 60)) * 60;
+		time_t seconds = (time_t)(nextRandom(seed) % (i < 100 ? 5 * 24 * 60 : 20 * 24 * 60)) * 60 + 60;
+		time_t to = calendar.addTradingSeconds(from, seconds);
+		if (calendar.tradingSeconds(from, to) != seconds || calendar.tradingSeconds(from, to - 60) >= seconds
+			|| refTradingSeconds(from, to) != seconds) {
+			mismatches++;
+		}
+	}
+	CHECK(mismatches == 0);
+}
+
+// Windows are contiguous, cover the range and hold span seconds of trading time, the last one at most.
+TEST(MarketCalendarPlanWindows)
+{
+	CMarketCalendar calendar;
+	newCalendar(calendar);
+	time_t start = Dec20 - 3 * Day;
+	time_t end = Dec20 + 16 * Day + 7 * Hour;
+	time_t span = 30 * Hour;
+	vector<pair<time_t, time_t> > windows;
+	calendar.planWindows(start, end, span, windows);
+	CHECK(windows.size() > 1);
+	CHECK(windows.front().first == start);
+	CHECK(windows.back().second == end);
+	for (size_t i = 0; i < windows.size(); i++) {
+		time_t secs = calendar.tradingSeconds(windows[i].first, windows[i].second);
+		CHECK(i + 1 < windows.size() ? secs == span : secs <= span);
+		CHECK(i == 0 || windows[i].first == windows[i - 1].second);
+	}
+
+	calendar.planWindows(start, end, 0, windows);
+	CHECK(windows.size() == 1);
+	CHECK(windows[0].first == start && windows[0].second == end);
+}
+
+// The same open and close time is a market that never closes, holidays still apply.
+TEST(MarketCalendarAlwaysOpen)
+{
+	CMarketCalendar calendar;
+	calendar.setWeek(0, 0, 0, 0);
+	CHECK(calendar.tradingSeconds(Dec20, Dec20 + 7 * Day) == 7 * Day);
+	CHECK(calendar.addHolidays(Holidays) == 2);
+	CHECK(calendar.tradingSeconds(Dec20, Dec20 + 7 * Day) == 6 * Day);
+	CHECK(calendar.addTradingSeconds(Dec20 + 5 * Day - Hour, 2 * Hour) == Dec20 + 6 * Day + Hour);
+}
+
+// The history windows of getHistoricalData: m1 bars over the year-end holidays
+// never need more than 240 bars per request, and no more requests than the
+// trading time needs.
+TEST(MarketCalendarHistoryWindows)
+{
+	CMarketCalendar calendar;
+	newCalendar(calendar);
+	const time_t interval = 60;
+	const time_t candleMaxNumber = 240;
+	time_t start = Dec20 + 10 * Hour + 17 * 60;
+	time_t end = Dec20 + 14 * Day + 3 * Hour;
+	vector<pair<time_t, time_t> > windows;
+	calendar.planWindows(start - interval, end, interval * candleMaxNumber, windows);
+
+	time_t bars = refTradingSeconds(start - interval, end) / interval;
+	CHECK(windows.size() == (size_t)((bars + candleMaxNumber - 1) / candleMaxNumber));
+	int oversized = 0;
+	for (size_t i = 0; i < windows.size(); i++) {
+		if (refTradingSeconds(windows[i].first, windows[i].second) / interval > candleMaxNumber) {
+			oversized++;
+		}
+	}
+	CHECK(oversized == 0);
+	CHECK(windows.front().first == start - interval && windows.back().second == end);
+}
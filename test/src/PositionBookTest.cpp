@@ -0,0 +1,157 @@
+﻿/*
+* Copyright 2020 FXDaemon
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include "stdafx.h"
+#include "PositionBook.h"
+#include "Test.h"
+
+static TblTrade newTrade(const char* tradeID, const char* symbol, const char* bs, double amount, double open)
+{
+	TblTrade tblTrade;
+	memset(&tblTrade, 0, sizeof(tblTrade));
+	strcpy(tblTrade.TradeID, tradeID);
+	strcpy(tblTrade.Symbol, symbol);
+	strcpy(tblTrade.BS, bs);
+	tblTrade.Amount = amount;
+	tblTrade.Open = open;
+	tblTrade.GrossPL = PL_INVALID;
+	return tblTrade;
+}
+
+static TblPrice newPrice(const char* symbol, double bid, double ask)
+{
+	TblPrice tblPrice;
+	memset(&tblPrice, 0, sizeof(tblPrice));
+	strcpy(tblPrice.Symbol, symbol);
+	tblPrice.Bid = bid;
+	tblPrice.Ask = ask;
+	return tblPrice;
+}
+
+static TblAccount newAccount(const char* currency, double balance)
+{
+	TblAccount tblAccount;
+	memset(&tblAccount, 0, sizeof(tblAccount));
+	strcpy(tblAccount.Currency, currency);
+	tblAccount.Balance = balance;
+	return tblAccount;
+}
+
+// A buy is valued at the bid, in the account currency when it is the quote currency.
+TEST(PositionBookBuyInQuoteCurrency)
+{
+	CPositionBook book(0, 0, 1);
+	TblAccount tblAccount = newAccount("USD", 1000);
+	book.setAccount(&tblAccount);
+	TblTrade tblTrade = newTrade("1", "EUR/USD", "B", 10000, 1.1000);
+	book.setTrade(&tblTrade);
+
+	TblPrice tblPrice = newPrice("EUR/USD", 1.1010, 1.1012);
+	vector<TblTrade> tblTrades;
+	CHECK(book.onPrice(&tblPrice, tblTrades, &tblAccount));
+	CHECK(tblTrades.size() == 1);
+	CHECK_NEAR(tblTrades[0].PL, 10, 1e-6);
+	CHECK_NEAR(tblTrades[0].GrossPL, 10, 1e-6);
+	CHECK_NEAR(tblAccount.GrossPL, 10, 1e-6);
+	CHECK_NEAR(tblAccount.Equity, 1010, 1e-6);
+}
+
+// A sell is valued at the ask and converted through the inverse account pair.
+TEST(PositionBookSellConvertedByInversePair)
+{
+	CPositionBook book(0, 0, 1);
+	TblAccount tblAccount = newAccount("USD", 1000);
+	book.setAccount(&tblAccount);
+	TblPrice conversion = newPrice("USD/JPY", 149.88, 149.90);
+	vector<TblTrade> tblTrades;
+	book.onPrice(&conversion, tblTrades, &tblAccount);
+
+	TblTrade tblTrade = newTrade("1", "EUR/JPY", "S", 10000, 163.00);
+	book.setTrade(&tblTrade);
+	TblPrice tblPrice = newPrice("EUR/JPY", 162.88, 162.90);
+	tblTrades.clear();
+	book.onPrice(&tblPrice, tblTrades, &tblAccount);
+	CHECK(tblTrades.size() == 1);
+	CHECK_NEAR(tblTrades[0].PL, 10, 1e-6);
+	CHECK_NEAR(tblTrades[0].GrossPL, 0.10 * 10000 / 149.89, 1e-6);
+}
+
+// Without an account currency the broker's pip cost per PipCostAmount units is used.
+TEST(PositionBookPipCostWithoutAccount)
+{
+	CPositionBook book(0, 0, 1000);
+	TblTrade tblTrade = newTrade("1", "USD/JPY", "B", 10000, 150.00);
+	book.setTrade(&tblTrade);
+
+	TblPrice tblPrice = newPrice("USD/JPY", 150.10, 150.12);
+	tblPrice.PipCost = 0.0667;
+	vector<TblTrade> tblTrades;
+	TblAccount tblAccount;
+	CHECK(!book.onPrice(&tblPrice, tblTrades, &tblAccount));
+	CHECK(tblTrades.size() == 1);
+	CHECK_NEAR(tblTrades[0].PL, 10, 1e-6);
+	CHECK_NEAR(tblTrades[0].GrossPL, 10 * 0.0667 * 10, 1e-6);
+}
+
+// Trades and the account are only reported once they moved by the thresholds.
+TEST(PositionBookThresholds)
+{
+	CPositionBook book(5, 20, 1);
+	TblAccount tblAccount = newAccount("USD", 1000);
+	book.setAccount(&tblAccount);
+	TblTrade tblTrade = newTrade("1", "EUR/USD", "B", 10000, 1.1000);
+	book.setTrade(&tblTrade);
+
+	vector<TblTrade> tblTrades;
+	TblPrice tblPrice = newPrice("EUR/USD", 1.1000, 1.1002);
+	CHECK(!book.onPrice(&tblPrice, tblTrades, &tblAccount));
+	CHECK(tblTrades.size() == 1);
+
+	tblTrades.clear();
+	tblPrice.Bid = 1.1004;
+	CHECK(!book.onPrice(&tblPrice, tblTrades, &tblAccount));
+	CHECK(tblTrades.empty());
+
+	tblPrice.Bid = 1.1006;
+	CHECK(!book.onPrice(&tblPrice, tblTrades, &tblAccount));
+	CHECK(tblTrades.size() == 1);
+
+	tblTrades.clear();
+	tblPrice.Bid = 1.1020;
+	CHECK(book.onPrice(&tblPrice, tblTrades, &tblAccount));
+	CHECK_NEAR(tblAccount.Equity, 1020, 1e-6);
+}
+
+// A closed trade moves its gross P/L into the balance and leaves the revaluation.
+TEST(PositionBookCloseTrade)
+{
+	CPositionBook book(0, 0, 1);
+	TblAccount tblAccount = newAccount("USD", 1000);
+	book.setAccount(&tblAccount);
+	TblTrade tblTrade = newTrade("1", "EUR/USD", "B", 10000, 1.1000);
+	book.setTrade(&tblTrade);
+	vector<TblTrade> tblTrades;
+	TblPrice tblPrice = newPrice("EUR/USD", 1.1010, 1.1012);
+	book.onPrice(&tblPrice, tblTrades, &tblAccount);
+
+	book.closeTrade("1", 10);
+	tblTrades.clear();
+	tblPrice.Bid = 1.1050;
+	CHECK(book.onPrice(&tblPrice, tblTrades, &tblAccount));
+	CHECK(tblTrades.empty());
+	CHECK_NEAR(tblAccount.Balance, 1010, 1e-6);
+	CHECK_NEAR(tblAccount.GrossPL, 0, 1e-6);
+	CHECK_NEAR(tblAccount.Equity, 1010, 1e-6);
+}
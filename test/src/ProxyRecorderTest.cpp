@@ -0,0 +1,145 @@
+﻿/*
+* Copyright 2020 FXDaemon
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include "stdafx.h"
+#include "Thread.h"
+#include "ProxyRecorder.h"
+#include "Test.h"
+
+// Counts what reaches the host.
+class CCountingProxy : public IPluginProxy
+{
+public:
+	atomic<int> m_nPrices;
+	int m_nOthers;
+
+	CCountingProxy() : m_nOthers(0) { m_nPrices.store(0); }
+
+	bool registerPlugin(const char* /*name*/, IBaseOrder* /*baseOrder*/) { m_nOthers++; return true; }
+	void onDisconnected() { m_nOthers++; }
+	void onMessage(MsgLevel /*level*/, const char* /*message*/) { m_nOthers++; }
+	void onPrice(TableStatus /*status*/, const TblPrice* /*tblPrice*/) { m_nPrices++; }
+	void onAccount(TableStatus /*status*/, const TblAccount* /*tblAccount*/) { m_nOthers++; }
+	void onOrder(TableStatus /*status*/, const TblOrder* /*tblOrder*/) { m_nOthers++; }
+	void onOpenedTrade(TableStatus /*status*/, const TblTrade* /*tblTrade*/) { m_nOthers++; }
+	void onClosedTrade(TableStatus /*status*/, const TblTrade* /*tblTrade*/) { m_nOthers++; }
+};
+
+static const char DumpFile[] = "/tmp/proxyrecorder-test.txt";
+
+static void readLines(const char* fileName, vector<string>& lines)
+{
+	lines.clear();
+	FILE* fp = fopen(fileName, "r");
+	if (!fp) {
+		return;
+	}
+	char buf[512];
+	while (fgets(buf, sizeof(buf), fp)) {
+		lines.push_back(buf);
+	}
+	fclose(fp);
+}
+
+// Every callback reaches the host, the ring keeps the latest events oldest first.
+TEST(ProxyRecorderRing)
+{
+	CCountingProxy proxy;
+	CProxyRecorder recorder(&proxy, 5);
+	TblPrice tblPrice;
+	memset(&tblPrice, 0, sizeof(tblPrice));
+	for (int i = 0; i < 10; i++) {
+		sprintf(tblPrice.Symbol, "S%d", i);
+		tblPrice.Bid = i;
+		recorder.onPrice(ST_UPD, &tblPrice);
+	}
+	TblTrade tblTrade;
+	memset(&tblTrade, 0, sizeof(tblTrade));
+	strcpy(tblTrade.TradeID, "T1");
+	recorder.onOpenedTrade(ST_NEW, &tblTrade);
+	recorder.onMessage(MSG_INFO, "not recorded");
+
+	CHECK(proxy.m_nPrices == 10 && proxy.m_nOthers == 2);
+	CHECK(recorder.getCount(REC_PRICE) == 10);
+	CHECK(recorder.getCount(REC_OPENEDTRADE) == 1);
+	CHECK(recorder.getCount(REC_ACCOUNT) == 0);
+
+	CHECK(recorder.dump(DumpFile) == 8);
+	vector<string> lines;
+	readLines(DumpFile, lines);
+	CHECK(lines.size() == 2 * REC_MAX + 8);
+	CHECK(lines[0] == "# Price Count:10\n");
+	CHECK(lines[6] == "# OpenedTrade Count:1\n");
+
+	// Nine intervals between ten prices.
+	unsigned int intervals = 0, n;
+	const char* p = strchr(lines[1].c_str(), ':') + 1;
+	int used;
+	while (sscanf(p, " %u%n", &n, &used) == 1) {
+		intervals += n;
+		p += used;
+	}
+	CHECK(intervals == 9);
+
+	const string& first = lines[2 * REC_MAX];
+	CHECK(first.find("\tPrice\t1\tS3\t3.000000\t") != string::npos);
+	CHECK(lines.back().find("\tOpenedTrade\t0\tT1\t") != string::npos);
+	remove(DumpFile);
+}
+
+static void recordPrices(void* pv)
+{
+	CProxyRecorder* recorder = (CProxyRecorder*)pv;
+	TblPrice tblPrice;
+	memset(&tblPrice, 0, sizeof(tblPrice));
+	strcpy(tblPrice.Symbol, "EUR/USD");
+	for (int i = 0; i < 20000; i++) {
+		tblPrice.Bid = i;
+		recorder->onPrice(ST_UPD, &tblPrice);
+	}
+}
+
+// Producers on several threads lose no count, and the dump taken meanwhile only holds whole events.
+TEST(ProxyRecorderConcurrent)
+{
+	CCountingProxy proxy;
+	CProxyRecorder recorder(&proxy, 1024);
+	ThreadFunAttr threadFunAttr = { recordPrices, &recorder };
+	vector<CThread*> threads;
+	for (int i = 0; i < 4; i++) {
+		threads.push_back(new CThread(threadFunAttr));
+		threads.back()->_start();
+	}
+	int dumped = recorder.dump(DumpFile);
+	for (size_t i = 0; i < threads.size(); i++) {
+		threads[i]->join();
+		delete threads[i];
+	}
+	CHECK(dumped >= 0 && dumped <= 1024);
+	CHECK(recorder.getCount(REC_PRICE) == 80000);
+	CHECK(proxy.m_nPrices == 80000);
+
+	CHECK(recorder.dump(DumpFile) == 1024);
+	vector<string> lines;
+	readLines(DumpFile, lines);
+	int malformed = 0;
+	for (size_t i = 2 * REC_MAX; i < lines.size(); i++) {
+		if (lines[i].find("\tPrice\t1\tEUR/USD\t") == string::npos) {
+			malformed++;
+		}
+	}
+	CHECK(malformed == 0);
+	remove(DumpFile);
+}
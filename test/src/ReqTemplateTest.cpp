@@ -0,0 +1,98 @@
+﻿/*
+* Copyright 2020 FXDaemon
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include "stdafx.h"
+#include "ReqTemplate.h"
+#include "Test.h"
+
+static ReqParam newParam(const char* key, const char* value)
+{
+	ReqParam param;
+	param.key = key;
+	param.value = value;
+	return param;
+}
+
+TEST(ReqTemplatePathParams)
+{
+	CReqTemplate tmpl;
+	tmpl.compile("/v3/accounts/$account_id/trades/$trade_id/orders");
+	map<string, string> params;
+	params["$account_id"] = "101-001";
+	params["$trade_id"] = "42";
+	string out;
+	tmpl.render(params, out);
+	CHECK(out == "/v3/accounts/101-001/trades/42/orders");
+}
+
+TEST(ReqTemplateRequestBody)
+{
+	CReqTemplate tmpl;
+	tmpl.compile("{\"order\":{\"units\":\"$units\",\"instrument\":\"$instrument\",\"type\":\"MARKET\"}}");
+	vector<ReqParam> params;
+	params.push_back(newParam("$instrument", "EUR_USD"));
+	params.push_back(newParam("$units", "-1000"));
+	string out;
+	tmpl.render(&params, out);
+	CHECK(out == "{\"order\":{\"units\":\"-1000\",\"instrument\":\"EUR_USD\",\"type\":\"MARKET\"}}");
+}
+
+// A parameter is the longest name after '$', a shorter key never matches part of it.
+TEST(ReqTemplateLongestName)
+{
+	CReqTemplate tmpl;
+	tmpl.compile("$instrument_id/$instrument");
+	vector<ReqParam> params;
+	params.push_back(newParam("$instrument", "EUR_USD"));
+	string out;
+	tmpl.render(&params, out);
+	CHECK(out == "$instrument_id/EUR_USD");
+}
+
+// Unknown parameters and a '$' without a name are kept as written.
+TEST(ReqTemplateKeepsUnknown)
+{
+	CReqTemplate tmpl;
+	tmpl.compile("a=$a&b=$b&c=$-&d=$");
+	vector<ReqParam> params;
+	params.push_back(newParam("$a", "1"));
+	string out;
+	tmpl.render(&params, out);
+	CHECK(out == "a=1&b=$b&c=$-&d=$");
+
+	out.clear();
+	tmpl.render(NULL, out);
+	CHECK(out == tmpl.getText());
+}
+
+// render appends, and compile replaces the previous template.
+TEST(ReqTemplateRecompile)
+{
+	CReqTemplate tmpl;
+	CHECK(tmpl.empty());
+	tmpl.compile("/v3/$x");
+	map<string, string> params;
+	params["$x"] = "1";
+	params["$y"] = "2";
+	string out("https://host");
+	tmpl.render(params, out);
+	CHECK(out == "https://host/v3/1");
+
+	tmpl.compile("$y$x");
+	out.clear();
+	tmpl.render(params, out);
+	CHECK(out == "21");
+	CHECK(!tmpl.empty());
+}
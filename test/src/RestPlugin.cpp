@@ -0,0 +1,170 @@
+﻿/*
+* Copyright 2020 FXDaemon
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include "stdafx.h"
+#include "SimpleIni.h"
+#include "IPluginProxy.h"
+#include "Utils.h"
+#include "RestPlugin.h"
+
+static const char* ConfigFile = "conf/test-restapi.cfg";
+static const char* RunConfigFile = "/tmp/test-restapi.cfg";
+
+// Takes the plugin's registration and keeps the opened trades it reports.
+class CTestProxy : public IPluginProxy
+{
+public:
+	IBaseOrder* m_pBaseOrder;
+	map<string, TblTrade> m_mapTrades;
+	CCriticalSection m_csTrades;
+
+	CTestProxy() : m_pBaseOrder(NULL) {}
+
+	bool registerPlugin(const char* /*name*/, IBaseOrder* baseOrder) { m_pBaseOrder = baseOrder; return true; }
+	void onDisconnected() {}
+	void onMessage(MsgLevel /*level*/, const char* /*message*/) {}
+	void onPrice(TableStatus /*status*/, const TblPrice* /*tblPrice*/) {}
+	void onAccount(TableStatus /*status*/, const TblAccount* /*tblAccount*/) {}
+	void onOrder(TableStatus /*status*/, const TblOrder* /*tblOrder*/) {}
+	void onOpenedTrade(TableStatus status, const TblTrade* tblTrade)
+	{
+		CCriticalSection::Lock l(m_csTrades);
+		if (status == ST_DEL) {
+			m_mapTrades.erase(tblTrade->TradeID);
+		}
+		else {
+			m_mapTrades[tblTrade->TradeID] = *tblTrade;
+		}
+	}
+	void onClosedTrade(TableStatus /*status*/, const TblTrade* /*tblTrade*/) {}
+};
+
+// Function-local, the plugin registers from its static constructor.
+static CTestProxy* testProxy()
+{
+	static CTestProxy proxy;
+	return &proxy;
+}
+
+extern "C" IPluginProxy* getPluginProxy()
+{
+	return testProxy();
+}
+
+CTestServer* restServer()
+{
+	static CTestServer server;
+	return &server;
+}
+
+static int brokerHandler(const TestRequest& request, string& body, void* /*context*/)
+{
+	return answerBroker(request, body);
+}
+
+static void closeRestPlugin()
+{
+	testProxy()->m_pBaseOrder->close();
+}
+
+IBaseOrder* restPlugin()
+{
+	static IBaseOrder* baseOrder = NULL;
+	static bool started = false;
+	if (started) {
+		return baseOrder;
+	}
+	started = true;
+	if (!testProxy()->m_pBaseOrder || restServer()->start() != RET_SUCCESS) {
+		return NULL;
+	}
+	resetRestServer();
+
+	CSimpleIniCaseA ini;
+	if (ini.LoadFile(ConfigFile) != SI_OK) {
+		return NULL;
+	}
+	string host = "http://127.0.0.1:" + to_string(restServer()->getPort());
+	ini.SetValue("Base", "Host", host.c_str());
+	if (ini.SaveFile(RunConfigFile) != SI_OK) {
+		return NULL;
+	}
+	if (testProxy()->m_pBaseOrder->init(RunConfigFile) != RET_SUCCESS || testProxy()->m_pBaseOrder->login() != RET_SUCCESS) {
+		return NULL;
+	}
+	baseOrder = testProxy()->m_pBaseOrder;
+	atexit(closeRestPlugin);
+	return baseOrder;
+}
+
+bool openedTrade(const char* tradeID, TblTrade* tblTrade)
+{
+	CTestProxy* proxy = testProxy();
+	CCriticalSection::Lock l(proxy->m_csTrades);
+	map<string, TblTrade>::iterator it = proxy->m_mapTrades.find(tradeID);
+	if (it == proxy->m_mapTrades.end()) {
+		return false;
+	}
+	*tblTrade = it->second;
+	return true;
+}
+
+void resetRestServer()
+{
+	restServer()->setHandler(brokerHandler, NULL);
+	restServer()->clearRequests();
+}
+
+int answerBroker(const TestRequest& request, string& body)
+{
+	if (request.Method != "GET") {
+		return 0;
+	}
+	if (request.Path.find("/pricing") != string::npos) {
+		string now = CUtils::strOfTimeWithRFC3339(time(NULL)) + ".000000000Z";
+		string instruments;
+		size_t pos = request.Query.find("instruments=");
+		if (pos != string::npos) {
+			instruments = request.Query.substr(pos + 12, request.Query.find('&', pos) - pos - 12);
+			CUtils::replace(instruments, "%2C", ",");
+		}
+		body = "{\"prices\":[";
+		size_t start = 0;
+		while (start <= instruments.size() && !instruments.empty()) {
+			size_t end = instruments.find(',', start);
+			string symbol = instruments.substr(start, end == string::npos ? string::npos : end - start);
+			if (start > 0) {
+				body += ",";
+			}
+			body += "{\"instrument\":\"" + symbol + "\",\"time\":\"" + now +
+				"\",\"closeoutBid\":\"1.10000\",\"closeoutAsk\":\"1.10010\"}";
+			if (end == string::npos) {
+				break;
+			}
+			start = end + 1;
+		}
+		body += "],\"time\":\"" + now + "\"}";
+		return 200;
+	}
+	if (request.Path.find("/summary") != string::npos) {
+		body = "{\"account\":{\"id\":\"101-000-0000000-001\",\"alias\":\"test\",\"currency\":\"USD\",\"balance\":\"100000.0000\"}}";
+		return 200;
+	}
+	if (request.Path.find("/openTrades") != string::npos || request.Path.find("/trades") != string::npos) {
+		body = "{\"trades\":[]}";
+		return 200;
+	}
+	return 0;
+}
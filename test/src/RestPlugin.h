@@ -0,0 +1,22 @@
+#ifndef RESTPLUGIN_H
+#define RESTPLUGIN_H
+
+#include "IBaseOrder.h"
+#include "TestServer.h"
+
+// The COrder2Rest linked into the test binary, logged in on first use against
+// restServer() with conf/test-restapi.cfg. NULL when that fails.
+IBaseOrder* restPlugin();
+CTestServer* restServer();
+
+// The trade last reported to the host by onOpenedTrade, false once it was deleted.
+bool openedTrade(const char* tradeID, TblTrade* tblTrade);
+
+// Puts the broker answers back as the handler and clears the request log.
+void resetRestServer();
+
+// Answers prices, the account and empty trade lists as a broker would; a test's
+// handler passes on what it does not script.
+int answerBroker(const TestRequest& request, string& body);
+
+#endif
@@ -0,0 +1,95 @@
+﻿/*
+* Copyright 2020 FXDaemon
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include "stdafx.h"
+#include "Utils.h"
+#include "ServerClock.h"
+#include "Test.h"
+
+static const int64_t Ms = 1000000;
+static const int64_t Sec = 1000000000;
+
+// Server time of a request answered halfway between send and receive, truncated to resolutionNs.
+static int64_t serverTime(int64_t sendNs, int64_t recvNs, int64_t offsetNs, int64_t resolutionNs)
+{
+	int64_t ns = sendNs + (recvNs - sendNs) / 2 + offsetNs;
+	return ns - ns % resolutionNs;
+}
+
+TEST(ServerClockUnsynced)
+{
+	CServerClock clock;
+	CHECK(!clock.isSynced());
+	CHECK(llabs(clock.nowNs() - CUtils::getRealtimeNs()) < 10 * Ms);
+
+	int64_t localNs = CUtils::getMonotonicNs();
+	clock.addSample(localNs, localNs - Ms, 1700000000 * Sec, Sec);
+	clock.addSample(localNs - Ms, localNs, 0, Sec);
+	CHECK(!clock.isSynced());
+}
+
+// Whole-second server times from requests 7 ms apart in phase narrow the offset
+// to a few ms.
+TEST(ServerClockIntersectsSamples)
+{
+	CServerClock clock;
+	int64_t offsetNs = 1700000000 * Sec + 123456789 - CUtils::getMonotonicNs();
+	int64_t startNs = CUtils::getMonotonicNs() - 160 * Sec;
+	for (int i = 0; i < 150; i++) {
+		int64_t sendNs = startNs + i * 1007 * Ms;
+		int64_t recvNs = sendNs + 2 * Ms;
+		clock.addSample(sendNs, recvNs, serverTime(sendNs, recvNs, offsetNs, Sec), Sec);
+	}
+	CHECK(clock.isSynced());
+	int64_t errorNs = clock.nowNs() - (CUtils::getMonotonicNs() + offsetNs);
+	CHECK(llabs(errorNs) < 5 * Ms);
+}
+
+// A sample outside the common bounds means a clock was stepped, the window restarts from it.
+TEST(ServerClockFollowsStep)
+{
+	CServerClock clock;
+	int64_t offsetNs = 1700000000 * Sec - CUtils::getMonotonicNs();
+	int64_t startNs = CUtils::getMonotonicNs() - 10 * Sec;
+	for (int i = 0; i < 20; i++) {
+		int64_t sendNs = startNs + i * 250 * Ms;
+		clock.addSample(sendNs, sendNs + Ms, serverTime(sendNs, sendNs + Ms, offsetNs, Ms), Ms);
+	}
+	offsetNs += 30 * Sec;
+	int64_t sendNs = startNs + 6 * Sec;
+	clock.addSample(sendNs, sendNs + Ms, serverTime(sendNs, sendNs + Ms, offsetNs, Ms), Ms);
+	int64_t errorNs = clock.nowNs() - (CUtils::getMonotonicNs() + offsetNs);
+	CHECK(llabs(errorNs) < 5 * Ms);
+}
+
+// A server running 100 ppm fast drifts out of the bounds of 1 ms samples within
+// seconds, yet the drift is learned over ten minutes and extrapolated a minute
+// ahead; without it the error would be 6 ms.
+TEST(ServerClockEstimatesDrift)
+{
+	CServerClock clock;
+	int64_t nowNs = CUtils::getMonotonicNs();
+	int64_t offsetNs = 1700000000 * Sec - nowNs;
+	int64_t startNs = nowNs - 660 * Sec;
+	for (int i = 0; i <= 300; i++) {
+		int64_t sendNs = startNs + i * 2 * Sec;
+		int64_t recvNs = sendNs + Ms / 5;
+		int64_t driftNs = (sendNs - startNs) / 10000;
+		clock.addSample(sendNs, recvNs, serverTime(sendNs, recvNs, offsetNs + driftNs, Ms), Ms);
+	}
+	nowNs = CUtils::getMonotonicNs();
+	int64_t expectedNs = nowNs + offsetNs + (nowNs - startNs) / 10000;
+	CHECK(llabs(clock.nowNs() - expectedNs) < Ms);
+}
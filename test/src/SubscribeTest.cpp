@@ -0,0 +1,128 @@
+﻿/*
+* Copyright 2020 FXDaemon
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include "stdafx.h"
+#include "Utils.h"
+#include "RestPlugin.h"
+#include "Test.h"
+
+// The poll thread runs every 100 ms, the test config polls prices every round.
+static const DWORD PollMs = 300;
+
+// Price requests since the log was cleared, by their instruments parameter.
+static void pricedSymbols(vector<string>& instruments)
+{
+	vector<TestRequest> requests;
+	restServer()->getRequests(requests);
+	instruments.clear();
+	for (size_t i = 0; i < requests.size(); i++) {
+		if (requests[i].Path.find("/pricing") != string::npos) {
+			string query = requests[i].Query;
+			CUtils::replace(query, "%2C", ",");
+			instruments.push_back(query.substr(query.find('=') + 1));
+		}
+	}
+}
+
+// What the poll asks for once any change in flight has settled.
+static void polledSymbols(vector<string>& instruments)
+{
+	nsapi::Sleep(PollMs / 2);
+	restServer()->clearRequests();
+	nsapi::Sleep(PollMs);
+	pricedSymbols(instruments);
+}
+
+static bool allEqual(const vector<string>& values, const char* value)
+{
+	for (size_t i = 0; i < values.size(); i++) {
+		if (values[i] != value) {
+			return false;
+		}
+	}
+	return true;
+}
+
+// A symbol stays polled while any caller holds a subscription, and the poll
+// stops with the last unsubscribe.
+TEST(RestSubscribeRefCount)
+{
+	IBaseOrder* plugin = restPlugin();
+	CHECK(plugin != NULL);
+	if (!plugin) {
+		return;
+	}
+	resetRestServer();
+	const char* eurusd[] = { "EUR/USD", NULL };
+	const char* both[] = { "EUR/USD", "USD/JPY", NULL };
+	vector<string> instruments;
+
+	plugin->subscribe(eurusd);
+	plugin->subscribe(both);
+	polledSymbols(instruments);
+	CHECK(!instruments.empty() && allEqual(instruments, "EUR_USD,USD_JPY"));
+
+	plugin->unsubscribe(both);
+	polledSymbols(instruments);
+	CHECK(!instruments.empty() && allEqual(instruments, "EUR_USD"));
+
+	// More unsubscribes than subscribes do not go below zero.
+	plugin->unsubscribe(both);
+	plugin->unsubscribe(eurusd);
+	polledSymbols(instruments);
+	CHECK(instruments.empty());
+
+	plugin->subscribe(eurusd);
+	polledSymbols(instruments);
+	CHECK(!instruments.empty() && allEqual(instruments, "EUR_USD"));
+	plugin->unsubscribe(eurusd);
+	resetRestServer();
+}
+
+// A one-off getPrice of an unsubscribed symbol fetches it once, and the poll
+// goes back to the subscribed set after it.
+TEST(RestGetPriceRestoresPoll)
+{
+	IBaseOrder* plugin = restPlugin();
+	CHECK(plugin != NULL);
+	if (!plugin) {
+		return;
+	}
+	resetRestServer();
+	const char* eurusd[] = { "EUR/USD", NULL };
+	const char* usdjpy[] = { "USD/JPY", NULL };
+	vector<string> instruments;
+
+	plugin->subscribe(eurusd);
+	polledSymbols(instruments);
+	CHECK(!instruments.empty() && allEqual(instruments, "EUR_USD"));
+
+	restServer()->clearRequests();
+	TblPrice** tblPrices = NULL;
+	int count = plugin->getPrice(usdjpy, &tblPrices);
+	CHECK(count == 1);
+	if (count == 1) {
+		CHECK(strcmp(tblPrices[0]->Symbol, "USD/JPY") == 0);
+		delete tblPrices[0];
+		delete[] tblPrices;
+	}
+	pricedSymbols(instruments);
+	CHECK(std::count(instruments.begin(), instruments.end(), "USD_JPY") == 1);
+
+	polledSymbols(instruments);
+	CHECK(!instruments.empty() && allEqual(instruments, "EUR_USD"));
+	plugin->unsubscribe(eurusd);
+	resetRestServer();
+}
@@ -0,0 +1,118 @@
+﻿/*
+* Copyright 2020 FXDaemon
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include "stdafx.h"
+#include "Thread.h"
+#include "SymbolRegistry.h"
+#include "Test.h"
+
+// IDs are dense in the order symbols are first seen, either spelling finds them,
+// and interning a known symbol again returns its ID.
+TEST(SymbolRegistryIntern)
+{
+	CSymbolRegistry registry;
+	registry.setCombination("_");
+	CHECK(registry.addSymbols(" EUR/USD, USD/JPY ,,EUR/JPY") == 3);
+	CHECK(registry.size() == 3);
+	CHECK(registry.find("EUR/USD") == 0);
+	CHECK(registry.find("USD/JPY") == 1);
+	CHECK(registry.find("EUR/JPY") == 2);
+	CHECK(registry.intern("USD/JPY") == 1);
+	CHECK(registry.internBroker("EUR_JPY") == 2);
+	CHECK(registry.size() == 3);
+
+	CHECK(registry.internBroker("GBP_USD") == 3);
+	CHECK(strcmp(registry.symbol(3), "GBP/USD") == 0);
+	CHECK(registry.intern("AUD/USD") == 4);
+	CHECK(strcmp(registry.brokerSymbol(4), "AUD_USD") == 0);
+	CHECK(registry.intern("") == SYMBOL_INVALID);
+	CHECK(registry.size() == 5);
+}
+
+TEST(SymbolRegistryLookup)
+{
+	CSymbolRegistry registry;
+	registry.setCombination("_");
+	registry.addSymbols("USD/JPY,EUR/USD,XAU/USD,AUD/CAD");
+	for (int id = 0; id < registry.size(); id++) {
+		CHECK(registry.find(registry.symbol(id)) == id);
+		CHECK(registry.findBroker(registry.brokerSymbol(id)) == id);
+	}
+	CHECK(registry.find("EUR_USD") == SYMBOL_INVALID);
+	CHECK(registry.findBroker("EUR/USD") == SYMBOL_INVALID);
+	CHECK(registry.find("GBP/USD") == SYMBOL_INVALID);
+	CHECK(registry.findBroker("") == SYMBOL_INVALID);
+	CHECK(strcmp(registry.symbol(-1), "") == 0);
+	CHECK(strcmp(registry.brokerSymbol(registry.size()), "") == 0);
+}
+
+// A new combination respells the broker side only, the IDs and the strings
+// returned before stay valid.
+TEST(SymbolRegistryRespell)
+{
+	CSymbolRegistry registry;
+	registry.setCombination("_");
+	registry.addSymbols("EUR/USD,USD/JPY");
+	const char* before = registry.brokerSymbol(0);
+
+	registry.setCombination("");
+	CHECK(strcmp(registry.brokerSymbol(0), "EURUSD") == 0);
+	CHECK(strcmp(registry.brokerSymbol(1), "USDJPY") == 0);
+	CHECK(registry.findBroker("USDJPY") == 1);
+	CHECK(registry.findBroker("USD_JPY") == SYMBOL_INVALID);
+	CHECK(registry.find("USD/JPY") == 1);
+	CHECK(strcmp(before, "EUR_USD") == 0);
+
+	// Without a combination the broker spelling is taken as the symbol.
+	CHECK(registry.internBroker("GBPUSD") == 2);
+	CHECK(strcmp(registry.symbol(2), "GBPUSD") == 0);
+
+	registry.setCombination("/");
+	CHECK(strcmp(registry.brokerSymbol(0), "EUR/USD") == 0);
+	CHECK(registry.findBroker("EUR/USD") == 0);
+}
+
+static void internProcess(void* pv)
+{
+	CSymbolRegistry* registry = (CSymbolRegistry*)pv;
+	char symbol[16];
+	for (int i = 0; i < 200; i++) {
+		sprintf(symbol, "S%03d/USD", i);
+		registry->intern(symbol);
+	}
+}
+
+// Threads interning the same symbols at once give each one ID.
+TEST(SymbolRegistryConcurrentIntern)
+{
+	CSymbolRegistry registry;
+	ThreadFunAttr threadFunAttr = { internProcess, &registry };
+	vector<CThread*> threads;
+	for (int i = 0; i < 4; i++) {
+		threads.push_back(new CThread(threadFunAttr));
+		threads.back()->_start();
+	}
+	for (size_t i = 0; i < threads.size(); i++) {
+		threads[i]->join();
+		delete threads[i];
+	}
+	CHECK(registry.size() == 200);
+	set<string> symbols;
+	for (int id = 0; id < registry.size(); id++) {
+		symbols.insert(registry.symbol(id));
+		CHECK(registry.find(registry.symbol(id)) == id);
+	}
+	CHECK(symbols.size() == 200);
+}
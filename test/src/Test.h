@@ -0,0 +1,36 @@
+#ifndef TEST_H
+#define TEST_H
+
+#include <math.h>
+
+typedef void (*_testFunction)();
+
+// Test cases register themselves at static init, in the order of the file.
+class CTestCase
+{
+private:
+	const char* m_sName;
+	_testFunction m_fpTest;
+	CTestCase* m_pNext;
+	static CTestCase* m_pFirst;
+	static CTestCase* m_pLast;
+	static int m_nFailures;
+
+public:
+	CTestCase(const char* name, _testFunction test);
+
+	static int runAll(const char* filter);
+	static void fail(const char* file, int line, const char* expr);
+};
+
+#define TEST(name) \
+	static void name(); \
+	static CTestCase name##Case(#name, name); \
+	static void name()
+
+#define CHECK(expr) \
+	do { if (!(expr)) CTestCase::fail(__FILE__, __LINE__, #expr); } while (0)
+
+#define CHECK_NEAR(a, b, eps) CHECK(fabs((double)(a) - (double)(b)) <= (eps))
+
+#endif
@@ -0,0 +1,69 @@
+﻿/*
+* Copyright 2020 FXDaemon
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include "stdafx.h"
+#include "Test.h"
+
+CTestCase* CTestCase::m_pFirst = NULL;
+CTestCase* CTestCase::m_pLast = NULL;
+int CTestCase::m_nFailures = 0;
+
+CTestCase::CTestCase(const char* name, _testFunction test)
+{
+	m_sName = name;
+	m_fpTest = test;
+	m_pNext = NULL;
+	if (m_pLast) {
+		m_pLast->m_pNext = this;
+	}
+	else {
+		m_pFirst = this;
+	}
+	m_pLast = this;
+}
+
+// Runs the cases whose name contains filter, returns the number that failed.
+int CTestCase::runAll(const char* filter)
+{
+	int run = 0, failed = 0;
+	for (CTestCase* test = m_pFirst; test; test = test->m_pNext) {
+		if (filter && !strstr(test->m_sName, filter)) {
+			continue;
+		}
+		int failures = m_nFailures;
+		test->m_fpTest();
+		run++;
+		if (m_nFailures != failures) {
+			printf("FAILED  %s\n", test->m_sName);
+			failed++;
+		}
+		else {
+			printf("ok      %s\n", test->m_sName);
+		}
+	}
+	printf("%d tests, %d failed\n", run, failed);
+	return failed;
+}
+
+void CTestCase::fail(const char* file, int line, const char* expr)
+{
+	printf("%s:%d: CHECK(%s)\n", file, line, expr);
+	m_nFailures++;
+}
+
+int main(int argc, char* argv[])
+{
+	return CTestCase::runAll(argc > 1 ? argv[1] : NULL) == 0 ? 0 : 1;
+}
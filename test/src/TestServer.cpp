@@ -0,0 +1,197 @@
+﻿/*
+* Copyright 2020 FXDaemon
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include "stdafx.h"
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <thread>
+#include "IBaseOrder.h"
+#include "TestServer.h"
+
+CTestServer::CTestServer() : m_nListenFd(-1), m_nPort(0), m_fpHandler(NULL), m_pContext(NULL)
+{
+}
+
+CTestServer::~CTestServer()
+{
+	if (m_nListenFd >= 0) {
+		shutdown(m_nListenFd, SHUT_RDWR);
+		::close(m_nListenFd);
+	}
+}
+
+// Binds a port the kernel picks; the accept thread runs for the life of the process.
+int CTestServer::start()
+{
+	signal(SIGPIPE, SIG_IGN);
+	m_nListenFd = socket(AF_INET, SOCK_STREAM, 0);
+	if (m_nListenFd < 0) {
+		return RET_FAILED;
+	}
+	struct sockaddr_in addr;
+	memset(&addr, 0, sizeof(addr));
+	addr.sin_family = AF_INET;
+	addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	addr.sin_port = 0;
+	socklen_t len = sizeof(addr);
+	if (bind(m_nListenFd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(m_nListenFd, 64) != 0
+		|| getsockname(m_nListenFd, (struct sockaddr*)&addr, &len) != 0) {
+		::close(m_nListenFd);
+		m_nListenFd = -1;
+		return RET_FAILED;
+	}
+	m_nPort = ntohs(addr.sin_port);
+	std::thread(acceptProcess, this).detach();
+	return RET_SUCCESS;
+}
+
+void CTestServer::setHandler(_requestHandler handler, void* context)
+{
+	CCriticalSection::Lock l(m_csHandler);
+	m_fpHandler = handler;
+	m_pContext = context;
+}
+
+// Requests of the method whose path contains the given part.
+int CTestServer::count(const char* method, const char* path)
+{
+	CCriticalSection::Lock l(m_csHandler);
+	int n = 0;
+	for (size_t i = 0; i < m_vtRequests.size(); i++) {
+		if (m_vtRequests[i].Method == method && m_vtRequests[i].Path.find(path) != string::npos) {
+			n++;
+		}
+	}
+	return n;
+}
+
+void CTestServer::getRequests(vector<TestRequest>& requests)
+{
+	CCriticalSection::Lock l(m_csHandler);
+	requests = m_vtRequests;
+}
+
+void CTestServer::clearRequests()
+{
+	CCriticalSection::Lock l(m_csHandler);
+	m_vtRequests.clear();
+}
+
+void CTestServer::acceptProcess(CTestServer* server)
+{
+	int on = 1;
+	while (true) {
+		int fd = accept(server->m_nListenFd, NULL, NULL);
+		if (fd < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			break;
+		}
+		setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+		std::thread(connectionProcess, server, fd).detach();
+	}
+}
+
+void CTestServer::connectionProcess(CTestServer* server, int fd)
+{
+	server->serve(fd);
+	::close(fd);
+}
+
+// The handler runs without the lock, it may block until the test releases it.
+void CTestServer::serve(int fd)
+{
+	string buffer;
+	TestRequest request;
+	while (readRequest(fd, buffer, request)) {
+		_requestHandler handler;
+		void* context;
+		{
+			CCriticalSection::Lock l(m_csHandler);
+			m_vtRequests.push_back(request);
+			handler = m_fpHandler;
+			context = m_pContext;
+		}
+		string body;
+		int status = handler ? handler(request, body, context) : 0;
+		if (status == 0) {
+			status = 404;
+			body = "{\"errorMessage\":\"Unknown path " + request.Path + "\"}";
+		}
+
+		char head[256];
+		snprintf(head, sizeof(head), "HTTP/1.1 %d %s\r\nContent-Type: application/json\r\nContent-Length: %zu\r\n\r\n",
+			status, status == 200 ? "OK" : "Error", body.size());
+		string response = head + body;
+		size_t sent = 0;
+		while (sent < response.size()) {
+			ssize_t n = send(fd, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+			if (n <= 0) {
+				return;
+			}
+			sent += n;
+		}
+	}
+}
+
+bool CTestServer::readRequest(int fd, string& buffer, TestRequest& request)
+{
+	size_t end;
+	while ((end = buffer.find("\r\n\r\n")) == string::npos) {
+		char chunk[4096];
+		ssize_t n = recv(fd, chunk, sizeof(chunk), 0);
+		if (n <= 0) {
+			return false;
+		}
+		buffer.append(chunk, n);
+	}
+
+	string head = buffer.substr(0, end);
+	size_t sp1 = head.find(' ');
+	size_t sp2 = sp1 == string::npos ? string::npos : head.find(' ', sp1 + 1);
+	if (sp2 == string::npos) {
+		return false;
+	}
+	request.Method = head.substr(0, sp1);
+	string target = head.substr(sp1 + 1, sp2 - sp1 - 1);
+	size_t q = target.find('?');
+	request.Path = target.substr(0, q);
+	request.Query = q == string::npos ? "" : target.substr(q + 1);
+
+	size_t length = 0;
+	size_t pos = 0;
+	while ((pos = head.find("\r\n", pos)) != string::npos) {
+		pos += 2;
+		if (strncasecmp(head.c_str() + pos, "Content-Length:", 15) == 0) {
+			length = strtoul(head.c_str() + pos + 15, NULL, 10);
+		}
+	}
+
+	buffer.erase(0, end + 4);
+	while (buffer.size() < length) {
+		char chunk[4096];
+		ssize_t n = recv(fd, chunk, sizeof(chunk), 0);
+		if (n <= 0) {
+			return false;
+		}
+		buffer.append(chunk, n);
+	}
+	request.Body = buffer.substr(0, length);
+	buffer.erase(0, length);
+	return true;
+}
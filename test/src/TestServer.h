@@ -0,0 +1,47 @@
+#ifndef TESTSERVER_H
+#define TESTSERVER_H
+
+#include "CriticalSection.h"
+
+typedef struct {
+	string Method;
+	string Path;
+	string Query;
+	string Body;
+} TestRequest;
+
+// Returns the HTTP status of the answer put in body, 0 when the request is not handled.
+typedef int (*_requestHandler)(const TestRequest& request, string& body, void* context);
+
+// An HTTP/1.1 server on a free port of 127.0.0.1 that answers from the handler a
+// test sets, one thread per connection, so a handler may block one request while
+// others are served. Requests left unhandled are answered 404. Every request is logged.
+class CTestServer
+{
+private:
+	int m_nListenFd;
+	int m_nPort;
+	_requestHandler m_fpHandler;
+	void* m_pContext;
+	vector<TestRequest> m_vtRequests;
+	CCriticalSection m_csHandler;
+
+public:
+	CTestServer();
+	~CTestServer();
+
+	int start();
+	int getPort() const { return m_nPort; }
+	void setHandler(_requestHandler handler, void* context);
+	int count(const char* method, const char* path);
+	void getRequests(vector<TestRequest>& requests);
+	void clearRequests();
+
+private:
+	static void acceptProcess(CTestServer* server);
+	static void connectionProcess(CTestServer* server, int fd);
+	void serve(int fd);
+	static bool readRequest(int fd, string& buffer, TestRequest& request);
+};
+
+#endif
@@ -0,0 +1,125 @@
+﻿/*
+* Copyright 2020 FXDaemon
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include "stdafx.h"
+#include "TickJournal.h"
+#include "Test.h"
+
+// 2024-12-20 00:00 UTC
+static const int64_t Dec20Ns = 1734652800LL * 1000000000LL;
+static const int64_t NsPerDay = 86400LL * 1000000000LL;
+
+static string newJournalPath()
+{
+	char path[] = "/tmp/tickjournal-XXXXXX";
+	if (!mkdtemp(path)) {
+		return "";
+	}
+	return string(path) + "/";
+}
+
+static void removeJournalPath(const string& path)
+{
+	string cmd = "rm -rf " + path;
+	if (system(cmd.c_str()) != 0) {
+		printf("can't remove %s\n", path.c_str());
+	}
+}
+
+static TblPrice newPrice(const char* symbol, double bid, double ask, int64_t timeNs)
+{
+	TblPrice tblPrice;
+	memset(&tblPrice, 0, sizeof(tblPrice));
+	strcpy(tblPrice.Symbol, symbol);
+	tblPrice.Bid = bid;
+	tblPrice.Ask = ask;
+	tblPrice.Time = (time_t)(timeNs / 1000000000);
+	if (timeNs % 1000000000 != 0) {
+		setTimeExt(&tblPrice, timeNs, 0, 0);
+	}
+	return tblPrice;
+}
+
+// Ticks read back with their symbols, nanosecond server times and receive order.
+TEST(TickJournalRoundTrip)
+{
+	string path = newJournalPath();
+	CHECK(!path.empty());
+	{
+		CTickJournal journal(path.c_str(), 16, 1000);
+		for (int i = 0; i < 6; i++) {
+			TblPrice tblPrice = newPrice(i % 2 ? "USD/JPY" : "EUR/USD", 1.1 + i, 1.2 + i, Dec20Ns + i * 1000 + 7);
+			journal.append(&tblPrice, Dec20Ns + i * 1000000);
+		}
+		TblPrice tblPrice = newPrice("EUR/USD", 1.0, 1.1, Dec20Ns + 5000000000LL);
+		journal.append(&tblPrice, Dec20Ns + 6 * 1000000);
+		journal.stop();
+	}
+
+	CTickJournalReader reader;
+	CHECK(reader.open(path.c_str(), Dec20Ns / NsPerDay));
+	CHECK(reader.size() == 7);
+	CHECK(strcmp(reader.getSymbol(0), "EUR/USD") == 0);
+	CHECK(strcmp(reader.getSymbol(1), "USD/JPY") == 0);
+	CHECK(reader.getSymbolID("USD/JPY") == 1 && reader.getSymbolID("GBP/USD") == -1);
+	const TickRecord* record = reader.get(3);
+	CHECK(record && record->SymbolID == 1 && record->Bid == 4.1 && record->Ask == 4.2);
+	CHECK(record->ServerTimeNs == Dec20Ns + 3007 && record->RecvTimeNs == Dec20Ns + 3000000);
+	CHECK(reader.get(6)->ServerTimeNs == Dec20Ns + 5000000000LL);
+	CHECK(reader.get(7) == NULL);
+
+	CHECK(reader.seek(Dec20Ns) == 0);
+	CHECK(reader.seek(Dec20Ns + 2500000) == 3);
+	CHECK(reader.seek(Dec20Ns + NsPerDay) == 7);
+	const vector<uint64_t>* index = reader.getIndex(1);
+	CHECK(index && index->size() == 3 && (*index)[0] == 1 && (*index)[2] == 5);
+	reader.close();
+	removeJournalPath(path);
+}
+
+// A journal reopened on the same day continues it, past the capacity ticks are dropped,
+// and a new UTC day starts a file of its own.
+TEST(TickJournalReopenAndRollOver)
+{
+	string path = newJournalPath();
+	TblPrice eur = newPrice("EUR/USD", 1.1, 1.2, Dec20Ns);
+	TblPrice jpy = newPrice("USD/JPY", 150.1, 150.2, Dec20Ns);
+	{
+		CTickJournal journal(path.c_str(), 4, 1000);
+		journal.append(&eur, Dec20Ns + 1);
+		journal.append(&jpy, Dec20Ns + 2);
+	}
+	{
+		CTickJournal journal(path.c_str(), 4, 1000);
+		journal.append(&jpy, Dec20Ns + 3);
+		journal.append(&eur, Dec20Ns + 4);
+		journal.append(&eur, Dec20Ns + 5);
+		CHECK(journal.getDropped() == 1);
+		journal.append(&eur, Dec20Ns + NsPerDay + 1);
+		journal.stop();
+	}
+
+	CTickJournalReader reader;
+	CHECK(reader.open(path.c_str(), Dec20Ns / NsPerDay));
+	CHECK(reader.size() == 4);
+	CHECK((int)reader.get(2)->SymbolID == reader.getSymbolID("USD/JPY"));
+	CHECK((int)reader.get(3)->SymbolID == reader.getSymbolID("EUR/USD"));
+	CHECK(reader.getIndex(0)->size() == 2);
+	CHECK(reader.open(path.c_str(), Dec20Ns / NsPerDay + 1));
+	CHECK(reader.size() == 1 && strcmp(reader.getSymbol(0), "EUR/USD") == 0);
+	CHECK(!reader.open(path.c_str(), Dec20Ns / NsPerDay + 2));
+	reader.close();
+	removeJournalPath(path);
+}
@@ -0,0 +1,73 @@
+﻿/*
+* Copyright 2020 FXDaemon
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include "stdafx.h"
+#include <stddef.h>
+#include "IBaseOrder.h"
+#include "Test.h"
+
+// The extension fills the last 32 bytes of Reserve; hosts built before it see
+// the same struct.
+TEST(TimeExtLayout)
+{
+	CHECK(sizeof(TblTimeExt) == 32);
+	CHECK(offsetof(TblTimeExt, Tag) == 0);
+	CHECK(offsetof(TblTimeExt, TimeNs) == 8);
+	CHECK(offsetof(TblTimeExt, CloseTimeNs) == 16);
+	CHECK(offsetof(TblTimeExt, RecvNs) == 24);
+	CHECK(sizeof(((TblPrice*)0)->Reserve) == 120);
+	CHECK(sizeof(((TblOrder*)0)->Reserve) == 120);
+	CHECK(sizeof(((TblTrade*)0)->Reserve) == 120);
+}
+
+// The values come back, the tag sits at the start of the last 32 bytes, and the
+// text before them stays a terminated string.
+TEST(TimeExtRoundTrip)
+{
+	TblPrice tblPrice;
+	memset(&tblPrice, 'x', sizeof(tblPrice));
+	strcpy(tblPrice.Reserve, "host text");
+	setTimeExt(&tblPrice, 1700000000123456789LL, 0, 1700000000200000000LL);
+
+	TblTimeExt ext;
+	CHECK(getTimeExt(&tblPrice, &ext));
+	CHECK(ext.TimeNs == 1700000000123456789LL);
+	CHECK(ext.CloseTimeNs == 0);
+	CHECK(ext.RecvNs == 1700000000200000000LL);
+	CHECK(memcmp(tblPrice.Reserve + sizeof(tblPrice.Reserve) - 32, TIME_EXT_TAG, 4) == 0);
+	CHECK(strcmp(tblPrice.Reserve, "host text") == 0);
+
+	// A Reserve filled with text up to the end is cut before the extension.
+	memset(tblPrice.Reserve, 'y', sizeof(tblPrice.Reserve));
+	setTimeExt(&tblPrice, 1, 2, 3);
+	CHECK(strlen(tblPrice.Reserve) == sizeof(tblPrice.Reserve) - 33);
+	CHECK(getTimeExt(&tblPrice, &ext) && ext.TimeNs == 1 && ext.CloseTimeNs == 2 && ext.RecvNs == 3);
+
+	TblTrade tblTrade;
+	memset(&tblTrade, 0, sizeof(tblTrade));
+	setTimeExt(&tblTrade, 10, 20, 30);
+	CHECK(getTimeExt(&tblTrade, &ext) && ext.TimeNs == 10 && ext.CloseTimeNs == 20 && ext.RecvNs == 30);
+}
+
+// Tables from plugins that don't stamp them read as having no extension.
+TEST(TimeExtAbsent)
+{
+	TblOrder tblOrder;
+	memset(&tblOrder, 0, sizeof(tblOrder));
+	TblTimeExt ext;
+	CHECK(!getTimeExt(&tblOrder, &ext));
+	memset(tblOrder.Reserve, 'T', sizeof(tblOrder.Reserve));
+	CHECK(!getTimeExt(&tblOrder, &ext));
+}
@@ -0,0 +1,196 @@
+﻿/*
+* Copyright 2020 FXDaemon
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include "stdafx.h"
+#include "TrailingStop.h"
+#include "Test.h"
+
+// Records the stop changes, fails the next Failures calls and hands out a
+// stop order ID to trades that have none.
+class CStopRecorder : public IBaseOrder
+{
+public:
+	vector<vector<TblTrade> > m_vtCalls;
+	int m_nFailures;
+
+	CStopRecorder() : m_nFailures(0) {}
+
+	int init(const char* /*iniFile*/) { return RET_SUCCESS; }
+	int login() { return RET_SUCCESS; }
+	int close() { return RET_SUCCESS; }
+	time_t getServerTime() { return 0; }
+	int getAccount(const char* /*accountID*/, TblAccount** /*tblAccount*/) { return RET_FAILED; }
+	int getPrice(const char* /*symbols*/[], TblPrice** /*pTblPrice*/[]) { return RET_FAILED; }
+	int getOpenedTrades(TblTrade** /*pTblTrade*/[]) { return RET_FAILED; }
+	int getClosedTrades(TblTrade** /*pTblTrade*/[]) { return RET_FAILED; }
+	int getHistoricalData(const char* /*symbol*/, const char* /*period*/, time_t /*start*/, time_t /*end*/, bool /*maxRange*/, TblCandle** /*pTblCandle*/[]) { return RET_FAILED; }
+	int openMarketOrder(TblOrder* /*tblOrder*/) { return RET_FAILED; }
+	int changeStopLoss(TblTrade* /*tblTrade*/) { return RET_FAILED; }
+	int changeTakeProfit(TblTrade* /*tblTrade*/) { return RET_FAILED; }
+	int closeTrade(TblTrade* /*tblTrade*/) { return RET_FAILED; }
+	int openMarketOrders(TblOrder* /*tblOrders*/[]) { return RET_FAILED; }
+	int changeTakeProfits(TblTrade* /*tblTrades*/[]) { return RET_FAILED; }
+	int closeTrades(TblTrade* /*tblTrades*/[]) { return RET_FAILED; }
+	int getDepth(const char* /*symbol*/, TblDepth** /*tblDepth*/) { return RET_FAILED; }
+	int setTrailingStop(TblTrade* /*tblTrade*/, double /*distance*/, double /*step*/) { return RET_FAILED; }
+	int removeTrailingStop(TblTrade* /*tblTrade*/) { return RET_FAILED; }
+	int subscribe(const char* /*symbols*/[]) { return RET_SUCCESS; }
+	int unsubscribe(const char* /*symbols*/[]) { return RET_SUCCESS; }
+
+	int changeStopLosses(TblTrade* tblTrades[])
+	{
+		vector<TblTrade> call;
+		int count = 0;
+		for (; tblTrades[count]; count++) {
+			if (strlen(tblTrades[count]->StopOrderID) == 0) {
+				strcpy(tblTrades[count]->StopOrderID, (string("S") + tblTrades[count]->TradeID).c_str());
+			}
+			call.push_back(*tblTrades[count]);
+		}
+		m_vtCalls.push_back(call);
+		if (m_nFailures > 0) {
+			m_nFailures--;
+			return 0;
+		}
+		return count;
+	}
+};
+
+static TblTrade newTrade(const char* tradeID, const char* symbol, const char* bs)
+{
+	TblTrade tblTrade;
+	memset(&tblTrade, 0, sizeof(tblTrade));
+	strcpy(tblTrade.TradeID, tradeID);
+	strcpy(tblTrade.Symbol, symbol);
+	strcpy(tblTrade.BS, bs);
+	tblTrade.Amount = 10000;
+	return tblTrade;
+}
+
+static TblPrice newPrice(const char* symbol, double bid, double ask)
+{
+	TblPrice tblPrice;
+	memset(&tblPrice, 0, sizeof(tblPrice));
+	strcpy(tblPrice.Symbol, symbol);
+	tblPrice.Bid = bid;
+	tblPrice.Ask = ask;
+	return tblPrice;
+}
+
+// A buy stop follows the bid at Distance and only moves up, by at least Step.
+TEST(TrailingStopBuyFollowsBid)
+{
+	CStopRecorder recorder;
+	CTrailingStop trailingStop(&recorder);
+	TblTrade tblTrade = newTrade("1", "EUR/USD", "B");
+	CHECK(trailingStop.add(&tblTrade, 0.0020, 0.0005) == RET_SUCCESS);
+
+	TblPrice tblPrice = newPrice("EUR/USD", 1.1000, 1.1002);
+	CHECK(trailingStop.onPrice(&tblPrice));
+	CHECK(trailingStop.flush() == 1);
+	CHECK_NEAR(recorder.m_vtCalls.back()[0].Stop, 1.0980, 1e-9);
+
+	tblPrice.Bid = 1.1003;
+	CHECK(!trailingStop.onPrice(&tblPrice));
+	tblPrice.Bid = 1.0990;
+	CHECK(!trailingStop.onPrice(&tblPrice));
+	CHECK(trailingStop.flush() == 0);
+
+	tblPrice.Bid = 1.1006;
+	CHECK(trailingStop.onPrice(&tblPrice));
+	CHECK(trailingStop.flush() == 1);
+	CHECK(recorder.m_vtCalls.size() == 2);
+	CHECK_NEAR(recorder.m_vtCalls.back()[0].Stop, 1.0986, 1e-9);
+}
+
+// A sell stop follows the ask from above.
+TEST(TrailingStopSellFollowsAsk)
+{
+	CStopRecorder recorder;
+	CTrailingStop trailingStop(&recorder);
+	TblTrade tblTrade = newTrade("1", "USD/JPY", "S");
+	tblTrade.Stop = 150.50;
+	trailingStop.add(&tblTrade, 0.30, 0.05);
+
+	TblPrice tblPrice = newPrice("USD/JPY", 150.00, 150.02);
+	CHECK(trailingStop.onPrice(&tblPrice));
+	CHECK(trailingStop.flush() == 1);
+	CHECK_NEAR(recorder.m_vtCalls.back()[0].Stop, 150.32, 1e-9);
+
+	tblPrice.Ask = 149.99;
+	CHECK(!trailingStop.onPrice(&tblPrice));
+	tblPrice.Ask = 149.90;
+	CHECK(trailingStop.onPrice(&tblPrice));
+	trailingStop.flush();
+	CHECK_NEAR(recorder.m_vtCalls.back()[0].Stop, 150.20, 1e-9);
+}
+
+// Moves between two sends collapse into one change with the latest stop.
+TEST(TrailingStopCoalescesMoves)
+{
+	CStopRecorder recorder;
+	CTrailingStop trailingStop(&recorder);
+	TblTrade tblTrade = newTrade("1", "EUR/USD", "B");
+	trailingStop.add(&tblTrade, 0.0020, 0);
+	tblTrade = newTrade("2", "EUR/USD", "B");
+	trailingStop.add(&tblTrade, 0.0010, 0);
+
+	TblPrice tblPrice = newPrice("EUR/USD", 1.1000, 1.1002);
+	for (int i = 0; i < 5; i++) {
+		tblPrice.Bid += 0.0001;
+		trailingStop.onPrice(&tblPrice);
+	}
+	CHECK(trailingStop.flush() == 2);
+	CHECK(recorder.m_vtCalls.size() == 1);
+	CHECK(recorder.m_vtCalls[0].size() == 2);
+	CHECK_NEAR(recorder.m_vtCalls[0][0].Stop, 1.0985, 1e-9);
+	CHECK_NEAR(recorder.m_vtCalls[0][1].Stop, 1.0995, 1e-9);
+}
+
+// A failed change stays due with the stop order ID it got, and is sent again without a new price.
+TEST(TrailingStopRetriesFailedChange)
+{
+	CStopRecorder recorder;
+	CTrailingStop trailingStop(&recorder);
+	TblTrade tblTrade = newTrade("1", "EUR/USD", "B");
+	trailingStop.add(&tblTrade, 0.0020, 0.0005);
+
+	recorder.m_nFailures = 1;
+	TblPrice tblPrice = newPrice("EUR/USD", 1.1000, 1.1002);
+	trailingStop.onPrice(&tblPrice);
+	CHECK(trailingStop.flush() == 0);
+
+	CHECK(trailingStop.flush() == 1);
+	CHECK(recorder.m_vtCalls.size() == 2);
+	CHECK_NEAR(recorder.m_vtCalls[1][0].Stop, 1.0980, 1e-9);
+	CHECK(strcmp(recorder.m_vtCalls[1][0].StopOrderID, "S1") == 0);
+	CHECK(trailingStop.flush() == 0);
+}
+
+TEST(TrailingStopRemove)
+{
+	CStopRecorder recorder;
+	CTrailingStop trailingStop(&recorder);
+	TblTrade tblTrade = newTrade("1", "EUR/USD", "B");
+	trailingStop.add(&tblTrade, 0.0020, 0.0005);
+	CHECK(trailingStop.add(&tblTrade, 0, 0.0005) == RET_FAILED);
+	CHECK(trailingStop.remove("1") == RET_SUCCESS);
+	CHECK(trailingStop.remove("1") == RET_FAILED);
+
+	TblPrice tblPrice = newPrice("EUR/USD", 1.1000, 1.1002);
+	CHECK(!trailingStop.onPrice(&tblPrice));
+	CHECK(trailingStop.flush() == 0);
+	CHECK(recorder.m_vtCalls.empty());
+}
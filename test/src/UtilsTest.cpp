@@ -0,0 +1,73 @@
+﻿/*
+* Copyright 2020 FXDaemon
+*
+* Licensed under the Apache License, Version 2.0 (the "License");
+* you may not use this file except in compliance with the License.
+* You may obtain a copy of the License at
+*
+*      http://www.apache.org/licenses/LICENSE-2.0
+*
+* Unless required by applicable law or agreed to in writing, software
+* distributed under the License is distributed on an "AS IS" BASIS,
+* WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+* See the License for the specific language governing permissions and
+* limitations under the License.
+*/
+#include "stdafx.h"
+#include "Utils.h"
+#include "Test.h"
+
+// Seconds of every formatted time parse back to the time_t, over 1970-2099
+// including leap days, and agree with the mktime path of str2Time.
+TEST(RFC3339MatchesCalendar)
+{
+	setenv("TZ", "UTC", 1);
+	tzset();
+	int mismatches = 0;
+	for (int64_t t = 0; t < 4102444800LL; t += 86400 * 7 + 3623) {
+		string s = CUtils::strOfTimeWithRFC3339((time_t)t);
+		int64_t ns = 0;
+		if (!CUtils::parseRFC3339Ns((s + "Z").c_str(), &ns) || ns != t * 1000000000) {
+			mismatches++;
+			continue;
+		}
+		string slashed = CUtils::strOfTime((time_t)t, "%Y/%m/%d %H:%M:%S");
+		if (CUtils::str2Time(slashed.c_str()) != (time_t)t) {
+			mismatches++;
+		}
+	}
+	CHECK(mismatches == 0);
+
+	int64_t ns = 0;
+	CHECK(CUtils::parseRFC3339Ns("2024-02-29T23:59:59Z", &ns));
+	CHECK(ns == 1709251199LL * 1000000000);
+	CHECK(CUtils::parseRFC3339Ns("2000-03-01 00:00:00", &ns));
+	CHECK(ns == 951868800LL * 1000000000);
+}
+
+TEST(RFC3339Fraction)
+{
+	int64_t ns = 0;
+	CHECK(CUtils::parseRFC3339Ns("2016-12-27T13:25:49.123456789Z", &ns));
+	CHECK(ns == 1482845149123456789LL);
+	CHECK(CUtils::parseRFC3339Ns("2016-12-27T13:25:49.5Z", &ns));
+	CHECK(ns == 1482845149500000000LL);
+	// Digits past nanoseconds are dropped, not rounded.
+	CHECK(CUtils::parseRFC3339Ns("2016-12-27T13:25:49.123456789999Z", &ns));
+	CHECK(ns == 1482845149123456789LL);
+
+	CHECK(CUtils::str2TimeNs("2016-12-27T13:25:49.000000001Z") == 1482845149000000001LL);
+	CHECK(CUtils::str2Time("2016-12-27T13:25:49.999999999Z") == 1482845149);
+}
+
+TEST(RFC3339Malformed)
+{
+	int64_t ns = 0;
+	CHECK(!CUtils::parseRFC3339Ns("2016-13-27T13:25:49Z", &ns));
+	CHECK(!CUtils::parseRFC3339Ns("2016-12-27T24:00:00Z", &ns));
+	CHECK(!CUtils::parseRFC3339Ns("2016-12-27T13:25:49.Z", &ns));
+	CHECK(!CUtils::parseRFC3339Ns("2016-12-27T13:25:49+09:00", &ns));
+	CHECK(!CUtils::parseRFC3339Ns("2016-12-27", &ns));
+	CHECK(!CUtils::parseRFC3339Ns("", &ns));
+	CHECK(CUtils::str2TimeNs("not a time") == 0);
+}